@@ -220,6 +220,9 @@ AC_TRY_COMPILE([#include <sys/stat.h>],[struct stat t;
 dnl See if we have the removefile(3) function for securely removing files
 AC_CHECK_FUNCS(removefile)
 
+dnl See if we have the splice(2) function for moving data between descriptors
+AC_CHECK_FUNCS(splice)
+
 dnl See if we have libusb...
 AC_ARG_ENABLE(libusb, [  --enable-libusb         use libusb for USB printing])
 
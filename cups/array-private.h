@@ -39,6 +39,10 @@ extern "C" {
 
 extern int		_cupsArrayAddStrings(cups_array_t *a, const char *s)
 			                     _CUPS_API_1_5;
+extern cups_array_t	*_cupsArrayNewLarge(cups_array_func_t f, void *d,
+			                   cups_ahash_func_t h, int hsize,
+					   cups_acopy_func_t cf,
+					   cups_afree_func_t ff) _CUPS_API_1_7;
 extern cups_array_t	*_cupsArrayNewStrings(const char *s) _CUPS_API_1_5;
 
 #  ifdef __cplusplus
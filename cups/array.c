@@ -34,6 +34,7 @@
  *   cupsArrayNew()         - Create a new array.
  *   cupsArrayNew2()        - Create a new array with hash.
  *   cupsArrayNew3()        - Create a new array with hash and/or free function.
+ *   _cupsArrayNewLarge()   - Create a new array for large numbers of elements.
  *   _cupsArrayNewStrings() - Create a new array of comma-delimited strings.
  *   cupsArrayNext()        - Get the next element in the array.
  *   cupsArrayPrev()        - Get the previous element in the array.
@@ -44,7 +45,11 @@
  *                            cupsArrayRestore@.
  *   cupsArrayUserData()    - Return the user data for an array.
  *   cups_array_add()       - Insert or append an element to the array.
+ *   cups_array_block()     - Find the block containing an element.
+ *   cups_array_element()   - Get an element from a large array.
  *   cups_array_find()      - Find an element in the array.
+ *   cups_array_insert_at() - Insert an element at an index.
+ *   cups_array_remove_at() - Remove the element at an index.
  */
 
 /*
@@ -61,12 +66,21 @@
  */
 
 #define _CUPS_MAXSAVE	32		/**** Maximum number of saves ****/
+#define _CUPS_ABLOCK	256		/**** Elements per large array block ****/
 
 
 /*
  * Types and structures...
  */
 
+typedef struct _cups_ablock_s		/**** Block of large array elements ****/
+{
+  int			first,		/* Index of first element in block */
+			count;		/* Number of elements in block */
+  void			*elements[_CUPS_ABLOCK];
+					/* Elements */
+} _cups_ablock_t;
+
 struct _cups_array_s			/**** CUPS array structure ****/
 {
  /*
@@ -74,6 +88,10 @@ struct _cups_array_s			/**** CUPS array structure ****/
   * sorted pointers.  We leave the array type private/opaque so that we
   * can change the underlying implementation without affecting the users
   * of this API.
+  *
+  * Arrays created with _cupsArrayNewLarge() keep the pointers in a list of
+  * fixed-size blocks instead, so that inserts and removals only move the
+  * pointers in one block plus the block list.
   */
 
   int			num_elements,	/* Number of array elements */
@@ -92,15 +110,32 @@ struct _cups_array_s			/**** CUPS array structure ****/
 			*hash;		/* Hash array */
   cups_acopy_func_t	copyfunc;	/* Copy function */
   cups_afree_func_t	freefunc;	/* Free function */
+  int			large,		/* Use blocks for elements? */
+			num_blocks,	/* Number of blocks */
+			alloc_blocks,	/* Allocated block pointers */
+			last_block;	/* Last block used */
+  _cups_ablock_t	**blocks;	/* Blocks of elements */
 };
 
 
+/*
+ * Macros...
+ */
+
+#define _CUPS_ELEMENT(a,n) ((a)->large ? cups_array_element((a), (n)) : \
+                                         (a)->elements[n])
+
+
 /*
  * Local functions...
  */
 
 static int	cups_array_add(cups_array_t *a, void *e, int insert);
+static int	cups_array_block(cups_array_t *a, int n);
+static void	*cups_array_element(cups_array_t *a, int n);
 static int	cups_array_find(cups_array_t *a, void *e, int prev, int *rdiff);
+static int	cups_array_insert_at(cups_array_t *a, int n, void *e);
+static void	cups_array_remove_at(cups_array_t *a, int n);
 
 
 /*
@@ -222,17 +257,25 @@ cupsArrayClear(cups_array_t *a)		/* I - Array */
   if (a->freefunc)
   {
     int		i;			/* Looping var */
-    void	**e;			/* Current element */
 
-    for (i = a->num_elements, e = a->elements; i > 0; i --, e ++)
-      (a->freefunc)(*e, a->data);
+    for (i = 0; i < a->num_elements; i ++)
+      (a->freefunc)(_CUPS_ELEMENT(a, i), a->data);
   }
 
  /*
   * Set the number of elements to 0; we don't actually free the memory
-  * here - that is done in cupsArrayDelete()...
+  * here - that is done in cupsArrayDelete() - except for the blocks of large
+  * arrays...
   */
 
+  if (a->large)
+  {
+    while (a->num_blocks > 0)
+      free(a->blocks[-- a->num_blocks]);
+
+    a->last_block = 0;
+  }
+
   a->num_elements = 0;
   a->current      = -1;
   a->insert       = -1;
@@ -289,7 +332,7 @@ cupsArrayCurrent(cups_array_t *a)	/* I - Array */
   */
 
   if (a->current >= 0 && a->current < a->num_elements)
-    return (a->elements[a->current]);
+    return (_CUPS_ELEMENT(a, a->current));
   else
     return (NULL);
 }
@@ -322,10 +365,9 @@ cupsArrayDelete(cups_array_t *a)	/* I - Array */
   if (a->freefunc)
   {
     int		i;			/* Looping var */
-    void	**e;			/* Current element */
 
-    for (i = a->num_elements, e = a->elements; i > 0; i --, e ++)
-      (a->freefunc)(*e, a->data);
+    for (i = 0; i < a->num_elements; i ++)
+      (a->freefunc)(_CUPS_ELEMENT(a, i), a->data);
   }
 
  /*
@@ -335,6 +377,14 @@ cupsArrayDelete(cups_array_t *a)	/* I - Array */
   if (a->alloc_elements)
     free(a->elements);
 
+  if (a->alloc_blocks)
+  {
+    while (a->num_blocks > 0)
+      free(a->blocks[-- a->num_blocks]);
+
+    free(a->blocks);
+  }
+
   if (a->hashsize)
     free(a->hash);
 
@@ -378,7 +428,34 @@ cupsArrayDup(cups_array_t *a)		/* I - Array */
 
   memcpy(da->saved, a->saved, sizeof(a->saved));
 
-  if (a->num_elements)
+  if (a->large)
+  {
+   /*
+    * Copy the elements of a large array one at a time...
+    */
+
+    int		i;			/* Looping var */
+    void	*e;			/* Element */
+
+    da->large = 1;
+
+    for (i = 0; i < a->num_elements; i ++)
+    {
+      e = _CUPS_ELEMENT(a, i);
+
+      if (a->copyfunc)
+        e = (a->copyfunc)(e, a->data);
+
+      if (!e || !cups_array_insert_at(da, i, e))
+      {
+        cupsArrayDelete(da);
+	return (NULL);
+      }
+
+      da->num_elements ++;
+    }
+  }
+  else if (a->num_elements)
   {
    /*
     * Allocate memory for the elements...
@@ -497,7 +574,7 @@ cupsArrayFind(cups_array_t *a,		/* I - Array */
       * The array is not unique, find the first match...
       */
 
-      while (current > 0 && !(*(a->compare))(e, a->elements[current - 1],
+      while (current > 0 && !(*(a->compare))(e, _CUPS_ELEMENT(a, current - 1),
                                              a->data))
         current --;
     }
@@ -507,7 +584,7 @@ cupsArrayFind(cups_array_t *a,		/* I - Array */
     if (hash >= 0)
       a->hash[hash] = current;
 
-    return (a->elements[current]);
+    return (_CUPS_ELEMENT(a, current));
   }
   else
   {
@@ -773,6 +850,33 @@ cupsArrayNew3(cups_array_func_t  f,	/* I - Comparison function or @code NULL@ fo
 }
 
 
+/*
+ * '_cupsArrayNewLarge()' - Create a new array for large numbers of elements.
+ *
+ * The array works just like one created with @link cupsArrayNew3@, but the
+ * elements are stored in blocks so that adding and removing elements stays
+ * fast when the array holds many thousands of elements.
+ */
+
+cups_array_t *				/* O - Array */
+_cupsArrayNewLarge(cups_array_func_t f,	/* I - Comparison function or @code NULL@ for an unsorted array */
+                   void              *d,/* I - User data or @code NULL@ */
+                   cups_ahash_func_t h,	/* I - Hash function or @code NULL@ for unhashed lookups */
+		   int               hsize,
+					/* I - Hash size (>= 0) */
+		   cups_acopy_func_t cf,/* I - Copy function */
+		   cups_afree_func_t ff)/* I - Free function */
+{
+  cups_array_t	*a;			/* Array  */
+
+
+  if ((a = cupsArrayNew3(f, d, h, hsize, cf, ff)) != NULL)
+    a->large = 1;
+
+  return (a);
+}
+
+
 /*
  * '_cupsArrayNewStrings()' - Create a new array of comma-delimited strings.
  *
@@ -905,14 +1009,12 @@ cupsArrayRemove(cups_array_t *a,	/* I - Array */
   * Yes, now remove it...
   */
 
-  a->num_elements --;
-
   if (a->freefunc)
-    (a->freefunc)(a->elements[current], a->data);
+    (a->freefunc)(_CUPS_ELEMENT(a, current), a->data);
 
-  if (current < a->num_elements)
-    memmove(a->elements + current, a->elements + current + 1,
-            (a->num_elements - current) * sizeof(void *));
+  cups_array_remove_at(a, current);
+
+  a->num_elements --;
 
   if (current <= a->current)
     a->current --;
@@ -952,7 +1054,7 @@ cupsArrayRestore(cups_array_t *a)	/* I - Array */
   a->current = a->saved[a->num_saved];
 
   if (a->current >= 0 && a->current < a->num_elements)
-    return (a->elements[a->current]);
+    return (_CUPS_ELEMENT(a, a->current));
   else
     return (NULL);
 }
@@ -1024,7 +1126,7 @@ cups_array_add(cups_array_t *a,		/* I - Array */
   * Verify we have room for the new element...
   */
 
-  if (a->num_elements >= a->alloc_elements)
+  if (!a->large && a->num_elements >= a->alloc_elements)
   {
    /*
     * Allocate additional elements; start with 16 elements, then
@@ -1110,7 +1212,7 @@ cups_array_add(cups_array_t *a,		/* I - Array */
         * Insert at beginning of run...
 	*/
 
-	while (current > 0 && !(*(a->compare))(e, a->elements[current - 1],
+	while (current > 0 && !(*(a->compare))(e, _CUPS_ELEMENT(a, current - 1),
                                                a->data))
           current --;
       }
@@ -1125,7 +1227,7 @@ cups_array_add(cups_array_t *a,		/* I - Array */
           current ++;
 	}
 	while (current < a->num_elements &&
-               !(*(a->compare))(e, a->elements[current], a->data));
+               !(*(a->compare))(e, _CUPS_ELEMENT(a, current), a->data));
       }
     }
   }
@@ -1134,15 +1236,31 @@ cups_array_add(cups_array_t *a,		/* I - Array */
   * Insert or append the element...
   */
 
+  if (a->copyfunc)
+  {
+    if ((e = (a->copyfunc)(e, a->data)) == NULL)
+    {
+      DEBUG_puts("8cups_array_add: Copy function returned NULL, returning 0");
+      return (0);
+    }
+  }
+
+  if (!cups_array_insert_at(a, current, e))
+  {
+    DEBUG_puts("8cups_array_add: Unable to allocate memory, returning 0");
+
+    if (a->copyfunc && a->freefunc)
+      (a->freefunc)(e, a->data);
+
+    return (0);
+  }
+
   if (current < a->num_elements)
   {
    /*
-    * Shift other elements to the right...
+    * Adjust the indices of the elements that were shifted to the right...
     */
 
-    memmove(a->elements + current + 1, a->elements + current,
-            (a->num_elements - current) * sizeof(void *));
-
     if (a->current >= current)
       a->current ++;
 
@@ -1157,24 +1275,13 @@ cups_array_add(cups_array_t *a,		/* I - Array */
     DEBUG_printf(("9cups_array_add: append element at %d...", current));
 #endif /* DEBUG */
 
-  if (a->copyfunc)
-  {
-    if ((a->elements[current] = (a->copyfunc)(e, a->data)) == NULL)
-    {
-      DEBUG_puts("8cups_array_add: Copy function returned NULL, returning 0");
-      return (0);
-    }
-  }
-  else
-    a->elements[current] = e;
-
   a->num_elements ++;
   a->insert = current;
 
 #ifdef DEBUG
   for (current = 0; current < a->num_elements; current ++)
     DEBUG_printf(("9cups_array_add: a->elements[%d]=%p", current,
-                  a->elements[current]));
+                  _CUPS_ELEMENT(a, current)));
 #endif /* DEBUG */
 
   DEBUG_puts("9cups_array_add: returning 1");
@@ -1183,6 +1290,72 @@ cups_array_add(cups_array_t *a,		/* I - Array */
 }
 
 
+/*
+ * 'cups_array_block()' - Find the block containing an element.
+ */
+
+static int				/* O - Index of block */
+cups_array_block(cups_array_t *a,	/* I - Array */
+                 int          n)	/* I - Element index */
+{
+  int		left,			/* Left side of search */
+		right,			/* Right side of search */
+		current;		/* Current block */
+  _cups_ablock_t *b;			/* Block */
+
+
+ /*
+  * Check the last block that was used since most accesses are sequential...
+  */
+
+  if (a->last_block < a->num_blocks)
+  {
+    b = a->blocks[a->last_block];
+
+    if (n >= b->first && n < (b->first + b->count))
+      return (a->last_block);
+  }
+
+ /*
+  * Otherwise do a binary search of the starting indices...
+  */
+
+  left  = 0;
+  right = a->num_blocks - 1;
+
+  while (left < right)
+  {
+    current = (left + right + 1) / 2;
+
+    if (a->blocks[current]->first <= n)
+      left = current;
+    else
+      right = current - 1;
+  }
+
+  a->last_block = left;
+
+  return (left);
+}
+
+
+/*
+ * 'cups_array_element()' - Get an element from a large array.
+ */
+
+static void *				/* O - Element */
+cups_array_element(cups_array_t *a,	/* I - Array */
+                   int          n)	/* I - Element index */
+{
+  _cups_ablock_t *b;			/* Block */
+
+
+  b = a->blocks[cups_array_block(a, n)];
+
+  return (b->elements[n - b->first]);
+}
+
+
 /*
  * 'cups_array_find()' - Find an element in the array.
  */
@@ -1216,7 +1389,7 @@ cups_array_find(cups_array_t *a,	/* I - Array */
       * Start search on either side of previous...
       */
 
-      if ((diff = (*(a->compare))(e, a->elements[prev], a->data)) == 0 ||
+      if ((diff = (*(a->compare))(e, _CUPS_ELEMENT(a, prev), a->data)) == 0 ||
           (diff < 0 && prev == 0) ||
 	  (diff > 0 && prev == (a->num_elements - 1)))
       {
@@ -1262,7 +1435,7 @@ cups_array_find(cups_array_t *a,	/* I - Array */
     do
     {
       current = (left + right) / 2;
-      diff    = (*(a->compare))(e, a->elements[current], a->data);
+      diff    = (*(a->compare))(e, _CUPS_ELEMENT(a, current), a->data);
 
       DEBUG_printf(("9cups_array_find: left=%d, right=%d, current=%d, diff=%d",
                     left, right, current, diff));
@@ -1282,11 +1455,11 @@ cups_array_find(cups_array_t *a,	/* I - Array */
       * Check the last 1 or 2 elements...
       */
 
-      if ((diff = (*(a->compare))(e, a->elements[left], a->data)) <= 0)
+      if ((diff = (*(a->compare))(e, _CUPS_ELEMENT(a, left), a->data)) <= 0)
         current = left;
       else
       {
-        diff    = (*(a->compare))(e, a->elements[right], a->data);
+        diff    = (*(a->compare))(e, _CUPS_ELEMENT(a, right), a->data);
         current = right;
       }
     }
@@ -1302,7 +1475,7 @@ cups_array_find(cups_array_t *a,	/* I - Array */
     diff = 1;
 
     for (current = 0; current < a->num_elements; current ++)
-      if (a->elements[current] == e)
+      if (_CUPS_ELEMENT(a, current) == e)
       {
         diff = 0;
         break;
@@ -1321,6 +1494,223 @@ cups_array_find(cups_array_t *a,	/* I - Array */
 }
 
 
+/*
+ * 'cups_array_insert_at()' - Insert an element at an index.
+ *
+ * The caller is responsible for updating the element count and indices.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+cups_array_insert_at(cups_array_t *a,	/* I - Array */
+                     int          n,	/* I - Element index */
+		     void         *e)	/* I - Element */
+{
+  int		i,			/* Looping var */
+		block,			/* Index of block */
+		offset;			/* Offset in block */
+  _cups_ablock_t *b,			/* Block */
+		*nb;			/* New block */
+
+
+  if (!a->large)
+  {
+   /*
+    * Shift other elements to the right...
+    */
+
+    if (n < a->num_elements)
+      memmove(a->elements + n + 1, a->elements + n,
+              (a->num_elements - n) * sizeof(void *));
+
+    a->elements[n] = e;
+
+    return (1);
+  }
+
+ /*
+  * Make sure we have room for another block pointer...
+  */
+
+  if (a->num_blocks >= a->alloc_blocks)
+  {
+    _cups_ablock_t	**temp;		/* New block list */
+    int			count;		/* New allocation count */
+
+    count = a->alloc_blocks ? 2 * a->alloc_blocks : 16;
+
+    if ((temp = realloc(a->blocks, count * sizeof(_cups_ablock_t *))) == NULL)
+      return (0);
+
+    a->alloc_blocks = count;
+    a->blocks       = temp;
+  }
+
+ /*
+  * Find the block for the new element; appends go to the last block...
+  */
+
+  if (!a->num_blocks)
+  {
+    if ((b = calloc(1, sizeof(_cups_ablock_t))) == NULL)
+      return (0);
+
+    a->blocks[0]  = b;
+    a->num_blocks = 1;
+    block         = 0;
+  }
+  else if (n >= a->num_elements)
+    block = a->num_blocks - 1;
+  else
+    block = cups_array_block(a, n);
+
+  b      = a->blocks[block];
+  offset = n - b->first;
+
+  if (b->count >= _CUPS_ABLOCK)
+  {
+   /*
+    * Block is full, split it.  Appending to the last block just starts a new
+    * block so that arrays built in order stay densely packed...
+    */
+
+    if ((nb = calloc(1, sizeof(_cups_ablock_t))) == NULL)
+      return (0);
+
+    if (offset < _CUPS_ABLOCK || block < (a->num_blocks - 1))
+    {
+      nb->count = _CUPS_ABLOCK / 2;
+      b->count  -= nb->count;
+
+      memcpy(nb->elements, b->elements + b->count,
+             nb->count * sizeof(void *));
+    }
+
+    nb->first = b->first + b->count;
+
+    memmove(a->blocks + block + 2, a->blocks + block + 1,
+            (a->num_blocks - block - 1) * sizeof(_cups_ablock_t *));
+    a->blocks[block + 1] = nb;
+    a->num_blocks ++;
+
+    if (offset >= b->count)
+    {
+      block ++;
+      b      = nb;
+      offset = n - b->first;
+    }
+  }
+
+ /*
+  * Insert the element and adjust the starting index of the following
+  * blocks...
+  */
+
+  if (offset < b->count)
+    memmove(b->elements + offset + 1, b->elements + offset,
+            (b->count - offset) * sizeof(void *));
+
+  b->elements[offset] = e;
+  b->count ++;
+
+  for (i = block + 1; i < a->num_blocks; i ++)
+    a->blocks[i]->first ++;
+
+  a->last_block = block;
+
+  return (1);
+}
+
+
+/*
+ * 'cups_array_remove_at()' - Remove the element at an index.
+ *
+ * The caller is responsible for updating the element count and indices.
+ */
+
+static void
+cups_array_remove_at(cups_array_t *a,	/* I - Array */
+                     int          n)	/* I - Element index */
+{
+  int		i,			/* Looping var */
+		block,			/* Index of block */
+		offset;			/* Offset in block */
+  _cups_ablock_t *b,			/* Block */
+		*nb;			/* Next block */
+
+
+  if (!a->large)
+  {
+   /*
+    * Shift other elements to the left...
+    */
+
+    if (n < (a->num_elements - 1))
+      memmove(a->elements + n, a->elements + n + 1,
+              (a->num_elements - n - 1) * sizeof(void *));
+
+    return;
+  }
+
+ /*
+  * Remove the element and adjust the starting index of the following
+  * blocks...
+  */
+
+  block  = cups_array_block(a, n);
+  b      = a->blocks[block];
+  offset = n - b->first;
+
+  b->count --;
+
+  if (offset < b->count)
+    memmove(b->elements + offset, b->elements + offset + 1,
+            (b->count - offset) * sizeof(void *));
+
+  for (i = block + 1; i < a->num_blocks; i ++)
+    a->blocks[i]->first --;
+
+ /*
+  * Merge with the previous block if both are less than half full, so
+  * that lookups don't have to search lots of nearly empty blocks...
+  */
+
+  if (block > 0 &&
+      (a->blocks[block - 1]->count + b->count) <= (_CUPS_ABLOCK / 2))
+    block --;
+
+  b = a->blocks[block];
+
+  if (block < (a->num_blocks - 1) &&
+      (b->count + a->blocks[block + 1]->count) <= (_CUPS_ABLOCK / 2))
+  {
+    nb = a->blocks[block + 1];
+
+    memcpy(b->elements + b->count, nb->elements, nb->count * sizeof(void *));
+    b->count += nb->count;
+
+    free(nb);
+
+    a->num_blocks --;
+    memmove(a->blocks + block + 1, a->blocks + block + 2,
+            (a->num_blocks - block - 1) * sizeof(_cups_ablock_t *));
+  }
+  else if (!b->count)
+  {
+   /*
+    * Free the last empty block...
+    */
+
+    free(b);
+
+    a->num_blocks --;
+    memmove(a->blocks + block, a->blocks + block + 1,
+            (a->num_blocks - block) * sizeof(_cups_ablock_t *));
+  }
+
+  a->last_block = block;
+}
+
+
 /*
  * End of "$Id: array.c 10424 2012-04-23 17:26:57Z mike $".
  */
@@ -21,6 +21,8 @@
  *
  *   _cupsFileCheck()       - Check the permissions of the given filename.
  *   _cupsFileCheckFilter() - Report file check results as CUPS filter messages.
+ *   cupsFileBuffered()     - Return the number of bytes that can be read
+ *                            without waiting.
  *   cupsFileClose()        - Close a CUPS file.
  *   cupsFileCompression()  - Return whether a file is compressed.
  *   cupsFileEOF()          - Return the end-of-file status.
@@ -481,6 +483,26 @@ cupsFileClose(cups_file_t *fp)		/* I - CUPS file */
 }
 
 
+/*
+ * 'cupsFileBuffered()' - Return the number of bytes that can be read without
+ *                        waiting.
+ *
+ * Only data already read into the file's buffer is counted; use select() or
+ * poll() on the @link cupsFileNumber@ descriptor to check for more.
+ *
+ * @since CUPS 1.7@
+ */
+
+ssize_t					/* O - Number of buffered bytes */
+cupsFileBuffered(cups_file_t *fp)	/* I - CUPS file */
+{
+  if (!fp || fp->mode != 'r' || !fp->ptr)
+    return (0);
+
+  return (fp->end - fp->ptr);
+}
+
+
 /*
  * 'cupsFileCompression()' - Return whether a file is compressed.
  *
@@ -105,6 +105,9 @@ extern int		cupsFileUnlock(cups_file_t *fp) _CUPS_API_1_2;
 extern ssize_t		cupsFileWrite(cups_file_t *fp, const char *buf,
 			              size_t bytes) _CUPS_API_1_2;
 
+/**** New in CUPS 1.7 ****/
+extern ssize_t		cupsFileBuffered(cups_file_t *fp) _CUPS_API_1_7;
+
 
 #  ifdef __cplusplus
 }
@@ -136,6 +136,10 @@ typedef int socklen_t;
 #    endif /* HAVE_GETIFADDRS */
 #  endif /* !WIN32 */
 
+#  ifdef HAVE_LIBZ
+#    include <zlib.h>
+#  endif /* HAVE_LIBZ */
+
 
 /*
  * C++ magic...
@@ -156,6 +160,22 @@ extern "C" {
 #define _HTTP_RESOLVE_FQDN	2	/* Resolve to a FQDN */
 #define _HTTP_RESOLVE_FAXOUT	4	/* Resolve FaxOut service? */
 
+#define _HTTP_MAX_SBUFFER	65536	/* Max size of adaptive data buffers */
+
+
+/*
+ * Types and functions for content coding...
+ */
+
+typedef enum _http_coding_e		/**** HTTP content coding values ****/
+{
+  _HTTP_CODING_IDENTITY,		/* No content coding */
+  _HTTP_CODING_GZIP,			/* Compress with gzip */
+  _HTTP_CODING_DEFLATE,			/* Compress with zlib "deflate" */
+  _HTTP_CODING_GUNZIP,			/* Decompress gzip data */
+  _HTTP_CODING_INFLATE			/* Decompress zlib "deflate" data */
+} _http_coding_t;
+
 
 /*
  * Types and functions for SSL support...
@@ -255,8 +275,7 @@ struct _http_s				/**** HTTP connection structure. ****/
   http_encoding_t	data_encoding;	/* Chunked or not */
   int			_data_remaining;/* Number of bytes left (deprecated) */
   int			used;		/* Number of bytes used in buffer */
-  char			buffer[HTTP_MAX_BUFFER];
-					/* Buffer for incoming data */
+  char			*buffer;	/* Buffer for incoming data */
   int			auth_type;	/* Authentication in use */
   _cups_md5_state_t	md5_state;	/* MD5 state */
   char			nonce[HTTP_MAX_VALUE];
@@ -278,8 +297,7 @@ struct _http_s				/**** HTTP connection structure. ****/
   off_t			data_remaining;	/* Number of bytes left */
   http_addr_t		*hostaddr;	/* Current host address and port */
   http_addrlist_t	*addrlist;	/* List of valid addresses */
-  char			wbuffer[HTTP_MAX_BUFFER];
-					/* Buffer for outgoing data */
+  char			*wbuffer;	/* Buffer for outgoing data */
   int			wused;		/* Write buffer bytes used */
   /**** New in CUPS 1.3 ****/
   char			*field_authorization;
@@ -303,6 +321,15 @@ struct _http_s				/**** HTTP connection structure. ****/
 #  ifdef HAVE_GSSAPI
   char			gsshost[256];	/* Hostname for Kerberos */
 #  endif /* HAVE_GSSAPI */
+  /**** New in CUPS 1.7 ****/
+  char			*bufptr;	/* Pointer to unread data in buffer */
+  size_t		bufsize,	/* Size of incoming data buffer */
+			wbufsize;	/* Size of outgoing data buffer */
+#  ifdef HAVE_LIBZ
+  _http_coding_t	coding;		/* Content coding of message body */
+  z_stream		stream;		/* (De)compression stream */
+  Bytef			*sbuffer;	/* (De)compression buffer */
+#  endif /* HAVE_LIBZ */
 };
 
 
@@ -384,12 +411,18 @@ extern char		*_httpDecodeURI(char *dst, const char *src,
 extern void		_httpDisconnect(http_t *http);
 extern char		*_httpEncodeURI(char *dst, const char *src,
 			                size_t dstsize);
+extern void		_httpFreeBuffers(http_t *http);
 extern void		_httpFreeCredentials(http_tls_credentials_t credentials);
 extern ssize_t		_httpPeek(http_t *http, char *buffer, size_t length);
 extern const char	*_httpResolveURI(const char *uri, char *resolved_uri,
 			                 size_t resolved_size, int options,
 					 int (*cb)(void *context),
 					 void *context);
+extern int		_httpSetContentCoding(http_t *http,
+			                      const char *coding);
+#  ifdef HAVE_SPLICE
+extern ssize_t		_httpSplice(http_t *http, int fd, size_t length);
+#  endif /* HAVE_SPLICE */
 extern int		_httpUpdate(http_t *http, http_status_t *status);
 extern int		_httpWait(http_t *http, int msec, int usessl);
 
@@ -42,12 +42,15 @@
  *   httpError()	      - Get the last error on a connection.
  *   httpFlush()	      - Flush data from a HTTP connection.
  *   httpFlushWrite()	      - Flush data in write buffer.
+ *   _httpFreeBuffers()       - Free the data buffers for a connection.
  *   _httpFreeCredentials()   - Free internal credentials.
  *   httpFreeCredentials()    - Free an array of credentials.
  *   httpGet()		      - Send a GET request to the server.
  *   httpGetAuthString()      - Get the current authorization string.
  *   httpGetBlocking()	      - Get the blocking/non-block state of a
  *				connection.
+ *   httpGetContentEncoding() - Get a common content encoding, if any, between
+ *				the client and server.
  *   httpGetCookie()	      - Get any cookie data from the response.
  *   httpGetFd()	      - Get the file descriptor associated with a
  *				connection.
@@ -78,6 +81,7 @@
  *   httpReconnect2()	      - Reconnect to a HTTP server with timeout and
  *				optional cancel.
  *   httpSetAuthString()      - Set the current authorization string.
+ *   _httpSetContentCoding()  - Start compressing the message body.
  *   httpSetCredentials()     - Set the credentials associated with an
  *				encrypted connection.
  *   httpSetCookie()	      - Set the cookie value(s).
@@ -86,6 +90,8 @@
  *   httpSetLength()	      - Set the content-length and content-encoding.
  *   httpSetTimeout()	      - Set read/write timeouts and an optional
  *				callback.
+ *   _httpSplice()	      - Move message body data from a connection to
+ *				a pipe.
  *   httpTrace()	      - Send an TRACE request to the server.
  *   _httpUpdate()	      - Update the current HTTP status for incoming
  *				data.
@@ -98,15 +104,24 @@
  *   httpWrite2()	      - Write data to a HTTP connection.
  *   _httpWriteCDSA()	      - Write function for the CDSA library.
  *   _httpWriteGNUTLS()       - Write function for the GNU TLS library.
+ *   http_alloc_buffer()      - Allocate or grow a connection data buffer.
  *   http_bio_ctrl()	      - Control the HTTP connection.
  *   http_bio_free()	      - Free OpenSSL data.
  *   http_bio_new()	      - Initialize an OpenSSL BIO structure.
  *   http_bio_puts()	      - Send a string for OpenSSL.
  *   http_bio_read()	      - Read data for OpenSSL.
  *   http_bio_write()	      - Write data for OpenSSL.
+ *   http_content_coding_finish() - Finish doing any content encoding.
+ *   http_content_coding_start() - Start doing content encoding.
  *   http_debug_hex()	      - Do a hex dump of a buffer.
  *   http_field()	      - Return the field index for a field name.
+ *   http_fill_buffer()       - Prepare the input buffer for a body read.
+ *   http_find_session()      - Find the saved TLS session for a connection.
+ *   http_load_session()      - Use a saved TLS session for a connection.
+ *   http_read()	      - Read message body data without content
+ *				decoding.
  *   http_read_ssl()	      - Read from a SSL/TLS connection.
+ *   http_save_session()      - Save the TLS session for a connection.
  *   http_send()	      - Send a request with all fields and the trailing
  *				blank line.
  *   http_set_credentials()   - Set the SSL/TLS credentials.
@@ -133,6 +148,7 @@
 #  include <signal.h>
 #  include <sys/time.h>
 #  include <sys/resource.h>
+#  include <sys/uio.h>
 #endif /* WIN32 */
 #ifdef HAVE_POLL
 #  include <poll.h>
@@ -143,11 +159,20 @@
  * Local functions...
  */
 
+static int		http_alloc_buffer(http_t *http, char **buffer,
+			                  size_t *bufsize, size_t size);
+#ifdef HAVE_LIBZ
+static void		http_content_coding_finish(http_t *http);
+static int		http_content_coding_start(http_t *http,
+			                          _http_coding_t coding);
+#endif /* HAVE_LIBZ */
 #ifdef DEBUG
 static void		http_debug_hex(const char *prefix, const char *buffer,
 			               int bytes);
 #endif /* DEBUG */
 static http_field_t	http_field(const char *name);
+static ssize_t		http_fill_buffer(http_t *http);
+static ssize_t		http_read(http_t *http, char *buffer, size_t length);
 static int		http_send(http_t *http, http_state_t request,
 			          const char *uri);
 static int		http_write(http_t *http, const char *buffer,
@@ -155,6 +180,12 @@ static int		http_write(http_t *http, const char *buffer,
 static int		http_write_chunk(http_t *http, const char *buffer,
 			                 int length);
 #ifdef HAVE_SSL
+#  if defined(HAVE_LIBSSL) || defined(HAVE_GNUTLS)
+static struct _http_tls_session_s *http_find_session(http_t *http,
+			                             int create);
+static void		http_load_session(http_t *http);
+static void		http_save_session(http_t *http);
+#  endif /* HAVE_LIBSSL || HAVE_GNUTLS */
 static int		http_read_ssl(http_t *http, char *buf, int len);
 #  if defined(HAVE_CDSASSL) && defined(HAVE_SECCERTIFICATECOPYDATA)
 static int		http_set_credentials(http_t *http);
@@ -202,7 +233,8 @@ static const char * const http_fields[] =
 			  "Transfer-Encoding",
 			  "Upgrade",
 			  "User-Agent",
-			  "WWW-Authenticate"
+			  "WWW-Authenticate",
+			  "Accept-Encoding"
 			};
 #ifdef DEBUG
 static const char * const http_states[] =
@@ -225,6 +257,37 @@ static const char * const http_states[] =
 #endif /* DEBUG */
 
 
+#if defined(HAVE_SSL) && (defined(HAVE_LIBSSL) || defined(HAVE_GNUTLS))
+/*
+ * Saved TLS sessions, used to resume sessions when connecting to the same
+ * server again...
+ */
+
+#  define _HTTP_MAX_TLS_SESSIONS 8	/* Number of saved sessions */
+
+typedef struct _http_tls_session_s	/**** Saved TLS session ****/
+{
+  char		hostname[256];		/* Server hostname */
+  int		port;			/* Server port */
+  time_t	used;			/* Last time session was used */
+#  ifdef HAVE_LIBSSL
+  SSL_SESSION	*session;		/* Session data */
+#  else
+  gnutls_datum_t session;		/* Session data */
+#  endif /* HAVE_LIBSSL */
+} _http_tls_session_t;
+
+static _cups_mutex_t	http_tls_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for saved sessions */
+static _http_tls_session_t http_tls_sessions[_HTTP_MAX_TLS_SESSIONS];
+					/* Saved sessions */
+static int		http_tls_handshakes = 0,
+					/* Number of handshakes */
+			http_tls_resumed = 0;
+					/* Number of resumed sessions */
+#endif /* HAVE_SSL && (HAVE_LIBSSL || HAVE_GNUTLS) */
+
+
 #if defined(HAVE_SSL) && defined(HAVE_LIBSSL)
 /*
  * BIO methods for OpenSSL...
@@ -428,6 +491,8 @@ httpClose(http_t *http)			/* I - Connection to server */
   if (http->authstring && http->authstring != http->_authstring)
     free(http->authstring);
 
+  _httpFreeBuffers(http);
+
   free(http);
 }
 
@@ -866,6 +931,44 @@ httpFlushWrite(http_t *http)		/* I - Connection to server */
 }
 
 
+/*
+ * '_httpFreeBuffers()' - Free the data buffers for a connection.
+ *
+ * This is used by servers that embed the http_t structure in their client
+ * data and therefore do not call @link httpClose@.
+ */
+
+void
+_httpFreeBuffers(http_t *http)		/* I - Connection */
+{
+  if (!http)
+    return;
+
+#ifdef HAVE_LIBZ
+  if (http->coding)
+    http_content_coding_finish(http);
+#endif /* HAVE_LIBZ */
+
+  if (http->buffer)
+  {
+    free(http->buffer);
+    http->buffer = NULL;
+  }
+
+  if (http->wbuffer)
+  {
+    free(http->wbuffer);
+    http->wbuffer = NULL;
+  }
+
+  http->bufptr   = NULL;
+  http->bufsize  = 0;
+  http->used     = 0;
+  http->wbufsize = 0;
+  http->wused    = 0;
+}
+
+
 /*
  * '_httpFreeCredentials()' - Free internal credentials.
  */
@@ -963,6 +1066,103 @@ httpGetBlocking(http_t *http)		/* I - Connection to server */
 }
 
 
+/*
+ * 'httpGetContentEncoding()' - Get a common content encoding, if any, between
+ *                              the client and server.
+ *
+ * This function uses the value of the Accept-Encoding HTTP header and
+ * returns the highest-priority ("q" value) compression that is supported by
+ * the library, preferring "gzip" when several codings have the same
+ * priority.  @code NULL@ is returned when the message body should not be
+ * compressed.
+ *
+ * @since CUPS 1.7@
+ */
+
+const char *				/* O - Content-Coding value or
+					       @code NULL@ for the identity
+					       coding. */
+httpGetContentEncoding(http_t *http)	/* I - Connection to client/server */
+{
+#ifdef HAVE_LIBZ
+  if (http && http->fields[HTTP_FIELD_ACCEPT_ENCODING][0])
+  {
+    int		i;			/* Looping var */
+    char	temp[HTTP_MAX_VALUE],	/* Copy of Accept-Encoding value */
+		*start,			/* Start of coding value */
+		*end,			/* End of coding value */
+		*ptr;			/* Pointer into coding value */
+    double	qvalue;			/* "qvalue" for coding */
+    struct lconv *loc = localeconv();	/* Locale data */
+    static const char * const codings[] =
+    {					/* Supported content codings */
+      "deflate",
+      "gzip",
+      "x-deflate",
+      "x-gzip"
+    };
+    const char	*coding = NULL;		/* Best coding so far */
+    double	best = 0.0;		/* "qvalue" of best coding */
+
+
+    strlcpy(temp, http->fields[HTTP_FIELD_ACCEPT_ENCODING], sizeof(temp));
+
+    for (start = temp; *start; start = end)
+    {
+     /*
+      * Isolate the next "coding[;q=value]" element...
+      */
+
+      if ((end = strchr(start, ',')) != NULL)
+        *end++ = '\0';
+      else
+        end = start + strlen(start);
+
+      qvalue = 1.0;
+
+      if ((ptr = strchr(start, ';')) != NULL)
+      {
+        *ptr++ = '\0';
+
+        if ((ptr = strstr(ptr, "q=")) != NULL)
+	  qvalue = _cupsStrScand(ptr + 2, NULL, loc);
+      }
+
+      while (_cups_isspace(*start))
+        start ++;
+
+      for (ptr = start + strlen(start) - 1;
+           ptr >= start && _cups_isspace(*ptr);
+	   ptr --)
+        *ptr = '\0';
+
+     /*
+      * See if the coding matches something we support...
+      */
+
+      if (qvalue <= 0.0 || qvalue < best)
+        continue;
+
+      for (i = 0; i < (int)(sizeof(codings) / sizeof(codings[0])); i ++)
+	if (!_cups_strcasecmp(start, codings[i]))
+	{
+	  if (qvalue > best || !coding || strstr(codings[i], "gzip"))
+	  {
+	    coding = codings[i];
+	    best   = qvalue;
+	  }
+	  break;
+	}
+    }
+
+    return (coding);
+  }
+#endif /* HAVE_LIBZ */
+
+  return (NULL);
+}
+
+
 /*
  * 'httpGetCookie()' - Get any cookie data from the response.
  *
@@ -1172,19 +1372,23 @@ httpGets(char   *line,			/* I - Line to read into */
         return (NULL);
       }
 
+      if (http_alloc_buffer(http, &http->buffer, &http->bufsize,
+                            HTTP_MAX_BUFFER))
+        return (NULL);
+
+      http->bufptr = http->buffer;
+
 #ifdef HAVE_SSL
       if (http->tls)
-	bytes = http_read_ssl(http, http->buffer + http->used,
-	                      HTTP_MAX_BUFFER - http->used);
+	bytes = http_read_ssl(http, http->buffer, (int)http->bufsize);
       else
 #endif /* HAVE_SSL */
-        bytes = recv(http->fd, http->buffer + http->used,
-	             HTTP_MAX_BUFFER - http->used, 0);
+        bytes = recv(http->fd, http->buffer, http->bufsize, 0);
 
       DEBUG_printf(("4httpGets: read %d bytes...", bytes));
 
 #ifdef DEBUG
-      http_debug_hex("httpGets", http->buffer + http->used, bytes);
+      http_debug_hex("httpGets", http->buffer, bytes);
 #endif /* DEBUG */
 
       if (bytes < 0)
@@ -1252,7 +1456,7 @@ httpGets(char   *line,			/* I - Line to read into */
     * Now copy as much of the current line as possible...
     */
 
-    for (bufptr = http->buffer, bufend = http->buffer + http->used;
+    for (bufptr = http->bufptr, bufend = http->bufptr + http->used;
          lineptr < lineend && bufptr < bufend;)
     {
       if (*bufptr == 0x0a)
@@ -1267,9 +1471,8 @@ httpGets(char   *line,			/* I - Line to read into */
 	*lineptr++ = *bufptr++;
     }
 
-    http->used -= (int)(bufptr - http->buffer);
-    if (http->used > 0)
-      memmove(http->buffer, bufptr, http->used);
+    http->used   -= (int)(bufptr - http->bufptr);
+    http->bufptr = bufptr;
 
     if (eol)
     {
@@ -1681,10 +1884,8 @@ _httpPeek(http_t *http,			/* I - Connection to server */
       }
     }
 
-    if (http->data_remaining > sizeof(http->buffer))
-      buflen = sizeof(http->buffer);
-    else
-      buflen = http->data_remaining;
+    if ((buflen = http_fill_buffer(http)) < 0)
+      return (-1);
 
     DEBUG_printf(("2_httpPeek: Reading %d bytes into buffer.", (int)buflen));
 
@@ -1692,7 +1893,7 @@ _httpPeek(http_t *http,			/* I - Connection to server */
     {
 #ifdef HAVE_SSL
       if (http->tls)
-	bytes = http_read_ssl(http, http->buffer, buflen);
+	bytes = http_read_ssl(http, http->buffer, (int)buflen);
       else
 #endif /* HAVE_SSL */
       bytes = recv(http->fd, http->buffer, buflen, 0);
@@ -1757,7 +1958,7 @@ _httpPeek(http_t *http,			/* I - Connection to server */
     DEBUG_printf(("2_httpPeek: grabbing %d bytes from input buffer...",
                   (int)bytes));
 
-    memcpy(buffer, http->buffer, length);
+    memcpy(buffer, http->bufptr, length);
   }
   else
     bytes = 0;
@@ -1885,10 +2086,6 @@ httpRead2(http_t *http,			/* I - Connection to server */
           char   *buffer,		/* I - Buffer for data */
 	  size_t length)		/* I - Maximum number of bytes */
 {
-  ssize_t	bytes;			/* Bytes read */
-  char		len[32];		/* Length string */
-
-
   DEBUG_printf(("httpRead2(http=%p, buffer=%p, length=" CUPS_LLFMT ")",
                 http, buffer, CUPS_LLCAST length));
 
@@ -1901,337 +2098,146 @@ httpRead2(http_t *http,			/* I - Connection to server */
   if (length <= 0)
     return (0);
 
-  if (http->data_encoding == HTTP_ENCODE_CHUNKED &&
-      http->data_remaining <= 0)
+#ifdef HAVE_LIBZ
+  if (http->coding == _HTTP_CODING_GUNZIP ||
+      http->coding == _HTTP_CODING_INFLATE)
   {
-    DEBUG_puts("2httpRead2: Getting chunk length...");
+    ssize_t	bytes;			/* Bytes read */
+    int		zerr;			/* Decompression status */
+    http_state_t state = http->state;	/* State before read */
 
-    if (httpGets(len, sizeof(len), http) == NULL)
-    {
-      DEBUG_puts("1httpRead2: Could not get length!");
-      return (0);
-    }
 
-    http->data_remaining = strtoll(len, NULL, 16);
-    if (http->data_remaining < 0)
-    {
-      DEBUG_puts("1httpRead2: Negative chunk length!");
-      return (0);
-    }
-  }
+    http->stream.next_out  = (Bytef *)buffer;
+    http->stream.avail_out = (uInt)length;
 
-  DEBUG_printf(("2httpRead2: data_remaining=" CUPS_LLFMT,
-                CUPS_LLCAST http->data_remaining));
+    do
+    {
+      if (http->stream.avail_in == 0)
+      {
+       /*
+        * Read more compressed data; the state change at the end of the
+	* message body is held off until the decompressed data has been
+	* consumed...
+	*/
 
-  if (http->data_remaining <= 0)
-  {
-   /*
-    * A zero-length chunk ends a transfer; unless we are reading POST
-    * data, go idle...
-    */
+	state = http->state;
 
-    if (http->data_encoding == HTTP_ENCODE_CHUNKED)
-      httpGets(len, sizeof(len), http);
+        if ((bytes = http_read(http, (char *)http->sbuffer,
+	                       _HTTP_MAX_SBUFFER)) <= 0)
+	{
+	  if (bytes == 0 && http->state != state)
+	  {
+	    DEBUG_puts("1httpRead2: Compressed data truncated.");
+	    http_content_coding_finish(http);
+	  }
+	  else if (bytes < 0 && http->stream.avail_out == (uInt)length)
+	    return (-1);
 
-    if (http->state == HTTP_POST_RECV)
-      http->state ++;
-    else
-      http->state = HTTP_WAITING;
+	  break;
+	}
 
-   /*
-    * Prevent future reads for this request...
-    */
+        if (http->data_remaining <= 0 &&
+	    http->data_encoding == HTTP_ENCODE_LENGTH)
+	  http->state = state;
 
-    http->data_encoding = HTTP_ENCODE_LENGTH;
+	http->stream.next_in  = http->sbuffer;
+	http->stream.avail_in = (uInt)bytes;
+      }
 
-    return (0);
-  }
-  else if (length > (size_t)http->data_remaining)
-    length = (size_t)http->data_remaining;
+      if ((zerr = inflate(&(http->stream), Z_NO_FLUSH)) == Z_STREAM_END)
+      {
+       /*
+        * End of the compressed data; change states if we have read the
+	* whole message body...
+	*/
 
-  if (http->used == 0 && length <= 256)
-  {
-   /*
-    * Buffer small reads for better performance...
-    */
+        DEBUG_printf(("2httpRead2: Decompressed %lu bytes from %lu bytes.",
+	              http->stream.total_out, http->stream.total_in));
 
-    ssize_t	buflen;			/* Length of read for buffer */
+	http_content_coding_finish(http);
 
-    if (!http->blocking)
-    {
-      while (!httpWait(http, http->wait_value))
+        if (http->data_remaining <= 0 &&
+	    http->data_encoding == HTTP_ENCODE_LENGTH)
+	{
+	  if (http->state == HTTP_POST_RECV)
+	    http->state ++;
+	  else
+	    http->state = HTTP_WAITING;
+	}
+	break;
+      }
+      else if (zerr != Z_OK)
       {
-	if (http->timeout_cb && (*http->timeout_cb)(http, http->timeout_data))
-	  continue;
+        DEBUG_printf(("1httpRead2: inflate returned %d (%s)", zerr,
+	              http->stream.msg ? http->stream.msg : "unknown"));
 
-	return (0);
+	http_content_coding_finish(http);
+	http->error = EIO;
+	return (-1);
       }
     }
+    while (http->stream.avail_out == (uInt)length);
 
-    if (http->data_remaining > sizeof(http->buffer))
-      buflen = sizeof(http->buffer);
-    else
-      buflen = http->data_remaining;
+    return ((ssize_t)(length - http->stream.avail_out));
+  }
+#endif /* HAVE_LIBZ */
 
-    DEBUG_printf(("2httpRead2: Reading %d bytes into buffer.", (int)buflen));
+  return (http_read(http, buffer, length));
+}
 
-    do
-    {
-#ifdef HAVE_SSL
-      if (http->tls)
-	bytes = http_read_ssl(http, http->buffer, buflen);
-      else
-#endif /* HAVE_SSL */
-      bytes = recv(http->fd, http->buffer, buflen, 0);
 
-      if (bytes < 0)
-      {
-#ifdef WIN32
-	if (WSAGetLastError() != WSAEINTR)
-	{
-	  http->error = WSAGetLastError();
-	  return (-1);
-	}
-	else if (WSAGetLastError() == WSAEWOULDBLOCK)
-	{
-	  if (!http->timeout_cb ||
-	      !(*http->timeout_cb)(http, http->timeout_data))
-	  {
-	    http->error = WSAEWOULDBLOCK;
-	    return (-1);
-	  }
-	}
-#else
-	if (errno == EWOULDBLOCK || errno == EAGAIN)
-	{
-	  if (http->timeout_cb && !(*http->timeout_cb)(http, http->timeout_data))
-	  {
-	    http->error = errno;
-	    return (-1);
-	  }
-	  else if (!http->timeout_cb && errno != EAGAIN)
-	  {
-	    http->error = errno;
-	    return (-1);
-	  }
-	}
-	else if (errno != EINTR)
-	{
-	  http->error = errno;
-	  return (-1);
-	}
-#endif /* WIN32 */
-      }
-    }
-    while (bytes < 0);
+#if defined(HAVE_SSL) && defined(HAVE_CDSASSL)
+/*
+ * '_httpReadCDSA()' - Read function for the CDSA library.
+ */
 
-    DEBUG_printf(("2httpRead2: Read " CUPS_LLFMT " bytes into buffer.",
-                  CUPS_LLCAST bytes));
-#ifdef DEBUG
-    http_debug_hex("httpRead2", http->buffer, (int)bytes);
-#endif /* DEBUG */
+OSStatus				/* O  - -1 on error, 0 on success */
+_httpReadCDSA(
+    SSLConnectionRef connection,	/* I  - SSL/TLS connection */
+    void             *data,		/* I  - Data buffer */
+    size_t           *dataLength)	/* IO - Number of bytes */
+{
+  OSStatus	result;			/* Return value */
+  ssize_t	bytes;			/* Number of bytes read */
+  http_t	*http;			/* HTTP connection */
 
-    http->used = bytes;
-  }
 
-  if (http->used > 0)
+  http = (http_t *)connection;
+
+  if (!http->blocking)
   {
-    if (length > (size_t)http->used)
-      length = (size_t)http->used;
+   /*
+    * Make sure we have data before we read...
+    */
 
-    bytes = (ssize_t)length;
+    while (!_httpWait(http, http->wait_value, 0))
+    {
+      if (http->timeout_cb && (*http->timeout_cb)(http, http->timeout_data))
+	continue;
 
-    DEBUG_printf(("2httpRead2: grabbing %d bytes from input buffer...",
-                  (int)bytes));
+      http->error = ETIMEDOUT;
+      return (-1);
+    }
+  }
 
-    memcpy(buffer, http->buffer, length);
-    http->used -= (int)length;
+  do
+  {
+    bytes = recv(http->fd, data, *dataLength, 0);
+  }
+  while (bytes == -1 && (errno == EINTR || errno == EAGAIN));
 
-    if (http->used > 0)
-      memmove(http->buffer, http->buffer + length, http->used);
+  if (bytes == *dataLength)
+  {
+    result = 0;
   }
-#ifdef HAVE_SSL
-  else if (http->tls)
+  else if (bytes > 0)
   {
-    if (!http->blocking)
-    {
-      while (!httpWait(http, http->wait_value))
-      {
-	if (http->timeout_cb && (*http->timeout_cb)(http, http->timeout_data))
-	  continue;
-
-	return (0);
-      }
-    }
-
-    while ((bytes = (ssize_t)http_read_ssl(http, buffer, (int)length)) < 0)
-    {
-#ifdef WIN32
-      if (WSAGetLastError() == WSAEWOULDBLOCK)
-      {
-        if (!http->timeout_cb || !(*http->timeout_cb)(http, http->timeout_data))
-	  break;
-      }
-      else if (WSAGetLastError() != WSAEINTR)
-        break;
-#else
-      if (errno == EWOULDBLOCK || errno == EAGAIN)
-      {
-        if (http->timeout_cb && !(*http->timeout_cb)(http, http->timeout_data))
-	  break;
-        else if (!http->timeout_cb && errno != EAGAIN)
-	  break;
-      }
-      else if (errno != EINTR)
-        break;
-#endif /* WIN32 */
-    }
-  }
-#endif /* HAVE_SSL */
-  else
-  {
-    if (!http->blocking)
-    {
-      while (!httpWait(http, http->wait_value))
-      {
-	if (http->timeout_cb && (*http->timeout_cb)(http, http->timeout_data))
-	  continue;
-
-	return (0);
-      }
-    }
-
-    DEBUG_printf(("2httpRead2: reading " CUPS_LLFMT " bytes from socket...",
-                  CUPS_LLCAST length));
-
-#ifdef WIN32
-    while ((bytes = (ssize_t)recv(http->fd, buffer, (int)length, 0)) < 0)
-    {
-      if (WSAGetLastError() == WSAEWOULDBLOCK)
-      {
-        if (!http->timeout_cb || !(*http->timeout_cb)(http, http->timeout_data))
-	  break;
-      }
-      else if (WSAGetLastError() != WSAEINTR)
-        break;
-    }
-#else
-    while ((bytes = recv(http->fd, buffer, length, 0)) < 0)
-    {
-      if (errno == EWOULDBLOCK || errno == EAGAIN)
-      {
-        if (http->timeout_cb && !(*http->timeout_cb)(http, http->timeout_data))
-	  break;
-        else if (!http->timeout_cb && errno != EAGAIN)
-	  break;
-      }
-      else if (errno != EINTR)
-        break;
-    }
-#endif /* WIN32 */
-
-    DEBUG_printf(("2httpRead2: read " CUPS_LLFMT " bytes from socket...",
-                  CUPS_LLCAST bytes));
-#ifdef DEBUG
-    http_debug_hex("httpRead2", buffer, (int)bytes);
-#endif /* DEBUG */
-  }
-
-  if (bytes > 0)
-  {
-    http->data_remaining -= bytes;
-
-    if (http->data_remaining <= INT_MAX)
-      http->_data_remaining = (int)http->data_remaining;
-    else
-      http->_data_remaining = INT_MAX;
-  }
-  else if (bytes < 0)
-  {
-#ifdef WIN32
-    if (WSAGetLastError() == WSAEINTR)
-      bytes = 0;
-    else
-      http->error = WSAGetLastError();
-#else
-    if (errno == EINTR || (errno == EAGAIN && !http->timeout_cb))
-      bytes = 0;
-    else
-      http->error = errno;
-#endif /* WIN32 */
-  }
-  else
-  {
-    http->error = EPIPE;
-    return (0);
-  }
-
-  if (http->data_remaining == 0)
-  {
-    if (http->data_encoding == HTTP_ENCODE_CHUNKED)
-      httpGets(len, sizeof(len), http);
-    else if (http->state == HTTP_POST_RECV)
-      http->state ++;
-    else
-      http->state = HTTP_WAITING;
-  }
-
-  return (bytes);
-}
-
-
-#if defined(HAVE_SSL) && defined(HAVE_CDSASSL)
-/*
- * '_httpReadCDSA()' - Read function for the CDSA library.
- */
-
-OSStatus				/* O  - -1 on error, 0 on success */
-_httpReadCDSA(
-    SSLConnectionRef connection,	/* I  - SSL/TLS connection */
-    void             *data,		/* I  - Data buffer */
-    size_t           *dataLength)	/* IO - Number of bytes */
-{
-  OSStatus	result;			/* Return value */
-  ssize_t	bytes;			/* Number of bytes read */
-  http_t	*http;			/* HTTP connection */
-
-
-  http = (http_t *)connection;
-
-  if (!http->blocking)
-  {
-   /*
-    * Make sure we have data before we read...
-    */
-
-    while (!_httpWait(http, http->wait_value, 0))
-    {
-      if (http->timeout_cb && (*http->timeout_cb)(http, http->timeout_data))
-	continue;
-
-      http->error = ETIMEDOUT;
-      return (-1);
-    }
-  }
-
-  do
-  {
-    bytes = recv(http->fd, data, *dataLength, 0);
-  }
-  while (bytes == -1 && (errno == EINTR || errno == EAGAIN));
-
-  if (bytes == *dataLength)
-  {
-    result = 0;
-  }
-  else if (bytes > 0)
-  {
-    *dataLength = bytes;
-    result = errSSLWouldBlock;
-  }
-  else
-  {
-    *dataLength = 0;
+    *dataLength = bytes;
+    result = errSSLWouldBlock;
+  }
+  else
+  {
+    *dataLength = 0;
 
     if (bytes == 0)
       result = errSSLClosedGraceful;
@@ -2499,6 +2505,36 @@ httpSetAuthString(http_t     *http,	/* I - Connection to server */
 }
 
 
+/*
+ * '_httpSetContentCoding()' - Start compressing the message body.
+ *
+ * The message body must use chunked transfer encoding.  The coding is
+ * finished when the final (0-length) chunk is written.
+ */
+
+int					/* O - 0 on success, -1 on error */
+_httpSetContentCoding(
+    http_t     *http,			/* I - Connection to client */
+    const char *coding)			/* I - "gzip" or "deflate" */
+{
+#ifdef HAVE_LIBZ
+  if (!http || !coding || http->coding ||
+      http->data_encoding != HTTP_ENCODE_CHUNKED)
+    return (-1);
+
+  if (!strcmp(coding, "gzip") || !strcmp(coding, "x-gzip"))
+    return (http_content_coding_start(http, _HTTP_CODING_GZIP));
+  else if (!strcmp(coding, "deflate") || !strcmp(coding, "x-deflate"))
+    return (http_content_coding_start(http, _HTTP_CODING_DEFLATE));
+#else
+  (void)http;
+  (void)coding;
+#endif /* HAVE_LIBZ */
+
+  return (-1);
+}
+
+
 /*
  * 'httpSetCredentials()' - Set the credentials associated with an encrypted
  *			    connection.
@@ -2572,7 +2608,7 @@ httpSetField(http_t       *http,	/* I - Connection to server */
 {
   if (http == NULL ||
       field < HTTP_FIELD_ACCEPT_LANGUAGE ||
-      field > HTTP_FIELD_WWW_AUTHENTICATE ||
+      field >= HTTP_FIELD_MAX ||
       value == NULL)
     return;
 
@@ -2689,6 +2725,84 @@ httpSetTimeout(
 }
 
 
+#ifdef HAVE_SPLICE
+/*
+ * '_httpSplice()' - Move message body data from a connection to a pipe.
+ *
+ * The data is moved by the kernel without being copied to user space.  This
+ * is only possible for unencrypted connections with no buffered input while
+ * inside a message body or chunk; 0 is returned in all other cases (and when
+ * no data is available) so that the caller can use httpRead2() instead.
+ */
+
+ssize_t					/* O - Number of bytes moved or -1 on error */
+_httpSplice(http_t *http,		/* I - Connection to server */
+            int    fd,			/* I - Pipe to write to */
+	    size_t length)		/* I - Maximum number of bytes */
+{
+  ssize_t	bytes;			/* Bytes moved */
+  char		len[32];		/* Length string */
+
+
+  DEBUG_printf(("_httpSplice(http=%p, fd=%d, length=" CUPS_LLFMT ")",
+                http, fd, CUPS_LLCAST length));
+
+  if (!http || http->tls || http->used > 0 || http->data_remaining <= 0 ||
+      length == 0)
+    return (0);
+
+#ifdef HAVE_LIBZ
+  if (http->coding)
+    return (0);
+#endif /* HAVE_LIBZ */
+
+  if (length > (size_t)http->data_remaining)
+    length = (size_t)http->data_remaining;
+
+  while ((bytes = splice(http->fd, NULL, fd, NULL, length,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) < 0 &&
+         errno == EINTR);
+
+  DEBUG_printf(("2_httpSplice: splice() returned " CUPS_LLFMT ".",
+                CUPS_LLCAST bytes));
+
+  if (bytes < 0)
+  {
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      return (0);
+
+    http->error = errno;
+    return (-1);
+  }
+  else if (bytes == 0)
+  {
+    http->error = EPIPE;
+    return (-1);
+  }
+
+  http->activity       = time(NULL);
+  http->data_remaining -= bytes;
+
+  if (http->data_remaining <= INT_MAX)
+    http->_data_remaining = (int)http->data_remaining;
+  else
+    http->_data_remaining = INT_MAX;
+
+  if (http->data_remaining == 0)
+  {
+    if (http->data_encoding == HTTP_ENCODE_CHUNKED)
+      httpGets(len, sizeof(len), http);
+    else if (http->state == HTTP_POST_RECV)
+      http->state ++;
+    else
+      http->state = HTTP_WAITING;
+  }
+
+  return (bytes);
+}
+#endif /* HAVE_SPLICE */
+
+
 /*
  * 'httpTrace()' - Send an TRACE request to the server.
  */
@@ -2791,6 +2905,27 @@ _httpUpdate(http_t        *http,	/* I - Connection to server */
 	  break;
     }
 
+#ifdef HAVE_LIBZ
+   /*
+    * Decompress response message bodies as they are read...
+    */
+
+    if ((http->state == HTTP_GET_SEND || http->state == HTTP_POST_SEND) &&
+        (http->data_encoding == HTTP_ENCODE_CHUNKED ||
+	 http->data_remaining > 0))
+    {
+      const char *coding = http->fields[HTTP_FIELD_CONTENT_ENCODING];
+					/* Content-Encoding value */
+
+      if (!_cups_strcasecmp(coding, "gzip") ||
+          !_cups_strcasecmp(coding, "x-gzip"))
+        http_content_coding_start(http, _HTTP_CODING_GUNZIP);
+      else if (!_cups_strcasecmp(coding, "deflate") ||
+               !_cups_strcasecmp(coding, "x-deflate"))
+        http_content_coding_start(http, _HTTP_CODING_INFLATE);
+    }
+#endif /* HAVE_LIBZ */
+
     *status = http->status;
     return (0);
   }
@@ -3054,6 +3189,14 @@ httpWait(http_t *http,			/* I - Connection to server */
     return (1);
   }
 
+#ifdef HAVE_LIBZ
+  if (http->coding >= _HTTP_CODING_GUNZIP && http->stream.avail_in > 0)
+  {
+    DEBUG_puts("3httpWait: Returning 1 since there is buffered data ready.");
+    return (1);
+  }
+#endif /* HAVE_LIBZ */
+
  /*
   * Flush pending data, if any...
   */
@@ -3122,23 +3265,82 @@ httpWrite2(http_t     *http,		/* I - Connection to server */
 
   http->activity = time(NULL);
 
- /*
-  * Buffer small writes for better performance...
-  */
-
-  if (length > 0)
+#ifdef HAVE_LIBZ
+  if (http->coding == _HTTP_CODING_GZIP ||
+      http->coding == _HTTP_CODING_DEFLATE)
   {
-    if (http->wused && (length + http->wused) > sizeof(http->wbuffer))
-    {
-      DEBUG_printf(("2httpWrite2: Flushing buffer (wused=%d, length="
-                    CUPS_LLFMT ")", http->wused, CUPS_LLCAST length));
+   /*
+    * Compress the data, sending each full buffer of compressed data as a
+    * chunk; the final (0-length) write flushes the compressor...
+    */
+
+    int		zflush = length > 0 ? Z_NO_FLUSH : Z_FINISH;
+					/* Deflate flush mode */
+    size_t	slen;			/* Bytes of compressed data */
 
+
+    if (http->wused)
       httpFlushWrite(http);
-    }
 
-    if ((length + http->wused) <= sizeof(http->wbuffer) &&
-        length < sizeof(http->wbuffer))
-    {
+    http->stream.next_in  = (Bytef *)buffer;
+    http->stream.avail_in = (uInt)length;
+
+    do
+    {
+      http->stream.next_out  = http->sbuffer;
+      http->stream.avail_out = _HTTP_MAX_SBUFFER;
+
+      deflate(&(http->stream), zflush);
+
+      if ((slen = _HTTP_MAX_SBUFFER - http->stream.avail_out) > 0 &&
+          http_write_chunk(http, (char *)http->sbuffer, (int)slen) < 0)
+        return (-1);
+    }
+    while (http->stream.avail_out == 0);
+
+    if (length == 0)
+    {
+      DEBUG_printf(("2httpWrite2: Compressed %lu bytes to %lu bytes.",
+                    http->stream.total_in, http->stream.total_out));
+
+      http_content_coding_finish(http);
+    }
+
+    bytes = (ssize_t)length;
+  }
+  else
+#endif /* HAVE_LIBZ */
+
+ /*
+  * Buffer small writes for better performance...
+  */
+
+  if (length > 0)
+  {
+    if (http->wused && (length + http->wused) > http->wbufsize)
+    {
+      DEBUG_printf(("2httpWrite2: Flushing buffer (wused=%d, length="
+                    CUPS_LLFMT ")", http->wused, CUPS_LLCAST length));
+
+      httpFlushWrite(http);
+
+     /*
+      * The buffer filled up, so this is a bulk transfer - double the
+      * buffer size (up to the limit) to cut down on the number of writes...
+      */
+
+      if (http->wbufsize < _HTTP_MAX_SBUFFER)
+        http_alloc_buffer(http, &http->wbuffer, &http->wbufsize,
+	                  2 * http->wbufsize);
+    }
+
+    if (!http->wbuffer)
+      http_alloc_buffer(http, &http->wbuffer, &http->wbufsize,
+                        HTTP_MAX_BUFFER);
+
+    if (http->wbuffer && (length + http->wused) <= http->wbufsize &&
+        length < http->wbufsize)
+    {
      /*
       * Write to buffer...
       */
@@ -3288,6 +3490,44 @@ _httpWriteGNUTLS(
 #endif /* HAVE_SSL && HAVE_GNUTLS */
 
 
+/*
+ * 'http_alloc_buffer()' - Allocate or grow a connection data buffer.
+ *
+ * Existing buffer contents are preserved.
+ */
+
+static int				/* O  - 0 on success, -1 on error */
+http_alloc_buffer(http_t *http,		/* I  - Connection */
+                  char   **buffer,	/* IO - Buffer */
+		  size_t *bufsize,	/* IO - Size of buffer */
+		  size_t size)		/* I  - Minimum size of buffer */
+{
+  char	*temp;				/* New buffer */
+
+
+  if (*buffer && *bufsize >= size)
+    return (0);
+
+  if (size > _HTTP_MAX_SBUFFER)
+    size = _HTTP_MAX_SBUFFER;
+
+  DEBUG_printf(("4http_alloc_buffer(http=%p, buffer=%p, bufsize=" CUPS_LLFMT
+                ", size=" CUPS_LLFMT ")", http, *buffer,
+		CUPS_LLCAST *bufsize, CUPS_LLCAST size));
+
+  if ((temp = realloc(*buffer, size)) == NULL)
+  {
+    http->error = ENOMEM;
+    return (-1);
+  }
+
+  *buffer  = temp;
+  *bufsize = size;
+
+  return (0);
+}
+
+
 #if defined(HAVE_SSL) && defined(HAVE_LIBSSL)
 /*
  * 'http_bio_ctrl()' - Control the HTTP connection.
@@ -3414,101 +3654,617 @@ http_bio_read(BIO  *h,			/* I - BIO data */
 #else
       http->error = ETIMEDOUT;
 #endif /* WIN32 */
-
-      return (-1);
+
+      return (-1);
+    }
+  }
+
+  return (recv(http->fd, buf, size, 0));
+}
+
+
+/*
+ * 'http_bio_write()' - Write data for OpenSSL.
+ */
+
+static int				/* O - Bytes written */
+http_bio_write(BIO        *h,		/* I - BIO data */
+               const char *buf,		/* I - Buffer to write */
+	       int        num)		/* I - Number of bytes to write */
+{
+  return (send(((http_t *)h->ptr)->fd, buf, num, 0));
+}
+#endif /* HAVE_SSL && HAVE_LIBSSL */
+
+
+#ifdef HAVE_LIBZ
+/*
+ * 'http_content_coding_finish()' - Finish doing any content encoding.
+ */
+
+static void
+http_content_coding_finish(
+    http_t *http)			/* I - Connection */
+{
+  switch (http->coding)
+  {
+    case _HTTP_CODING_GZIP :
+    case _HTTP_CODING_DEFLATE :
+        deflateEnd(&(http->stream));
+        break;
+
+    case _HTTP_CODING_GUNZIP :
+    case _HTTP_CODING_INFLATE :
+        inflateEnd(&(http->stream));
+        break;
+
+    default :
+        break;
+  }
+
+  if (http->sbuffer)
+  {
+    free(http->sbuffer);
+    http->sbuffer = NULL;
+  }
+
+  http->coding = _HTTP_CODING_IDENTITY;
+}
+
+
+/*
+ * 'http_content_coding_start()' - Start doing content encoding.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+http_content_coding_start(
+    http_t         *http,		/* I - Connection */
+    _http_coding_t coding)		/* I - Content coding */
+{
+  int	zerr;				/* zlib status */
+
+
+  DEBUG_printf(("7http_content_coding_start(http=%p, coding=%d)", http,
+                coding));
+
+  if (http->coding)
+    http_content_coding_finish(http);
+
+  if ((http->sbuffer = malloc(_HTTP_MAX_SBUFFER)) == NULL)
+  {
+    http->error = errno;
+    return (-1);
+  }
+
+  memset(&(http->stream), 0, sizeof(http->stream));
+
+  switch (coding)
+  {
+    case _HTTP_CODING_GZIP :
+    case _HTTP_CODING_DEFLATE :
+       /*
+        * gzip uses a 16 byte header on the zlib stream (15 + 16 = 31)...
+	*/
+
+        zerr = deflateInit2(&(http->stream), Z_DEFAULT_COMPRESSION,
+	                    Z_DEFLATED,
+			    coding == _HTTP_CODING_GZIP ? 31 : 15, 8,
+			    Z_DEFAULT_STRATEGY);
+        break;
+
+    case _HTTP_CODING_GUNZIP :
+    case _HTTP_CODING_INFLATE :
+       /*
+        * Automatically detect the gzip or zlib header (15 + 32 = 47)...
+	*/
+
+        zerr = inflateInit2(&(http->stream), 47);
+        break;
+
+    default :
+        zerr = Z_STREAM_ERROR;
+        break;
+  }
+
+  if (zerr != Z_OK)
+  {
+    DEBUG_printf(("8http_content_coding_start: zlib error %d", zerr));
+
+    free(http->sbuffer);
+    http->sbuffer = NULL;
+    http->error   = zerr == Z_MEM_ERROR ? ENOMEM : EINVAL;
+
+    return (-1);
+  }
+
+  http->coding = coding;
+
+  return (0);
+}
+#endif /* HAVE_LIBZ */
+
+
+#ifdef DEBUG
+/*
+ * 'http_debug_hex()' - Do a hex dump of a buffer.
+ */
+
+static void
+http_debug_hex(const char *prefix,	/* I - Prefix for line */
+               const char *buffer,	/* I - Buffer to dump */
+               int        bytes)	/* I - Bytes to dump */
+{
+  int	i, j,				/* Looping vars */
+	ch;				/* Current character */
+  char	line[255],			/* Line buffer */
+	*start,				/* Start of line after prefix */
+	*ptr;				/* Pointer into line */
+
+
+  if (_cups_debug_fd < 0 || _cups_debug_level < 6)
+    return;
+
+  DEBUG_printf(("6%s: %d bytes:", prefix, bytes));
+
+  snprintf(line, sizeof(line), "6%s: ", prefix);
+  start = line + strlen(line);
+
+  for (i = 0; i < bytes; i += 16)
+  {
+    for (j = 0, ptr = start; j < 16 && (i + j) < bytes; j ++, ptr += 2)
+      sprintf(ptr, "%02X", buffer[i + j] & 255);
+
+    while (j < 16)
+    {
+      strcpy(ptr, "  ");
+      ptr += 2;
+      j ++;
+    }
+
+    strcpy(ptr, "  ");
+    ptr += 2;
+
+    for (j = 0; j < 16 && (i + j) < bytes; j ++)
+    {
+      ch = buffer[i + j] & 255;
+
+      if (ch < ' ' || ch >= 127)
+	ch = '.';
+
+      *ptr++ = ch;
+    }
+
+    *ptr = '\0';
+    DEBUG_puts(line);
+  }
+}
+#endif /* DEBUG */
+
+
+/*
+ * 'http_field()' - Return the field index for a field name.
+ */
+
+static http_field_t			/* O - Field index */
+http_field(const char *name)		/* I - String name */
+{
+  int	i;				/* Looping var */
+
+
+  for (i = 0; i < HTTP_FIELD_MAX; i ++)
+    if (_cups_strcasecmp(name, http_fields[i]) == 0)
+      return ((http_field_t)i);
+
+  return (HTTP_FIELD_UNKNOWN);
+}
+
+
+/*
+ * 'http_fill_buffer()' - Prepare the input buffer for a body read.
+ *
+ * The buffer must be empty.  It starts at HTTP_MAX_BUFFER bytes and doubles
+ * (up to _HTTP_MAX_SBUFFER bytes) whenever the remaining message body does
+ * not fit, so that bulk transfers need fewer system calls.
+ */
+
+static ssize_t				/* O - Number of bytes to read or -1 */
+http_fill_buffer(http_t *http)		/* I - Connection */
+{
+  size_t	size;			/* Size of buffer */
+
+
+  if ((size = http->bufsize) < HTTP_MAX_BUFFER)
+    size = HTTP_MAX_BUFFER;
+  else if (http->data_remaining > (off_t)size && size < _HTTP_MAX_SBUFFER)
+    size *= 2;
+
+  if (http_alloc_buffer(http, &http->buffer, &http->bufsize, size))
+    return (-1);
+
+  http->bufptr = http->buffer;
+
+  if (http->data_remaining > (off_t)http->bufsize)
+    return ((ssize_t)http->bufsize);
+  else
+    return ((ssize_t)http->data_remaining);
+}
+
+
+#if defined(HAVE_SSL) && (defined(HAVE_LIBSSL) || defined(HAVE_GNUTLS))
+/*
+ * 'http_find_session()' - Find the saved TLS session for a connection.
+ *
+ * The caller must hold the http_tls_mutex lock.  When "create" is non-zero,
+ * the least recently used entry is reused for the connection as needed.
+ */
+
+static _http_tls_session_t *		/* O - Saved session or NULL */
+http_find_session(http_t *http,		/* I - Connection to server */
+                  int    create)	/* I - Create entry if not found? */
+{
+  int			i,		/* Looping var */
+			port;		/* Server port */
+  _http_tls_session_t	*session,	/* Current session */
+			*oldest;	/* Least recently used session */
+
+
+  port = _httpAddrPort(http->hostaddr);
+
+  for (i = _HTTP_MAX_TLS_SESSIONS, session = http_tls_sessions,
+           oldest = http_tls_sessions;
+       i > 0;
+       i --, session ++)
+  {
+    if (session->port == port && !_cups_strcasecmp(session->hostname,
+                                                   http->hostname))
+      return (session);
+
+    if (session->used < oldest->used)
+      oldest = session;
+  }
+
+  if (!create)
+    return (NULL);
+
+#  ifdef HAVE_LIBSSL
+  if (oldest->session)
+    SSL_SESSION_free(oldest->session);
+
+  oldest->session = NULL;
+#  else
+  if (oldest->session.data)
+    gnutls_free(oldest->session.data);
+
+  oldest->session.data = NULL;
+  oldest->session.size = 0;
+#  endif /* HAVE_LIBSSL */
+
+  strlcpy(oldest->hostname, http->hostname, sizeof(oldest->hostname));
+  oldest->port = port;
+
+  return (oldest);
+}
+
+
+/*
+ * 'http_load_session()' - Use a saved TLS session for a connection.
+ */
+
+static void
+http_load_session(http_t *http)		/* I - Connection to server */
+{
+  _http_tls_session_t	*session;	/* Saved session */
+
+
+  _cupsMutexLock(&http_tls_mutex);
+
+  if ((session = http_find_session(http, 0)) != NULL)
+  {
+#  ifdef HAVE_LIBSSL
+    if (session->session)
+      SSL_set_session(http->tls, session->session);
+#  else
+    if (session->session.data)
+      gnutls_session_set_data(http->tls, session->session.data,
+                              session->session.size);
+#  endif /* HAVE_LIBSSL */
+
+    session->used = time(NULL);
+
+    DEBUG_printf(("8http_load_session: Using saved session for %s:%d.",
+                  session->hostname, session->port));
+  }
+
+  _cupsMutexUnlock(&http_tls_mutex);
+}
+#endif /* HAVE_SSL && (HAVE_LIBSSL || HAVE_GNUTLS) */
+
+
+/*
+ * 'http_read()' - Read message body data without content decoding.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+http_read(http_t *http,			/* I - Connection to server */
+          char   *buffer,		/* I - Buffer for data */
+	  size_t length)		/* I - Maximum number of bytes */
+{
+  ssize_t	bytes;			/* Bytes read */
+  char		len[32];		/* Length string */
+
+
+  if (http->data_encoding == HTTP_ENCODE_CHUNKED &&
+      http->data_remaining <= 0)
+  {
+    DEBUG_puts("2http_read: Getting chunk length...");
+
+    if (httpGets(len, sizeof(len), http) == NULL)
+    {
+      DEBUG_puts("1http_read: Could not get length!");
+      return (0);
+    }
+
+    http->data_remaining = strtoll(len, NULL, 16);
+    if (http->data_remaining < 0)
+    {
+      DEBUG_puts("1http_read: Negative chunk length!");
+      return (0);
+    }
+  }
+
+  DEBUG_printf(("2http_read: data_remaining=" CUPS_LLFMT,
+                CUPS_LLCAST http->data_remaining));
+
+  if (http->data_remaining <= 0)
+  {
+   /*
+    * A zero-length chunk ends a transfer; unless we are reading POST
+    * data, go idle...
+    */
+
+    if (http->data_encoding == HTTP_ENCODE_CHUNKED)
+      httpGets(len, sizeof(len), http);
+
+    if (http->state == HTTP_POST_RECV)
+      http->state ++;
+    else
+      http->state = HTTP_WAITING;
+
+   /*
+    * Prevent future reads for this request...
+    */
+
+    http->data_encoding = HTTP_ENCODE_LENGTH;
+
+    return (0);
+  }
+  else if (length > (size_t)http->data_remaining)
+    length = (size_t)http->data_remaining;
+
+  if (http->used == 0 && length <= 256)
+  {
+   /*
+    * Buffer small reads for better performance...
+    */
+
+    ssize_t	buflen;			/* Length of read for buffer */
+
+    if (!http->blocking)
+    {
+      while (!httpWait(http, http->wait_value))
+      {
+	if (http->timeout_cb && (*http->timeout_cb)(http, http->timeout_data))
+	  continue;
+
+	return (0);
+      }
+    }
+
+    if ((buflen = http_fill_buffer(http)) < 0)
+      return (-1);
+
+    DEBUG_printf(("2http_read: Reading %d bytes into buffer.", (int)buflen));
+
+    do
+    {
+#ifdef HAVE_SSL
+      if (http->tls)
+	bytes = http_read_ssl(http, http->buffer, (int)buflen);
+      else
+#endif /* HAVE_SSL */
+      bytes = recv(http->fd, http->buffer, buflen, 0);
+
+      if (bytes < 0)
+      {
+#ifdef WIN32
+	if (WSAGetLastError() != WSAEINTR)
+	{
+	  http->error = WSAGetLastError();
+	  return (-1);
+	}
+	else if (WSAGetLastError() == WSAEWOULDBLOCK)
+	{
+	  if (!http->timeout_cb ||
+	      !(*http->timeout_cb)(http, http->timeout_data))
+	  {
+	    http->error = WSAEWOULDBLOCK;
+	    return (-1);
+	  }
+	}
+#else
+	if (errno == EWOULDBLOCK || errno == EAGAIN)
+	{
+	  if (http->timeout_cb && !(*http->timeout_cb)(http, http->timeout_data))
+	  {
+	    http->error = errno;
+	    return (-1);
+	  }
+	  else if (!http->timeout_cb && errno != EAGAIN)
+	  {
+	    http->error = errno;
+	    return (-1);
+	  }
+	}
+	else if (errno != EINTR)
+	{
+	  http->error = errno;
+	  return (-1);
+	}
+#endif /* WIN32 */
+      }
     }
-  }
-
-  return (recv(http->fd, buf, size, 0));
-}
-
-
-/*
- * 'http_bio_write()' - Write data for OpenSSL.
- */
-
-static int				/* O - Bytes written */
-http_bio_write(BIO        *h,		/* I - BIO data */
-               const char *buf,		/* I - Buffer to write */
-	       int        num)		/* I - Number of bytes to write */
-{
-  return (send(((http_t *)h->ptr)->fd, buf, num, 0));
-}
-#endif /* HAVE_SSL && HAVE_LIBSSL */
-
+    while (bytes < 0);
 
+    DEBUG_printf(("2http_read: Read " CUPS_LLFMT " bytes into buffer.",
+                  CUPS_LLCAST bytes));
 #ifdef DEBUG
-/*
- * 'http_debug_hex()' - Do a hex dump of a buffer.
- */
-
-static void
-http_debug_hex(const char *prefix,	/* I - Prefix for line */
-               const char *buffer,	/* I - Buffer to dump */
-               int        bytes)	/* I - Bytes to dump */
-{
-  int	i, j,				/* Looping vars */
-	ch;				/* Current character */
-  char	line[255],			/* Line buffer */
-	*start,				/* Start of line after prefix */
-	*ptr;				/* Pointer into line */
+    http_debug_hex("http_read", http->buffer, (int)bytes);
+#endif /* DEBUG */
 
+    http->used = bytes;
+  }
 
-  if (_cups_debug_fd < 0 || _cups_debug_level < 6)
-    return;
+  if (http->used > 0)
+  {
+    if (length > (size_t)http->used)
+      length = (size_t)http->used;
 
-  DEBUG_printf(("6%s: %d bytes:", prefix, bytes));
+    bytes = (ssize_t)length;
 
-  snprintf(line, sizeof(line), "6%s: ", prefix);
-  start = line + strlen(line);
+    DEBUG_printf(("2http_read: grabbing %d bytes from input buffer...",
+                  (int)bytes));
 
-  for (i = 0; i < bytes; i += 16)
+    memcpy(buffer, http->bufptr, length);
+    http->used   -= (int)length;
+    http->bufptr += length;
+  }
+#ifdef HAVE_SSL
+  else if (http->tls)
   {
-    for (j = 0, ptr = start; j < 16 && (i + j) < bytes; j ++, ptr += 2)
-      sprintf(ptr, "%02X", buffer[i + j] & 255);
-
-    while (j < 16)
+    if (!http->blocking)
     {
-      strcpy(ptr, "  ");
-      ptr += 2;
-      j ++;
-    }
+      while (!httpWait(http, http->wait_value))
+      {
+	if (http->timeout_cb && (*http->timeout_cb)(http, http->timeout_data))
+	  continue;
 
-    strcpy(ptr, "  ");
-    ptr += 2;
+	return (0);
+      }
+    }
 
-    for (j = 0; j < 16 && (i + j) < bytes; j ++)
+    while ((bytes = (ssize_t)http_read_ssl(http, buffer, (int)length)) < 0)
     {
-      ch = buffer[i + j] & 255;
-
-      if (ch < ' ' || ch >= 127)
-	ch = '.';
+#ifdef WIN32
+      if (WSAGetLastError() == WSAEWOULDBLOCK)
+      {
+        if (!http->timeout_cb || !(*http->timeout_cb)(http, http->timeout_data))
+	  break;
+      }
+      else if (WSAGetLastError() != WSAEINTR)
+        break;
+#else
+      if (errno == EWOULDBLOCK || errno == EAGAIN)
+      {
+        if (http->timeout_cb && !(*http->timeout_cb)(http, http->timeout_data))
+	  break;
+        else if (!http->timeout_cb && errno != EAGAIN)
+	  break;
+      }
+      else if (errno != EINTR)
+        break;
+#endif /* WIN32 */
+    }
+  }
+#endif /* HAVE_SSL */
+  else
+  {
+    if (!http->blocking)
+    {
+      while (!httpWait(http, http->wait_value))
+      {
+	if (http->timeout_cb && (*http->timeout_cb)(http, http->timeout_data))
+	  continue;
 
-      *ptr++ = ch;
+	return (0);
+      }
     }
 
-    *ptr = '\0';
-    DEBUG_puts(line);
-  }
-}
-#endif /* DEBUG */
+    DEBUG_printf(("2http_read: reading " CUPS_LLFMT " bytes from socket...",
+                  CUPS_LLCAST length));
 
+#ifdef WIN32
+    while ((bytes = (ssize_t)recv(http->fd, buffer, (int)length, 0)) < 0)
+    {
+      if (WSAGetLastError() == WSAEWOULDBLOCK)
+      {
+        if (!http->timeout_cb || !(*http->timeout_cb)(http, http->timeout_data))
+	  break;
+      }
+      else if (WSAGetLastError() != WSAEINTR)
+        break;
+    }
+#else
+    while ((bytes = recv(http->fd, buffer, length, 0)) < 0)
+    {
+      if (errno == EWOULDBLOCK || errno == EAGAIN)
+      {
+        if (http->timeout_cb && !(*http->timeout_cb)(http, http->timeout_data))
+	  break;
+        else if (!http->timeout_cb && errno != EAGAIN)
+	  break;
+      }
+      else if (errno != EINTR)
+        break;
+    }
+#endif /* WIN32 */
 
-/*
- * 'http_field()' - Return the field index for a field name.
- */
+    DEBUG_printf(("2http_read: read " CUPS_LLFMT " bytes from socket...",
+                  CUPS_LLCAST bytes));
+#ifdef DEBUG
+    http_debug_hex("http_read", buffer, (int)bytes);
+#endif /* DEBUG */
+  }
 
-static http_field_t			/* O - Field index */
-http_field(const char *name)		/* I - String name */
-{
-  int	i;				/* Looping var */
+  if (bytes > 0)
+  {
+    http->data_remaining -= bytes;
 
+    if (http->data_remaining <= INT_MAX)
+      http->_data_remaining = (int)http->data_remaining;
+    else
+      http->_data_remaining = INT_MAX;
+  }
+  else if (bytes < 0)
+  {
+#ifdef WIN32
+    if (WSAGetLastError() == WSAEINTR)
+      bytes = 0;
+    else
+      http->error = WSAGetLastError();
+#else
+    if (errno == EINTR || (errno == EAGAIN && !http->timeout_cb))
+      bytes = 0;
+    else
+      http->error = errno;
+#endif /* WIN32 */
+  }
+  else
+  {
+    http->error = EPIPE;
+    return (0);
+  }
 
-  for (i = 0; i < HTTP_FIELD_MAX; i ++)
-    if (_cups_strcasecmp(name, http_fields[i]) == 0)
-      return ((http_field_t)i);
+  if (http->data_remaining == 0)
+  {
+    if (http->data_encoding == HTTP_ENCODE_CHUNKED)
+      httpGets(len, sizeof(len), http);
+    else if (http->state == HTTP_POST_RECV)
+      http->state ++;
+    else
+      http->state = HTTP_WAITING;
+  }
 
-  return (HTTP_FIELD_UNKNOWN);
+  return (bytes);
 }
 
 
@@ -3603,6 +4359,52 @@ http_read_ssl(http_t *http,		/* I - Connection to server */
 #endif /* HAVE_SSL */
 
 
+#if defined(HAVE_SSL) && (defined(HAVE_LIBSSL) || defined(HAVE_GNUTLS))
+/*
+ * 'http_save_session()' - Save the TLS session for a connection.
+ *
+ * Sessions are saved when the connection is shut down since TLS 1.3 servers
+ * send their session tickets after the handshake.
+ */
+
+static void
+http_save_session(http_t *http)		/* I - Connection to server */
+{
+  _http_tls_session_t	*session;	/* Saved session */
+#  ifdef HAVE_LIBSSL
+  SSL_SESSION		*data;		/* Session data */
+
+
+  if ((data = SSL_get1_session(http->tls)) == NULL)
+    return;
+#  else
+  gnutls_datum_t	data;		/* Session data */
+
+
+  if (gnutls_session_get_data2(http->tls, &data))
+    return;
+#  endif /* HAVE_LIBSSL */
+
+  _cupsMutexLock(&http_tls_mutex);
+
+  session = http_find_session(http, 1);
+
+#  ifdef HAVE_LIBSSL
+  if (session->session)
+    SSL_SESSION_free(session->session);
+#  else
+  if (session->session.data)
+    gnutls_free(session->session.data);
+#  endif /* HAVE_LIBSSL */
+
+  session->session = data;
+  session->used    = time(NULL);
+
+  _cupsMutexUnlock(&http_tls_mutex);
+}
+#endif /* HAVE_SSL && (HAVE_LIBSSL || HAVE_GNUTLS) */
+
+
 /*
  * 'http_send()' - Send a request with all fields and the trailing blank line.
  */
@@ -3638,6 +4440,15 @@ http_send(http_t       *http,	/* I - Connection to server */
   if (http == NULL || uri == NULL)
     return (-1);
 
+#ifdef HAVE_LIBZ
+ /*
+  * Stop any content coding left over from the previous response...
+  */
+
+  if (http->coding)
+    http_content_coding_finish(http);
+#endif /* HAVE_LIBZ */
+
  /*
   * Set the User-Agent field if it isn't already...
   */
@@ -3983,6 +4794,8 @@ http_setup_ssl(http_t *http)		/* I - Connection to server */
   SSL_set_tlsext_host_name(http->tls, hostname);
 #   endif /* HAVE_SSL_SET_TLSEXT_HOST_NAME */
 
+  http_load_session(http);
+
   if (SSL_connect(http->tls) != 1)
   {
     unsigned long	error;	/* Error code */
@@ -4012,6 +4825,14 @@ http_setup_ssl(http_t *http)		/* I - Connection to server */
     return (-1);
   }
 
+  _cupsMutexLock(&http_tls_mutex);
+  http_tls_handshakes ++;
+  if (SSL_session_reused(http->tls))
+    http_tls_resumed ++;
+  DEBUG_printf(("8http_setup_ssl: %d handshakes, %d resumed sessions.",
+                http_tls_handshakes, http_tls_resumed));
+  _cupsMutexUnlock(&http_tls_mutex);
+
 #  elif defined(HAVE_GNUTLS)
   (void)any_root;
 
@@ -4039,6 +4860,8 @@ http_setup_ssl(http_t *http)		/* I - Connection to server */
   gnutls_transport_set_pull_function(http->tls, _httpReadGNUTLS);
   gnutls_transport_set_push_function(http->tls, _httpWriteGNUTLS);
 
+  http_load_session(http);
+
   while ((status = gnutls_handshake(http->tls)) != GNUTLS_E_SUCCESS)
   {
     DEBUG_printf(("8http_setup_ssl: gnutls_handshake returned %d (%s)",
@@ -4062,6 +4885,14 @@ http_setup_ssl(http_t *http)		/* I - Connection to server */
 
   http->tls_credentials = credentials;
 
+  _cupsMutexLock(&http_tls_mutex);
+  http_tls_handshakes ++;
+  if (gnutls_session_is_resumed(http->tls))
+    http_tls_resumed ++;
+  DEBUG_printf(("8http_setup_ssl: %d handshakes, %d resumed sessions.",
+                http_tls_handshakes, http_tls_resumed));
+  _cupsMutexUnlock(&http_tls_mutex);
+
 #  elif defined(HAVE_CDSASSL)
   if ((error = SSLNewContext(false, &http->tls)))
   {
@@ -4373,6 +5204,8 @@ http_shutdown_ssl(http_t *http)		/* I - Connection to server */
 
   context = SSL_get_SSL_CTX(http->tls);
 
+  http_save_session(http);
+
   SSL_shutdown(http->tls);
   SSL_CTX_free(context);
   SSL_free(http->tls);
@@ -4383,6 +5216,8 @@ http_shutdown_ssl(http_t *http)		/* I - Connection to server */
 
   credentials = (gnutls_certificate_client_credentials *)(http->tls_credentials);
 
+  http_save_session(http);
+
   gnutls_bye(http->tls, GNUTLS_SHUT_RDWR);
   gnutls_deinit(http->tls);
   gnutls_certificate_free_credentials(*credentials);
@@ -4664,6 +5499,57 @@ http_write_chunk(http_t     *http,	/* I - Connection to server */
   */
 
   sprintf(header, "%x\r\n", length);
+
+#ifndef WIN32
+  if (!http->tls)
+  {
+   /*
+    * Send the whole chunk with a single writev() call; anything that does
+    * not make it out the first time is sent using http_write(), which
+    * handles the timeout and error cases for us...
+    */
+
+    struct iovec	iov[3];		/* Chunk header, data, and trailer */
+    ssize_t		vbytes;		/* Bytes written by writev() */
+    int			i;		/* Looping var */
+
+    iov[0].iov_base = header;
+    iov[0].iov_len  = strlen(header);
+    iov[1].iov_base = (void *)buffer;
+    iov[1].iov_len  = (size_t)length;
+    iov[2].iov_base = (void *)"\r\n";
+    iov[2].iov_len  = 2;
+
+    while ((vbytes = writev(http->fd, iov, 3)) < 0 && errno == EINTR);
+
+    DEBUG_printf(("8http_write_chunk: writev() returned %d.", (int)vbytes));
+
+    if (vbytes < 0)
+      vbytes = 0;
+
+    for (i = 0; i < 3; i ++)
+    {
+      if ((size_t)vbytes >= iov[i].iov_len)
+      {
+        vbytes -= (ssize_t)iov[i].iov_len;
+	continue;
+      }
+
+      if (http_write(http, (char *)iov[i].iov_base + vbytes,
+                     (int)(iov[i].iov_len - (size_t)vbytes)) < 0)
+      {
+	DEBUG_printf(("8http_write_chunk: http_write of segment %d failed!",
+	              i));
+	return (-1);
+      }
+
+      vbytes = 0;
+    }
+
+    return (length);
+  }
+#endif /* !WIN32 */
+
   if (http_write(http, header, (int)strlen(header)) < 0)
   {
     DEBUG_puts("8http_write_chunk: http_write of length failed!");
@@ -172,6 +172,7 @@ typedef enum http_field_e		/**** HTTP field names ****/
   HTTP_FIELD_UPGRADE,			/* Upgrade field */
   HTTP_FIELD_USER_AGENT,		/* User-Agent field */
   HTTP_FIELD_WWW_AUTHENTICATE,		/* WWW-Authenticate field */
+  HTTP_FIELD_ACCEPT_ENCODING,		/* Accept-Encoding field @since CUPS 1.7@ */
   HTTP_FIELD_MAX			/* Maximum field index */
 } http_field_t;
 
@@ -471,6 +472,9 @@ extern http_version_t	httpGetVersion(http_t *http) _CUPS_API_1_6;
 extern int		httpReconnect2(http_t *http, int msec, int *cancel)
 			               _CUPS_API_1_6;
 
+/**** New in CUPS 1.7 ****/
+extern const char	*httpGetContentEncoding(http_t *http) _CUPS_API_1_7;
+
 
 /*
  * C++ magic...
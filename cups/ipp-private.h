@@ -40,6 +40,14 @@ extern "C" {
 
 #  define IPP_BUF_SIZE	(IPP_MAX_LENGTH + 2)
 					/* Size of buffer */
+#  define IPP_ARENA_SIZE	16384	/* Size of attribute arena blocks */
+#  define IPP_INDEX_MIN	32	/* Minimum attributes for a name index */
+#  define IPP_READER_MAX	(256 * IPP_BUF_SIZE)
+					/* Default maximum size of attributes
+					 * buffered by a reader */
+
+#  define _IPP_ATTR_ARENA	1	/* Attribute is allocated from an arena */
+#  define _IPP_ATTR_BORROWED	2	/* Strings may point into read buffer */
 
 
 /*
@@ -56,12 +64,63 @@ typedef struct				/**** Attribute mapping data ****/
 					 * attribute */
 } _ipp_option_t;
 
+typedef struct _ipp_block_s		/**** Attribute arena block ****/
+{
+  struct _ipp_block_s	*next;		/* Next (older) block */
+  size_t		size,		/* Size of data area */
+			used;		/* Bytes used in data area */
+} _ipp_block_t;
+
+typedef struct _ipp_arena_s		/**** Attribute arena ****/
+{
+  int			use;		/* Number of messages using arena */
+  _ipp_block_t		*blocks;	/* Allocated blocks, newest first */
+  ipp_uchar_t		*input;		/* Read buffer with borrowed strings */
+  size_t		inputlen;	/* Length of read buffer */
+  struct _ipp_reader_s	*reader;	/* Reader being parsed, if any */
+} _ipp_arena_t;
+
+typedef struct _ipp_entry_s		/**** Attribute name index entry ****/
+{
+  ipp_attribute_t	*attr,		/* Attribute */
+			*prev;		/* Previous attribute in message */
+  unsigned		hash;		/* Hash of attribute name */
+  int			next;		/* Next entry in bucket or -1 */
+} _ipp_entry_t;
+
+typedef struct _ipp_index_s		/**** Attribute name index ****/
+{
+  int			num_buckets,	/* Number of buckets (power of 2) */
+			num_entries,	/* Number of entries */
+			alloc_entries;	/* Allocated entries */
+  int			*heads,		/* First entry in each bucket */
+			*tails;		/* Last entry in each bucket */
+  _ipp_entry_t		*entries;	/* Entries in message order */
+} _ipp_index_t;
+
+typedef struct _ipp_reader_s		/**** Incremental IPP message reader ****/
+{
+  ipp_uchar_t	*buffer;		/* Message data */
+  size_t	bufsize,		/* Size of buffer */
+		maxsize,		/* Maximum size of attributes or 0 */
+		used,			/* Bytes of data in buffer */
+		scanned,		/* Bytes of complete items in buffer */
+		pos,			/* Current parse/copy position */
+		savedpos;		/* Position of byte replaced by nul */
+  ipp_uchar_t	saved;			/* Byte replaced by nul */
+  int		header;			/* Non-zero when header is scanned */
+} _ipp_reader_t;
+
 
 /*
  * Prototypes for private functions...
  */
 
 extern _ipp_option_t	*_ippFindOption(const char *name);
+extern void		_ippFreeReader(_ipp_reader_t *reader);
+extern ipp_t		*_ippMoveAttributes(ipp_t *ipp);
+extern ipp_state_t	_ippReadHTTP(http_t *http, ipp_t *ipp,
+			             _ipp_reader_t *reader);
 
 
 /*
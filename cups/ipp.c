@@ -44,6 +44,8 @@
  *   ippFindAttribute()     - Find a named attribute in a request.
  *   ippFindNextAttribute() - Find the next named attribute in a request.
  *   ippFirstAttribute()    - Return the first attribute in the message.
+ *   _ippFreeReader()	    - Free the data buffered by an incremental IPP
+ *			      reader.
  *   ippGetBoolean()	    - Get a boolean value for an attribute.
  *   ippGetCollection()     - Get a collection value for an attribute.
  *   ippGetCount()	    - Get the number of values in an attribute.
@@ -63,12 +65,18 @@
  *   ippGetVersion()	    - Get the major and minor version number from an
  *			      IPP message.
  *   ippLength()	    - Compute the length of an IPP message.
+ *   _ippMoveAttributes()   - Move the attributes of a message to a new
+ *			      message on the heap.
  *   ippNextAttribute()     - Return the next attribute in the message.
  *   ippNew()		    - Allocate a new IPP message.
  *   ippNewRequest()	    - Allocate a new IPP request message.
+ *   ippNewWithArena()	    - Allocate a new IPP message whose attributes are
+ *			      allocated from an arena.
  *   ippRead()		    - Read data for an IPP message from a HTTP
  *			      connection.
  *   ippReadFile()	    - Read data for an IPP message from a file.
+ *   _ippReadHTTP()	    - Incrementally read an IPP message from a
+ *			      non-blocking HTTP connection.
  *   ippReadIO()	    - Read data for an IPP message.
  *   ippSetBoolean()	    - Set a boolean value in an attribute.
  *   ippSetCollection()     - Set a collection value in an attribute.
@@ -92,17 +100,31 @@
  *   ippWriteFile()	    - Write data for an IPP message to a file.
  *   ippWriteIO()	    - Write data for an IPP message.
  *   ipp_add_attr()	    - Add a new attribute to the message.
+ *   ipp_arena_alloc()	    - Allocate zeroed memory from an attribute arena.
+ *   ipp_arena_release()    - Release a reference to an attribute arena.
  *   ipp_free_values()	    - Free attribute values.
  *   ipp_get_code()	    - Convert a C locale/charset name into an IPP
  *			      language/charset code.
+ *   ipp_index_add()	    - Add an attribute to a message's name index.
+ *   ipp_index_build()	    - Build the name index for a message.
+ *   ipp_index_free()	    - Free the name index for a message.
+ *   ipp_index_hash()	    - Compute the case-insensitive hash of an
+ *			      attribute name.
  *   ipp_lang_code()	    - Convert a C locale name into an IPP language
  *			      code.
  *   ipp_length()	    - Compute the length of an IPP message or
  *			      collection value.
+ *   ipp_move_attrs()	    - Move attributes to another message, moving arena
+ *			      attributes to the heap.
  *   ipp_read_http()	    - Semi-blocking read on a HTTP connection...
  *   ipp_read_file()	    - Read IPP data from a file.
+ *   ipp_reader_borrow()    - Borrow a string from a reader buffer.
+ *   ipp_reader_read()	    - Read IPP data from a reader buffer.
+ *   ipp_reader_scan()	    - Find the end of the attributes in a reader
+ *			      buffer.
  *   ipp_set_value()	    - Get the value element from an attribute,
  *			      expanding it as needed.
+ *   ipp_unborrow()	    - Copy strings borrowed from an arena's read buffer.
  *   ipp_write_file()	    - Write IPP data to a file.
  */
 
@@ -123,11 +145,20 @@
 static ipp_attribute_t	*ipp_add_attr(ipp_t *ipp, const char *name,
 			              ipp_tag_t  group_tag, ipp_tag_t value_tag,
 			              int num_values);
+static void		*ipp_arena_alloc(_ipp_arena_t *arena, size_t size);
+static void		ipp_arena_release(_ipp_arena_t *arena);
 static void		ipp_free_values(ipp_attribute_t *attr, int element,
 			                int count);
 static char		*ipp_get_code(const char *locale, char *buffer,
 			              size_t bufsize)
 			              __attribute__((nonnull(1,2)));
+static int		ipp_move_attrs(ipp_t *dst, ipp_t *src);
+static int		ipp_index_add(_ipp_index_t *index,
+			              ipp_attribute_t *attr,
+			              ipp_attribute_t *prev);
+static void		ipp_index_build(ipp_t *ipp);
+static void		ipp_index_free(ipp_t *ipp);
+static unsigned		ipp_index_hash(const char *name);
 static char		*ipp_lang_code(const char *locale, char *buffer,
 			               size_t bufsize)
 			               __attribute__((nonnull(1,2)));
@@ -136,8 +167,15 @@ static ssize_t		ipp_read_http(http_t *http, ipp_uchar_t *buffer,
 			              size_t length);
 static ssize_t		ipp_read_file(int *fd, ipp_uchar_t *buffer,
 			              size_t length);
+static char		*ipp_reader_borrow(_ipp_reader_t *reader, int length);
+static ssize_t		ipp_reader_read(_ipp_reader_t *reader,
+			                ipp_uchar_t *buffer, size_t length);
+static int		ipp_reader_scan(_ipp_reader_t *reader);
 static _ipp_value_t	*ipp_set_value(ipp_t *ipp, ipp_attribute_t **attr,
 			               int element);
+static int		ipp_unborrow(_ipp_arena_t *arena,
+			             ipp_attribute_t *attr,
+				     ipp_attribute_t *temp);
 static ssize_t		ipp_write_file(int *fd, ipp_uchar_t *buffer,
 			               size_t length);
 
@@ -1316,7 +1354,8 @@ ippCopyAttribute(
 	       i --, srcval ++, dstval ++)
 	    dstval->string.text = srcval->string.text;
         }
-	else if (srcattr->value_tag & IPP_TAG_COPY)
+	else if ((srcattr->value_tag & IPP_TAG_COPY) ||
+	         (srcattr->flags & _IPP_ATTR_BORROWED))
 	{
 	  for (i = srcattr->num_values, srcval = srcattr->values,
 	           dstval = dstattr->values;
@@ -1393,7 +1432,8 @@ ippCopyAttribute(
 	    dstval->string.text     = srcval->string.text;
           }
         }
-	else if (srcattr->value_tag & IPP_TAG_COPY)
+	else if ((srcattr->value_tag & IPP_TAG_COPY) ||
+	         (srcattr->flags & _IPP_ATTR_BORROWED))
 	{
 	  for (i = srcattr->num_values, srcval = srcattr->values,
 	           dstval = dstattr->values;
@@ -1435,8 +1475,23 @@ ippCopyAttribute(
              i > 0;
              i --, srcval ++, dstval ++)
 	{
-	  dstval->collection = srcval->collection;
-	  srcval->collection->use ++;
+	  if (!quickcopy && srcval->collection->arena &&
+	      srcval->collection->arena != dst->arena)
+	  {
+	   /*
+	    * Don't keep another message's arena alive - copy the collection
+	    * into a normal message instead...
+	    */
+
+	    if ((dstval->collection = ippNew()) != NULL)
+	      ippCopyAttributes(dstval->collection, srcval->collection, 0,
+	                        NULL, NULL);
+	  }
+	  else
+	  {
+	    dstval->collection = srcval->collection;
+	    srcval->collection->use ++;
+	  }
 	}
         break;
 
@@ -1600,9 +1655,16 @@ ippDelete(ipp_t *ipp)			/* I - IPP message */
     if (attr->name)
       _cupsStrFree(attr->name);
 
-    free(attr);
+    if (!(attr->flags & _IPP_ATTR_ARENA))
+      free(attr);
   }
 
+  if (ipp->index)
+    ipp_index_free(ipp);
+
+  if (ipp->arena)
+    ipp_arena_release(ipp->arena);
+
   free(ipp);
 }
 
@@ -1610,6 +1672,10 @@ ippDelete(ipp_t *ipp)			/* I - IPP message */
 /*
  * 'ippDeleteAttribute()' - Delete a single attribute in an IPP message.
  *
+ * Attributes of a message created with @link ippNewWithArena@ are allocated
+ * from the message's arena and can only be deleted from that message; when
+ * the @code ipp@ parameter is @code NULL@ such attributes are left alone.
+ *
  * @since CUPS 1.1.19/OS X 10.3@
  */
 
@@ -1632,6 +1698,12 @@ ippDeleteAttribute(
   if (!attr)
     return;
 
+  if (!ipp && (attr->flags & _IPP_ATTR_ARENA))
+  {
+    DEBUG_puts("1ippDeleteAttribute: Arena attribute without a message.");
+    return;
+  }
+
  /*
   * Find the attribute in the list...
   */
@@ -1655,11 +1727,29 @@ ippDeleteAttribute(
 	if (current == ipp->last)
 	  ipp->last = prev;
 
+        if (current == ipp->current)
+	{
+	 /*
+	  * Back up so that ippNextAttribute continues with the next
+	  * attribute; if the first attribute was deleted, continue with the
+	  * new first attribute...
+	  */
+
+	  ipp->current = prev;
+	  ipp->prev    = NULL;
+	  ipp->atfirst = prev == NULL;
+	}
+	else if (current == ipp->prev)
+	  ipp->prev = NULL;
+
         break;
       }
 
     if (!current)
       return;
+
+    if (ipp->index)
+      ipp_index_free(ipp);
   }
 
  /*
@@ -1671,7 +1761,12 @@ ippDeleteAttribute(
   if (attr->name)
     _cupsStrFree(attr->name);
 
-  free(attr);
+ /*
+  * Attributes in an arena are freed along with the message...
+  */
+
+  if (!(attr->flags & _IPP_ATTR_ARENA))
+    free(attr);
 }
 
 
@@ -1765,6 +1860,11 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
 {
   ipp_attribute_t	*attr;		/* Current atttribute */
   ipp_tag_t		value_tag;	/* Value tag */
+  int			count;		/* Number of attributes searched */
+  _ipp_index_t		*index;		/* Attribute name index */
+  _ipp_entry_t		*entry;		/* Current index entry */
+  unsigned		hash;		/* Hash of name */
+  int			i;		/* Looping var */
 
 
   DEBUG_printf(("2ippFindNextAttribute(ipp=%p, name=\"%s\", type=%02x(%s))",
@@ -1773,15 +1873,53 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
   if (!ipp || !name)
     return (NULL);
 
+  ipp->atfirst = 0;
+
+  if (!ipp->current && (index = ipp->index) != NULL)
+  {
+   /*
+    * Search from the start of a large message using the name index...
+    */
+
+    hash = ipp_index_hash(name);
+
+    for (i = index->heads[hash & (index->num_buckets - 1)];
+         i >= 0;
+	 i = entry->next)
+    {
+      entry     = index->entries + i;
+      attr      = entry->attr;
+      value_tag = (ipp_tag_t)(attr->value_tag & IPP_TAG_MASK);
+
+      if (entry->hash == hash && _cups_strcasecmp(attr->name, name) == 0 &&
+          (value_tag == type || type == IPP_TAG_ZERO ||
+	   (value_tag == IPP_TAG_TEXTLANG && type == IPP_TAG_TEXT) ||
+	   (value_tag == IPP_TAG_NAMELANG && type == IPP_TAG_NAME)))
+      {
+        ipp->current = attr;
+	ipp->prev    = entry->prev;
+
+	return (attr);
+      }
+    }
+
+    ipp->current = NULL;
+    ipp->prev    = NULL;
+
+    return (NULL);
+  }
+
   if (ipp->current)
   {
     ipp->prev = ipp->current;
     attr      = ipp->current->next;
+    count     = -1;
   }
   else
   {
     ipp->prev = NULL;
     attr      = ipp->attrs;
+    count     = 0;
   }
 
   for (; attr != NULL; ipp->prev = attr, attr = attr->next)
@@ -1800,11 +1938,22 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
 
       return (attr);
     }
+
+    if (count >= 0)
+      count ++;
   }
 
   ipp->current = NULL;
   ipp->prev    = NULL;
 
+ /*
+  * Index the message once a search from the start has to look at a lot of
+  * attributes; small messages are never indexed...
+  */
+
+  if (count >= IPP_INDEX_MIN)
+    ipp_index_build(ipp);
+
   return (NULL);
 }
 
@@ -1829,10 +1978,29 @@ ippFirstAttribute(ipp_t *ipp)		/* I - IPP message */
   * Return the first attribute...
   */
 
+  ipp->atfirst = 0;
+
   return (ipp->current = ipp->attrs);
 }
 
 
+/*
+ * '_ippFreeReader()' - Free the data buffered by an incremental IPP reader.
+ */
+
+void
+_ippFreeReader(_ipp_reader_t *reader)	/* I - IPP reader */
+{
+  if (!reader)
+    return;
+
+  if (reader->buffer)
+    free(reader->buffer);
+
+  memset(reader, 0, sizeof(_ipp_reader_t));
+}
+
+
 /*
  * 'ippGetBoolean()' - Get a boolean value for an attribute.
  *
@@ -2296,6 +2464,41 @@ ippLength(ipp_t *ipp)			/* I - IPP message */
 }
 
 
+/*
+ * '_ippMoveAttributes()' - Move the attributes of a message to a new message
+ *                          on the heap.
+ *
+ * The attributes are moved rather than copied - strings and collection values
+ * are handed over to the new message as-is, and attributes allocated from an
+ * arena are moved to the heap so that the new message can outlive @code ipp@.
+ * The old message is left without attributes, but pointers to its former
+ * attributes stay readable until it is deleted.
+ */
+
+ipp_t *					/* O - New message or @code NULL@ on error */
+_ippMoveAttributes(ipp_t *ipp)		/* I - IPP message */
+{
+  ipp_t	*temp;				/* New message */
+
+
+  DEBUG_printf(("_ippMoveAttributes(ipp=%p)", ipp));
+
+  if (!ipp || (temp = ippNew()) == NULL)
+    return (NULL);
+
+  temp->request = ipp->request;
+  temp->state   = ipp->state;
+
+  if (!ipp_move_attrs(temp, ipp))
+  {
+    ippDelete(temp);
+    return (NULL);
+  }
+
+  return (temp);
+}
+
+
 /*
  * 'ippNextAttribute()' - Return the next attribute in the message.
  *
@@ -2309,7 +2512,21 @@ ippNextAttribute(ipp_t *ipp)		/* I - IPP message */
   * Range check input...
   */
 
-  if (!ipp || !ipp->current)
+  if (!ipp)
+    return (NULL);
+
+  if (ipp->atfirst)
+  {
+   /*
+    * The current attribute was the first one and has been deleted...
+    */
+
+    ipp->atfirst = 0;
+
+    return (ipp->current = ipp->attrs);
+  }
+
+  if (!ipp->current)
     return (NULL);
 
  /*
@@ -2413,6 +2630,45 @@ ippNewRequest(ipp_op_t op)		/* I - Operation code */
 }
 
 
+/*
+ * 'ippNewWithArena()' - Allocate a new IPP message whose attributes are
+ *                       allocated from an arena.
+ *
+ * Attributes added to the message are carved out of large blocks of memory
+ * which are freed all at once by @link ippDelete@, avoiding a separate heap
+ * allocation for every attribute.  Memory used by attributes that are deleted
+ * or grown is not reused until the message is deleted, so arena messages are
+ * best used for requests and responses that are read or built once and then
+ * discarded.
+ *
+ * @since CUPS 1.7@
+ */
+
+ipp_t *					/* O - New IPP message */
+ippNewWithArena(void)
+{
+  ipp_t		*temp;			/* New IPP message */
+
+
+  DEBUG_puts("ippNewWithArena()");
+
+  if ((temp = ippNew()) != NULL)
+  {
+    if ((temp->arena = calloc(1, sizeof(_ipp_arena_t))) == NULL)
+    {
+      free(temp);
+      temp = NULL;
+    }
+    else
+      temp->arena->use = 1;
+  }
+
+  DEBUG_printf(("1ippNewWithArena: Returning %p", temp));
+
+  return (temp);
+}
+
+
 /*
  * 'ippRead()' - Read data for an IPP message from a HTTP connection.
  */
@@ -2451,6 +2707,163 @@ ippReadFile(int   fd,			/* I - HTTP data */
 }
 
 
+/*
+ * '_ippReadHTTP()' - Incrementally read an IPP message from a non-blocking
+ *                    HTTP connection.
+ *
+ * Unlike ippRead(), this function never waits for more data.  Whatever is
+ * available on the connection is appended to the reader's buffer and scanned
+ * for the end of the attributes; the message is then parsed from memory in a
+ * single pass.  IPP_HEADER or IPP_ATTRIBUTE is returned while the message is
+ * incomplete.  Attributes larger than the reader's "maxsize" (IPP_READER_MAX
+ * when 0) are rejected with IPP_REQUEST_ENTITY.
+ *
+ * Messages created with ippNewWithArena() borrow their names and strings from
+ * the buffer, which is then handed over to the arena, so strings are only
+ * copied when attributes are copied to another message.
+ *
+ * Message body data that follows the attributes is left in the reader's
+ * buffer between "pos" and "used" for the caller to consume.
+ */
+
+ipp_state_t				/* O - Current state */
+_ippReadHTTP(http_t        *http,	/* I - HTTP connection */
+             ipp_t         *ipp,	/* I - IPP data */
+	     _ipp_reader_t *reader)	/* I - IPP reader */
+{
+  ssize_t	bytes;			/* Bytes read */
+  int		done;			/* Found the end of the attributes? */
+  size_t	maxsize,		/* Maximum size of attributes */
+		length;			/* Length of message body data */
+  ipp_state_t	state;			/* State of message */
+
+
+  DEBUG_printf(("_ippReadHTTP(http=%p, ipp=%p, reader=%p)", http, ipp,
+                reader));
+
+  if (!http || !ipp || !reader)
+    return (IPP_ERROR);
+
+  if (ipp->state == IPP_DATA)
+    return (IPP_DATA);
+
+ /*
+  * Read whatever is available without blocking...
+  */
+
+  maxsize = reader->maxsize ? reader->maxsize : IPP_READER_MAX;
+
+  while (!(done = ipp_reader_scan(reader)) && httpWait(http, 0))
+  {
+    if (reader->used >= reader->bufsize)
+    {
+      size_t		bufsize;	/* New size of buffer */
+      ipp_uchar_t	*buffer;	/* New buffer */
+
+      if (reader->used >= maxsize)
+      {
+        _cupsSetError(IPP_REQUEST_ENTITY, _("IPP attributes are too large."),
+	              1);
+        DEBUG_printf(("1_ippReadHTTP: More than %d bytes of attributes.",
+	              (int)maxsize));
+        return (IPP_ERROR);
+      }
+
+      bufsize = reader->bufsize ? 2 * reader->bufsize : IPP_BUF_SIZE;
+
+      if (bufsize > maxsize)
+        bufsize = maxsize;
+
+      if ((buffer = realloc(reader->buffer, bufsize)) == NULL)
+      {
+        _cupsSetError(IPP_INTERNAL_ERROR, strerror(errno), 0);
+        DEBUG_printf(("1_ippReadHTTP: Unable to grow buffer to %d bytes.",
+	              (int)bufsize));
+        return (IPP_ERROR);
+      }
+
+      reader->buffer  = buffer;
+      reader->bufsize = bufsize;
+    }
+
+    if ((bytes = httpRead2(http, (char *)reader->buffer + reader->used,
+                           reader->bufsize - reader->used)) > 0)
+    {
+      reader->used += (size_t)bytes;
+    }
+    else if (bytes == 0 && http->error != EPIPE)
+    {
+     /*
+      * End of message body...
+      */
+
+      break;
+    }
+    else if (bytes == 0 || (errno != EAGAIN && errno != EINTR))
+    {
+      DEBUG_printf(("1_ippReadHTTP: Read error %d (%s)", http->error,
+                    strerror(http->error)));
+      _cupsSetHTTPError(HTTP_ERROR);
+      return (IPP_ERROR);
+    }
+    else
+      break;
+  }
+
+  DEBUG_printf(("2_ippReadHTTP: used=%d, scanned=%d, done=%d",
+                (int)reader->used, (int)reader->scanned, done));
+
+  if (!done)
+    return (reader->header ? IPP_ATTRIBUTE : IPP_HEADER);
+
+ /*
+  * Parse the complete message from memory...
+  */
+
+  reader->pos = 0;
+
+  if (!ipp->arena || ipp->arena->input)
+    return (ippReadIO(reader, (ipp_iocb_t)ipp_reader_read, 1, NULL, ipp));
+
+ /*
+  * Borrow names and strings from the buffer and give the buffer to the arena,
+  * keeping any message body data in a new buffer...
+  */
+
+  ipp->arena->reader = reader;
+
+  state = ippReadIO(reader, (ipp_iocb_t)ipp_reader_read, 1, NULL, ipp);
+
+  ipp->arena->reader = NULL;
+
+  ipp->arena->input    = reader->buffer;
+  ipp->arena->inputlen = reader->scanned;
+
+  length  = reader->used - reader->scanned;
+  maxsize = reader->maxsize;
+
+  memset(reader, 0, sizeof(_ipp_reader_t));
+
+  reader->maxsize = maxsize;
+
+  if (length > 0)
+  {
+    if ((reader->buffer = malloc(length)) == NULL)
+    {
+      _cupsSetError(IPP_INTERNAL_ERROR, strerror(errno), 0);
+      return (IPP_ERROR);
+    }
+
+    memcpy(reader->buffer, ipp->arena->input + ipp->arena->inputlen, length);
+
+    reader->bufsize = reader->used = length;
+    reader->header  = 1;
+  }
+
+  return (state);
+}
+
+
 /*
  * 'ippReadIO()' - Read data for an IPP message.
  *
@@ -2469,10 +2882,12 @@ ippReadIO(void       *src,		/* I - Data source */
 			string[IPP_MAX_NAME],
 					/* Small string buffer */
 			*bufptr;	/* Pointer into buffer */
+  char			*name;		/* Attribute name */
   ipp_attribute_t	*attr;		/* Current attribute */
   ipp_tag_t		tag;		/* Current tag */
   ipp_tag_t		value_tag;	/* Current value tag */
   _ipp_value_t		*value;		/* Current value */
+  _ipp_reader_t		*reader;	/* Reader to borrow strings from */
 
 
   DEBUG_printf(("ippReadIO(src=%p, cb=%p, blocking=%d, parent=%p, ipp=%p)",
@@ -2482,6 +2897,13 @@ ippReadIO(void       *src,		/* I - Data source */
   if (!src || !ipp)
     return (IPP_ERROR);
 
+ /*
+  * When _ippReadHTTP() is parsing into an arena, borrow names and strings
+  * from its buffer instead of copying them...
+  */
+
+  reader = ipp->arena ? ipp->arena->reader : NULL;
+
   if ((buffer = (unsigned char *)_cupsBufferGet(IPP_BUF_SIZE)) == NULL)
   {
     DEBUG_puts("1ippReadIO: Unable to get read buffer.");
@@ -2772,6 +3194,9 @@ ippReadIO(void       *src,		/* I - Data source */
 
 	    attr = ipp->current = ipp_add_attr(ipp, NULL, ipp->curtag, IPP_TAG_ZERO, 1);
 
+	    if (attr && reader)
+	      attr->flags |= _IPP_ATTR_BORROWED;
+
 	    DEBUG_printf(("2ippReadIO: membername, ipp->current=%p, ipp->prev=%p",
 	                  ipp->current, ipp->prev));
 
@@ -2783,19 +3208,28 @@ ippReadIO(void       *src,		/* I - Data source */
 	    * New attribute; read the name and add it...
 	    */
 
-	    if ((*cb)(src, buffer, n) < n)
+	    if (reader)
+	      name = ipp_reader_borrow(reader, n);
+	    else if ((*cb)(src, buffer, n) < n)
+	      name = NULL;
+	    else
+	    {
+	      buffer[n] = '\0';
+	      name      = (char *)buffer;
+	    }
+
+	    if (!name)
 	    {
 	      DEBUG_puts("1ippReadIO: unable to read name.");
 	      _cupsBufferRelease((char *)buffer);
 	      return (IPP_ERROR);
 	    }
 
-	    buffer[n] = '\0';
-
             if (ipp->current)
 	      ipp->prev = ipp->current;
 
-	    if ((attr = ipp->current = ipp_add_attr(ipp, (char *)buffer, ipp->curtag, tag,
+	    if ((attr = ipp->current = ipp_add_attr(ipp, reader ? NULL : name,
+	                                            ipp->curtag, tag,
 	                                            1)) == NULL)
 	    {
 	      _cupsSetHTTPError(HTTP_ERROR);
@@ -2804,8 +3238,14 @@ ippReadIO(void       *src,		/* I - Data source */
 	      return (IPP_ERROR);
 	    }
 
+	    if (reader)
+	    {
+	      attr->name  = name;
+	      attr->flags |= _IPP_ATTR_BORROWED;
+	    }
+
 	    DEBUG_printf(("2ippReadIO: name=\"%s\", ipp->current=%p, "
-	                  "ipp->prev=%p", buffer, ipp->current, ipp->prev));
+	                  "ipp->prev=%p", name, ipp->current, ipp->prev));
 
 	    value = attr->values;
 	  }
@@ -2913,6 +3353,18 @@ ippReadIO(void       *src,		/* I - Data source */
 	    case IPP_TAG_CHARSET :
 	    case IPP_TAG_LANGUAGE :
 	    case IPP_TAG_MIMETYPE :
+	        if (reader)
+		{
+		  if ((value->string.text = ipp_reader_borrow(reader, n)) == NULL)
+		  {
+		    DEBUG_puts("1ippReadIO: unable to read string value.");
+		    _cupsBufferRelease((char *)buffer);
+		    return (IPP_ERROR);
+		  }
+
+		  break;
+		}
+
 	        if (n > 0)
 	        {
 		  if ((*cb)(src, buffer, n) < n)
@@ -3016,6 +3468,43 @@ ippReadIO(void       *src,		/* I - Data source */
 		  return (IPP_ERROR);
 		}
 
+                if (reader)
+		{
+		 /*
+		  * Borrow the language and text from the reader buffer...
+		  */
+
+                  int	length = n;	/* Length of composite value */
+
+		  if ((*cb)(src, buffer, 2) < 2 ||
+		      (n = (buffer[0] << 8) | buffer[1]) > (length - 4) ||
+		      (value->string.language =
+		           ipp_reader_borrow(reader, n)) == NULL)
+		  {
+		    _cupsSetError(IPP_INTERNAL_ERROR,
+				  _("IPP language length overflows value."), 1);
+		    DEBUG_printf(("1ippReadIO: bad language value length %d.",
+				  n));
+		    _cupsBufferRelease((char *)buffer);
+		    return (IPP_ERROR);
+		  }
+
+                  length -= 2 + n;
+
+		  if ((*cb)(src, buffer, 2) < 2 ||
+		      (n = (buffer[0] << 8) | buffer[1]) != (length - 2) ||
+		      (value->string.text = ipp_reader_borrow(reader, n)) == NULL)
+		  {
+		    _cupsSetError(IPP_INTERNAL_ERROR,
+				  _("IPP string length overflows value."), 1);
+		    DEBUG_printf(("1ippReadIO: bad string value length %d.", n));
+		    _cupsBufferRelease((char *)buffer);
+		    return (IPP_ERROR);
+		  }
+
+		  break;
+		}
+
 	        if ((*cb)(src, buffer, n) < n)
 		{
 	          DEBUG_puts("1ippReadIO: Unable to read string w/language "
@@ -3075,7 +3564,16 @@ ippReadIO(void       *src,		/* I - Data source */
 	        * Oh, boy, here comes a collection value, so read it...
 		*/
 
-                value->collection = ippNew();
+                if ((value->collection = ippNew()) != NULL && ipp->arena)
+		{
+		 /*
+		  * Share the arena with the collection value - the arena stays
+		  * around until the collection and the message are deleted...
+		  */
+
+		  value->collection->arena = ipp->arena;
+		  ipp->arena->use ++;
+		}
 
                 if (n > 0)
 		{
@@ -3124,15 +3622,26 @@ ippReadIO(void       *src,		/* I - Data source */
 		  _cupsBufferRelease((char *)buffer);
 		  return (IPP_ERROR);
 		}
+		else if (reader)
+		{
+		  if ((attr->name = ipp_reader_borrow(reader, n)) == NULL)
+		  {
+		    DEBUG_puts("1ippReadIO: Unable to read member name value.");
+		    _cupsBufferRelease((char *)buffer);
+		    return (IPP_ERROR);
+		  }
+		}
 		else if ((*cb)(src, buffer, n) < n)
 		{
 	          DEBUG_puts("1ippReadIO: Unable to read member name value.");
 		  _cupsBufferRelease((char *)buffer);
 		  return (IPP_ERROR);
 		}
-
-		buffer[n] = '\0';
-		attr->name = _cupsStrAlloc((char *)buffer);
+		else
+		{
+		  buffer[n] = '\0';
+		  attr->name = _cupsStrAlloc((char *)buffer);
+		}
 
                /*
 	        * Since collection members are encoded differently than
@@ -3445,6 +3954,9 @@ ippSetName(ipp_t           *ipp,	/* IO - IPP message */
       _cupsStrFree((*attr)->name);
 
     (*attr)->name = temp;
+
+    if (ipp->index)
+      ipp_index_free(ipp);
   }
 
   return (temp != NULL);
@@ -4948,8 +5460,13 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
   else
     alloc_values = (num_values + IPP_MAX_VALUES - 1) & ~(IPP_MAX_VALUES - 1);
 
-  attr = calloc(sizeof(ipp_attribute_t) +
-                (alloc_values - 1) * sizeof(_ipp_value_t), 1);
+  if (ipp->arena)
+    attr = ipp_arena_alloc(ipp->arena, sizeof(ipp_attribute_t) +
+                                       (alloc_values - 1) *
+				       sizeof(_ipp_value_t));
+  else
+    attr = calloc(sizeof(ipp_attribute_t) +
+                  (alloc_values - 1) * sizeof(_ipp_value_t), 1);
 
   if (attr)
   {
@@ -4960,6 +5477,9 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
     if (name)
       attr->name = _cupsStrAlloc(name);
 
+    if (ipp->arena)
+      attr->flags = _IPP_ATTR_ARENA;
+
     attr->group_tag  = group_tag;
     attr->value_tag  = value_tag;
     attr->num_values = num_values;
@@ -4975,6 +5495,14 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
 
     ipp->prev = ipp->last;
     ipp->last = ipp->current = attr;
+
+   /*
+    * Keep the name index up-to-date; unnamed attributes get their name later
+    * (if at all), so just drop the index...
+    */
+
+    if (ipp->index && (!name || !ipp_index_add(ipp->index, attr, ipp->prev)))
+      ipp_index_free(ipp);
   }
 
   DEBUG_printf(("5ipp_add_attr: Returning %p", attr));
@@ -4984,21 +5512,110 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
 
 
 /*
- * 'ipp_free_values()' - Free attribute values.
+ * 'ipp_arena_alloc()' - Allocate zeroed memory from an attribute arena.
  */
 
-static void
-ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
-                int             element,/* I - First value to free */
-                int             count)	/* I - Number of values to free */
+static void *				/* O - Memory or NULL on error */
+ipp_arena_alloc(_ipp_arena_t *arena,	/* I - Attribute arena */
+                size_t       size)	/* I - Number of bytes */
 {
-  int		i;			/* Looping var */
-  _ipp_value_t	*value;			/* Current value */
+  _ipp_block_t	*block;			/* Current block */
+  size_t	bsize;			/* Block size */
+  void		*ptr;			/* Allocated memory */
+  const size_t	offset = (sizeof(_ipp_block_t) + 15) & ~(size_t)15;
+					/* Offset of data in block */
 
 
-  DEBUG_printf(("4ipp_free_values(attr=%p, element=%d, count=%d)", attr, element, count));
+ /*
+  * Keep all allocations aligned to 16 bytes...
+  */
 
-  if (!(attr->value_tag & IPP_TAG_COPY))
+  size = (size + 15) & ~(size_t)15;
+
+  if ((block = arena->blocks) == NULL || (block->size - block->used) < size)
+  {
+   /*
+    * Start a new block; attributes larger than a block get a block of their
+    * own...
+    */
+
+    bsize = size > IPP_ARENA_SIZE ? size : IPP_ARENA_SIZE;
+
+    if ((block = calloc(1, offset + bsize)) == NULL)
+    {
+      DEBUG_printf(("4ipp_arena_alloc: Unable to allocate %d bytes.",
+                    (int)(offset + bsize)));
+      return (NULL);
+    }
+
+    block->size = bsize;
+
+    if (arena->blocks && bsize > IPP_ARENA_SIZE)
+    {
+     /*
+      * Keep the partially used block at the front of the list...
+      */
+
+      block->next          = arena->blocks->next;
+      arena->blocks->next = block;
+    }
+    else
+    {
+      block->next   = arena->blocks;
+      arena->blocks = block;
+    }
+  }
+
+  ptr         = (char *)block + offset + block->used;
+  block->used += size;
+
+  return (ptr);
+}
+
+
+/*
+ * 'ipp_arena_release()' - Release a reference to an attribute arena.
+ */
+
+static void
+ipp_arena_release(_ipp_arena_t *arena)	/* I - Attribute arena */
+{
+  _ipp_block_t	*block,			/* Current block */
+		*next;			/* Next block */
+
+
+  if (-- arena->use > 0)
+    return;
+
+  for (block = arena->blocks; block; block = next)
+  {
+    next = block->next;
+    free(block);
+  }
+
+  if (arena->input)
+    free(arena->input);
+
+  free(arena);
+}
+
+
+/*
+ * 'ipp_free_values()' - Free attribute values.
+ */
+
+static void
+ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
+                int             element,/* I - First value to free */
+                int             count)	/* I - Number of values to free */
+{
+  int		i;			/* Looping var */
+  _ipp_value_t	*value;			/* Current value */
+
+
+  DEBUG_printf(("4ipp_free_values(attr=%p, element=%d, count=%d)", attr, element, count));
+
+  if (!(attr->value_tag & IPP_TAG_COPY))
   {
    /*
     * Free values as needed...
@@ -5108,6 +5725,156 @@ ipp_get_code(const char *value,		/* I - Locale/charset string */
 }
 
 
+/*
+ * 'ipp_index_add()' - Add an attribute to a message's name index.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+ipp_index_add(_ipp_index_t    *index,	/* I - Attribute name index */
+              ipp_attribute_t *attr,	/* I - Attribute to add */
+	      ipp_attribute_t *prev)	/* I - Previous attribute in message */
+{
+  int		i,			/* Looping var */
+		bucket,			/* Bucket for entry */
+		*temp;			/* New bucket arrays */
+  _ipp_entry_t	*entry;			/* New entry */
+
+
+ /*
+  * Grow the entries array as needed...
+  */
+
+  if (index->num_entries >= index->alloc_entries)
+  {
+    i = index->alloc_entries ? 2 * index->alloc_entries : IPP_INDEX_MIN;
+
+    if ((entry = realloc(index->entries, i * sizeof(_ipp_entry_t))) == NULL)
+      return (0);
+
+    index->entries       = entry;
+    index->alloc_entries = i;
+  }
+
+ /*
+  * Double the number of buckets when the chains get long, relinking the
+  * existing entries in message order...
+  */
+
+  if (index->num_entries >= 2 * index->num_buckets)
+  {
+    i = index->num_buckets ? 2 * index->num_buckets : IPP_INDEX_MIN;
+
+    if ((temp = malloc(2 * i * sizeof(int))) == NULL)
+      return (0);
+
+    free(index->heads);
+
+    index->heads       = temp;
+    index->tails       = temp + i;
+    index->num_buckets = i;
+
+    memset(temp, 0xff, 2 * i * sizeof(int));
+
+    for (i = 0, entry = index->entries; i < index->num_entries; i ++, entry ++)
+    {
+      bucket      = entry->hash & (index->num_buckets - 1);
+      entry->next = -1;
+
+      if (index->tails[bucket] >= 0)
+        index->entries[index->tails[bucket]].next = i;
+      else
+        index->heads[bucket] = i;
+
+      index->tails[bucket] = i;
+    }
+  }
+
+ /*
+  * Add the new entry to the end of its bucket...
+  */
+
+  i      = index->num_entries ++;
+  entry  = index->entries + i;
+  bucket = (entry->hash = ipp_index_hash(attr->name)) &
+           (index->num_buckets - 1);
+
+  entry->attr = attr;
+  entry->prev = prev;
+  entry->next = -1;
+
+  if (index->tails[bucket] >= 0)
+    index->entries[index->tails[bucket]].next = i;
+  else
+    index->heads[bucket] = i;
+
+  index->tails[bucket] = i;
+
+  return (1);
+}
+
+
+/*
+ * 'ipp_index_build()' - Build the name index for a message.
+ */
+
+static void
+ipp_index_build(ipp_t *ipp)		/* I - IPP message */
+{
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*prev;		/* Previous attribute */
+
+
+  DEBUG_printf(("4ipp_index_build(ipp=%p)", ipp));
+
+  if ((ipp->index = calloc(1, sizeof(_ipp_index_t))) == NULL)
+    return;
+
+  for (attr = ipp->attrs, prev = NULL; attr; prev = attr, attr = attr->next)
+    if (attr->name && !ipp_index_add(ipp->index, attr, prev))
+    {
+      ipp_index_free(ipp);
+      return;
+    }
+}
+
+
+/*
+ * 'ipp_index_free()' - Free the name index for a message.
+ */
+
+static void
+ipp_index_free(ipp_t *ipp)		/* I - IPP message */
+{
+  free(ipp->index->heads);
+  free(ipp->index->entries);
+  free(ipp->index);
+
+  ipp->index = NULL;
+}
+
+
+/*
+ * 'ipp_index_hash()' - Compute the case-insensitive hash of an attribute
+ *                      name.
+ */
+
+static unsigned				/* O - Hash value */
+ipp_index_hash(const char *name)	/* I - Attribute name */
+{
+  unsigned	hash;			/* Hash value */
+
+
+ /*
+  * FNV-1a over the lowercase name...
+  */
+
+  for (hash = 2166136261U; *name; name ++)
+    hash = (hash ^ (unsigned)_cups_tolower(*name & 255)) * 16777619U;
+
+  return (hash);
+}
+
+
 /*
  * 'ipp_lang_code()' - Convert a C locale name into an IPP language code.
  *
@@ -5292,6 +6059,130 @@ ipp_length(ipp_t *ipp,			/* I - IPP message or collection */
 }
 
 
+/*
+ * 'ipp_move_attrs()' - Move attributes to another message, moving arena
+ *                      attributes to the heap.
+ *
+ * When "dst" and "src" are the same message, the attributes are moved to the
+ * heap in place.  Collection values are always converted in place and drop
+ * their reference to the arena, and strings borrowed from the arena's read
+ * buffer are copied to the string pool.  On error the attributes that were
+ * already moved are put back in "src", which stays usable.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+ipp_move_attrs(ipp_t *dst,		/* I - Destination message */
+               ipp_t *src)		/* I - Source message */
+{
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*next,		/* Next attribute */
+			*temp,		/* Attribute on the heap */
+			*head = NULL,	/* First moved attribute */
+			*tail = NULL;	/* Last moved attribute */
+  _ipp_value_t		*value;		/* Current value */
+  int			i,		/* Looping var */
+			alloc_values;	/* Number of allocated values */
+  size_t		size;		/* Size of attribute */
+
+
+  if (src->index)
+    ipp_index_free(src);
+
+  for (attr = src->attrs; attr; attr = next)
+  {
+    next = attr->next;
+
+   /*
+    * Collection values are shared with the attribute, so move them to the
+    * heap where they are...
+    */
+
+    if (attr->value_tag == IPP_TAG_BEGIN_COLLECTION)
+    {
+      for (i = attr->num_values, value = attr->values; i > 0; i --, value ++)
+        if (value->collection && value->collection->arena)
+	{
+	  if (!ipp_move_attrs(value->collection, value->collection))
+	    break;
+
+	  ipp_arena_release(value->collection->arena);
+	  value->collection->arena = NULL;
+	}
+
+      if (i > 0)
+        break;
+    }
+
+    if (attr->flags & _IPP_ATTR_ARENA)
+    {
+      if (attr->num_values <= 1)
+	alloc_values = 1;
+      else
+	alloc_values = (attr->num_values + IPP_MAX_VALUES - 1) &
+		       ~(IPP_MAX_VALUES - 1);
+
+      size = sizeof(ipp_attribute_t) +
+             (alloc_values - 1) * sizeof(_ipp_value_t);
+
+      if ((temp = malloc(size)) == NULL)
+      {
+        DEBUG_printf(("4ipp_move_attrs: Unable to allocate %d bytes.",
+	              (int)size));
+        break;
+      }
+
+      memcpy(temp, attr, size);
+      temp->flags &= ~_IPP_ATTR_ARENA;
+
+      if ((temp->flags & _IPP_ATTR_BORROWED) &&
+          !ipp_unborrow(src->arena, attr, temp))
+      {
+        free(temp);
+	break;
+      }
+    }
+    else
+      temp = attr;
+
+    temp->next = NULL;
+
+    if (tail)
+      tail->next = temp;
+    else
+      head = temp;
+
+    tail = temp;
+  }
+
+  src->current = NULL;
+  src->prev    = NULL;
+  src->atfirst = 0;
+
+  if (attr)
+  {
+   /*
+    * Put the moved attributes back in front of the rest...
+    */
+
+    if (tail)
+    {
+      tail->next = attr;
+      src->attrs = head;
+    }
+
+    return (0);
+  }
+
+  if (dst != src)
+    src->attrs = src->last = NULL;
+
+  dst->attrs = head;
+  dst->last  = tail;
+
+  return (1);
+}
+
+
 /*
  * 'ipp_read_http()' - Semi-blocking read on a HTTP connection...
  */
@@ -5384,6 +6275,150 @@ ipp_read_file(int         *fd,		/* I - File descriptor */
 }
 
 
+/*
+ * 'ipp_reader_borrow()' - Borrow a string from a reader buffer.
+ *
+ * The byte following the string is replaced by a nul and handed back by the
+ * next call to ipp_reader_read().
+ */
+
+static char *				/* O - String or NULL on error */
+ipp_reader_borrow(_ipp_reader_t *reader,/* I - IPP reader */
+                  int           length)	/* I - Length of string */
+{
+  ipp_uchar_t	*ptr;			/* Pointer to string */
+
+
+ /*
+  * A nul-terminated string needs one more byte, which is always there since
+  * the attributes end with an end-of-attributes tag...
+  */
+
+  if (length < 0 || (reader->pos + (size_t)length) >= reader->scanned)
+    return (NULL);
+
+  ptr              = reader->buffer + reader->pos;
+  reader->pos      += (size_t)length;
+  reader->savedpos = reader->pos;
+  reader->saved    = *(ptr + length);
+  ptr[length]      = '\0';
+
+  return ((char *)ptr);
+}
+
+
+/*
+ * 'ipp_reader_read()' - Read IPP data from a reader buffer.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+ipp_reader_read(_ipp_reader_t *reader,	/* I - IPP reader */
+                ipp_uchar_t   *buffer,	/* O - Read buffer */
+		size_t        length)	/* I - Number of bytes to read */
+{
+  if (length > (reader->scanned - reader->pos))
+    length = reader->scanned - reader->pos;
+
+  memcpy(buffer, reader->buffer + reader->pos, length);
+
+  if (reader->savedpos && reader->savedpos >= reader->pos &&
+      reader->savedpos < (reader->pos + length))
+  {
+   /*
+    * Give back the byte that was replaced by a nul...
+    */
+
+    buffer[reader->savedpos - reader->pos] = reader->saved;
+    reader->savedpos                       = 0;
+  }
+
+  reader->pos += length;
+
+  return ((ssize_t)length);
+}
+
+
+/*
+ * 'ipp_reader_scan()' - Find the end of the attributes in a reader buffer.
+ *
+ * Scanning resumes with the first incomplete item from the previous call, so
+ * each byte is only looked at once no matter how the message is split up.
+ */
+
+static int				/* O - 1 if found, 0 if more data needed */
+ipp_reader_scan(_ipp_reader_t *reader)	/* I - IPP reader */
+{
+  ipp_uchar_t	*bufptr,		/* Pointer into buffer */
+		*bufend;		/* End of data in buffer */
+  int		tag;			/* Current tag */
+  size_t	length;			/* Length of current item */
+
+
+  if (!reader->header)
+  {
+   /*
+    * Skip the version, operation/status code, and request ID...
+    */
+
+    if (reader->used < 8)
+      return (0);
+
+    reader->header  = 1;
+    reader->scanned = 8;
+  }
+
+  for (bufptr = reader->buffer + reader->scanned,
+           bufend = reader->buffer + reader->used;
+       bufptr < bufend;
+       bufptr += length, reader->scanned += length)
+  {
+    tag    = bufptr[0];
+    length = 1;
+
+    if (tag == IPP_TAG_EXTENSION)
+    {
+     /*
+      * 32-bit "extension" tag...
+      */
+
+      if ((size_t)(bufend - bufptr) < 5)
+        return (0);
+
+      tag    = (((((bufptr[1] << 8) | bufptr[2]) << 8) | bufptr[3]) << 8) |
+               bufptr[4];
+      length = 5;
+    }
+
+    if (tag == IPP_TAG_END)
+    {
+      reader->scanned += length;
+      return (1);
+    }
+    else if (tag < IPP_TAG_UNSUPPORTED_VALUE)
+      continue;				/* Group tag */
+
+   /*
+    * Attribute or value: name-length, name, value-length, value...
+    */
+
+    if ((size_t)(bufend - bufptr) < (length + 2))
+      return (0);
+
+    length += 2 + ((bufptr[length] << 8) | bufptr[length + 1]);
+
+    if ((size_t)(bufend - bufptr) < (length + 2))
+      return (0);
+
+    length += 2 + ((bufptr[length] << 8) | bufptr[length + 1]);
+
+    if ((size_t)(bufend - bufptr) < length)
+      return (0);
+  }
+
+  return (0);
+}
+
+
 /*
  * 'ipp_set_value()' - Get the value element from an attribute, expanding it as
  *                     needed.
@@ -5397,7 +6432,8 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   ipp_attribute_t	*temp,		/* New attribute pointer */
 			*current,	/* Current attribute in list */
 			*prev;		/* Previous attribute in list */
-  int			alloc_values;	/* Allocated values */
+  int			alloc_values,	/* Allocated values */
+			old_values;	/* Previously allocated values */
 
 
  /*
@@ -5425,6 +6461,8 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   * values when num_values > 1.
   */
 
+  old_values = alloc_values;
+
   if (alloc_values < IPP_MAX_VALUES)
     alloc_values = IPP_MAX_VALUES;
   else
@@ -5437,8 +6475,24 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   * Reallocate memory...
   */
 
-  if ((temp = realloc(temp, sizeof(ipp_attribute_t) +
-			    (alloc_values - 1) * sizeof(_ipp_value_t))) == NULL)
+  if (temp->flags & _IPP_ATTR_ARENA)
+  {
+   /*
+    * Arena memory cannot be resized, so copy the attribute to a new chunk and
+    * leave the old one for ippDelete to free...
+    */
+
+    if ((temp = ipp_arena_alloc(ipp->arena, sizeof(ipp_attribute_t) +
+                                            (alloc_values - 1) *
+					    sizeof(_ipp_value_t))) != NULL)
+      memcpy(temp, *attr, sizeof(ipp_attribute_t) +
+                          (old_values - 1) * sizeof(_ipp_value_t));
+  }
+  else
+    temp = realloc(temp, sizeof(ipp_attribute_t) +
+			 (alloc_values - 1) * sizeof(_ipp_value_t));
+
+  if (!temp)
   {
     _cupsSetHTTPError(HTTP_ERROR);
     DEBUG_puts("4ipp_set_value: Unable to resize attribute.");
@@ -5501,6 +6555,9 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
     if (ipp->last == *attr)
       ipp->last = temp;
 
+    if (ipp->index)
+      ipp_index_free(ipp);
+
     *attr = temp;
   }
 
@@ -5515,6 +6572,90 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
 }
 
 
+/*
+ * 'ipp_unborrow()' - Copy strings borrowed from an arena's read buffer.
+ *
+ * "temp" is a copy of "attr"; on error "temp" is restored to the strings in
+ * "attr".
+ */
+
+static int				/* O - 1 on success, 0 on error */
+ipp_unborrow(_ipp_arena_t    *arena,	/* I - Attribute arena */
+             ipp_attribute_t *attr,	/* I - Original attribute */
+             ipp_attribute_t *temp)	/* I - Copy of attribute */
+{
+  int		i,			/* Looping var */
+		status = 1,		/* Return status */
+		strings;		/* Does the attribute have strings? */
+  _ipp_value_t	*value;			/* Current value */
+  ipp_tag_t	value_tag;		/* Value tag */
+  ipp_uchar_t	*start,			/* Start of read buffer */
+		*end;			/* End of read buffer */
+
+
+  value_tag = (ipp_tag_t)(attr->value_tag & IPP_TAG_MASK);
+  strings   = value_tag == IPP_TAG_TEXTLANG || value_tag == IPP_TAG_NAMELANG ||
+              (value_tag >= IPP_TAG_TEXT && value_tag <= IPP_TAG_MIMETYPE);
+
+  if (arena && arena->input)
+  {
+    start = arena->input;
+    end   = arena->input + arena->inputlen;
+
+    if ((ipp_uchar_t *)temp->name >= start && (ipp_uchar_t *)temp->name < end)
+      status = (temp->name = _cupsStrAlloc(temp->name)) != NULL;
+
+    for (i = strings ? temp->num_values : 0, value = temp->values;
+         status && i > 0;
+	 i --, value ++)
+    {
+     /*
+      * Like ippCopyAttribute, all values share the first value's language...
+      */
+
+      if ((ipp_uchar_t *)value->string.language < start ||
+          (ipp_uchar_t *)value->string.language >= end)
+        ;
+      else if (value > temp->values)
+        value->string.language = temp->values[0].string.language;
+      else
+        status = (value->string.language =
+	              _cupsStrAlloc(value->string.language)) != NULL;
+
+      if (status && (ipp_uchar_t *)value->string.text >= start &&
+          (ipp_uchar_t *)value->string.text < end)
+        status = (value->string.text =
+	              _cupsStrAlloc(value->string.text)) != NULL;
+    }
+  }
+
+  if (status)
+  {
+    temp->flags &= ~_IPP_ATTR_BORROWED;
+    return (1);
+  }
+
+ /*
+  * Free the strings that were copied before the error...
+  */
+
+  if (temp->name && temp->name != attr->name)
+    _cupsStrFree(temp->name);
+
+  if (strings && temp->values[0].string.language &&
+      temp->values[0].string.language != attr->values[0].string.language)
+    _cupsStrFree(temp->values[0].string.language);
+
+  for (i = 0, value = temp->values;
+       strings && i < temp->num_values;
+       i ++, value ++)
+    if (value->string.text && value->string.text != attr->values[i].string.text)
+      _cupsStrFree(value->string.text);
+
+  return (0);
+}
+
+
 /*
  * 'ipp_write_file()' - Write IPP data to a file.
  */
@@ -477,6 +477,7 @@ struct _ipp_attribute_s			/**** Attribute ****/
 		value_tag;		/* What type of value is it? */
   char		*name;			/* Name of attribute */
   int		num_values;		/* Number of values */
+  int		flags;			/* Allocation flags @private@ */
   _ipp_value_t	values[1];		/* Values */
 };
 
@@ -494,6 +495,11 @@ struct _ipp_s				/**** IPP Request/Response/Notification ****/
 
 /**** New in CUPS 1.4.4 ****/
   int			use;		/* Use count @since CUPS 1.4.4/OS X 10.6.?@ */
+
+/**** New in CUPS 1.7 ****/
+  struct _ipp_arena_s	*arena;		/* Attribute arena or NULL @since CUPS 1.7@ */
+  struct _ipp_index_s	*index;		/* Attribute name index or NULL @since CUPS 1.7@ */
+  int			atfirst;	/* Next attribute is the first one @since CUPS 1.7@ */
 };
 #  endif /* _IPP_PRIVATE_STRUCTURES */
 
@@ -656,6 +662,9 @@ extern int		ippSetValueTag(ipp_t *ipp, ipp_attribute_t **attr,
 extern int		ippSetVersion(ipp_t *ipp, int major, int minor)
 			              _CUPS_API_1_6;
 
+/**** New in CUPS 1.7 ****/
+extern ipp_t		*ippNewWithArena(void) _CUPS_API_1_7;
+
 
 /*
  * C++ magic...
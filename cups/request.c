@@ -693,6 +693,9 @@ cupsSendRequest(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
     httpSetExpect(http, expect);
     httpSetField(http, HTTP_FIELD_CONTENT_TYPE, "application/ipp");
     httpSetLength(http, length);
+#ifdef HAVE_LIBZ
+    httpSetField(http, HTTP_FIELD_ACCEPT_ENCODING, "gzip, deflate");
+#endif /* HAVE_LIBZ */
 
 #ifdef HAVE_GSSAPI
     if (http->authstring && !strncmp(http->authstring, "Negotiate", 9))
@@ -58,12 +58,15 @@ extern "C" {
  */
 
 #  define _CUPS_STR_GUARD	0x12344321
+#  define _CUPS_SP_STRIPES	16	/* Number of lock stripes (power of 2) */
 
 typedef struct _cups_sp_item_s		/**** String Pool Item ****/
 {
 #  ifdef DEBUG_GUARDS
   unsigned int	guard;			/* Guard word */
 #  endif /* DEBUG_GUARDS */
+  struct _cups_sp_item_s *next;		/* Next item in hash bucket */
+  unsigned int	hash;			/* Hash of string */
   unsigned int	ref_count;		/* Reference count */
   char		str[1];			/* String */
 } _cups_sp_item_t;
@@ -172,6 +175,7 @@ extern char	*_cupsStrAlloc(const char *s);
 extern void	_cupsStrFlush(void);
 extern void	_cupsStrFree(const char *s);
 extern char	*_cupsStrRetain(const char *s);
+extern size_t	_cupsStrPoolStatistics(size_t *hits, size_t *misses);
 extern size_t	_cupsStrStatistics(size_t *alloc_bytes, size_t *total_bytes);
 
 
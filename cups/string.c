@@ -20,6 +20,7 @@
  *   _cupsStrFlush()      - Flush the string pool.
  *   _cupsStrFormatd()    - Format a floating-point number.
  *   _cupsStrFree()       - Free/dereference a string.
+ *   _cupsStrPoolStatistics() - Return lookup statistics for string pool.
  *   _cupsStrRetain()     - Increment the reference count of a string.
  *   _cupsStrScand()      - Scan a string for a floating-point number.
  *   _cupsStrStatistics() - Return allocation statistics for string pool.
@@ -29,7 +30,8 @@
  *   _cups_strncasecmp()  - Do a case-insensitive comparison on up to N chars.
  *   _cups_strlcat()      - Safely concatenate two strings.
  *   _cups_strlcpy()      - Safely copy two strings.
- *   compare_sp_items()   - Compare two string pool items...
+ *   sp_hash()            - Compute the hash of a string.
+ *   sp_stripe()          - Get the stripe for a hash value.
  */
 
 /*
@@ -40,26 +42,50 @@
 #include "string-private.h"
 #include "debug-private.h"
 #include "thread-private.h"
-#include "array.h"
 #include <stddef.h>
 #include <limits.h>
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _cups_sp_stripe_s	/**** String Pool Stripe ****/
+{
+  _cups_mutex_t		mutex;		/* Mutex to control access to stripe */
+  _cups_sp_item_t	**buckets;	/* Hash buckets */
+  size_t		num_buckets,	/* Number of buckets (power of 2) */
+			count,		/* Number of strings */
+			hits,		/* Number of lookups that found a string */
+			misses;		/* Number of lookups that added a string */
+} _cups_sp_stripe_t;
+
+
 /*
  * Local globals...
+ *
+ * The string pool is split into stripes by hash value, each with its own
+ * lock and hash table, so that threads working on different strings don't
+ * contend for a single mutex...
  */
 
-static _cups_mutex_t	sp_mutex = _CUPS_MUTEX_INITIALIZER;
-					/* Mutex to control access to pool */
-static cups_array_t	*stringpool = NULL;
-					/* Global string pool */
+#define SP_STRIPE_INIT	{ _CUPS_MUTEX_INITIALIZER, NULL, 0, 0, 0, 0 }
+
+static _cups_sp_stripe_t sp_stripes[_CUPS_SP_STRIPES] =
+{					/* Global string pool */
+  SP_STRIPE_INIT, SP_STRIPE_INIT, SP_STRIPE_INIT, SP_STRIPE_INIT,
+  SP_STRIPE_INIT, SP_STRIPE_INIT, SP_STRIPE_INIT, SP_STRIPE_INIT,
+  SP_STRIPE_INIT, SP_STRIPE_INIT, SP_STRIPE_INIT, SP_STRIPE_INIT,
+  SP_STRIPE_INIT, SP_STRIPE_INIT, SP_STRIPE_INIT, SP_STRIPE_INIT
+};
 
 
 /*
  * Local functions...
  */
 
-static int	compare_sp_items(_cups_sp_item_t *a, _cups_sp_item_t *b);
+static unsigned		sp_hash(const char *s);
+static _cups_sp_stripe_t *sp_stripe(unsigned hash);
 
 
 /*
@@ -69,8 +95,14 @@ static int	compare_sp_items(_cups_sp_item_t *a, _cups_sp_item_t *b);
 char *					/* O - String pointer */
 _cupsStrAlloc(const char *s)		/* I - String */
 {
+  unsigned		hash;		/* Hash of string */
+  _cups_sp_stripe_t	*stripe;	/* Stripe for string */
   _cups_sp_item_t	*item,		/* String pool item */
-			*key;		/* Search key */
+			**bucket,	/* Hash bucket */
+			**buckets,	/* New hash buckets */
+			*next;		/* Next item */
+  size_t		i,		/* Looping var */
+			num_buckets;	/* New number of buckets */
 
 
  /*
@@ -81,47 +113,78 @@ _cupsStrAlloc(const char *s)		/* I - String */
     return (NULL);
 
  /*
-  * Get the string pool...
+  * Get the string pool stripe...
   */
 
-  _cupsMutexLock(&sp_mutex);
+  hash   = sp_hash(s);
+  stripe = sp_stripe(hash);
+
+  _cupsMutexLock(&(stripe->mutex));
 
-  if (!stringpool)
-    stringpool = cupsArrayNew((cups_array_func_t)compare_sp_items, NULL);
+ /*
+  * See if the string is already in the pool...
+  */
 
-  if (!stringpool)
+  if (stripe->buckets)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    for (item = stripe->buckets[(hash / _CUPS_SP_STRIPES) &
+                                (stripe->num_buckets - 1)];
+	 item;
+	 item = item->next)
+      if (item->hash == hash && !strcmp(item->str, s))
+      {
+       /*
+	* Found it, return the cached string...
+	*/
 
-    return (NULL);
+	item->ref_count ++;
+	stripe->hits ++;
+
+#ifdef DEBUG_GUARDS
+	DEBUG_printf(("5_cupsStrAlloc: Using string %p(%s) for \"%s\", "
+	              "guard=%08x, ref_count=%d", item, item->str, s,
+		      item->guard, item->ref_count));
+
+	if (item->guard != _CUPS_STR_GUARD)
+	  abort();
+#endif /* DEBUG_GUARDS */
+
+	_cupsMutexUnlock(&(stripe->mutex));
+
+	return (item->str);
+      }
   }
 
  /*
-  * See if the string is already in the pool...
+  * Grow the hash table as needed...
   */
 
-  key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
-
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL)
+  if (stripe->count >= 2 * stripe->num_buckets)
   {
-   /*
-    * Found it, return the cached string...
-    */
+    num_buckets = stripe->num_buckets ? 2 * stripe->num_buckets : 64;
 
-    item->ref_count ++;
+    if ((buckets = calloc(num_buckets, sizeof(_cups_sp_item_t *))) == NULL)
+    {
+      _cupsMutexUnlock(&(stripe->mutex));
 
-#ifdef DEBUG_GUARDS
-    DEBUG_printf(("5_cupsStrAlloc: Using string %p(%s) for \"%s\", guard=%08x, "
-                  "ref_count=%d", item, item->str, s, item->guard,
-		  item->ref_count));
+      return (NULL);
+    }
 
-    if (item->guard != _CUPS_STR_GUARD)
-      abort();
-#endif /* DEBUG_GUARDS */
+    for (i = 0; i < stripe->num_buckets; i ++)
+      for (item = stripe->buckets[i]; item; item = next)
+      {
+        next       = item->next;
+	bucket     = buckets + ((item->hash / _CUPS_SP_STRIPES) &
+	                        (num_buckets - 1));
+	item->next = *bucket;
+	*bucket    = item;
+      }
 
-    _cupsMutexUnlock(&sp_mutex);
+    if (stripe->buckets)
+      free(stripe->buckets);
 
-    return (item->str);
+    stripe->buckets     = buckets;
+    stripe->num_buckets = num_buckets;
   }
 
  /*
@@ -131,11 +194,12 @@ _cupsStrAlloc(const char *s)		/* I - String */
   item = (_cups_sp_item_t *)calloc(1, sizeof(_cups_sp_item_t) + strlen(s));
   if (!item)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&(stripe->mutex));
 
     return (NULL);
   }
 
+  item->hash      = hash;
   item->ref_count = 1;
   strcpy(item->str, s);
 
@@ -151,9 +215,15 @@ _cupsStrAlloc(const char *s)		/* I - String */
   * Add the string to the pool and return it...
   */
 
-  cupsArrayAdd(stringpool, item);
+  bucket     = stripe->buckets + ((hash / _CUPS_SP_STRIPES) &
+                                  (stripe->num_buckets - 1));
+  item->next = *bucket;
+  *bucket    = item;
 
-  _cupsMutexUnlock(&sp_mutex);
+  stripe->count ++;
+  stripe->misses ++;
+
+  _cupsMutexUnlock(&(stripe->mutex));
 
   return (item->str);
 }
@@ -166,23 +236,35 @@ _cupsStrAlloc(const char *s)		/* I - String */
 void
 _cupsStrFlush(void)
 {
-  _cups_sp_item_t	*item;		/* Current item */
+  int			i;		/* Looping var */
+  size_t		j;		/* Looping var */
+  _cups_sp_stripe_t	*stripe;	/* Current stripe */
+  _cups_sp_item_t	*item,		/* Current item */
+			*next;		/* Next item */
 
 
-  DEBUG_printf(("4_cupsStrFlush: %d strings in array",
-                cupsArrayCount(stringpool)));
+  DEBUG_puts("4_cupsStrFlush()");
 
-  _cupsMutexLock(&sp_mutex);
+  for (i = 0, stripe = sp_stripes; i < _CUPS_SP_STRIPES; i ++, stripe ++)
+  {
+    _cupsMutexLock(&(stripe->mutex));
 
-  for (item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
-    free(item);
+    for (j = 0; j < stripe->num_buckets; j ++)
+      for (item = stripe->buckets[j]; item; item = next)
+      {
+        next = item->next;
+	free(item);
+      }
+
+    if (stripe->buckets)
+      free(stripe->buckets);
 
-  cupsArrayDelete(stringpool);
-  stringpool = NULL;
+    stripe->buckets     = NULL;
+    stripe->num_buckets = 0;
+    stripe->count       = 0;
 
-  _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&(stripe->mutex));
+  }
 }
 
 
@@ -273,7 +355,10 @@ _cupsStrFormatd(char         *buf,	/* I - String */
 void
 _cupsStrFree(const char *s)		/* I - String to free */
 {
+  unsigned		hash;		/* Hash of string */
+  _cups_sp_stripe_t	*stripe;	/* Stripe for string */
   _cups_sp_item_t	*item,		/* String pool item */
+			**prev,		/* Previous item pointer */
 			*key;		/* Search key */
 
 
@@ -286,21 +371,8 @@ _cupsStrFree(const char *s)		/* I - String to free */
 
  /*
   * Check the string pool...
-  *
-  * We don't need to lock the mutex yet, as we only want to know if
-  * the stringpool is initialized.  The rest of the code will still
-  * work if it is initialized before we lock...
-  */
-
-  if (!stringpool)
-    return;
-
- /*
-  * See if the string is already in the pool...
   */
 
-  _cupsMutexLock(&sp_mutex);
-
   key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
 
 #ifdef DEBUG_GUARDS
@@ -312,28 +384,85 @@ _cupsStrFree(const char *s)		/* I - String to free */
   }
 #endif /* DEBUG_GUARDS */
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL &&
-      item == key)
+ /*
+  * The string might not be in the pool, so hash the string itself rather
+  * than trusting the item header...
+  */
+
+  hash   = sp_hash(s);
+  stripe = sp_stripe(hash);
+
+  _cupsMutexLock(&(stripe->mutex));
+
+  if (stripe->buckets)
   {
-   /*
-    * Found it, dereference...
-    */
+    for (prev = stripe->buckets + ((hash / _CUPS_SP_STRIPES) &
+                                   (stripe->num_buckets - 1));
+         (item = *prev) != NULL;
+	 prev = &(item->next))
+      if (item == key)
+      {
+       /*
+	* Found it, dereference...
+	*/
 
-    item->ref_count --;
+	item->ref_count --;
 
-    if (!item->ref_count)
-    {
-     /*
-      * Remove and free...
-      */
+	if (!item->ref_count)
+	{
+	 /*
+	  * Remove and free...
+	  */
 
-      cupsArrayRemove(stringpool, item);
+	  *prev = item->next;
+	  stripe->count --;
 
-      free(item);
-    }
+	  free(item);
+	}
+
+        break;
+      }
   }
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&(stripe->mutex));
+}
+
+
+/*
+ * '_cupsStrPoolStatistics()' - Return lookup statistics for string pool.
+ */
+
+size_t					/* O - Number of unique strings */
+_cupsStrPoolStatistics(size_t *hits,	/* O - Lookups of existing strings */
+                       size_t *misses)	/* O - Lookups that added a string */
+{
+  int			i;		/* Looping var */
+  _cups_sp_stripe_t	*stripe;	/* Current stripe */
+  size_t		count,		/* Number of strings */
+			h,		/* Hits */
+			m;		/* Misses */
+
+
+  for (i = 0, stripe = sp_stripes, count = 0, h = 0, m = 0;
+       i < _CUPS_SP_STRIPES;
+       i ++, stripe ++)
+  {
+    _cupsMutexLock(&(stripe->mutex));
+
+    count += stripe->count;
+    h     += stripe->hits;
+    m     += stripe->misses;
+
+    _cupsMutexUnlock(&(stripe->mutex));
+  }
+
+  if (hits)
+    *hits = h;
+
+  if (misses)
+    *misses = m;
+
+  return (count);
 }
 
 
@@ -364,11 +493,11 @@ _cupsStrRetain(const char *s)		/* I - String to retain */
     }
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexLock(&sp_mutex);
+    _cupsMutexLock(&(sp_stripe(item->hash)->mutex));
 
     item->ref_count ++;
 
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&(sp_stripe(item->hash)->mutex));
   }
 
   return ((char *)s);
@@ -521,10 +650,13 @@ size_t					/* O - Number of strings */
 _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
                    size_t *total_bytes)	/* O - Total string bytes */
 {
-  size_t		count,		/* Number of strings */
+  int			i;		/* Looping var */
+  size_t		j,		/* Looping var */
+			count,		/* Number of strings */
 			abytes,		/* Allocated string bytes */
 			tbytes,		/* Total string bytes */
 			len;		/* Length of string */
+  _cups_sp_stripe_t	*stripe;	/* Current stripe */
   _cups_sp_item_t	*item;		/* Current item */
 
 
@@ -532,24 +664,29 @@ _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
   * Loop through strings in pool, counting everything up...
   */
 
-  _cupsMutexLock(&sp_mutex);
-
-  for (count = 0, abytes = 0, tbytes = 0,
-           item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
+  for (i = 0, stripe = sp_stripes, count = 0, abytes = 0, tbytes = 0;
+       i < _CUPS_SP_STRIPES;
+       i ++, stripe ++)
   {
-   /*
-    * Count allocated memory, using a 64-bit aligned buffer as a basis.
-    */
+    _cupsMutexLock(&(stripe->mutex));
 
-    count  += item->ref_count;
-    len    = (strlen(item->str) + 8) & ~7;
-    abytes += sizeof(_cups_sp_item_t) + len;
-    tbytes += item->ref_count * len;
-  }
+    abytes += stripe->num_buckets * sizeof(_cups_sp_item_t *);
+
+    for (j = 0; j < stripe->num_buckets; j ++)
+      for (item = stripe->buckets[j]; item; item = item->next)
+      {
+       /*
+	* Count allocated memory, using a 64-bit aligned buffer as a basis.
+	*/
+
+	count  += item->ref_count;
+	len    = (strlen(item->str) + 8) & ~7;
+	abytes += sizeof(_cups_sp_item_t) + len;
+	tbytes += item->ref_count * len;
+      }
 
-  _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&(stripe->mutex));
+  }
 
  /*
   * Return values...
@@ -743,14 +880,34 @@ _cups_strlcpy(char       *dst,		/* O - Destination string */
 
 
 /*
- * 'compare_sp_items()' - Compare two string pool items...
+ * 'sp_hash()' - Compute the hash of a string.
+ */
+
+static unsigned				/* O - Hash value */
+sp_hash(const char *s)			/* I - String */
+{
+  unsigned	hash;			/* Hash value */
+
+
+ /*
+  * FNV-1a hash...
+  */
+
+  for (hash = 2166136261U; *s; s ++)
+    hash = (hash ^ (unsigned)(*s & 255)) * 16777619U;
+
+  return (hash);
+}
+
+
+/*
+ * 'sp_stripe()' - Get the stripe for a hash value.
  */
 
-static int				/* O - Result of comparison */
-compare_sp_items(_cups_sp_item_t *a,	/* I - First item */
-                 _cups_sp_item_t *b)	/* I - Second item */
+static _cups_sp_stripe_t *		/* O - Stripe */
+sp_stripe(unsigned hash)		/* I - Hash value */
 {
-  return (strcmp(a->str, b->str));
+  return (sp_stripes + (hash & (_CUPS_SP_STRIPES - 1)));
 }
 
 
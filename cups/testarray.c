@@ -27,7 +27,7 @@
 
 #include "string-private.h"
 #include "debug-private.h"
-#include "array.h"
+#include "array-private.h"
 #include "dir.h"
 
 
@@ -49,7 +49,8 @@ main(int  argc,				/* I - Number of command-line arguments */
 {
   int		i;			/* Looping var */
   cups_array_t	*array,			/* Test array */
-		*dup_array;		/* Duplicate array */
+		*dup_array,		/* Duplicate array */
+		*large_array;		/* Large array */
   int		status;			/* Exit status */
   char		*text;			/* Text from array */
   char		word[256];		/* Word from file */
@@ -397,6 +398,74 @@ main(int  argc,				/* I - Number of command-line arguments */
   else
     puts("PASS");
 
+ /*
+  * _cupsArrayNewLarge()
+  */
+
+  fputs("_cupsArrayNewLarge: ", stdout);
+
+  large_array = _cupsArrayNewLarge((cups_array_func_t)strcmp, data, NULL, 0,
+                                   NULL, NULL);
+
+  for (text = (char *)cupsArrayLast(array);
+       text;
+       text = (char *)cupsArrayPrev(array))
+    if (!cupsArrayAdd(large_array, text))
+      break;
+
+  if (text)
+  {
+    printf("FAIL (unable to add \"%s\")\n", text);
+    status ++;
+  }
+  else if (cupsArrayCount(large_array) != cupsArrayCount(array))
+  {
+    printf("FAIL (%d elements, expected %d)\n", cupsArrayCount(large_array),
+           cupsArrayCount(array));
+    status ++;
+  }
+  else
+  {
+    for (i = 0, text = (char *)cupsArrayFirst(large_array);
+	 text;
+	 i ++, text = (char *)cupsArrayNext(large_array))
+      if (text != cupsArrayIndex(array, i) ||
+          text != cupsArrayFind(large_array, text))
+	break;
+
+    if (text)
+    {
+      printf("FAIL (element %d is \"%s\")\n", i, text);
+      status ++;
+    }
+    else
+      puts("PASS");
+  }
+
+  fputs("_cupsArrayNewLarge (remove): ", stdout);
+
+  for (i = 0, text = (char *)cupsArrayFirst(array);
+       text;
+       i ++, text = (char *)cupsArrayNext(array))
+    if (i & 1)
+      cupsArrayRemove(large_array, text);
+
+  for (i = 0, text = (char *)cupsArrayFirst(large_array);
+       text;
+       i ++, text = (char *)cupsArrayNext(large_array))
+    if (text != cupsArrayIndex(array, 2 * i))
+      break;
+
+  if (text || cupsArrayCount(large_array) != (cupsArrayCount(array) + 1) / 2)
+  {
+    printf("FAIL (element %d is \"%s\")\n", i, text ? text : "(null)");
+    status ++;
+  }
+  else
+    puts("PASS");
+
+  cupsArrayDelete(large_array);
+
  /*
   * Delete the arrays...
   */
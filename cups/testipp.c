@@ -30,11 +30,13 @@
 #include "file.h"
 #include "string-private.h"
 #include "ipp-private.h"
+#include "cups-private.h"
 #ifdef WIN32
 #  include <io.h>
 #else
 #  include <unistd.h>
 #  include <fcntl.h>
+#  include <sys/socket.h>
 #endif /* WIN32 */
 
 
@@ -263,6 +265,11 @@ main(int  argc,			/* I - Number of command-line arguments */
   cups_file_t	*fp;		/* File pointer */
   int		i;		/* Looping var */
   int		status;		/* Status of tests (0 = success, 1 = fail) */
+#ifndef WIN32
+  int		fds[2];		/* Socket pair for HTTP tests */
+  http_t	*http;		/* HTTP connection */
+  _ipp_reader_t	reader;		/* IPP reader */
+#endif /* !WIN32 */
 
 
   status = 0;
@@ -549,6 +556,309 @@ main(int  argc,			/* I - Number of command-line arguments */
 
     ippDelete(request);
 
+   /*
+    * Read the data into an arena message, copy the collection out of it, and
+    * make sure the copy survives the arena...
+    */
+
+    printf("Read Sample into Arena: ");
+
+    request   = ippNewWithArena();
+    data.rpos = 0;
+
+    while ((state = ippReadIO(&data, (ipp_iocb_t)read_cb, 1, NULL,
+                              request)) != IPP_DATA)
+      if (state == IPP_ERROR)
+	break;
+
+    if (state != IPP_DATA)
+    {
+      printf("FAIL - %d bytes read.\n", (int)data.rpos);
+      status = 1;
+    }
+    else if ((length = ippLength(request)) != sizeof(collection))
+    {
+      printf("FAIL - wrong ippLength(), %d instead of %d bytes!\n",
+             length, (int)sizeof(collection));
+      status = 1;
+    }
+    else
+    {
+      ipp_t		*copy;		/* Copy of media-col */
+
+      copy = ippNew();
+      ippCopyAttribute(copy, ippFindAttribute(request, "media-col",
+                                              IPP_TAG_BEGIN_COLLECTION), 0);
+
+      attr = ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_INTEGER, "copies",
+                           1);
+      for (i = 1; i < 20; i ++)
+        ippSetInteger(request, &attr, i, i + 1);
+
+      if (ippGetCount(attr) != 20 || ippGetInteger(attr, 19) != 20 ||
+          ippFindAttribute(request, "copies", IPP_TAG_INTEGER) != attr)
+      {
+        puts("FAIL (unable to grow attribute)");
+	status = 1;
+	attr   = NULL;
+      }
+
+      ippDelete(request);
+      request = NULL;
+
+      if (!attr)
+        ;
+      else if ((media_col = ippFindAttribute(copy, "media-col",
+                                             IPP_TAG_BEGIN_COLLECTION)) == NULL ||
+               ippGetCount(media_col) != 2 ||
+	       !ippFindAttribute(ippGetCollection(media_col, 1), "media-size",
+	                         IPP_TAG_BEGIN_COLLECTION))
+      {
+        puts("FAIL (bad copy of media-col)");
+	status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(copy);
+    }
+
+    ippDelete(request);
+
+   /*
+    * Read the data into an arena message again and move the attributes out of
+    * the arena...
+    */
+
+    printf("_ippMoveAttributes: ");
+
+    request   = ippNewWithArena();
+    data.rpos = 0;
+
+    while ((state = ippReadIO(&data, (ipp_iocb_t)read_cb, 1, NULL,
+                              request)) != IPP_DATA)
+      if (state == IPP_ERROR)
+	break;
+
+    if (state != IPP_DATA)
+    {
+      printf("FAIL - %d bytes read.\n", (int)data.rpos);
+      status = 1;
+    }
+    else
+    {
+      ipp_t		*moved;		/* Moved attributes */
+
+      media_col = ippFindAttribute(request, "media-col",
+                                   IPP_TAG_BEGIN_COLLECTION);
+
+      if ((moved = _ippMoveAttributes(request)) == NULL)
+      {
+        puts("FAIL (unable to move attributes)");
+	status = 1;
+      }
+      else if (ippFirstAttribute(request) ||
+               !media_col || ippGetCount(media_col) != 2)
+      {
+        puts("FAIL (old message not emptied)");
+	status = 1;
+      }
+      else
+      {
+        ippDelete(request);
+	request = NULL;
+
+	if ((length = ippLength(moved)) != sizeof(collection))
+	{
+	  printf("FAIL - wrong ippLength(), %d instead of %d bytes!\n",
+		 length, (int)sizeof(collection));
+	  status = 1;
+	}
+	else if ((media_col = ippFindAttribute(moved, "media-col",
+					       IPP_TAG_BEGIN_COLLECTION)) == NULL ||
+		 ippGetCount(media_col) != 2 ||
+		 (media_size = ippFindAttribute(ippGetCollection(media_col, 1),
+						"media-size",
+						IPP_TAG_BEGIN_COLLECTION)) == NULL ||
+		 (attr = ippFindAttribute(ippGetCollection(media_size, 0),
+					  "x-dimension",
+					  IPP_TAG_INTEGER)) == NULL)
+	{
+	  puts("FAIL (bad media-col after move)");
+	  status = 1;
+	}
+	else
+	{
+	  for (i = 1; i < 20; i ++)
+	    ippSetInteger(ippGetCollection(media_size, 0), &attr, i, i);
+
+	  if (ippGetCount(attr) != 20)
+	  {
+	    puts("FAIL (unable to grow moved attribute)");
+	    status = 1;
+	  }
+	  else
+	    puts("PASS");
+	}
+      }
+
+      ippDelete(moved);
+    }
+
+    ippDelete(request);
+
+#ifndef WIN32
+   /*
+    * Read the same message from a non-blocking HTTP connection a few bytes at
+    * a time, with some document data after the attributes...
+    */
+
+    printf("_ippReadHTTP (split reads): ");
+
+    if (socketpair(AF_LOCAL, SOCK_STREAM, 0, fds))
+    {
+      printf("FAIL (socketpair: %s)\n", strerror(errno));
+      status = 1;
+    }
+    else if ((http = _httpCreate("/testipp", 0, NULL, HTTP_ENCRYPT_NEVER,
+                                 AF_LOCAL)) == NULL)
+    {
+      puts("FAIL (unable to create HTTP connection)");
+      close(fds[0]);
+      close(fds[1]);
+      status = 1;
+    }
+    else
+    {
+      ipp_t		*moved = NULL;	/* Moved attributes */
+
+      fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+      http->fd             = fds[0];
+      http->blocking       = 0;
+      http->state          = HTTP_POST_RECV;
+      http->data_encoding  = HTTP_ENCODE_LENGTH;
+      http->data_remaining = sizeof(collection) + 4;
+      http->_data_remaining = (int)http->data_remaining;
+
+      memset(&reader, 0, sizeof(reader));
+
+      request = ippNewWithArena();
+      state   = IPP_IDLE;
+
+      for (i = 0; i < (int)sizeof(collection); i += 16)
+      {
+        if (write(fds[1], collection + i,
+	          sizeof(collection) - i > 16 ? 16 : sizeof(collection) - i) < 0)
+	  break;
+
+	if ((state = _ippReadHTTP(http, request, &reader)) == IPP_DATA ||
+	    state == IPP_ERROR)
+	  break;
+      }
+
+      if (state == IPP_DATA && i + 16 < (int)sizeof(collection))
+      {
+        printf("FAIL (finished after %d of %d bytes)\n", i + 16,
+	       (int)sizeof(collection));
+	status = 1;
+      }
+      else if (state != IPP_DATA)
+      {
+        printf("FAIL (state %d after %d bytes)\n", state, i);
+	status = 1;
+      }
+      else if (write(fds[1], "data", 4) != 4 ||
+               httpRead2(http, (char *)buffer, sizeof(buffer)) != 4 ||
+	       memcmp(buffer, "data", 4) ||
+	       reader.used != reader.pos)
+      {
+        puts("FAIL (document data not left on connection)");
+	status = 1;
+      }
+      else if ((length = ippLength(request)) != sizeof(collection))
+      {
+	printf("FAIL - wrong ippLength(), %d instead of %d bytes!\n",
+	       length, (int)sizeof(collection));
+	status = 1;
+      }
+      else if (ippGetVersion(request, &i) != 1 || i != 1 ||
+               ippGetOperation(request) != IPP_PRINT_JOB ||
+	       ippGetRequestId(request) != 1)
+      {
+        puts("FAIL (bad message header)");
+	status = 1;
+      }
+      else if ((attr = ippCopyAttribute(cols[0] = ippNew(),
+                                        ippFindAttribute(request,
+					                 "printer-uri",
+							 IPP_TAG_URI),
+					0)) == NULL ||
+               (moved = _ippMoveAttributes(request)) == NULL)
+      {
+        puts("FAIL (unable to copy or move attributes)");
+	status = 1;
+      }
+      else
+      {
+        ippDelete(request);
+	request = NULL;
+
+	if (strcmp(ippGetString(attr, 0, NULL),
+	           "ipp://localhost/printers/foo") ||
+	    (attr = ippFindAttribute(moved, "media-col",
+	                             IPP_TAG_BEGIN_COLLECTION)) == NULL ||
+	    (attr = ippFindAttribute(ippGetCollection(attr, 0), "media-color",
+	                             IPP_TAG_KEYWORD)) == NULL ||
+	    strcmp(ippGetString(attr, 0, NULL), "blue") ||
+	    ippLength(moved) != sizeof(collection))
+	{
+	  puts("FAIL (bad attributes after read)");
+	  status = 1;
+	}
+	else
+	  puts("PASS");
+      }
+
+      ippDelete(cols[0]);
+      ippDelete(moved);
+      ippDelete(request);
+      _ippFreeReader(&reader);
+
+     /*
+      * Attributes larger than the reader's maximum size are rejected...
+      */
+
+      printf("_ippReadHTTP (too large): ");
+
+      http->state          = HTTP_POST_RECV;
+      http->data_encoding  = HTTP_ENCODE_LENGTH;
+      http->data_remaining = sizeof(collection);
+      http->_data_remaining = (int)http->data_remaining;
+
+      memset(&reader, 0, sizeof(reader));
+      reader.maxsize = 32;
+
+      request = ippNewWithArena();
+
+      if (write(fds[1], collection, sizeof(collection)) < 0 ||
+          (state = _ippReadHTTP(http, request, &reader)) != IPP_ERROR ||
+	  cupsLastError() != IPP_REQUEST_ENTITY)
+      {
+        printf("FAIL (state %d, %s)\n", state, cupsLastErrorString());
+	status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(request);
+      _ippFreeReader(&reader);
+
+      httpClose(http);
+      close(fds[1]);
+    }
+#endif /* !WIN32 */
+
    /*
     * Read the mixed data and confirm we converted everything to rangeOfInteger
     * values...
@@ -625,6 +935,141 @@ main(int  argc,			/* I - Number of command-line arguments */
 
     ippDelete(request);
 
+   /*
+    * Test lookups in a message large enough to be indexed...
+    */
+
+    fputs("ippFindAttribute(indexed): ", stdout);
+
+    request = ippNew();
+
+    for (i = 0; i < 100; i ++)
+    {
+      snprintf((char *)buffer, sizeof(buffer), "attr-%d", i);
+      ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER,
+	            (char *)buffer, i);
+    }
+
+    ippAddString(request, IPP_TAG_PRINTER, IPP_TAG_TEXTLANG, "ATTR-50", "en",
+	         "duplicate");
+
+    if (ippFindAttribute(request, "no-such-attr", IPP_TAG_ZERO))
+    {
+      puts("FAIL (found missing attribute)");
+      status = 1;
+    }
+    else if (!request->index)
+    {
+      puts("FAIL (no index)");
+      status = 1;
+    }
+    else if ((attr = ippFindAttribute(request, "attr-99",
+	                              IPP_TAG_INTEGER)) == NULL ||
+	     ippGetInteger(attr, 0) != 99)
+    {
+      puts("FAIL (attr-99 not found)");
+      status = 1;
+    }
+    else if ((attr = ippFindAttribute(request, "attr-50",
+	                              IPP_TAG_TEXT)) == NULL ||
+	     strcmp(ippGetString(attr, 0, NULL), "duplicate"))
+    {
+      puts("FAIL (ATTR-50 not found)");
+      status = 1;
+    }
+    else if ((attr = ippFindAttribute(request, "attr-50",
+	                              IPP_TAG_ZERO)) == NULL ||
+	     ippGetInteger(attr, 0) != 50 ||
+	     (attr = ippFindNextAttribute(request, "attr-50",
+	                                  IPP_TAG_ZERO)) == NULL ||
+	     attr->value_tag != IPP_TAG_TEXTLANG)
+    {
+      puts("FAIL (attr-50 duplicates not found)");
+      status = 1;
+    }
+    else if ((attr = ippFindAttribute(request, "attr-10",
+	                              IPP_TAG_INTEGER)) == NULL ||
+	     !ippSetInteger(request, &attr, 1, 10) ||
+	     ippFindAttribute(request, "attr-10", IPP_TAG_INTEGER) != attr ||
+	     ippGetCount(attr) != 2)
+    {
+      puts("FAIL (attr-10 not found after growing)");
+      status = 1;
+    }
+    else
+    {
+      ippDeleteAttribute(request, ippFindAttribute(request, "attr-20",
+	                                           IPP_TAG_ZERO));
+
+      if (ippFindAttribute(request, "attr-20", IPP_TAG_ZERO) ||
+	  (attr = ippFindAttribute(request, "attr-21",
+	                           IPP_TAG_ZERO)) == NULL ||
+	  ippGetInteger(attr, 0) != 21)
+      {
+	puts("FAIL (wrong attribute after delete)");
+	status = 1;
+      }
+      else
+	puts("PASS");
+    }
+
+    ippDelete(request);
+
+   /*
+    * Delete the first attribute while iterating...
+    */
+
+    fputs("ippDeleteAttribute(first while iterating): ", stdout);
+
+    request = ippNew();
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "attr-1", 1);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "attr-2", 2);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "attr-3", 3);
+
+    for (i = 0, attr = ippFirstAttribute(request);
+         attr;
+	 attr = ippNextAttribute(request))
+    {
+      i ++;
+
+      if (ippGetInteger(attr, 0) == 1)
+        ippDeleteAttribute(request, attr);
+    }
+
+    if (i != 3 || (attr = ippFirstAttribute(request)) == NULL ||
+        ippGetInteger(attr, 0) != 2)
+    {
+      printf("FAIL (saw %d attributes)\n", i);
+      status = 1;
+    }
+    else
+      puts("PASS");
+
+    ippDelete(request);
+
+   /*
+    * Arena attributes can only be deleted from their message...
+    */
+
+    fputs("ippDeleteAttribute(NULL, arena attribute): ", stdout);
+
+    request = ippNewWithArena();
+    attr    = ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
+                            "attr-1", 1);
+
+    ippDeleteAttribute(NULL, attr);
+
+    if (ippFindAttribute(request, "attr-1", IPP_TAG_INTEGER) != attr ||
+        ippGetInteger(attr, 0) != 1)
+    {
+      puts("FAIL (attribute freed)");
+      status = 1;
+    }
+    else
+      puts("PASS");
+
+    ippDelete(request);
+
    /*
     * Test _ippFindOption() private API...
     */
@@ -20,7 +20,8 @@
 /*
  * This header defines several constants - _CUPS_DEPRECATED,
  * _CUPS_API_1_1, _CUPS_API_1_1_19, _CUPS_API_1_1_20, _CUPS_API_1_1_21,
- * _CUPS_API_1_2, _CUPS_API_1_3, _CUPS_API_1_4, _CUPS_API_1_5, _CUPS_API_1_6 -
+ * _CUPS_API_1_2, _CUPS_API_1_3, _CUPS_API_1_4, _CUPS_API_1_5, _CUPS_API_1_6,
+ * _CUPS_API_1_7 -
  * which add compiler-specific attributes that flag functions that are
  * deprecated or added in particular releases.
  *
@@ -57,6 +58,7 @@
 #    define _CUPS_API_1_4 AVAILABLE_MAC_OS_X_VERSION_10_6_AND_LATER
 #    define _CUPS_API_1_5 AVAILABLE_MAC_OS_X_VERSION_10_7_AND_LATER
 #    define _CUPS_API_1_6
+#    define _CUPS_API_1_7
 #  else
 #    define _CUPS_API_1_1_19
 #    define _CUPS_API_1_1_20
@@ -66,6 +68,7 @@
 #    define _CUPS_API_1_4
 #    define _CUPS_API_1_5
 #    define _CUPS_API_1_6
+#    define _CUPS_API_1_7
 #  endif /* __APPLE__ && !_CUPS_SOURCE */
 
 /*
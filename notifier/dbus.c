@@ -18,6 +18,7 @@
  *
  *   main()         - Read events and send DBUS notifications.
  *   acquire_lock() - Acquire a lock so we only have a single notifier running.
+ *   events_ready() - See if another event can be read without waiting.
  */
 
 /*
@@ -28,6 +29,7 @@
 #include <cups/string-private.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <sys/select.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -158,6 +160,7 @@ enum
  */
 
 static int	acquire_lock(int *fd, char *lockfile, size_t locksize);
+static int	events_ready(cups_file_t *fp);
 
 
 /*
@@ -168,6 +171,7 @@ int					/* O - Exit status */
 main(int  argc,				/* I - Number of command-line args */
      char *argv[])			/* I - Command-line arguments */
 {
+  cups_file_t		*fp;		/* Events from scheduler */
   ipp_t			*msg;		/* Event message from scheduler */
   ipp_state_t		state;		/* IPP event state */
   struct sigaction	action;		/* POSIX sigaction data */
@@ -211,9 +215,13 @@ main(int  argc,				/* I - Number of command-line args */
   }
 
  /*
-  * Loop forever until we run out of events...
+  * Loop forever until we run out of events; the scheduler sends events in
+  * batches, so read them through a buffer and only flush the DBUS
+  * connection once the batch has been sent...
   */
 
+  fp = cupsFileStdin();
+
   for (;;)
   {
     ipp_attribute_t	*attr;		/* Current attribute */
@@ -233,8 +241,12 @@ main(int  argc,				/* I - Number of command-line args */
     * Get the next event...
     */
 
+    if (con && !events_ready(fp))
+      dbus_connection_flush(con);
+
     msg = ippNew();
-    while ((state = ippReadFile(0, msg)) != IPP_DATA)
+    while ((state = ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL,
+                              msg)) != IPP_DATA)
     {
       if (state <= IPP_IDLE)
         break;
@@ -243,14 +255,17 @@ main(int  argc,				/* I - Number of command-line args */
     fprintf(stderr, "DEBUG: state=%d\n", state);
 
     if (state == IPP_ERROR)
-      fputs("DEBUG: ippReadFile() returned IPP_ERROR!\n", stderr);
+      fputs("DEBUG: ippReadIO() returned IPP_ERROR!\n", stderr);
 
     if (state <= IPP_IDLE)
     {
      /*
-      * Out of messages, free memory and then exit...
+      * Out of messages, send anything left, free memory and then exit...
       */
 
+      if (con)
+        dbus_connection_flush(con);
+
       ippDelete(msg);
       break;
     }
@@ -550,7 +565,6 @@ main(int  argc,				/* I - Number of command-line args */
     }
 
     dbus_connection_send(con, message, NULL);
-    dbus_connection_flush(con);
 
    /*
     * Cleanup...
@@ -613,6 +627,29 @@ acquire_lock(int    *fd,		/* O - Lock file descriptor */
   else
     return (0);
 }
+
+/*
+ * 'events_ready()' - See if another event can be read without waiting.
+ */
+
+static int				/* O - 1 if ready, 0 otherwise */
+events_ready(cups_file_t *fp)		/* I - Events from scheduler */
+{
+  fd_set		input;		/* Input set for select() */
+  struct timeval	timeout;	/* Timeout for select() */
+
+
+  if (cupsFileBuffered(fp) > 0)
+    return (1);
+
+  timeout.tv_sec  = 0;
+  timeout.tv_usec = 0;
+
+  FD_ZERO(&input);
+  FD_SET(cupsFileNumber(fp), &input);
+
+  return (select(cupsFileNumber(fp) + 1, &input, NULL, NULL, &timeout) > 0);
+}
 #else /* !HAVE_DBUS */
 int
 main(void)
@@ -62,6 +62,7 @@ main(int  argc,				/* I - Number of command-line arguments */
      char *argv[])			/* I - Command-line arguments */
 {
   int		i;			/* Looping var */
+  cups_file_t	*fp;			/* Events from scheduler */
   ipp_t		*msg;			/* Event message from scheduler */
   ipp_state_t	state;			/* IPP event state */
   char		*subject,		/* Subject for notification message */
@@ -138,9 +139,12 @@ main(int  argc,				/* I - Number of command-line arguments */
             templen);
 
  /*
-  * Loop forever until we run out of events...
+  * Loop forever until we run out of events; the scheduler sends events in
+  * batches, so read them through a buffer...
   */
 
+  fp = cupsFileStdin();
+
   for (;;)
   {
    /*
@@ -148,7 +152,8 @@ main(int  argc,				/* I - Number of command-line arguments */
     */
 
     msg = ippNew();
-    while ((state = ippReadFile(0, msg)) != IPP_DATA)
+    while ((state = ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL,
+                              msg)) != IPP_DATA)
     {
       if (state <= IPP_IDLE)
         break;
@@ -157,7 +162,7 @@ main(int  argc,				/* I - Number of command-line arguments */
     fprintf(stderr, "DEBUG: state=%d\n", state);
 
     if (state == IPP_ERROR)
-      fputs("DEBUG: ippReadFile() returned IPP_ERROR!\n", stderr);
+      fputs("DEBUG: ippReadIO() returned IPP_ERROR!\n", stderr);
 
     if (state <= IPP_IDLE)
     {
@@ -36,6 +36,14 @@
 #include <cups/ipp-private.h>	/* TODO: Update so we don't need this */
 
 
+/*
+ * Constants...
+ */
+
+#define RSS_INTERVAL	5		/* Minimum seconds between saves */
+#define RSS_RETRIES	3		/* Maximum tries to save changes */
+
+
 /*
  * Structures...
  */
@@ -82,6 +90,7 @@ main(int  argc,				/* I - Number of command-line arguments */
      char *argv[])			/* I - Command-line arguments */
 {
   int		i;			/* Looping var */
+  cups_file_t	*fp;			/* Events from scheduler */
   ipp_t		*event;			/* Event from scheduler */
   ipp_state_t	state;			/* IPP event state */
   char		scheme[32],		/* URI scheme ("rss") */
@@ -113,6 +122,13 @@ main(int  argc,				/* I - Number of command-line arguments */
   fd_set	input;			/* Input set for select() */
   struct timeval timeout;		/* Timeout for select() */
   int		changed;		/* Has the RSS data changed? */
+  int		saved;			/* Were the changes saved? */
+  int		failures;		/* Number of failed saves */
+  int		eof;			/* Out of events? */
+  time_t	curtime,		/* Current time */
+		last_save;		/* Time of last save */
+  int		num_events,		/* Number of events received */
+		num_saves;		/* Number of times file was saved */
   int		exit_status;		/* Exit status */
 
 
@@ -243,18 +259,28 @@ main(int  argc,				/* I - Number of command-line arguments */
   language = cupsLangDefault();
 
  /*
-  * Read events and update the RSS file until we are out of events.
+  * Read events and update the RSS file until we are out of events.  The
+  * messages are kept in memory and the file is saved at most once every
+  * RSS_INTERVAL seconds, no matter how many events arrive in between...
   */
 
-  for (exit_status = 0, event = NULL;;)
+  fp        = cupsFileStdin();
+  last_save = 0;
+
+  for (exit_status = 0, eof = 0, num_events = 0, num_saves = 0, failures = 0,
+           event = NULL;;)
   {
-    if (changed)
+    curtime = time(NULL);
+
+    if (changed && (eof || (curtime - last_save) >= RSS_INTERVAL))
     {
      /*
       * Save the messages to the file again, uploading as needed...
       */
 
-      if (save_rss(rss, newname, baseurl))
+      last_save = curtime;
+
+      if ((saved = save_rss(rss, newname, baseurl)) != 0)
       {
 	if (http)
 	{
@@ -263,8 +289,11 @@ main(int  argc,				/* I - Number of command-line arguments */
 	  */
 
           if ((status = cupsPutFile(http, resource, filename)) != HTTP_CREATED)
+	  {
             fprintf(stderr, "ERROR: Unable to PUT %s from %s on port %d: %d %s\n",
 	            resource, host, port, status, httpStatus(status));
+	    saved = 0;
+	  }
 	}
 	else
 	{
@@ -273,30 +302,70 @@ main(int  argc,				/* I - Number of command-line arguments */
 	  */
 
           if (rename(newname, filename))
+	  {
             fprintf(stderr, "ERROR: Unable to rename %s to %s: %s\n",
 	            newname, filename, strerror(errno));
+	    saved = 0;
+	  }
 	}
+      }
 
-	changed = 0;
+      if (saved)
+      {
+	changed  = 0;
+	failures = 0;
+	num_saves ++;
+
+	fprintf(stderr, "DEBUG: Saved %s (%d events received, %d saves).\n",
+	        filename, num_events, num_saves);
+      }
+      else if (++ failures >= RSS_RETRIES)
+      {
+       /*
+        * Don't keep waking up to retry; the next event tries again...
+	*/
+
+	fprintf(stderr, "ERROR: Unable to save %s after %d tries.\n", filename,
+	        failures);
+
+	changed  = 0;
+	failures = 0;
       }
     }
 
+    if (eof)
+      break;
+
    /*
-    * Wait up to 30 seconds for an event...
+    * Wait up to 30 seconds for an event, or until it is time to save the
+    * pending changes...
     */
 
-    timeout.tv_sec  = 30;
-    timeout.tv_usec = 0;
+    if (cupsFileBuffered(fp) <= 0)
+    {
+      if (changed)
+        timeout.tv_sec = last_save + RSS_INTERVAL - curtime;
+      else
+        timeout.tv_sec = 30;
 
-    FD_ZERO(&input);
-    FD_SET(0, &input);
+      if (timeout.tv_sec < 0)
+        timeout.tv_sec = 0;
 
-    if (select(1, &input, NULL, NULL, &timeout) < 0)
-      continue;
-    else if (!FD_ISSET(0, &input))
-    {
-      fprintf(stderr, "DEBUG: %s is bored, exiting...\n", argv[1]);
-      break;
+      timeout.tv_usec = 0;
+
+      FD_ZERO(&input);
+      FD_SET(0, &input);
+
+      if (select(1, &input, NULL, NULL, &timeout) < 0)
+	continue;
+      else if (!FD_ISSET(0, &input))
+      {
+        if (changed)
+	  continue;
+
+	fprintf(stderr, "DEBUG: %s is bored, exiting...\n", argv[1]);
+	break;
+      }
     }
 
    /*
@@ -304,17 +373,27 @@ main(int  argc,				/* I - Number of command-line arguments */
     */
 
     event = ippNew();
-    while ((state = ippReadFile(0, event)) != IPP_DATA)
+    while ((state = ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL,
+                              event)) != IPP_DATA)
     {
       if (state <= IPP_IDLE)
         break;
     }
 
     if (state == IPP_ERROR)
-      fputs("DEBUG: ippReadFile() returned IPP_ERROR!\n", stderr);
+      fputs("DEBUG: ippReadIO() returned IPP_ERROR!\n", stderr);
 
     if (state <= IPP_IDLE)
-      break;
+    {
+     /*
+      * Save any changes before exiting...
+      */
+
+      eof = 1;
+      continue;
+    }
+
+    num_events ++;
 
    /*
     * Collect the info from the event...
@@ -397,6 +476,9 @@ main(int  argc,				/* I - Number of command-line arguments */
   * We only get here when idle or error...
   */
 
+  fprintf(stderr, "DEBUG: Received %d events, saved %s %d times.\n",
+          num_events, filename, num_saves);
+
   ippDelete(event);
 
   if (http)
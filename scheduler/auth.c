@@ -30,21 +30,39 @@
  *   cupsdCopyLocation()       - Make a copy of a location...
  *   cupsdDeleteAllLocations() - Free all memory used for location
  *                               authorization.
+ *   cupsdExpireGroupCache()   - Expire or refresh cached group memberships.
+ *   cupsdFlushAuthCache()     - Forget all cached Basic credentials.
  *   cupsdFindBest()           - Find the location entry that best matches the
  *                               resource.
  *   cupsdFindLocation()       - Find the named location.
  *   cupsdFreeLocation()       - Free all memory used by a location.
  *   cupsdIsAuthorized()       - Check to see if the user is authorized...
  *   cupsdNewLocation()        - Create a new location for authorization.
+ *   add_authnode()            - Add a network to an address trie.
+ *   add_locnode()             - Add a location to a location tree.
  *   check_authref()           - Check if an authorization services reference
  *                               has the supplied right.
+ *   check_authset()           - Check compiled authorization masks.
+ *   check_group()             - Look up a user's group membership.
+ *   check_password()          - Check a Basic username and password.
+ *   compare_groups()          - Compare two cached group memberships.
  *   compare_locations()       - Compare two locations.
+ *   compile_authset()         - Compile authorization masks.
+ *   compile_locations()       - Compile the location trees.
  *   copy_authmask()           - Copy function for auth masks.
  *   cups_crypt()              - Encrypt the password using the DES or MD5
  *                               algorithms, as needed.
+ *   find_locnode()            - Find the child node for a character.
  *   free_authmask()           - Free function for auth masks.
+ *   free_authnode()           - Free an address trie.
+ *   free_authset()            - Free compiled authorization masks.
+ *   free_locations()          - Free the location trees.
+ *   free_locnode()            - Free a location tree node.
+ *   get_authcache()           - Get the cache entry for Basic credentials.
  *   get_md5_password()        - Get an MD5 password.
+ *   match_authnode()          - Match an address against an address trie.
  *   pam_func()                - PAM conversation function.
+ *   pam_rejected()            - Check whether a PAM error rejects the user.
  *   to64()                    - Base64-encode an integer value...
  */
 
@@ -99,25 +117,113 @@ extern void	krb5_ipc_client_clear_target(void);
 #endif /* HAVE_KRB5_IPC_CLIENT_SET_TARGET_UID */
 
 
+/*
+ * Local constants...
+ */
+
+#define CUPSD_AUTHCACHE_MAX	64	/* Number of cached Basic credentials */
+#define CUPSD_GROUPCACHE_MAX	1024	/* Number of cached group memberships */
+
+
+/*
+ * Local structures...
+ */
+
+typedef struct cupsd_authcache_s	/**** Cached Basic credentials ****/
+{
+  unsigned char		digest[16];	/* Keyed hash of request and credentials */
+  time_t		expires;	/* Expiration time or 0 if not cached */
+} cupsd_authcache_t;
+
+typedef struct cupsd_groupcache_s	/**** Cached group membership ****/
+{
+  char			*username,	/* Username */
+			*groupname;	/* Group name */
+  int			uid,		/* User ID or -1 */
+			gid,		/* Primary group ID or -1 */
+			member,		/* Is the user a member of the group? */
+			used;		/* Used since the last lookup? */
+  time_t		expires;	/* Expiration time */
+} cupsd_groupcache_t;
+
+typedef struct cupsd_authnode_s		/**** Address trie node ****/
+{
+  struct cupsd_authnode_s *child[2];	/* Children for 0 and 1 bits */
+  int			match;		/* Does a network end here? */
+} cupsd_authnode_t;
+
+struct cupsd_authset_s			/**** Compiled authorization masks ****/
+{
+  int			num_masks,	/* Number of masks compiled */
+			fallback,	/* Check masks with cupsdCheckAuth()? */
+			has_interface,	/* Have interface masks? */
+			has_local,	/* Have @LOCAL masks? */
+			netif_gen;	/* Interface list generation */
+  cupsd_authnode_t	*addrs,		/* Networks using 128-bit addresses */
+			*addrs4;	/* IPv4 interface networks */
+  cups_array_t		*names,		/* Host and domain names */
+			*domains;	/* Domain names */
+};
+
+typedef struct cupsd_locnode_s		/**** Location tree node ****/
+{
+  int			ch,		/* Character for this node */
+			num_children,	/* Number of child nodes */
+			alloc_children,	/* Allocated child nodes */
+			num_locs;	/* Number of locations */
+  struct cupsd_locnode_s *children;	/* Child nodes, sorted by character */
+  cupsd_location_t	**locs;		/* Locations ending here */
+} cupsd_locnode_t;
+
+
 /*
  * Local functions...
  */
 
+static int		add_authnode(cupsd_authnode_t **node,
+			             const unsigned *addr,
+				     const unsigned *mask, int words);
+static int		add_locnode(cupsd_locnode_t *node,
+			            cupsd_location_t *loc, int fold);
 #ifdef HAVE_AUTHORIZATION_H
 static int		check_authref(cupsd_client_t *con, const char *right);
 #endif /* HAVE_AUTHORIZATION_H */
+static int		check_authset(cupsd_authset_t **set,
+			              cups_array_t *masks, unsigned ip[4],
+				      char *name, int name_len);
+static int		check_group(const char *username, struct passwd *user,
+			            const char *groupname);
+static int		check_password(cupsd_client_t *con,
+			               const char *username,
+				       const char *password);
+static int		compare_groups(cupsd_groupcache_t *a,
+			               cupsd_groupcache_t *b);
 static int		compare_locations(cupsd_location_t *a,
 			                  cupsd_location_t *b);
+static cupsd_authset_t	*compile_authset(cupsd_authset_t *set,
+			                 cups_array_t *masks);
+static int		compile_locations(void);
 static cupsd_authmask_t	*copy_authmask(cupsd_authmask_t *am, void *data);
 #if !HAVE_LIBPAM && !defined(HAVE_USERSEC_H)
 static char		*cups_crypt(const char *pw, const char *salt);
 #endif /* !HAVE_LIBPAM && !HAVE_USERSEC_H */
+static cupsd_locnode_t	*find_locnode(cupsd_locnode_t *node, int ch);
 static void		free_authmask(cupsd_authmask_t *am, void *data);
+static void		free_authnode(cupsd_authnode_t *node);
+static void		free_authset(cupsd_authset_t *set);
+static void		free_locations(void);
+static void		free_locnode(cupsd_locnode_t *node);
+static cupsd_authcache_t	*get_authcache(cupsd_client_t *con, int type,
+			               const char *username,
+				       const char *password);
 static char		*get_md5_password(const char *username,
 			                  const char *group, char passwd[33]);
+static int		match_authnode(cupsd_authnode_t *node,
+			               const unsigned *addr, int words);
 #if HAVE_LIBPAM
 static int		pam_func(int, const struct pam_message **,
 			         struct pam_response **, void *);
+static int		pam_rejected(int pamerr);
 #elif !defined(HAVE_USERSEC_H)
 static void		to64(char *s, unsigned long v, int n);
 #endif /* HAVE_LIBPAM */
@@ -143,6 +249,18 @@ typedef struct cupsd_authdata_s		/**** Authentication data ****/
 #if defined(__hpux) && HAVE_LIBPAM
 static cupsd_authdata_t	*auth_data;	/* Current client being authenticated */
 #endif /* __hpux && HAVE_LIBPAM */
+static cupsd_authcache_t	authcache[CUPSD_AUTHCACHE_MAX];
+					/* Cached Basic credentials */
+static unsigned char	authcache_salt[16];
+					/* HMAC key for cached credentials */
+static int		authcache_salted = 0;
+					/* Has the salt been generated? */
+static cups_array_t	*group_cache = NULL;
+					/* Cached group memberships */
+static cupsd_locnode_t	*loc_tree = NULL,
+					/* Location tree */
+			*loc_ctree = NULL;
+					/* Case-insensitive location tree */
 
 
 /*
@@ -203,6 +321,8 @@ cupsdAddLocation(cupsd_location_t *loc)	/* I - Location to add */
   {
     cupsArrayAdd(Locations, loc);
 
+    free_locations();
+
     cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdAddLocation: Added location \"%s\"",
                     loc->location ? loc->location : "(null)");
   }
@@ -622,7 +742,8 @@ cupsdAuthorize(cupsd_client_t *con)	/* I - Client connection */
     * Get the Basic authentication data...
     */
 
-    int	userlen;			/* Username:password length */
+    int			userlen;	/* Username:password length */
+    cupsd_authcache_t	*cache;		/* Cached credentials */
 
 
     authorization += 5;
@@ -677,222 +798,31 @@ cupsdAuthorize(cupsd_client_t *con)	/* I - Client connection */
     {
       default :
       case CUPSD_AUTH_BASIC :
-          {
-#if HAVE_LIBPAM
-	   /*
-	    * Only use PAM to do authentication.  This supports MD5
-	    * passwords, among other things...
-	    */
-
-	    pam_handle_t	*pamh;	/* PAM authentication handle */
-	    int			pamerr;	/* PAM error code */
-	    struct pam_conv	pamdata;/* PAM conversation data */
-	    cupsd_authdata_t	data;	/* Authentication data */
-
-
-            strlcpy(data.username, username, sizeof(data.username));
-	    strlcpy(data.password, password, sizeof(data.password));
-
-#  if defined(__sun) || defined(__hpux)
-	    pamdata.conv        = (int (*)(int, struct pam_message **,
-	                                   struct pam_response **,
-					   void *))pam_func;
-#  else
-	    pamdata.conv        = pam_func;
-#  endif /* __sun || __hpux */
-	    pamdata.appdata_ptr = &data;
-
-#  ifdef __hpux
-	   /*
-	    * Workaround for HP-UX bug in pam_unix; see pam_func() below for
-	    * more info...
-	    */
-
-	    auth_data = &data;
-#  endif /* __hpux */
-
-	    pamerr = pam_start("cups", username, &pamdata, &pamh);
-	    if (pamerr != PAM_SUCCESS)
-	    {
-	      cupsdLogMessage(CUPSD_LOG_ERROR,
-	                      "[Client %d] pam_start() returned %d (%s)",
-        	              con->http.fd, pamerr, pam_strerror(pamh, pamerr));
-	      return;
-	    }
-
-#  ifdef HAVE_PAM_SET_ITEM
-#    ifdef PAM_RHOST
-	    pamerr = pam_set_item(pamh, PAM_RHOST, con->http.hostname);
-	    if (pamerr != PAM_SUCCESS)
-	      cupsdLogMessage(CUPSD_LOG_WARN,
-	                      "[Client %d] pam_set_item(PAM_RHOST) "
-			      "returned %d (%s)", con->http.fd, pamerr,
-			      pam_strerror(pamh, pamerr));
-#    endif /* PAM_RHOST */
-
-#    ifdef PAM_TTY
-	    pamerr = pam_set_item(pamh, PAM_TTY, "cups");
-	    if (pamerr != PAM_SUCCESS)
-	      cupsdLogMessage(CUPSD_LOG_WARN,
-	                      "[Client %d] pam_set_item(PAM_TTY) "
-			      "returned %d (%s)!", con->http.fd, pamerr,
-			      pam_strerror(pamh, pamerr));
-#    endif /* PAM_TTY */
-#  endif /* HAVE_PAM_SET_ITEM */
-
-	    pamerr = pam_authenticate(pamh, PAM_SILENT);
-	    if (pamerr != PAM_SUCCESS)
-	    {
-	      cupsdLogMessage(CUPSD_LOG_ERROR,
-	                      "[Client %d] pam_authenticate() returned %d (%s)",
-        	              con->http.fd, pamerr, pam_strerror(pamh, pamerr));
-	      pam_end(pamh, 0);
-	      return;
-	    }
-
-#  ifdef HAVE_PAM_SETCRED
-            pamerr = pam_setcred(pamh, PAM_ESTABLISH_CRED | PAM_SILENT);
-	    if (pamerr != PAM_SUCCESS)
-	      cupsdLogMessage(CUPSD_LOG_WARN,
-	                      "[Client %d] pam_setcred() returned %d (%s)",
-	                      con->http.fd, pamerr,
-			      pam_strerror(pamh, pamerr));
-#  endif /* HAVE_PAM_SETCRED */
-
-	    pamerr = pam_acct_mgmt(pamh, PAM_SILENT);
-	    if (pamerr != PAM_SUCCESS)
-	    {
-	      cupsdLogMessage(CUPSD_LOG_ERROR,
-	                      "[Client %d] pam_acct_mgmt() returned %d (%s)",
-        	              con->http.fd, pamerr, pam_strerror(pamh, pamerr));
-	      pam_end(pamh, 0);
-	      return;
-	    }
-
-	    pam_end(pamh, PAM_SUCCESS);
-
-#elif defined(HAVE_USERSEC_H)
-	   /*
-	    * Use AIX authentication interface...
-	    */
-
-	    char	*authmsg;	/* Authentication message */
-	    int		reenter;	/* ??? */
-
-
-	    cupsdLogMessage(CUPSD_LOG_DEBUG,
-	                    "[Client %d] AIX authenticate of username \"%s\"",
-	                    con->http.fd, username);
-
-	    reenter = 1;
-	    if (authenticate(username, password, &reenter, &authmsg) != 0)
-	    {
-	      cupsdLogMessage(CUPSD_LOG_DEBUG,
-	                      "[Client %d] Unable to authenticate username "
-			      "\"%s\": %s", con->http.fd, username,
-			      strerror(errno));
-	      return;
-	    }
-
-#else
-           /*
-	    * Use normal UNIX password file-based authentication...
-	    */
-
-            char		*pass;	/* Encrypted password */
-            struct passwd	*pw;	/* User password data */
-#  ifdef HAVE_SHADOW_H
-            struct spwd		*spw;	/* Shadow password data */
-#  endif /* HAVE_SHADOW_H */
-
-
-	    pw = getpwnam(username);	/* Get the current password */
-	    endpwent();			/* Close the password file */
-
-	    if (!pw)
-	    {
-	     /*
-	      * No such user...
-	      */
-
-	      cupsdLogMessage(CUPSD_LOG_ERROR,
-	                      "[Client %d] Unknown username \"%s\".",
-        	              con->http.fd, username);
-	      return;
-	    }
-
-#  ifdef HAVE_SHADOW_H
-	    spw = getspnam(username);
-	    endspent();
-
-	    if (!spw && !strcmp(pw->pw_passwd, "x"))
-	    {
-	     /*
-	      * Don't allow blank passwords!
-	      */
-
-	      cupsdLogMessage(CUPSD_LOG_ERROR,
-	                      "[Client %d] Username \"%s\" has no shadow "
-			      "password.", con->http.fd, username);
-	      return;
-	    }
-
-	    if (spw && !spw->sp_pwdp[0] && !pw->pw_passwd[0])
-#  else
-	    if (!pw->pw_passwd[0])
-#  endif /* HAVE_SHADOW_H */
-	    {
-	     /*
-	      * Don't allow blank passwords!
-	      */
+         /*
+	  * Use cached successes for the same credentials from the same host
+	  * when possible, since PAM and directory lookups can be slow...
+	  */
 
-	      cupsdLogMessage(CUPSD_LOG_ERROR,
-	                      "[Client %d] Username \"%s\" has no password.",
-	                      con->http.fd, username);
+          if ((cache = get_authcache(con, type, username, password)) != NULL &&
+	      cache->expires)
+	  {
+	    cupsdLogMessage(CUPSD_LOG_DEBUG2,
+			    "[Client %d] Using cached credentials for \"%s\".",
+			    con->http.fd, username);
+	  }
+	  else
+	  {
+	    if (check_password(con, username, password) <= 0)
 	      return;
-	    }
 
 	   /*
-	    * OK, the password isn't blank, so compare with what came from the
-	    * client...
+	    * Only cache successes so that failed and erroneous lookups are
+	    * always repeated...
 	    */
 
-	    pass = cups_crypt(password, pw->pw_passwd);
-
-	    cupsdLogMessage(CUPSD_LOG_DEBUG2,
-	                    "[Client %d] pw_passwd=\"%s\", crypt=\"%s\"",
-		            con->http.fd, pw->pw_passwd, pass);
-
-	    if (!pass || strcmp(pw->pw_passwd, pass))
-	    {
-#  ifdef HAVE_SHADOW_H
-	      if (spw)
-	      {
-		pass = cups_crypt(password, spw->sp_pwdp);
-
-		cupsdLogMessage(CUPSD_LOG_DEBUG2,
-	                	"[Client %d] sp_pwdp=\"%s\", crypt=\"%s\"",
-				con->http.fd, spw->sp_pwdp, pass);
-
-		if (pass == NULL || strcmp(spw->sp_pwdp, pass))
-		{
-	          cupsdLogMessage(CUPSD_LOG_ERROR,
-		                  "[Client %d] Authentication failed for user "
-		                  "\"%s\".", con->http.fd, username);
-		  return;
-        	}
-	      }
-	      else
-#  endif /* HAVE_SHADOW_H */
-	      {
-		cupsdLogMessage(CUPSD_LOG_ERROR,
-		        	"[Client %d] Authentication failed for user "
-		        	"\"%s\".", con->http.fd, username);
-		return;
-              }
-	    }
-#endif /* HAVE_LIBPAM */
-          }
+	    if (cache)
+	      cache->expires = time(NULL) + AuthCacheTimeout;
+	  }
 
 	  cupsdLogMessage(CUPSD_LOG_DEBUG,
 			  "[Client %d] Authorized as %s using Basic",
@@ -1230,20 +1160,20 @@ cupsdCheckAccess(
       case CUPSD_AUTH_ALLOW : /* Order Deny,Allow */
           allow = 1;
 
-          if (cupsdCheckAuth(ip, name, namelen, loc->deny))
+          if (check_authset(&(loc->deny_set), loc->deny, ip, name, namelen))
 	    allow = 0;
 
-          if (cupsdCheckAuth(ip, name, namelen, loc->allow))
+          if (check_authset(&(loc->allow_set), loc->allow, ip, name, namelen))
 	    allow = 1;
 	  break;
 
       case CUPSD_AUTH_DENY : /* Order Allow,Deny */
           allow = 0;
 
-          if (cupsdCheckAuth(ip, name, namelen, loc->allow))
+          if (check_authset(&(loc->allow_set), loc->allow, ip, name, namelen))
 	    allow = 1;
 
-          if (cupsdCheckAuth(ip, name, namelen, loc->deny))
+          if (check_authset(&(loc->deny_set), loc->deny, ip, name, namelen))
 	    allow = 0;
 	  break;
     }
@@ -1436,6 +1366,9 @@ cupsdCheckAuth(unsigned     ip[4],	/* I - Client address */
 
 /*
  * 'cupsdCheckGroup()' - Check for a user's group membership.
+ *
+ * Results are cached for GroupCacheTimeout seconds since the group lookups
+ * can involve network directory services.
  */
 
 int					/* O - 1 if user is a member, 0 otherwise */
@@ -1444,14 +1377,8 @@ cupsdCheckGroup(
     struct passwd *user,		/* I - System user info */
     const char    *groupname)		/* I - Group name */
 {
-  int		i;			/* Looping var */
-  struct group	*group;			/* System group info */
-  char		junk[33];		/* MD5 password (not used) */
-#ifdef HAVE_MBR_UID_TO_UUID
-  uuid_t	useruuid,		/* UUID for username */
-		groupuuid;		/* UUID for groupname */
-  int		is_member;		/* True if user is a member of group */
-#endif /* HAVE_MBR_UID_TO_UUID */
+  cupsd_groupcache_t	key,		/* Search key */
+			*cache;		/* Cached membership */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
@@ -1465,87 +1392,60 @@ cupsdCheckGroup(
   if (!username || !groupname)
     return (0);
 
+  if (GroupCacheTimeout <= 0)
+    return (check_group(username, user, groupname));
+
  /*
-  * Check to see if the user is a member of the named group...
+  * See if we have checked this user and group recently...
   */
 
-  group = getgrnam(groupname);
-  endgrent();
+  key.username  = (char *)username;
+  key.groupname = (char *)groupname;
+  key.uid       = user ? (int)user->pw_uid : -1;
+  key.gid       = user ? (int)user->pw_gid : -1;
 
-  if (group != NULL)
+  if ((cache = (cupsd_groupcache_t *)cupsArrayFind(group_cache,
+                                                   &key)) != NULL &&
+      cache->expires > time(NULL))
   {
-   /*
-    * Group exists, check it...
-    */
+    GroupCacheHits ++;
 
-    for (i = 0; group->gr_mem[i]; i ++)
-      if (!_cups_strcasecmp(username, group->gr_mem[i]))
-	return (1);
-  }
-
- /*
-  * Group doesn't exist or user not in group list, check the group ID
-  * against the user's group ID...
-  */
+    cache->used = 1;
 
-  if (user && group && group->gr_gid == user->pw_gid)
-    return (1);
+    return (cache->member);
+  }
 
-#ifdef HAVE_MBR_UID_TO_UUID
- /*
-  * Check group membership through MacOS X membership API...
-  */
+  GroupCacheMisses ++;
 
-  if (user && !mbr_uid_to_uuid(user->pw_uid, useruuid))
+  if (!cache)
   {
-    if (group)
-    {
-     /*
-      * Map group name to UUID and check membership...
-      */
+   /*
+    * Add a new entry if there is room...
+    */
 
-      if (!mbr_gid_to_uuid(group->gr_gid, groupuuid))
-        if (!mbr_check_membership(useruuid, groupuuid, &is_member))
-	  if (is_member)
-	    return (1);
-    }
-    else if (groupname[0] == '#')
-    {
-     /*
-      * Use UUID directly and check for equality (user UUID) and
-      * membership (group UUID)...
-      */
+    if (!group_cache)
+      group_cache = cupsArrayNew((cups_array_func_t)compare_groups, NULL);
 
-      if (!uuid_parse((char *)groupname + 1, groupuuid))
-      {
-        if (!uuid_compare(useruuid, groupuuid))
-	  return (1);
-	else if (!mbr_check_membership(useruuid, groupuuid, &is_member))
-	  if (is_member)
-	    return (1);
-      }
+    if (cupsArrayCount(group_cache) < CUPSD_GROUPCACHE_MAX &&
+        (cache = calloc(1, sizeof(cupsd_groupcache_t))) != NULL)
+    {
+      cache->username  = _cupsStrAlloc(username);
+      cache->groupname = _cupsStrAlloc(groupname);
+      cache->uid       = key.uid;
+      cache->gid       = key.gid;
 
-      return (0);
+      cupsArrayAdd(group_cache, cache);
     }
   }
-  else if (groupname[0] == '#')
-    return (0);
-#endif /* HAVE_MBR_UID_TO_UUID */
 
- /*
-  * Username not found, group not found, or user is not part of the
-  * system group...  Check for a user and group in the MD5 password
-  * file...
-  */
-
-  if (get_md5_password(username, groupname, junk) != NULL)
-    return (1);
+  if (!cache)
+    return (check_group(username, user, groupname));
 
- /*
-  * If we get this far, then the user isn't part of the named group...
-  */
+  cache->member  = check_group(username, user, groupname);
+  cache->used    = 0;
+  cache->expires = time(NULL) + GroupCacheTimeout;
 
-  return (0);
+  return (cache->member);
 }
 
 
@@ -1646,6 +1546,90 @@ cupsdDeleteAllLocations(void)
 
   cupsArrayDelete(Locations);
   Locations = NULL;
+
+  free_locations();
+}
+
+
+/*
+ * 'cupsdExpireGroupCache()' - Expire or refresh cached group memberships.
+ *
+ * When GroupCacheRefresh is enabled, memberships that have been used since
+ * they were looked up are checked again shortly before they expire, so that
+ * requests from active users do not wait for directory lookups.
+ */
+
+void
+cupsdExpireGroupCache(void)
+{
+  cupsd_groupcache_t	*cache;		/* Current membership */
+  struct passwd		*user;		/* User info */
+  time_t		curtime,	/* Current time */
+			refresh;	/* Refresh memberships expiring before */
+
+
+  if (!group_cache)
+    return;
+
+  curtime = time(NULL);
+  refresh = curtime + (GroupCacheTimeout + 9) / 10;
+
+  for (cache = (cupsd_groupcache_t *)cupsArrayFirst(group_cache);
+       cache;
+       cache = (cupsd_groupcache_t *)cupsArrayNext(group_cache))
+  {
+    if (GroupCacheRefresh && cache->used && cache->expires > curtime &&
+        cache->expires <= refresh)
+    {
+     /*
+      * Look up the membership again...
+      */
+
+      if (cache->uid < 0)
+        user = NULL;
+      else if ((user = getpwnam(cache->username)) != NULL &&
+               ((int)user->pw_uid != cache->uid ||
+	        (int)user->pw_gid != cache->gid))
+	user = NULL;
+
+      if (cache->uid < 0 || user)
+      {
+	cupsdLogMessage(CUPSD_LOG_DEBUG2,
+	                "cupsdExpireGroupCache: Refreshing \"%s\" in \"%s\".",
+			cache->username, cache->groupname);
+
+	cache->member  = check_group(cache->username, user, cache->groupname);
+	cache->used    = 0;
+	cache->expires = curtime + GroupCacheTimeout;
+	continue;
+      }
+    }
+
+    if (cache->expires <= curtime || GroupCacheTimeout <= 0)
+    {
+      cupsArrayRemove(group_cache, cache);
+
+      _cupsStrFree(cache->username);
+      _cupsStrFree(cache->groupname);
+      free(cache);
+    }
+  }
+}
+
+
+/*
+ * 'cupsdFlushAuthCache()' - Forget all cached Basic credentials.
+ *
+ * A new salt is generated the next time credentials are cached.
+ */
+
+void
+cupsdFlushAuthCache(void)
+{
+  memset(authcache, 0, sizeof(authcache));
+  memset(authcache_salt, 0, sizeof(authcache_salt));
+
+  authcache_salted = 0;
 }
 
 
@@ -1664,6 +1648,9 @@ cupsdFindBest(const char   *path,	/* I - Resource path */
 			*best;		/* Best match for location so far */
   int			bestlen;	/* Length of best match */
   int			limit;		/* Limit field */
+  int			i,		/* Looping var */
+			fold;		/* Compare queue names without case? */
+  cupsd_locnode_t	*node;		/* Current location tree node */
   static const int	limits[] =	/* Map http_status_t to CUPSD_AUTH_LIMIT_xyz */
 		{
 		  CUPSD_AUTH_LIMIT_ALL,
@@ -1706,49 +1693,87 @@ cupsdFindBest(const char   *path,	/* I - Resource path */
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdFindBest: uri = \"%s\"...", uri);
 
- /*
-  * Loop through the list of locations to find a match...
-  */
-
   limit   = limits[state];
   best    = NULL;
   bestlen = 0;
+  fold    = !strncmp(uri, "/printers/", 10) || !strncmp(uri, "/classes/", 9);
 
-  for (loc = (cupsd_location_t *)cupsArrayFirst(Locations);
-       loc;
-       loc = (cupsd_location_t *)cupsArrayNext(Locations))
+  if (loc_tree || compile_locations())
   {
-    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdFindBest: Location %s Limit %x",
-                    loc->location ? loc->location : "nil", loc->limit);
+   /*
+    * Walk the location tree using the URI, remembering the longest location
+    * that allows this request type...
+    */
 
-    if (!strncmp(uri, "/printers/", 10) || !strncmp(uri, "/classes/", 9))
-    {
-     /*
-      * Use case-insensitive comparison for queue names...
-      */
+    node   = fold ? loc_ctree : loc_tree;
+    uriptr = uri;
 
-      if (loc->length > bestlen && loc->location &&
-          !_cups_strncasecmp(uri, loc->location, loc->length) &&
-	  loc->location[0] == '/' &&
-	  (limit & loc->limit) != 0)
+    while (node)
+    {
+      for (i = 0; i < node->num_locs; i ++)
       {
-	best    = loc;
-	bestlen = loc->length;
-      }
+        loc = node->locs[i];
+
+	cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdFindBest: Location %s Limit %x",
+			loc->location, loc->limit);
+
+        if (limit & loc->limit)
+	{
+	  best = loc;
+	  break;
+	}
+      }
+
+      if (!*uriptr)
+        break;
+
+      node = find_locnode(node, fold ? _cups_tolower(*uriptr & 255) :
+                                       *uriptr & 255);
+      uriptr ++;
     }
-    else
+  }
+  else
+  {
+   /*
+    * Loop through the list of locations to find a match...
+    */
+
+    for (loc = (cupsd_location_t *)cupsArrayFirst(Locations);
+         loc;
+	 loc = (cupsd_location_t *)cupsArrayNext(Locations))
     {
-     /*
-      * Use case-sensitive comparison for other URIs...
-      */
+      cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdFindBest: Location %s Limit %x",
+		      loc->location ? loc->location : "nil", loc->limit);
 
-      if (loc->length > bestlen && loc->location &&
-          !strncmp(uri, loc->location, loc->length) &&
-	  loc->location[0] == '/' &&
-	  (limit & loc->limit) != 0)
+      if (fold)
       {
-	best    = loc;
-	bestlen = loc->length;
+       /*
+	* Use case-insensitive comparison for queue names...
+	*/
+
+	if (loc->length > bestlen && loc->location &&
+	    !_cups_strncasecmp(uri, loc->location, loc->length) &&
+	    loc->location[0] == '/' &&
+	    (limit & loc->limit) != 0)
+	{
+	  best    = loc;
+	  bestlen = loc->length;
+	}
+      }
+      else
+      {
+       /*
+	* Use case-sensitive comparison for other URIs...
+	*/
+
+	if (loc->length > bestlen && loc->location &&
+	    !strncmp(uri, loc->location, loc->length) &&
+	    loc->location[0] == '/' &&
+	    (limit & loc->limit) != 0)
+	{
+	  best    = loc;
+	  bestlen = loc->length;
+	}
       }
     }
   }
@@ -1791,6 +1816,9 @@ cupsdFreeLocation(cupsd_location_t *loc)/* I - Location to free */
   cupsArrayDelete(loc->allow);
   cupsArrayDelete(loc->deny);
 
+  free_authset(loc->allow_set);
+  free_authset(loc->deny_set);
+
   _cupsStrFree(loc->location);
   free(loc);
 }
@@ -2176,6 +2204,136 @@ cupsdNewLocation(const char *location)	/* I - Location path */
 }
 
 
+/*
+ * 'add_authnode()' - Add a network to an address trie.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+add_authnode(cupsd_authnode_t **node,	/* IO - Root of trie */
+             const unsigned   *addr,	/* I  - Network address */
+	     const unsigned   *mask,	/* I  - Network mask */
+	     int              words)	/* I  - Number of address words */
+{
+  int		i,			/* Looping var */
+		bit;			/* Current bit */
+
+
+  for (i = 0; i < (32 * words); i ++)
+  {
+    if (!(mask[i / 32] & (0x80000000 >> (i & 31))))
+      break;
+
+    if (!*node && (*node = calloc(1, sizeof(cupsd_authnode_t))) == NULL)
+      return (0);
+
+    bit  = (addr[i / 32] & (0x80000000 >> (i & 31))) != 0;
+    node = (*node)->child + bit;
+  }
+
+ /*
+  * Only contiguous netmasks can be added to the trie...
+  */
+
+  for (; i < (32 * words); i ++)
+    if (mask[i / 32] & (0x80000000 >> (i & 31)))
+      return (0);
+
+  if (!*node && (*node = calloc(1, sizeof(cupsd_authnode_t))) == NULL)
+    return (0);
+
+  (*node)->match = 1;
+
+  return (1);
+}
+
+
+/*
+ * 'add_locnode()' - Add a location to a location tree.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+add_locnode(cupsd_locnode_t  *node,	/* I - Root of tree */
+            cupsd_location_t *loc,	/* I - Location */
+	    int              fold)	/* I - Fold case of location? */
+{
+  const char		*ptr,		/* Pointer into location */
+			*end;		/* End of location */
+  int			ch,		/* Current character */
+			left,		/* Left side of search */
+			right,		/* Right side of search */
+			current;	/* Current child */
+  cupsd_locnode_t	*child;		/* Child nodes */
+  cupsd_location_t	**locs;		/* Locations */
+
+
+  for (ptr = loc->location, end = ptr + loc->length;
+       *ptr && ptr < end;
+       ptr ++)
+  {
+    ch = fold ? _cups_tolower(*ptr & 255) : *ptr & 255;
+
+   /*
+    * Do a binary search for the character...
+    */
+
+    for (left = 0, right = node->num_children; left < right;)
+    {
+      current = (left + right) / 2;
+
+      if (node->children[current].ch < ch)
+        left = current + 1;
+      else
+        right = current;
+    }
+
+    if (left >= node->num_children || node->children[left].ch != ch)
+    {
+     /*
+      * Insert a new child node...
+      */
+
+      if (node->num_children >= node->alloc_children)
+      {
+        if ((child = realloc(node->children,
+	                     (node->alloc_children + 4) *
+			         sizeof(cupsd_locnode_t))) == NULL)
+	  return (0);
+
+        node->children       = child;
+	node->alloc_children += 4;
+      }
+
+      child = node->children + left;
+
+      if (left < node->num_children)
+        memmove(child + 1, child,
+	        (node->num_children - left) * sizeof(cupsd_locnode_t));
+
+      memset(child, 0, sizeof(cupsd_locnode_t));
+      child->ch = ch;
+
+      node->num_children ++;
+    }
+
+    node = node->children + left;
+  }
+
+ /*
+  * Add the location to the end of the list so that the order of the Locations
+  * array is preserved...
+  */
+
+  if ((locs = realloc(node->locs, (node->num_locs + 1) *
+                                      sizeof(cupsd_location_t *))) == NULL)
+    return (0);
+
+  node->locs = locs;
+  node->locs[node->num_locs ++] = loc;
+
+  return (1);
+}
+
+
 #ifdef HAVE_AUTHORIZATION_H
 /*
  * 'check_authref()' - Check if an authorization services reference has the
@@ -2230,131 +2388,730 @@ check_authref(cupsd_client_t *con,	/* I - Connection */
 
 
 /*
- * 'compare_locations()' - Compare two locations.
+ * 'check_authset()' - Check compiled authorization masks.
+ *
+ * This is equivalent to cupsdCheckAuth() but uses the masks compiled into a
+ * trie of networks and sorted arrays of names, which are rebuilt when masks
+ * are added or the network interfaces change.
  */
 
-static int				/* O - Result of comparison */
-compare_locations(cupsd_location_t *a,	/* I - First location */
-                  cupsd_location_t *b)	/* I - Second location */
+static int				/* O  - 1 if mask matches, 0 otherwise */
+check_authset(cupsd_authset_t **set,	/* IO - Compiled masks */
+              cups_array_t    *masks,	/* I  - Masks */
+              unsigned        ip[4],	/* I  - Client address */
+	      char            *name,	/* I  - Client hostname */
+	      int             name_len)	/* I  - Length of hostname */
 {
-  return (strcmp(b->location, a->location));
-}
+  cupsd_authset_t	*temp;		/* Compiled masks */
+  char			*domain;	/* Current domain in hostname */
 
 
-/*
- * 'copy_authmask()' - Copy function for auth masks.
- */
+  if (!masks)
+    return (0);
 
-static cupsd_authmask_t	*		/* O - New auth mask */
-copy_authmask(cupsd_authmask_t *mask,	/* I - Existing auth mask */
-              void             *data)	/* I - User data (unused) */
-{
-  cupsd_authmask_t	*temp;		/* New auth mask */
+  if ((temp = *set) != NULL && temp->has_local)
+    cupsdNetIFUpdate();
 
+  if (!temp || temp->num_masks != cupsArrayCount(masks) ||
+      (temp->has_interface && temp->netif_gen != NetIFGeneration))
+    *set = temp = compile_authset(temp, masks);
 
-  (void)data;
+  if (!temp || temp->fallback)
+    return (cupsdCheckAuth(ip, name, name_len, masks));
 
-  if ((temp = malloc(sizeof(cupsd_authmask_t))) != NULL)
-  {
-    memcpy(temp, mask, sizeof(cupsd_authmask_t));
+#ifdef __APPLE__
+ /*
+  * Allow Back-to-My-Mac addresses...
+  */
 
-    if (temp->type == CUPSD_AUTH_NAME || temp->type == CUPSD_AUTH_INTERFACE)
-    {
-     /*
-      * Make a copy of the name...
-      */
+  if (temp->has_local && (ip[0] & 0xff000000) == 0xfd000000)
+    return (1);
+#endif /* __APPLE__ */
 
-      if ((temp->mask.name.name = _cupsStrAlloc(temp->mask.name.name)) == NULL)
-      {
-       /*
-        * Failed to make copy...
-	*/
+ /*
+  * Check for network address matches...
+  */
 
-        free(temp);
-	temp = NULL;
-      }
-    }
+  if (match_authnode(temp->addrs, ip, 4) ||
+      match_authnode(temp->addrs4, ip + 3, 1))
+    return (1);
+
+ /*
+  * Check for exact name and domain matches...
+  */
+
+  if (cupsArrayFind(temp->names, name))
+    return (1);
+
+  if (cupsArrayCount(temp->domains) > 0)
+  {
+    for (domain = strchr(name, '.'); domain; domain = strchr(domain + 1, '.'))
+      if (cupsArrayFind(temp->domains, domain))
+        return (1);
   }
 
-  return (temp);
+  return (0);
 }
 
 
-#if !HAVE_LIBPAM && !defined(HAVE_USERSEC_H)
 /*
- * 'cups_crypt()' - Encrypt the password using the DES or MD5 algorithms,
- *                  as needed.
+ * 'check_group()' - Look up a user's group membership.
  */
 
-static char *				/* O - Encrypted password */
-cups_crypt(const char *pw,		/* I - Password string */
-           const char *salt)		/* I - Salt (key) string */
+static int				/* O - 1 if user is a member, 0 otherwise */
+check_group(const char    *username,	/* I - User name */
+            struct passwd *user,	/* I - System user info */
+            const char    *groupname)	/* I - Group name */
 {
-  if (!strncmp(salt, "$1$", 3))
-  {
-   /*
-    * Use MD5 passwords without the benefit of PAM; this is for
-    * Slackware Linux, and the algorithm was taken from the
-    * old shadow-19990827/lib/md5crypt.c source code... :(
-    */
-
-    int			i;		/* Looping var */
-    unsigned long	n;		/* Output number */
-    int			pwlen;		/* Length of password string */
-    const char		*salt_end;	/* End of "salt" data for MD5 */
-    char		*ptr;		/* Pointer into result string */
-    _cups_md5_state_t	state;		/* Primary MD5 state info */
-    _cups_md5_state_t	state2;		/* Secondary MD5 state info */
-    unsigned char	digest[16];	/* MD5 digest result */
-    static char		result[120];	/* Final password string */
+  int		i;			/* Looping var */
+  struct group	*group;			/* System group info */
+  char		junk[33];		/* MD5 password (not used) */
+#ifdef HAVE_MBR_UID_TO_UUID
+  uuid_t	useruuid,		/* UUID for username */
+		groupuuid;		/* UUID for groupname */
+  int		is_member;		/* True if user is a member of group */
+#endif /* HAVE_MBR_UID_TO_UUID */
 
 
-   /*
-    * Get the salt data between dollar signs, e.g. $1$saltdata$md5.
-    * Get a maximum of 8 characters of salt data after $1$...
-    */
+ /*
+  * Check to see if the user is a member of the named group...
+  */
 
-    for (salt_end = salt + 3; *salt_end && (salt_end - salt) < 11; salt_end ++)
-      if (*salt_end == '$')
-        break;
+  group = getgrnam(groupname);
+  endgrent();
 
+  if (group != NULL)
+  {
    /*
-    * Compute the MD5 sum we need...
+    * Group exists, check it...
     */
 
-    pwlen = strlen(pw);
-
-    _cupsMD5Init(&state);
-    _cupsMD5Append(&state, (unsigned char *)pw, pwlen);
-    _cupsMD5Append(&state, (unsigned char *)salt, salt_end - salt);
+    for (i = 0; group->gr_mem[i]; i ++)
+      if (!_cups_strcasecmp(username, group->gr_mem[i]))
+	return (1);
+  }
 
-    _cupsMD5Init(&state2);
-    _cupsMD5Append(&state2, (unsigned char *)pw, pwlen);
-    _cupsMD5Append(&state2, (unsigned char *)salt + 3, salt_end - salt - 3);
-    _cupsMD5Append(&state2, (unsigned char *)pw, pwlen);
-    _cupsMD5Finish(&state2, digest);
+ /*
+  * Group doesn't exist or user not in group list, check the group ID
+  * against the user's group ID...
+  */
 
-    for (i = pwlen; i > 0; i -= 16)
-      _cupsMD5Append(&state, digest, i > 16 ? 16 : i);
+  if (user && group && group->gr_gid == user->pw_gid)
+    return (1);
 
-    for (i = pwlen; i > 0; i >>= 1)
-      _cupsMD5Append(&state, (unsigned char *)((i & 1) ? "" : pw), 1);
+#ifdef HAVE_MBR_UID_TO_UUID
+ /*
+  * Check group membership through MacOS X membership API...
+  */
 
-    _cupsMD5Finish(&state, digest);
+  if (user && !mbr_uid_to_uuid(user->pw_uid, useruuid))
+  {
+    if (group)
+    {
+     /*
+      * Map group name to UUID and check membership...
+      */
 
-    for (i = 0; i < 1000; i ++)
+      if (!mbr_gid_to_uuid(group->gr_gid, groupuuid))
+        if (!mbr_check_membership(useruuid, groupuuid, &is_member))
+	  if (is_member)
+	    return (1);
+    }
+    else if (groupname[0] == '#')
     {
-      _cupsMD5Init(&state);
+     /*
+      * Use UUID directly and check for equality (user UUID) and
+      * membership (group UUID)...
+      */
 
-      if (i & 1)
-        _cupsMD5Append(&state, (unsigned char *)pw, pwlen);
-      else
-        _cupsMD5Append(&state, digest, 16);
+      if (!uuid_parse((char *)groupname + 1, groupuuid))
+      {
+        if (!uuid_compare(useruuid, groupuuid))
+	  return (1);
+	else if (!mbr_check_membership(useruuid, groupuuid, &is_member))
+	  if (is_member)
+	    return (1);
+      }
 
-      if (i % 3)
-        _cupsMD5Append(&state, (unsigned char *)salt + 3, salt_end - salt - 3);
+      return (0);
+    }
+  }
+  else if (groupname[0] == '#')
+    return (0);
+#endif /* HAVE_MBR_UID_TO_UUID */
 
-      if (i % 7)
+ /*
+  * Username not found, group not found, or user is not part of the
+  * system group...  Check for a user and group in the MD5 password
+  * file...
+  */
+
+  if (get_md5_password(username, groupname, junk) != NULL)
+    return (1);
+
+ /*
+  * If we get this far, then the user isn't part of the named group...
+  */
+
+  return (0);
+}
+
+
+/*
+ * 'check_password()' - Check a Basic username and password.
+ *
+ * Errors that don't tell us whether the password is good, such as an
+ * unavailable directory server, return -1 so that they are not cached.
+ */
+
+static int				/* O - 1 if valid, 0 if not, -1 on error */
+check_password(cupsd_client_t *con,	/* I - Client connection */
+               const char     *username,/* I - Username */
+	       const char     *password)/* I - Password */
+{
+#if HAVE_LIBPAM
+ /*
+  * Only use PAM to do authentication.  This supports MD5
+  * passwords, among other things...
+  */
+
+  pam_handle_t		*pamh;		/* PAM authentication handle */
+  int			pamerr;		/* PAM error code */
+  struct pam_conv	pamdata;	/* PAM conversation data */
+  cupsd_authdata_t	data;		/* Authentication data */
+
+
+  strlcpy(data.username, username, sizeof(data.username));
+  strlcpy(data.password, password, sizeof(data.password));
+
+#  if defined(__sun) || defined(__hpux)
+  pamdata.conv        = (int (*)(int, struct pam_message **,
+				 struct pam_response **,
+				 void *))pam_func;
+#  else
+  pamdata.conv        = pam_func;
+#  endif /* __sun || __hpux */
+  pamdata.appdata_ptr = &data;
+
+#  ifdef __hpux
+ /*
+  * Workaround for HP-UX bug in pam_unix; see pam_func() below for
+  * more info...
+  */
+
+  auth_data = &data;
+#  endif /* __hpux */
+
+  pamerr = pam_start("cups", username, &pamdata, &pamh);
+  if (pamerr != PAM_SUCCESS)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+		    "[Client %d] pam_start() returned %d (%s)",
+		    con->http.fd, pamerr, pam_strerror(pamh, pamerr));
+    return (-1);
+  }
+
+#  ifdef HAVE_PAM_SET_ITEM
+#    ifdef PAM_RHOST
+  pamerr = pam_set_item(pamh, PAM_RHOST, con->http.hostname);
+  if (pamerr != PAM_SUCCESS)
+    cupsdLogMessage(CUPSD_LOG_WARN,
+		    "[Client %d] pam_set_item(PAM_RHOST) "
+		    "returned %d (%s)", con->http.fd, pamerr,
+		    pam_strerror(pamh, pamerr));
+#    endif /* PAM_RHOST */
+
+#    ifdef PAM_TTY
+  pamerr = pam_set_item(pamh, PAM_TTY, "cups");
+  if (pamerr != PAM_SUCCESS)
+    cupsdLogMessage(CUPSD_LOG_WARN,
+		    "[Client %d] pam_set_item(PAM_TTY) "
+		    "returned %d (%s)!", con->http.fd, pamerr,
+		    pam_strerror(pamh, pamerr));
+#    endif /* PAM_TTY */
+#  endif /* HAVE_PAM_SET_ITEM */
+
+  pamerr = pam_authenticate(pamh, PAM_SILENT);
+  if (pamerr != PAM_SUCCESS)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+		    "[Client %d] pam_authenticate() returned %d (%s)",
+		    con->http.fd, pamerr, pam_strerror(pamh, pamerr));
+    pam_end(pamh, 0);
+    return (pam_rejected(pamerr) ? 0 : -1);
+  }
+
+#  ifdef HAVE_PAM_SETCRED
+  pamerr = pam_setcred(pamh, PAM_ESTABLISH_CRED | PAM_SILENT);
+  if (pamerr != PAM_SUCCESS)
+    cupsdLogMessage(CUPSD_LOG_WARN,
+		    "[Client %d] pam_setcred() returned %d (%s)",
+		    con->http.fd, pamerr,
+		    pam_strerror(pamh, pamerr));
+#  endif /* HAVE_PAM_SETCRED */
+
+  pamerr = pam_acct_mgmt(pamh, PAM_SILENT);
+  if (pamerr != PAM_SUCCESS)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+		    "[Client %d] pam_acct_mgmt() returned %d (%s)",
+		    con->http.fd, pamerr, pam_strerror(pamh, pamerr));
+    pam_end(pamh, 0);
+    return (pam_rejected(pamerr) ? 0 : -1);
+  }
+
+  pam_end(pamh, PAM_SUCCESS);
+
+#elif defined(HAVE_USERSEC_H)
+ /*
+  * Use AIX authentication interface...
+  */
+
+  char	*authmsg;			/* Authentication message */
+  int	reenter;			/* ??? */
+
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG,
+		  "[Client %d] AIX authenticate of username \"%s\"",
+		  con->http.fd, username);
+
+  reenter = 1;
+  if (authenticate((char *)username, (char *)password, &reenter,
+                   &authmsg) != 0)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+		    "[Client %d] Unable to authenticate username "
+		    "\"%s\": %s", con->http.fd, username,
+		    strerror(errno));
+    return (-1);
+  }
+
+#else
+ /*
+  * Use normal UNIX password file-based authentication...
+  */
+
+  char			*pass;		/* Encrypted password */
+  struct passwd		*pw;		/* User password data */
+#  ifdef HAVE_SHADOW_H
+  struct spwd		*spw;		/* Shadow password data */
+#  endif /* HAVE_SHADOW_H */
+
+
+  pw = getpwnam(username);	/* Get the current password */
+  endpwent();			/* Close the password file */
+
+  if (!pw)
+  {
+   /*
+    * No such user...
+    */
+
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+		    "[Client %d] Unknown username \"%s\".",
+		    con->http.fd, username);
+    return (0);
+  }
+
+#  ifdef HAVE_SHADOW_H
+  spw = getspnam(username);
+  endspent();
+
+  if (!spw && !strcmp(pw->pw_passwd, "x"))
+  {
+   /*
+    * Don't allow blank passwords!
+    */
+
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+		    "[Client %d] Username \"%s\" has no shadow "
+		    "password.", con->http.fd, username);
+    return (0);
+  }
+
+  if (spw && !spw->sp_pwdp[0] && !pw->pw_passwd[0])
+#  else
+  if (!pw->pw_passwd[0])
+#  endif /* HAVE_SHADOW_H */
+  {
+   /*
+    * Don't allow blank passwords!
+    */
+
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+		    "[Client %d] Username \"%s\" has no password.",
+		    con->http.fd, username);
+    return (0);
+  }
+
+ /*
+  * OK, the password isn't blank, so compare with what came from the
+  * client...
+  */
+
+  pass = cups_crypt(password, pw->pw_passwd);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2,
+		  "[Client %d] pw_passwd=\"%s\", crypt=\"%s\"",
+		  con->http.fd, pw->pw_passwd, pass);
+
+  if (!pass || strcmp(pw->pw_passwd, pass))
+  {
+#  ifdef HAVE_SHADOW_H
+    if (spw)
+    {
+      pass = cups_crypt(password, spw->sp_pwdp);
+
+      cupsdLogMessage(CUPSD_LOG_DEBUG2,
+		      "[Client %d] sp_pwdp=\"%s\", crypt=\"%s\"",
+		      con->http.fd, spw->sp_pwdp, pass);
+
+      if (pass == NULL || strcmp(spw->sp_pwdp, pass))
+      {
+	cupsdLogMessage(CUPSD_LOG_ERROR,
+			"[Client %d] Authentication failed for user "
+			"\"%s\".", con->http.fd, username);
+	return (0);
+      }
+    }
+    else
+#  endif /* HAVE_SHADOW_H */
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+		      "[Client %d] Authentication failed for user "
+		      "\"%s\".", con->http.fd, username);
+      return (0);
+    }
+  }
+#endif /* HAVE_LIBPAM */
+
+  return (1);
+}
+
+
+/*
+ * 'compare_groups()' - Compare two cached group memberships.
+ */
+
+static int				/* O - Result of comparison */
+compare_groups(cupsd_groupcache_t *a,	/* I - First membership */
+               cupsd_groupcache_t *b)	/* I - Second membership */
+{
+  int	result;				/* Result of comparison */
+
+
+  if ((result = strcmp(a->username, b->username)) != 0)
+    return (result);
+  else if ((result = strcmp(a->groupname, b->groupname)) != 0)
+    return (result);
+  else if (a->uid != b->uid)
+    return (a->uid - b->uid);
+  else
+    return (a->gid - b->gid);
+}
+
+
+/*
+ * 'compare_locations()' - Compare two locations.
+ */
+
+static int				/* O - Result of comparison */
+compare_locations(cupsd_location_t *a,	/* I - First location */
+                  cupsd_location_t *b)	/* I - Second location */
+{
+  return (strcmp(b->location, a->location));
+}
+
+
+/*
+ * 'compile_authset()' - Compile authorization masks.
+ */
+
+static cupsd_authset_t *		/* O - Compiled masks or NULL on error */
+compile_authset(cupsd_authset_t *set,	/* I - Old compiled masks or NULL */
+                cups_array_t    *masks)	/* I - Masks */
+{
+  cupsd_authmask_t	*mask;		/* Current mask */
+  cupsd_netif_t		*iface;		/* Network interface */
+  unsigned		addr[4],	/* Network address */
+			netmask[4];	/* Network mask */
+  int			i;		/* Looping var */
+
+
+  free_authset(set);
+
+  if ((set = calloc(1, sizeof(cupsd_authset_t))) == NULL)
+    return (NULL);
+
+  set->num_masks = cupsArrayCount(masks);
+  set->netif_gen = NetIFGeneration;
+
+  for (mask = (cupsd_authmask_t *)cupsArrayFirst(masks);
+       mask && !set->fallback;
+       mask = (cupsd_authmask_t *)cupsArrayNext(masks))
+  {
+    switch (mask->type)
+    {
+      case CUPSD_AUTH_INTERFACE :
+	  set->has_interface = 1;
+
+          if (!strcmp(mask->mask.name.name, "*"))
+	  {
+	    set->has_local = 1;
+
+            cupsdNetIFUpdate();
+
+	    set->netif_gen = NetIFGeneration;
+	  }
+
+	  for (iface = (cupsd_netif_t *)cupsArrayFirst(NetIFList);
+	       iface && !set->fallback;
+	       iface = (cupsd_netif_t *)cupsArrayNext(NetIFList))
+	  {
+	    if (set->has_local && !strcmp(mask->mask.name.name, "*"))
+	    {
+	      if (!iface->is_local)
+	        continue;
+	    }
+	    else if (strcmp(mask->mask.name.name, iface->name))
+	      continue;
+
+	    if (iface->address.addr.sa_family == AF_INET)
+	    {
+	     /*
+	      * IPv4 interfaces only match the last 32 bits of the address...
+	      */
+
+	      netmask[0] = ntohl(iface->mask.ipv4.sin_addr.s_addr);
+	      addr[0]    = ntohl(iface->address.ipv4.sin_addr.s_addr) &
+	                   netmask[0];
+
+	      if (!add_authnode(&(set->addrs4), addr, netmask, 1))
+	        set->fallback = 1;
+	    }
+#ifdef AF_INET6
+	    else
+	    {
+	      for (i = 0; i < 4; i ++)
+	      {
+	        netmask[i] = ntohl(iface->mask.ipv6.sin6_addr.s6_addr32[i]);
+		addr[i]    = ntohl(iface->address.ipv6.sin6_addr.s6_addr32[i]) &
+		             netmask[i];
+	      }
+
+	      if (!add_authnode(&(set->addrs), addr, netmask, 4))
+	        set->fallback = 1;
+	    }
+#endif /* AF_INET6 */
+	  }
+	  break;
+
+      case CUPSD_AUTH_NAME :
+          if (!set->names)
+	    set->names = cupsArrayNew((cups_array_func_t)_cups_strcasecmp,
+	                              NULL);
+
+          if (!cupsArrayAdd(set->names, mask->mask.name.name))
+	    set->fallback = 1;
+
+          if (mask->mask.name.name[0] == '.')
+	  {
+	    if (!set->domains)
+	      set->domains = cupsArrayNew((cups_array_func_t)_cups_strcasecmp,
+	                                  NULL);
+
+            if (!cupsArrayAdd(set->domains, mask->mask.name.name))
+	      set->fallback = 1;
+	  }
+	  break;
+
+      case CUPSD_AUTH_IP :
+         /*
+	  * Networks that can never match, such as "None", are left out...
+	  */
+
+          for (i = 0; i < 4; i ++)
+	    if (mask->mask.ip.address[i] & ~mask->mask.ip.netmask[i])
+	      break;
+
+          if (i == 4 &&
+	      !add_authnode(&(set->addrs), mask->mask.ip.address,
+	                    mask->mask.ip.netmask, 4))
+	    set->fallback = 1;
+          break;
+    }
+  }
+
+  if (set->fallback)
+    cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                    "compile_authset: Unable to compile %d masks, checking "
+		    "them one at a time.", set->num_masks);
+
+  return (set);
+}
+
+
+/*
+ * 'compile_locations()' - Compile the location trees.
+ *
+ * The locations are added to a tree of path characters so that
+ * cupsdFindBest() only needs to look at the locations that are a prefix of
+ * the URI.  Queue names in /printers and /classes URIs are case-insensitive,
+ * so a second tree is built with the locations in lowercase.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+compile_locations(void)
+{
+  cupsd_location_t	*loc;		/* Current location */
+
+
+  free_locations();
+
+  if (!Locations)
+    return (0);
+
+  if ((loc_tree = calloc(1, sizeof(cupsd_locnode_t))) == NULL ||
+      (loc_ctree = calloc(1, sizeof(cupsd_locnode_t))) == NULL)
+  {
+    free_locations();
+    return (0);
+  }
+
+  for (loc = (cupsd_location_t *)cupsArrayFirst(Locations);
+       loc;
+       loc = (cupsd_location_t *)cupsArrayNext(Locations))
+  {
+    if (!loc->location || loc->location[0] != '/' || loc->length <= 0)
+      continue;
+
+    if (!add_locnode(loc_tree, loc, 0) || !add_locnode(loc_ctree, loc, 1))
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Unable to allocate memory for location tree.");
+      free_locations();
+      return (0);
+    }
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'copy_authmask()' - Copy function for auth masks.
+ */
+
+static cupsd_authmask_t	*		/* O - New auth mask */
+copy_authmask(cupsd_authmask_t *mask,	/* I - Existing auth mask */
+              void             *data)	/* I - User data (unused) */
+{
+  cupsd_authmask_t	*temp;		/* New auth mask */
+
+
+  (void)data;
+
+  if ((temp = malloc(sizeof(cupsd_authmask_t))) != NULL)
+  {
+    memcpy(temp, mask, sizeof(cupsd_authmask_t));
+
+    if (temp->type == CUPSD_AUTH_NAME || temp->type == CUPSD_AUTH_INTERFACE)
+    {
+     /*
+      * Make a copy of the name...
+      */
+
+      if ((temp->mask.name.name = _cupsStrAlloc(temp->mask.name.name)) == NULL)
+      {
+       /*
+        * Failed to make copy...
+	*/
+
+        free(temp);
+	temp = NULL;
+      }
+    }
+  }
+
+  return (temp);
+}
+
+
+#if !HAVE_LIBPAM && !defined(HAVE_USERSEC_H)
+/*
+ * 'cups_crypt()' - Encrypt the password using the DES or MD5 algorithms,
+ *                  as needed.
+ */
+
+static char *				/* O - Encrypted password */
+cups_crypt(const char *pw,		/* I - Password string */
+           const char *salt)		/* I - Salt (key) string */
+{
+  if (!strncmp(salt, "$1$", 3))
+  {
+   /*
+    * Use MD5 passwords without the benefit of PAM; this is for
+    * Slackware Linux, and the algorithm was taken from the
+    * old shadow-19990827/lib/md5crypt.c source code... :(
+    */
+
+    int			i;		/* Looping var */
+    unsigned long	n;		/* Output number */
+    int			pwlen;		/* Length of password string */
+    const char		*salt_end;	/* End of "salt" data for MD5 */
+    char		*ptr;		/* Pointer into result string */
+    _cups_md5_state_t	state;		/* Primary MD5 state info */
+    _cups_md5_state_t	state2;		/* Secondary MD5 state info */
+    unsigned char	digest[16];	/* MD5 digest result */
+    static char		result[120];	/* Final password string */
+
+
+   /*
+    * Get the salt data between dollar signs, e.g. $1$saltdata$md5.
+    * Get a maximum of 8 characters of salt data after $1$...
+    */
+
+    for (salt_end = salt + 3; *salt_end && (salt_end - salt) < 11; salt_end ++)
+      if (*salt_end == '$')
+        break;
+
+   /*
+    * Compute the MD5 sum we need...
+    */
+
+    pwlen = strlen(pw);
+
+    _cupsMD5Init(&state);
+    _cupsMD5Append(&state, (unsigned char *)pw, pwlen);
+    _cupsMD5Append(&state, (unsigned char *)salt, salt_end - salt);
+
+    _cupsMD5Init(&state2);
+    _cupsMD5Append(&state2, (unsigned char *)pw, pwlen);
+    _cupsMD5Append(&state2, (unsigned char *)salt + 3, salt_end - salt - 3);
+    _cupsMD5Append(&state2, (unsigned char *)pw, pwlen);
+    _cupsMD5Finish(&state2, digest);
+
+    for (i = pwlen; i > 0; i -= 16)
+      _cupsMD5Append(&state, digest, i > 16 ? 16 : i);
+
+    for (i = pwlen; i > 0; i >>= 1)
+      _cupsMD5Append(&state, (unsigned char *)((i & 1) ? "" : pw), 1);
+
+    _cupsMD5Finish(&state, digest);
+
+    for (i = 0; i < 1000; i ++)
+    {
+      _cupsMD5Init(&state);
+
+      if (i & 1)
+        _cupsMD5Append(&state, (unsigned char *)pw, pwlen);
+      else
+        _cupsMD5Append(&state, digest, 16);
+
+      if (i % 3)
+        _cupsMD5Append(&state, (unsigned char *)salt + 3, salt_end - salt - 3);
+
+      if (i % 7)
         _cupsMD5Append(&state, (unsigned char *)pw, pwlen);
 
       if (i & 1)
@@ -2403,6 +3160,35 @@ cups_crypt(const char *pw,		/* I - Password string */
 #endif /* !HAVE_LIBPAM && !HAVE_USERSEC_H */
 
 
+/*
+ * 'find_locnode()' - Find the child node for a character.
+ */
+
+static cupsd_locnode_t *		/* O - Child node or NULL */
+find_locnode(cupsd_locnode_t *node,	/* I - Parent node */
+             int             ch)	/* I - Character */
+{
+  int	left,				/* Left side of search */
+	right,				/* Right side of search */
+	current;			/* Current child */
+
+
+  for (left = 0, right = node->num_children - 1; left <= right;)
+  {
+    current = (left + right) / 2;
+
+    if (node->children[current].ch == ch)
+      return (node->children + current);
+    else if (node->children[current].ch < ch)
+      left = current + 1;
+    else
+      right = current - 1;
+  }
+
+  return (NULL);
+}
+
+
 /*
  * 'free_authmask()' - Free function for auth masks.
  */
@@ -2420,6 +3206,202 @@ free_authmask(cupsd_authmask_t *mask,	/* I - Auth mask to free */
 }
 
 
+/*
+ * 'free_authnode()' - Free an address trie.
+ */
+
+static void
+free_authnode(cupsd_authnode_t *node)	/* I - Root of trie */
+{
+  if (!node)
+    return;
+
+  free_authnode(node->child[0]);
+  free_authnode(node->child[1]);
+
+  free(node);
+}
+
+
+/*
+ * 'free_authset()' - Free compiled authorization masks.
+ */
+
+static void
+free_authset(cupsd_authset_t *set)	/* I - Compiled masks */
+{
+  if (!set)
+    return;
+
+  free_authnode(set->addrs);
+  free_authnode(set->addrs4);
+
+  cupsArrayDelete(set->names);
+  cupsArrayDelete(set->domains);
+
+  free(set);
+}
+
+
+/*
+ * 'free_locations()' - Free the location trees.
+ */
+
+static void
+free_locations(void)
+{
+  if (loc_tree)
+  {
+    free_locnode(loc_tree);
+    free(loc_tree);
+    loc_tree = NULL;
+  }
+
+  if (loc_ctree)
+  {
+    free_locnode(loc_ctree);
+    free(loc_ctree);
+    loc_ctree = NULL;
+  }
+}
+
+
+/*
+ * 'free_locnode()' - Free a location tree node.
+ */
+
+static void
+free_locnode(cupsd_locnode_t *node)	/* I - Node */
+{
+  int	i;				/* Looping var */
+
+
+  for (i = 0; i < node->num_children; i ++)
+    free_locnode(node->children + i);
+
+  if (node->children)
+    free(node->children);
+
+  if (node->locs)
+    free(node->locs);
+}
+
+
+/*
+ * 'get_authcache()' - Get the cache entry for Basic credentials.
+ *
+ * The entry is found using an HMAC-MD5, keyed with a random salt, of the
+ * authentication type, location, client hostname, username, and password,
+ * so the password is never kept in memory.  If the credentials are not
+ * cached, the oldest entry is reused and returned with an expiration time
+ * of 0.
+ */
+
+static cupsd_authcache_t *		/* O - Cache entry or NULL if disabled */
+get_authcache(cupsd_client_t *con,	/* I - Client connection */
+              int            type,	/* I - Authentication type */
+              const char     *username,	/* I - Username */
+	      const char     *password)	/* I - Password */
+{
+  int			i;		/* Looping var */
+  cupsd_authcache_t	*cache,		/* Current entry */
+			*oldest;	/* Oldest entry */
+  _cups_md5_state_t	state;		/* MD5 state */
+  unsigned char		pad[64],	/* HMAC inner/outer key pad */
+			digest[16];	/* Keyed hash */
+  const char		*location;	/* Location being accessed */
+  char			typestr[12];	/* Authentication type string */
+  time_t		curtime;	/* Current time */
+
+
+  if (AuthCacheTimeout <= 0)
+    return (NULL);
+
+  if (!authcache_salted)
+  {
+   /*
+    * The salt must not be guessable, so don't cache anything unless we can
+    * read it from the kernel's random number generator...
+    */
+
+    int		fd;			/* /dev/urandom file descriptor */
+    ssize_t	bytes;			/* Bytes read */
+
+
+    if ((fd = open("/dev/urandom", O_RDONLY)) < 0)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Unable to open /dev/urandom - %s; not caching "
+		      "credentials.", strerror(errno));
+      return (NULL);
+    }
+
+    bytes = read(fd, authcache_salt, sizeof(authcache_salt));
+    close(fd);
+
+    if (bytes != (ssize_t)sizeof(authcache_salt))
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Unable to read /dev/urandom - %s; not caching "
+		      "credentials.", bytes < 0 ? strerror(errno) : "short read");
+      return (NULL);
+    }
+
+    authcache_salted = 1;
+  }
+
+  location = con->best ? con->best->location : "";
+
+  snprintf(typestr, sizeof(typestr), "%d", type);
+
+ /*
+  * HMAC-MD5 (RFC 2104) with the salt as the key; the inner hash covers
+  * everything that must match for the cached result to apply...
+  */
+
+  memset(pad, 0x36, sizeof(pad));
+  for (i = 0; i < (int)sizeof(authcache_salt); i ++)
+    pad[i] ^= authcache_salt[i];
+
+  _cupsMD5Init(&state);
+  _cupsMD5Append(&state, pad, sizeof(pad));
+  _cupsMD5Append(&state, (unsigned char *)typestr, strlen(typestr) + 1);
+  _cupsMD5Append(&state, (unsigned char *)location, strlen(location) + 1);
+  _cupsMD5Append(&state, (unsigned char *)con->http.hostname,
+                 strlen(con->http.hostname) + 1);
+  _cupsMD5Append(&state, (unsigned char *)username, strlen(username) + 1);
+  _cupsMD5Append(&state, (unsigned char *)password, strlen(password));
+  _cupsMD5Finish(&state, digest);
+
+  memset(pad, 0x5c, sizeof(pad));
+  for (i = 0; i < (int)sizeof(authcache_salt); i ++)
+    pad[i] ^= authcache_salt[i];
+
+  _cupsMD5Init(&state);
+  _cupsMD5Append(&state, pad, sizeof(pad));
+  _cupsMD5Append(&state, digest, sizeof(digest));
+  _cupsMD5Finish(&state, digest);
+
+  curtime = time(NULL);
+
+  for (i = CUPSD_AUTHCACHE_MAX, cache = authcache, oldest = authcache;
+       i > 0;
+       i --, cache ++)
+  {
+    if (cache->expires > curtime && !memcmp(cache->digest, digest, 16))
+      return (cache);
+
+    if (cache->expires < oldest->expires)
+      oldest = cache;
+  }
+
+  memcpy(oldest->digest, digest, 16);
+  oldest->expires = 0;
+
+  return (oldest);
+}
+
+
 /*
  * 'get_md5_password()' - Get an MD5 password.
  */
@@ -2482,6 +3464,33 @@ get_md5_password(const char *username,	/* I - Username */
 }
 
 
+/*
+ * 'match_authnode()' - Match an address against an address trie.
+ */
+
+static int				/* O - 1 if a network matches, 0 otherwise */
+match_authnode(cupsd_authnode_t *node,	/* I - Root of trie */
+               const unsigned   *addr,	/* I - Address */
+	       int              words)	/* I - Number of address words */
+{
+  int	i;				/* Looping var */
+
+
+  for (i = 0; node; i ++)
+  {
+    if (node->match)
+      return (1);
+
+    if (i >= (32 * words))
+      break;
+
+    node = node->child[(addr[i / 32] & (0x80000000 >> (i & 31))) != 0];
+  }
+
+  return (0);
+}
+
+
 #if HAVE_LIBPAM
 /*
  * 'pam_func()' - PAM conversation function.
@@ -2573,6 +3582,32 @@ pam_func(
 
   return (PAM_SUCCESS);
 }
+
+
+/*
+ * 'pam_rejected()' - Check whether a PAM error rejects the user.
+ *
+ * Other errors, such as an unreachable directory server, say nothing about
+ * the credentials.
+ */
+
+static int				/* O - 1 if rejected, 0 otherwise */
+pam_rejected(int pamerr)		/* I - PAM error code */
+{
+  switch (pamerr)
+  {
+    case PAM_AUTH_ERR :
+    case PAM_USER_UNKNOWN :
+    case PAM_MAXTRIES :
+    case PAM_ACCT_EXPIRED :
+    case PAM_PERM_DENIED :
+    case PAM_NEW_AUTHTOK_REQD :
+        return (1);
+
+    default :
+        return (0);
+  }
+}
 #elif !defined(HAVE_USERSEC_H)
 
 
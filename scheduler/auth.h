@@ -88,6 +88,9 @@ typedef struct
   }		mask;			/* Mask data */
 } cupsd_authmask_t;
 
+typedef struct cupsd_authset_s cupsd_authset_t;
+					/**** Compiled authorization masks ****/
+
 typedef struct
 {
   char			*location;	/* Location of resource */
@@ -102,6 +105,8 @@ typedef struct
 			*allow,		/* Allow lines */
 			*deny;		/* Deny lines */
   http_encryption_t	encryption;	/* To encrypt or not to encrypt... */
+  cupsd_authset_t	*allow_set,	/* Compiled allow lines */
+			*deny_set;	/* Compiled deny lines */
 } cupsd_location_t;
 
 typedef struct cupsd_client_s cupsd_client_t;
@@ -113,6 +118,10 @@ typedef struct cupsd_client_s cupsd_client_t;
 
 VAR cups_array_t	*Locations	VALUE(NULL);
 					/* Authorization locations */
+VAR int			GroupCacheHits	VALUE(0),
+					/* Group membership cache hits */
+			GroupCacheMisses VALUE(0);
+					/* Group membership cache misses */
 #ifdef HAVE_SSL
 VAR http_encryption_t	DefaultEncryption VALUE(HTTP_ENCRYPT_REQUIRED);
 					/* Default encryption for authentication */
@@ -139,6 +148,8 @@ extern int		cupsdCheckGroup(const char *username,
 			                const char *groupname);
 extern cupsd_location_t	*cupsdCopyLocation(cupsd_location_t *loc);
 extern void		cupsdDeleteAllLocations(void);
+extern void		cupsdExpireGroupCache(void);
+extern void		cupsdFlushAuthCache(void);
 extern cupsd_location_t	*cupsdFindBest(const char *path, http_state_t state);
 extern cupsd_location_t	*cupsdFindLocation(const char *location);
 extern void		cupsdFreeLocation(cupsd_location_t *loc);
@@ -284,6 +284,8 @@ cupsdLoadAllClasses(void)
 			*valueptr;	/* Pointer into value */
   cupsd_printer_t	*p,		/* Current printer class */
 			*temp;		/* Temporary pointer to printer */
+  struct stat		fileinfo;	/* classes.conf file information */
+  time_t		conftime;	/* classes.conf modification time */
 
 
  /*
@@ -294,6 +296,11 @@ cupsdLoadAllClasses(void)
   if ((fp = cupsdOpenConfFile(line)) == NULL)
     return;
 
+  if (stat(line, &fileinfo))
+    conftime = 0;
+  else
+    conftime = fileinfo.st_mtime;
+
  /*
   * Read class configurations until we hit EOF...
   */
@@ -347,6 +354,7 @@ cupsdLoadAllClasses(void)
     {
       if (p != NULL)
       {
+        cupsdLoadPrinterState(p, conftime);
         cupsdSetPrinterAttrs(p);
         p = NULL;
       }
@@ -809,7 +817,27 @@ cupsdSaveAllClasses(void)
     cupsFilePuts(fp, "</Class>\n");
   }
 
-  cupsdCloseCreatedConfFile(fp, filename);
+  if (cupsdQueueCreatedConfFile(fp, filename))
+    return;
+
+ /*
+  * classes.conf now has the current state of every class, so remove any
+  * state files that have been written since the last save once it is in
+  * place...
+  */
+
+  for (pclass = (cupsd_printer_t *)cupsArrayFirst(Printers);
+       pclass;
+       pclass = (cupsd_printer_t *)cupsArrayNext(Printers))
+  {
+    if (!(pclass->type & CUPS_PRINTER_CLASS))
+      continue;
+
+    pclass->state_dirty = 0;
+
+    if (pclass->state_saved)
+      cupsdRemovePrinterState(pclass);
+  }
 }
 
 
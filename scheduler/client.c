@@ -38,6 +38,8 @@
  *			      (i.e. "..").
  *   pipe_command()	    - Pipe the output of a command to the remote
  *			      client.
+ *   splice_request()	    - Move request data from the client to the
+ *			      request file.
  *   valid_host()	    - Is the Host: field valid?
  *   write_file()	    - Send a file via HTTP.
  *   write_pipe()	    - Flag that data is available on the CGI pipe.
@@ -101,6 +103,9 @@ static int		is_cgi(cupsd_client_t *con, const char *filename,
 static int		is_path_absolute(const char *path);
 static int		pipe_command(cupsd_client_t *con, int infile, int *outfile,
 			             char *command, char *options, int root);
+#ifdef HAVE_SPLICE
+static int		splice_request(cupsd_client_t *con, int *written);
+#endif /* HAVE_SPLICE */
 static int		valid_host(cupsd_client_t *con);
 static int		write_file(cupsd_client_t *con, http_status_t code,
 		        	   char *filename, char *type,
@@ -124,6 +129,7 @@ cupsdAcceptClient(cupsd_listener_t *lis)/* I - Listener socket */
   socklen_t		addrlen;	/* Length of address */
   char			*hostname;	/* Hostname for address */
   http_addr_t		temp;		/* Temporary address variable */
+  cupsd_netif_t		*netif;		/* Local network interface */
   static time_t		last_dos = 0;	/* Time of last DoS attack */
 #ifdef HAVE_TCPD_H
   struct request_info	wrap_req;	/* TCP wrappers request information */
@@ -406,6 +412,8 @@ cupsdAcceptClient(cupsd_listener_t *lis)/* I - Listener socket */
   {
     if (httpAddrLocalhost(&temp))
       strlcpy(con->servername, "localhost", sizeof(con->servername));
+    else if (HostNameLookups && (netif = cupsdNetIFFindAddress(&temp)) != NULL)
+      strlcpy(con->servername, netif->hostname, sizeof(con->servername));
     else if (HostNameLookups || RemotePort)
       httpAddrLookup(&temp, con->servername, sizeof(con->servername));
     else
@@ -508,6 +516,16 @@ cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
   cupsdLogMessage(CUPSD_LOG_DEBUG, "[Client %d] Closing connection.",
                   con->http.fd);
 
+ /*
+  * Stop waiting for events...
+  */
+
+  if (con->notify_wait)
+  {
+    cupsArrayRemove(NotifyWaitClients, con);
+    con->notify_wait = 0;
+  }
+
  /*
   * Flush pending writes before closing...
   */
@@ -588,6 +606,7 @@ cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
 
     httpClearCookie(HTTP(con));
     httpClearFields(HTTP(con));
+    _httpFreeBuffers(HTTP(con));
 
     cupsdClearString(&con->filename);
     cupsdClearString(&con->command);
@@ -600,6 +619,8 @@ cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
       con->request = NULL;
     }
 
+    _ippFreeReader(&(con->reader));
+
     if (con->response)
     {
       ippDelete(con->response);
@@ -671,7 +692,8 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
   int			major, minor;	/* HTTP version numbers */
   http_status_t		status;		/* Transfer status */
   ipp_state_t		ipp_state;	/* State of IPP transfer */
-  int			bytes;		/* Number of bytes to POST */
+  int			bytes,		/* Number of bytes to POST */
+			written;	/* Number of bytes written to file */
   char			*filename;	/* Name of file for GET/HEAD */
   char			buf[1024];	/* Buffer for real filename */
   struct stat		filestats;	/* File information */
@@ -700,6 +722,28 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 		  con->request ? ipp_states[con->request->state] : "",
 		  con->file);
 
+  if (con->notify_wait)
+  {
+   /*
+    * A Get-Notifications request is waiting for events; only check for the
+    * client closing the connection and stop reading until the response has
+    * been sent...
+    */
+
+    if ((bytes = recv(con->http.fd, buf, 1, MSG_PEEK)) == 0 ||
+        (bytes < 0 && errno != EAGAIN && errno != EINTR))
+    {
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "[Client %d] Closing while waiting for events.",
+		      con->http.fd);
+      cupsdCloseClient(con);
+    }
+    else
+      cupsdAddSelect(con->http.fd, NULL, NULL, con);
+
+    return;
+  }
+
 #ifdef HAVE_SSL
   if (con->auto_ssl)
   {
@@ -789,6 +833,8 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	  con->request = NULL;
 	}
 
+	_ippFreeReader(&(con->reader));
+
 	if (con->response)
 	{
 	  ippDelete(con->response);
@@ -1548,7 +1594,10 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
 	    if (!strcmp(con->http.fields[HTTP_FIELD_CONTENT_TYPE],
 	                "application/ipp"))
-              con->request = ippNew();
+	    {
+              con->request        = ippNewWithArena();
+	      con->reader.maxsize = MaxRequestSize > 0 ? (size_t)MaxRequestSize : 0;
+	    }
             else if (!WebInterface)
 	    {
 	     /*
@@ -2061,16 +2110,20 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
           if (con->request && con->file < 0)
 	  {
 	   /*
-	    * Grab any request data from the connection...
+	    * Grab any request data from the connection without waiting for
+	    * the rest of the request...
 	    */
 
-	    if ((ipp_state = ippRead(&(con->http), con->request)) == IPP_ERROR)
+	    if ((ipp_state = _ippReadHTTP(HTTP(con), con->request,
+	                                  &(con->reader))) == IPP_ERROR)
 	    {
               cupsdLogMessage(CUPSD_LOG_ERROR,
                               "[Client %d] IPP read error: %s", con->http.fd,
                               cupsLastErrorString());
 
-	      cupsdSendError(con, HTTP_BAD_REQUEST, CUPSD_AUTH_NONE);
+	      cupsdSendError(con, cupsLastError() == IPP_REQUEST_ENTITY ?
+	                              HTTP_REQUEST_TOO_LARGE : HTTP_BAD_REQUEST,
+			     CUPSD_AUTH_NONE);
 	      cupsdCloseClient(con);
 	      return;
 	    }
@@ -2093,10 +2146,14 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 			      ippOpString(con->request->request.op.operation_id),
 			      con->request->request.op.request_id);
 	      con->bytes += ippLength(con->request);
+
+	      if (con->reader.pos >= con->reader.used)
+	        _ippFreeReader(&(con->reader));
 	    }
 	  }
 
-          if (con->file < 0 && con->http.state != HTTP_POST_SEND)
+          if (con->file < 0 && (con->http.state != HTTP_POST_SEND ||
+	                        con->reader.pos < con->reader.used))
 	  {
            /*
 	    * Create a file as needed for the request data...
@@ -2125,9 +2182,35 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
             fcntl(con->file, F_SETFD, fcntl(con->file, F_GETFD) | FD_CLOEXEC);
 	  }
 
-	  if (con->http.state != HTTP_POST_SEND)
+	  if (con->http.state != HTTP_POST_SEND ||
+	      con->reader.pos < con->reader.used)
 	  {
-            if ((bytes = httpRead2(HTTP(con), line, sizeof(line))) < 0)
+	    if (con->reader.pos < con->reader.used)
+	    {
+	     /*
+	      * Copy any document data that was read along with the IPP
+	      * request...
+	      */
+
+	      bytes   = (int)(con->reader.used - con->reader.pos);
+	      written = write(con->file, con->reader.buffer + con->reader.pos,
+	                      bytes);
+
+	      _ippFreeReader(&(con->reader));
+	    }
+	    else
+#ifdef HAVE_SPLICE
+           /*
+	    * Move the data directly from the socket to the file if we can,
+	    * otherwise read it through the HTTP buffer...
+	    */
+
+            if ((bytes = splice_request(con, &written)) == 0)
+#endif /* HAVE_SPLICE */
+            if ((bytes = httpRead2(HTTP(con), line, sizeof(line))) > 0)
+	      written = write(con->file, line, bytes);
+
+            if (bytes < 0)
 	    {
 	      if (con->http.error && con->http.error != EPIPE)
 		cupsdLogMessage(CUPSD_LOG_DEBUG,
@@ -2146,7 +2229,7 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	    {
 	      con->bytes += bytes;
 
-              if (write(con->file, line, bytes) < bytes)
+              if (written < bytes)
 	      {
         	cupsdLogMessage(CUPSD_LOG_ERROR,
 	                	"[Client %d] Unable to write %d bytes to "
@@ -2837,6 +2920,14 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
 
 	      if (con->http.version == HTTP_1_1)
 	      {
+		const char *coding = httpGetContentEncoding(HTTP(con));
+					/* Content coding to use */
+
+		if (coding &&
+		    httpPrintf(HTTP(con), "Content-Encoding: %s\r\n",
+		               coding) < 0)
+		  return;
+
 		if (httpPrintf(HTTP(con), "Transfer-Encoding: chunked\r\n") < 0)
 		  return;
 	      }
@@ -2872,7 +2963,19 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
 	    }
 
 	    if (con->http.version == HTTP_1_1)
+	    {
+	      const char *coding = httpGetContentEncoding(HTTP(con));
+					/* Content coding to use */
+
 	      con->http.data_encoding = HTTP_ENCODE_CHUNKED;
+
+	      if (con->sent_header == 1 && coding &&
+	          _httpSetContentCoding(HTTP(con), coding))
+	      {
+		cupsdCloseClient(con);
+		return;
+	      }
+	    }
           }
 	  else
 	    field_col = 0;
@@ -2925,7 +3028,8 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
 
       httpFlushWrite(HTTP(con));
 
-      if (con->http.data_encoding == HTTP_ENCODE_CHUNKED && con->sent_header == 1)
+      if (con->http.data_encoding == HTTP_ENCODE_CHUNKED &&
+          (con->sent_header == 1 || !con->pipe_pid))
       {
 	if (httpWrite2(HTTP(con), "", 0) < 0)
 	{
@@ -2967,6 +3071,8 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
       con->request = NULL;
     }
 
+    _ippFreeReader(&(con->reader));
+
     if (con->response)
     {
       ippDelete(con->response);
@@ -3972,6 +4078,82 @@ pipe_command(cupsd_client_t *con,	/* I - Client connection */
 }
 
 
+#ifdef HAVE_SPLICE
+/*
+ * 'splice_request()' - Move request data from the client to the request file.
+ *
+ * The data goes through a pipe that is shared by all clients, since it is
+ * always emptied before returning.  At most one pipe buffer is moved per call
+ * so that a large upload only proceeds as fast as select() reports data and
+ * does not starve other clients.
+ */
+
+static int				/* O - Bytes read, 0 for none, -1 on error */
+splice_request(cupsd_client_t *con,	/* I - Client connection */
+               int            *written)	/* O - Bytes written to file */
+{
+  int		bytes;			/* Bytes read from client */
+  ssize_t	moved;			/* Bytes moved to file */
+  char		buffer[8192];		/* Copy buffer */
+  static int	fds[2] = { -1, -1 };	/* Splice pipe */
+
+
+  if (con->file < 0)
+    return (0);
+
+  if (fds[0] < 0 && cupsdOpenPipe(fds))
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+                    "[Client %d] Unable to create splice pipe: %s",
+		    con->http.fd, strerror(errno));
+    return (0);
+  }
+
+  if ((bytes = (int)_httpSplice(HTTP(con), fds[1], 65536)) <= 0)
+    return (bytes);
+
+  for (*written = 0; *written < bytes; *written += (int)moved)
+  {
+    if ((moved = splice(fds[0], NULL, con->file, NULL,
+                        (size_t)(bytes - *written), SPLICE_F_MOVE)) > 0)
+      continue;
+    else if (moved < 0 && errno == EINTR)
+    {
+      moved = 0;
+      continue;
+    }
+
+   /*
+    * Not all file systems support splice(), so copy anything left in the
+    * pipe the old-fashioned way...
+    */
+
+    if (bytes - *written < (int)sizeof(buffer))
+      moved = bytes - *written;
+    else
+      moved = sizeof(buffer);
+
+    if ((moved = read(fds[0], buffer, (size_t)moved)) <= 0 ||
+        write(con->file, buffer, (size_t)moved) < moved)
+    {
+     /*
+      * Throw away the pipe and its contents so the next client starts clean...
+      */
+
+      cupsdClosePipe(fds);
+      break;
+    }
+  }
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                  "[Client %d] splice_request: Moved %d of %d bytes to \"%s\".",
+		  con->http.fd, *written, bytes, con->filename);
+
+  return (bytes);
+}
+#endif /* HAVE_SPLICE */
+
+
 /*
  * 'valid_host()' - Is the Host: field valid?
  */
@@ -3980,7 +4162,6 @@ static int				/* O - 1 if valid, 0 if not */
 valid_host(cupsd_client_t *con)		/* I - Client connection */
 {
   cupsd_alias_t	*a;			/* Current alias */
-  cupsd_netif_t	*netif;			/* Current network interface */
   const char	*host,			/* Host field */
 		*end;			/* End character */
 
@@ -4119,25 +4300,7 @@ valid_host(cupsd_client_t *con)		/* I - Client connection */
   * Check for interface hostname matches...
   */
 
-  for (netif = (cupsd_netif_t *)cupsArrayFirst(NetIFList);
-       netif;
-       netif = (cupsd_netif_t *)cupsArrayNext(NetIFList))
-  {
-    if (!_cups_strncasecmp(host, netif->hostname, netif->hostlen))
-    {
-     /*
-      * Prefix matches; check the character at the end - it must be ":", ".",
-      * ".:", or nul...
-      */
-
-      end = host + netif->hostlen;
-
-      if (!*end || *end == ':' || (*end == '.' && (!end[1] || end[1] == ':')))
-        return (1);
-    }
-  }
-
-  return (0);
+  return (cupsdNetIFFindHostname(host) != NULL);
 }
 
 
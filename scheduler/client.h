@@ -27,6 +27,7 @@ struct cupsd_client_s
   http_t		http;		/* HTTP client connection */
   ipp_t			*request,	/* IPP request information */
 			*response;	/* IPP response information */
+  _ipp_reader_t		reader;		/* Incremental IPP request reader */
   cupsd_location_t	*best;		/* Best match for AAA */
   struct timeval	start;		/* Request start time */
   http_state_t		operation;	/* Request operation */
@@ -45,6 +46,7 @@ struct cupsd_client_s
   int			file;		/* Input/output file */
   int			file_ready;	/* Input ready on file/pipe? */
   int			pipe_pid;	/* Pipe process ID (or 0 if not a pipe) */
+  time_t		notify_wait;	/* Time to stop waiting for events */
   int			sent_header,	/* Non-zero if sent HTTP header */
 			got_fields,	/* Non-zero if all fields seen */
 			header_used;	/* Number of header bytes used */
@@ -68,6 +70,13 @@ struct cupsd_client_s
 #define HTTP(con) &((con)->http)
 
 
+/*
+ * Smallest IPP response that is compressed for clients that accept it...
+ */
+
+#define CUPSD_COMPRESS_MIN	8192
+
+
 /*
  * HTTP listener structure...
  */
@@ -98,14 +107,24 @@ VAR time_t		ListeningPaused	VALUE(0);
 					/* Time when listening was paused */
 VAR cups_array_t	*Clients	VALUE(NULL),
 					/* HTTP clients */
-			*ActiveClients	VALUE(NULL);
+			*ActiveClients	VALUE(NULL),
 					/* Active HTTP clients */
+			*NotifyWaitClients VALUE(NULL);
+					/* Clients waiting for events */
+VAR int			NotifyWaitEvents VALUE(0);
+					/* Non-zero if waiting clients have events */
 VAR char		*ServerHeader	VALUE(NULL);
 					/* Server header in requests */
 VAR int			CGIPipes[2]	VALUE2(-1,-1);
 					/* Pipes for CGI error/debug output */
 VAR cupsd_statbuf_t	*CGIStatusBuffer VALUE(NULL);
 					/* Status buffer for pipes */
+#ifdef HAVE_SSL
+VAR int			TLSHandshakes	VALUE(0),
+					/* Number of TLS handshakes */
+			TLSResumed	VALUE(0);
+					/* Number of resumed TLS sessions */
+#endif /* HAVE_SSL */
 
 
 /*
@@ -113,9 +132,11 @@ VAR cupsd_statbuf_t	*CGIStatusBuffer VALUE(NULL);
  */
 
 extern void	cupsdAcceptClient(cupsd_listener_t *lis);
+extern void	cupsdCheckNotifications(void);
 extern void	cupsdCloseAllClients(void);
 extern int	cupsdCloseClient(cupsd_client_t *con);
 extern void	cupsdDeleteAllListeners(void);
+extern void	cupsdFlushAttrFilters(void);
 extern int	cupsdFlushHeader(cupsd_client_t *con);
 extern void	cupsdPauseListening(void);
 extern int	cupsdProcessIPPRequest(cupsd_client_t *con);
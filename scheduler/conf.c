@@ -25,6 +25,7 @@
  *   mime_error_cb()	      - Log a MIME error.
  *   parse_aaa()	      - Parse authentication, authorization, and access
  *				control lines.
+ *   parse_events()	      - Parse event names in a string.
  *   parse_fatal_errors()     - Parse FatalErrors values in a string.
  *   parse_groups()	      - Parse system group names in a string.
  *   parse_protocols()	      - Parse browse protocols in a string.
@@ -87,6 +88,7 @@ typedef struct
 
 static const cupsd_var_t	cupsd_vars[] =
 {
+  { "AuthCacheTimeout",		&AuthCacheTimeout,	CUPSD_VARTYPE_TIME },
   { "AutoPurgeJobs", 		&JobAutoPurge,		CUPSD_VARTYPE_BOOLEAN },
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
   { "BrowseDNSSDSubTypes",	&DNSSDSubTypes,		CUPSD_VARTYPE_STRING },
@@ -107,6 +109,8 @@ static const cupsd_var_t	cupsd_vars[] =
 #ifdef HAVE_GSSAPI
   { "GSSServiceName",		&GSSServiceName,	CUPSD_VARTYPE_STRING },
 #endif /* HAVE_GSSAPI */
+  { "GroupCacheRefresh",	&GroupCacheRefresh,	CUPSD_VARTYPE_BOOLEAN },
+  { "GroupCacheTimeout",	&GroupCacheTimeout,	CUPSD_VARTYPE_TIME },
   { "JobKillDelay",		&JobKillDelay,		CUPSD_VARTYPE_TIME },
   { "JobRetryLimit",		&JobRetryLimit,		CUPSD_VARTYPE_INTEGER },
   { "JobRetryInterval",		&JobRetryInterval,	CUPSD_VARTYPE_TIME },
@@ -203,6 +207,7 @@ static int		get_addr_and_mask(const char *value, unsigned *ip,
 static void		mime_error_cb(void *ctx, const char *message);
 static int		parse_aaa(cupsd_location_t *loc, char *line,
 			          char *value, int linenum);
+static unsigned		parse_events(const char *s);
 static int		parse_fatal_errors(const char *s);
 static int		parse_groups(const char *s);
 static int		parse_protocols(const char *s);
@@ -561,6 +566,7 @@ cupsdReadConfiguration(void)
   */
 
   cupsdDeleteAllLocations();
+  cupsdFlushAuthCache();
 
   cupsdDeleteAllListeners();
 
@@ -703,6 +709,7 @@ cupsdReadConfiguration(void)
   */
 
   AccessLogLevel           = CUPSD_ACCESSLOG_ACTIONS;
+  AuthCacheTimeout         = 60;
   ConfigFilePerm           = CUPS_DEFAULT_CONFIG_FILE_PERM;
   FatalErrors              = parse_fatal_errors(CUPS_DEFAULT_FATAL_ERRORS);
   default_auth_type          = CUPSD_AUTH_BASIC;
@@ -718,6 +725,8 @@ cupsdReadConfiguration(void)
   FilterLevel              = 0;
   FilterLimit              = 0;
   FilterNice               = 0;
+  GroupCacheRefresh        = FALSE;
+  GroupCacheTimeout        = 60;
   HostNameLookups          = FALSE;
   KeepAlive                = TRUE;
   KeepAliveTimeout         = DEFAULT_KEEPALIVE;
@@ -776,6 +785,7 @@ cupsdReadConfiguration(void)
   MaxSubscriptionsPerUser    = 0;
   DefaultLeaseDuration       = 86400;
   MaxLeaseDuration           = 0;
+  CoalesceEvents             = CUPSD_EVENT_NONE;
 
 #ifdef HAVE_LAUNCHD
   LaunchdTimeout = 10;
@@ -2379,6 +2389,67 @@ parse_aaa(cupsd_location_t *loc,	/* I - Location */
 }
 
 
+/*
+ * 'parse_events()' - Parse event names in a string.
+ */
+
+static unsigned				/* O - Event mask */
+parse_events(const char *s)		/* I - Space-delimited event names */
+{
+  unsigned	mask;			/* Event mask */
+  cupsd_eventmask_t event;		/* Current event */
+  char		value[1024],		/* Value string */
+		*valstart,		/* Pointer into value */
+		*valend;		/* End of value */
+
+
+ /*
+  * Empty event line yields NULL pointer...
+  */
+
+  if (!s)
+    return (CUPSD_EVENT_NONE);
+
+ /*
+  * Loop through the value string,...
+  */
+
+  strlcpy(value, s, sizeof(value));
+
+  mask = CUPSD_EVENT_NONE;
+
+  for (valstart = value; *valstart;)
+  {
+   /*
+    * Get the current space/comma-delimited event name...
+    */
+
+    for (valend = valstart; *valend; valend ++)
+      if (_cups_isspace(*valend) || *valend == ',')
+	break;
+
+    if (*valend)
+      *valend++ = '\0';
+
+   /*
+    * Add the event to the bitmask...
+    */
+
+    if ((event = cupsdEventValue(valstart)) != CUPSD_EVENT_NONE)
+      mask |= event;
+    else if (_cups_strcasecmp(valstart, "none"))
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unknown event \"%s\" ignored.",
+                      valstart);
+
+    for (valstart = valend; *valstart; valstart ++)
+      if (!_cups_isspace(*valstart) && *valstart != ',')
+	break;
+  }
+
+  return (mask);
+}
+
+
 /*
  * 'parse_fatal_errors()' - Parse FatalErrors values in a string.
  */
@@ -3047,6 +3118,14 @@ read_cupsd_conf(cups_file_t *fp)	/* I - File to read from */
 
       BrowseLocalProtocols = protocols;
     }
+    else if (!_cups_strcasecmp(line, "CoalesceEvents"))
+    {
+     /*
+      * "CoalesceEvents name [... name]"
+      */
+
+      CoalesceEvents = parse_events(value);
+    }
     else if (!_cups_strcasecmp(line, "DefaultAuthType") && value)
     {
      /*
@@ -163,7 +163,9 @@ VAR gid_t		Group			VALUE(0);
 					/* Group ID for server */
 VAR cupsd_accesslog_t	AccessLogLevel		VALUE(CUPSD_ACCESSLOG_ACTIONS);
 					/* Access log level */
-VAR int			ClassifyOverride	VALUE(0),
+VAR int			AuthCacheTimeout	VALUE(60),
+					/* Time to cache Basic credentials */
+			ClassifyOverride	VALUE(0),
 					/* Allow overrides? */
 			ConfigFilePerm		VALUE(0640),
 					/* Permissions for config files */
@@ -171,6 +173,10 @@ VAR int			ClassifyOverride	VALUE(0),
 					/* Amount of automatic debug history */
 			FatalErrors		VALUE(CUPSD_FATAL_CONFIG),
 					/* Which errors are fatal? */
+			GroupCacheRefresh	VALUE(FALSE),
+					/* Refresh group memberships early? */
+			GroupCacheTimeout	VALUE(60),
+					/* Time to cache group memberships */
 			StrictConformance	VALUE(FALSE),
 					/* Require strict IPP conformance? */
 			LogFilePerm		VALUE(0644);
@@ -193,7 +193,11 @@ extern void		cupsdClosePipe(int *fds);
 extern cups_file_t	*cupsdCreateConfFile(const char *filename, mode_t mode);
 extern cups_file_t	*cupsdOpenConfFile(const char *filename);
 extern int		cupsdOpenPipe(int *fds);
+extern int		cupsdQueueCreatedConfFile(cups_file_t *fp,
+			                          const char *filename);
+extern void		cupsdQueueRemoveFile(const char *filename);
 extern int		cupsdRemoveFile(const char *filename);
+extern void		cupsdWaitConfFiles(const char *filename);
 
 /* main.c */
 extern int		cupsdAddString(cups_array_t **a, const char *s);
@@ -25,20 +25,27 @@
  *				 information.
  *   cupsdUpdateDNSSDName()    - Update the computer name we use for
  *				 browsing...
+ *   cupsdUpdateDNSSDPrinters() - Send pending DNS-SD printer updates.
+ *   deregister_printer()      - Deregister a printer and forget what was
+ *				 registered.
  *   dnssdAddAlias()	       - Add a DNS-SD alias name.
  *   dnssdBuildTxtRecord()     - Build a TXT record from printer info.
  *   dnssdDeregisterInstance() - Deregister a DNS-SD service instance.
  *   dnssdDeregisterPrinter()  - Deregister all services for a printer.
+ *   dnssdDigestPrinter()      - Compute a digest of the services to register
+ *				 for a printer.
  *   dnssdErrorString()        - Return an error string for an error code.
- *   dnssdRegisterCallback()   - Free a TXT record.
+ *   dnssdFreeTxtRecord()      - Free a TXT record.
+ *   dnssdHashTxtRecord()      - Add a TXT record to a digest.
  *   dnssdRegisterCallback()   - DNSServiceRegister callback.
  *   dnssdRegisterInstance()   - Register an instance of a printer service.
- *   dnssdRegisterPrinter()    - Start sending broadcast information for a
- *				 printer or update the broadcast contents.
+ *   dnssdRegisterPrinter()    - Register all services for a printer.
  *   dnssdStop()	       - Stop all DNS-SD registrations.
  *   dnssdUpdate()	       - Handle DNS-SD queries.
  *   get_auth_info_required()  - Get the auth-info-required value to advertise.
  *   get_hostconfig()	       - Get an /etc/hostconfig service setting.
+ *   register_printer()	       - Register a printer or update its
+ *				 registration when it has changed.
  *   update_lpd()	       - Update the LPD configuration as needed.
  *   update_smb()	       - Update the SMB configuration as needed.
  */
@@ -68,6 +75,8 @@ static char		*get_auth_info_required(cupsd_printer_t *p,
 #ifdef __APPLE__
 static int		get_hostconfig(const char *name);
 #endif /* __APPLE__ */
+static void		deregister_printer(cupsd_printer_t *p, int clear_name);
+static void		register_printer(cupsd_printer_t *p);
 static void		update_lpd(int onoff);
 static void		update_smb(int onoff);
 
@@ -81,8 +90,12 @@ static cupsd_txt_t	dnssdBuildTxtRecord(cupsd_printer_t *p, int for_lpd);
 static void		dnssdDeregisterInstance(cupsd_srv_t *srv);
 static void		dnssdDeregisterPrinter(cupsd_printer_t *p,
 			                       int clear_name);
+static void		dnssdDigestPrinter(cupsd_printer_t *p,
+			                   unsigned char digest[16]);
 static const char	*dnssdErrorString(int error);
 static void		dnssdFreeTxtRecord(cupsd_txt_t *txt);
+static void		dnssdHashTxtRecord(_cups_md5_state_t *state,
+			                   cupsd_txt_t *txt);
 #  ifdef HAVE_DNSSD
 static void		dnssdRegisterCallback(DNSServiceRef sdRef,
 					      DNSServiceFlags flags,
@@ -101,11 +114,23 @@ static int		dnssdRegisterInstance(cupsd_srv_t *srv,
 					      char *name, const char *type,
 					      const char *subtypes, int port,
 					      cupsd_txt_t *txt, int commit);
-static void		dnssdRegisterPrinter(cupsd_printer_t *p);
+static int		dnssdRegisterPrinter(cupsd_printer_t *p);
 static void		dnssdStop(void);
 #  ifdef HAVE_DNSSD
 static void		dnssdUpdate(void);
 #  endif /* HAVE_DNSSD */
+
+
+/*
+ * Local globals...
+ */
+
+static const cupsd_dnssd_ops_t dnssd_ops =
+{					/* DNS-SD registration functions */
+  dnssdDigestPrinter,
+  dnssdRegisterPrinter,
+  dnssdDeregisterPrinter
+};
 #endif /* HAVE_DNSSD || HAVE_AVAHI */
 
 
@@ -136,10 +161,8 @@ cupsdDeregisterPrinter(
   * Announce the deletion...
   */
 
-#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
-  if (removeit && (BrowseLocalProtocols & BROWSE_DNSSD) && DNSSDMaster)
-    dnssdDeregisterPrinter(p, 1);
-#endif /* HAVE_DNSSD || HAVE_AVAHI */
+  if (removeit && (BrowseLocalProtocols & BROWSE_DNSSD) && DNSSDOps)
+    deregister_printer(p, 1);
 }
 
 
@@ -158,10 +181,32 @@ cupsdRegisterPrinter(cupsd_printer_t *p)/* I - Printer */
       (p->type & (CUPS_PRINTER_REMOTE | CUPS_PRINTER_SCANNER)))
     return;
 
-#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
-  if ((BrowseLocalProtocols & BROWSE_DNSSD) && DNSSDMaster)
-    dnssdRegisterPrinter(p);
-#endif /* HAVE_DNSSD || HAVE_AVAHI */
+  if ((BrowseLocalProtocols & BROWSE_DNSSD) && DNSSDOps)
+  {
+    time_t	curtime = time(NULL);	/* Current time */
+
+
+   /*
+    * New registrations and removals happen right away, as do updates to
+    * printers that have not been updated recently.  Otherwise coalesce the
+    * change with any others that come in before the update interval is up...
+    */
+
+    if (!p->reg_time || !p->shared ||
+        (!p->reg_update && curtime >= (p->reg_time + DNSSD_INTERVAL)))
+      register_printer(p);
+    else if (!p->reg_update)
+    {
+      p->reg_update = p->reg_time + DNSSD_INTERVAL;
+
+      if (!DNSSDUpdateTime || DNSSDUpdateTime > p->reg_update)
+        DNSSDUpdateTime = p->reg_update;
+
+      cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                      "cupsdRegisterPrinter: Deferring DNS-SD update of %s "
+		      "for %d seconds.", p->name, (int)(p->reg_update - curtime));
+    }
+  }
 }
 
 
@@ -240,6 +285,9 @@ cupsdStartBrowsing(void)
     }
 #  endif /* HAVE_DNSSD */
 
+    if (DNSSDMaster)
+      DNSSDOps = &dnssd_ops;
+
    /*
     * Then get the port we use for registrations.  If we are not listening
     * on any non-local ports, there is no sense sharing local printers via
@@ -484,8 +532,64 @@ cupsdUpdateDNSSDName(void)
                           DNSSDPort, NULL, 1);
   }
 }
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+
+
+/*
+ * 'cupsdUpdateDNSSDPrinters()' - Send pending DNS-SD printer updates.
+ */
+
+void
+cupsdUpdateDNSSDPrinters(void)
+{
+  cupsd_printer_t	*p;		/* Current printer */
+  time_t		curtime;	/* Current time */
 
 
+  curtime         = time(NULL);
+  DNSSDUpdateTime = 0;
+
+  for (p = (cupsd_printer_t *)cupsArrayFirst(Printers);
+       p;
+       p = (cupsd_printer_t *)cupsArrayNext(Printers))
+  {
+    if (!p->reg_update)
+      continue;
+
+    if (p->reg_update <= curtime)
+    {
+      p->reg_update = 0;
+
+      if (Browsing && (BrowseLocalProtocols & BROWSE_DNSSD) && DNSSDOps &&
+          !(p->type & (CUPS_PRINTER_REMOTE | CUPS_PRINTER_SCANNER)))
+        register_printer(p);
+    }
+    else if (!DNSSDUpdateTime || DNSSDUpdateTime > p->reg_update)
+      DNSSDUpdateTime = p->reg_update;
+  }
+}
+
+
+/*
+ * 'deregister_printer()' - Deregister a printer and forget what was
+ *                          registered.
+ */
+
+static void
+deregister_printer(
+    cupsd_printer_t *p,			/* I - Printer */
+    int             clear_name)		/* I - Clear the name? */
+{
+  (*DNSSDOps->deregister_printer)(p, clear_name);
+
+  p->reg_time   = 0;
+  p->reg_update = 0;
+
+  memset(p->reg_digest, 0, sizeof(p->reg_digest));
+}
+
+
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
 #  ifdef __APPLE__
 /*
  * 'dnssdAddAlias()' - Add a DNS-SD alias name.
@@ -781,6 +885,44 @@ dnssdDeregisterPrinter(
 }
 
 
+/*
+ * 'dnssdDigestPrinter()' - Compute a digest of the services to register for
+ *                          a printer.
+ *
+ * The digest covers both TXT records, the service type, and the port numbers
+ * and subtypes, so an update can be skipped when none of them has changed.
+ */
+
+static void
+dnssdDigestPrinter(
+    cupsd_printer_t *p,			/* I - Printer */
+    unsigned char   digest[16])		/* O - Digest */
+{
+  _cups_md5_state_t	state;		/* MD5 state */
+  cupsd_txt_t		txt;		/* TXT record */
+  char			services[1024];	/* Service types, ports, and subtypes */
+
+
+  _cupsMD5Init(&state);
+
+  txt = dnssdBuildTxtRecord(p, 0);
+  dnssdHashTxtRecord(&state, &txt);
+  dnssdFreeTxtRecord(&txt);
+
+  txt = dnssdBuildTxtRecord(p, 1);
+  dnssdHashTxtRecord(&state, &txt);
+  dnssdFreeTxtRecord(&txt);
+
+  snprintf(services, sizeof(services), "%s %d %d %s",
+           (p->type & CUPS_PRINTER_FAX) ? "_fax-ipp" : "_ipp",
+	   (BrowseLocalProtocols & BROWSE_LPD) ? 515 : 0, DNSSDPort,
+	   DNSSDSubTypes ? DNSSDSubTypes : "");
+  _cupsMD5Append(&state, (unsigned char *)services, strlen(services));
+
+  _cupsMD5Finish(&state, digest);
+}
+
+
 /*
  * 'dnssdErrorString()' - Return an error string for an error code.
  */
@@ -896,7 +1038,7 @@ dnssdErrorString(int error)		/* I - Error number */
 
 
 /*
- * 'dnssdRegisterCallback()' - Free a TXT record.
+ * 'dnssdFreeTxtRecord()' - Free a TXT record.
  */
 
 static void
@@ -912,6 +1054,46 @@ dnssdFreeTxtRecord(cupsd_txt_t *txt)	/* I - TXT record */
 }
 
 
+/*
+ * 'dnssdHashTxtRecord()' - Add a TXT record to a digest.
+ */
+
+static void
+dnssdHashTxtRecord(
+    _cups_md5_state_t *state,		/* I - MD5 state */
+    cupsd_txt_t       *txt)		/* I - TXT record */
+{
+  unsigned char	length[2];		/* Length of data */
+#  ifdef HAVE_AVAHI
+  AvahiStringList *item;		/* Current key/value pair */
+#  endif /* HAVE_AVAHI */
+
+
+#  ifdef HAVE_DNSSD
+  length[0] = (unsigned char)(TXTRecordGetLength(txt) >> 8);
+  length[1] = (unsigned char)TXTRecordGetLength(txt);
+
+  _cupsMD5Append(state, length, 2);
+  _cupsMD5Append(state, TXTRecordGetBytesPtr(txt), TXTRecordGetLength(txt));
+
+#  else /* HAVE_AVAHI */
+  for (item = *txt; item; item = avahi_string_list_get_next(item))
+  {
+    length[0] = (unsigned char)(avahi_string_list_get_size(item) >> 8);
+    length[1] = (unsigned char)avahi_string_list_get_size(item);
+
+    _cupsMD5Append(state, length, 2);
+    _cupsMD5Append(state, avahi_string_list_get_text(item),
+                   (int)avahi_string_list_get_size(item));
+  }
+
+  length[0] = length[1] = 0xff;
+
+  _cupsMD5Append(state, length, 2);
+#  endif /* HAVE_DNSSD */
+}
+
+
 /*
  * 'dnssdRegisterCallback()' - DNSServiceRegister callback.
  */
@@ -1167,11 +1349,10 @@ dnssdRegisterInstance(
 
 
 /*
- * 'dnssdRegisterPrinter()' - Start sending broadcast information for a printer
- *		              or update the broadcast contents.
+ * 'dnssdRegisterPrinter()' - Register all services for a printer.
  */
 
-static void
+static int				/* O - 1 on success, 0 on failure */
 dnssdRegisterPrinter(cupsd_printer_t *p)/* I - Printer */
 {
   char		name[256];		/* Service name */
@@ -1180,18 +1361,7 @@ dnssdRegisterPrinter(cupsd_printer_t *p)/* I - Printer */
   cupsd_txt_t	ipp_txt,		/* IPP(S) TXT record */
  		printer_txt;		/* LPD TXT record */
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "dnssdRegisterPrinter(%s) %s", p->name,
-                  !p->ipp_srv ? "new" : "update");
-
- /*
-  * Remove the current registrations if we have them and then return if
-  * per-printer sharing was just disabled...
-  */
-
-  dnssdDeregisterPrinter(p, 0);
-
-  if (!p->shared)
-    return;
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "dnssdRegisterPrinter(%s)", p->name);
 
  /*
   * Set the registered name as needed; the registered name takes the form of
@@ -1282,6 +1452,8 @@ dnssdRegisterPrinter(cupsd_printer_t *p)/* I - Printer */
     dnssdDeregisterInstance(&p->printer_srv);
 #  endif /* HAVE_DNSSD */
   }
+
+  return (status);
 }
 
 
@@ -1302,7 +1474,7 @@ dnssdStop(void)
   for (p = (cupsd_printer_t *)cupsArrayFirst(Printers);
        p;
        p = (cupsd_printer_t *)cupsArrayNext(Printers))
-    dnssdDeregisterPrinter(p, 1);
+    deregister_printer(p, 1);
 
  /*
   * Shutdown the rest of the service refs...
@@ -1327,6 +1499,9 @@ dnssdStop(void)
   cupsArrayDelete(DNSSDPrinters);
   DNSSDPrinters = NULL;
 
+  DNSSDOps        = NULL;
+  DNSSDUpdateTime = 0;
+
   DNSSDPort = 0;
 }
 
@@ -1485,6 +1660,57 @@ get_hostconfig(const char *name)	/* I - Name of service */
 #endif /* __APPLE__ */
 
 
+/*
+ * 'register_printer()' - Register a printer or update its registration when
+ *                        it has changed.
+ */
+
+static void
+register_printer(cupsd_printer_t *p)	/* I - Printer */
+{
+  unsigned char	digest[16];		/* Digest of services to register */
+
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "register_printer(%s) %s", p->name,
+                  !p->reg_time ? "new" : "update");
+
+  p->reg_update = 0;
+
+ /*
+  * Remove the current registrations if we have them and then return if
+  * per-printer sharing was just disabled...
+  */
+
+  if (!p->shared)
+  {
+    deregister_printer(p, 0);
+    return;
+  }
+
+ /*
+  * Skip the update if nothing we advertise has changed since the last
+  * registration...
+  */
+
+  (*DNSSDOps->digest_printer)(p, digest);
+
+  if (p->reg_time && !memcmp(digest, p->reg_digest, sizeof(digest)))
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "register_printer(%s) unchanged",
+                    p->name);
+    return;
+  }
+
+  deregister_printer(p, 0);
+
+  if ((*DNSSDOps->register_printer)(p))
+  {
+    memcpy(p->reg_digest, digest, sizeof(p->reg_digest));
+    p->reg_time = time(NULL);
+  }
+}
+
+
 /*
  * 'update_lpd()' - Update the LPD configuration as needed.
  */
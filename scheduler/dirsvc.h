@@ -23,6 +23,30 @@
 #define BROWSE_ALL	7		/* All protocols */
 
 
+/*
+ * Minimum number of seconds between DNS-SD updates for a printer...
+ */
+
+#define DNSSD_INTERVAL	5
+
+
+/*
+ * DNS-SD registration functions; cupsdStartBrowsing() installs the
+ * mDNSResponder or Avahi implementation and unit tests can substitute their
+ * own...
+ */
+
+typedef struct cupsd_dnssd_ops_s	/**** DNS-SD registration functions ****/
+{
+  void		(*digest_printer)(cupsd_printer_t *p, unsigned char digest[16]);
+					/* Compute digest of services */
+  int		(*register_printer)(cupsd_printer_t *p);
+					/* Register services, 1 on success */
+  void		(*deregister_printer)(cupsd_printer_t *p, int clear_name);
+					/* Deregister services */
+} cupsd_dnssd_ops_t;
+
+
 /*
  * Globals...
  */
@@ -34,6 +58,10 @@ VAR int			Browsing	VALUE(TRUE),
 			BrowseLocalProtocols
 					VALUE(BROWSE_ALL);
 					/* Protocols to support for local printers */
+VAR const cupsd_dnssd_ops_t *DNSSDOps	VALUE(NULL);
+					/* DNS-SD registration functions */
+VAR time_t		DNSSDUpdateTime	VALUE(0);
+					/* Time of next pending printer update */
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
 VAR char		*DNSSDComputerName VALUE(NULL),
 					/* Computer/server name */
@@ -77,6 +105,7 @@ extern void	cupsdStopBrowsing(void);
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
 extern void	cupsdUpdateDNSSDName(void);
 #endif /* HAVE_DNSSD || HAVE_AVAHI */
+extern void	cupsdUpdateDNSSDPrinters(void);
 
 
 /*
@@ -21,8 +21,20 @@
  *   cupsdCreateConfFile()       - Create a configuration file safely.
  *   cupsdOpenConfFile()         - Open a configuration file.
  *   cupsdOpenPipe()             - Create a pipe which is closed on exec.
+ *   cupsdQueueCreatedConfFile() - Close a created configuration file and
+ *                                 queue it to be moved into place.
+ *   cupsdQueueRemoveFile()      - Queue a file to be removed after any
+ *                                 pending moves.
  *   cupsdRemoveFile()           - Remove a file using the 7-pass US DoD method.
+ *   cupsdWaitConfFiles()        - Wait for queued configuration files to be
+ *                                 moved into place.
+ *   finish_conf_file()          - Move a created configuration file into
+ *                                 place.
+ *   is_queued()                 - See if a configuration file is queued.
  *   overwrite_data()            - Overwrite the data in a file.
+ *   queue_file()                - Add a file to the writer queue.
+ *   start_writer()              - Start the writer thread.
+ *   writer_thread()             - Move queued configuration files into place.
  */
 
 /*
@@ -34,10 +46,70 @@
 #include <fnmatch.h>
 #ifdef HAVE_REMOVEFILE
 #  include <removefile.h>
-#else
+#endif /* HAVE_REMOVEFILE */
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
+
+/*
+ * Local types...
+ */
+
+#ifdef HAVE_PTHREAD_H
+typedef struct cupsd_writer_s		/**** Queued writer operation ****/
+{
+  int		remove;			/* Remove the file instead of moving it? */
+  char		filename[1024];		/* Filename */
+} cupsd_writer_t;
+#endif /* HAVE_PTHREAD_H */
+
+
+/*
+ * Local globals...
+ *
+ * Configuration and state files that are saved by cupsdCleanDirty() are
+ * written to "filename.N" by the main thread and then handed to a writer
+ * thread which syncs the new file, securely removes "filename.O", and
+ * renames the files into place so the main loop does not block on disk I/O.
+ * Files that are no longer needed are removed by the same thread, in order,
+ * so a removal never runs before an earlier move...
+ */
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t	writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+					/* Mutex for writer data */
+static pthread_cond_t	writer_cond = PTHREAD_COND_INITIALIZER;
+					/* Condition for writer data */
+static int		writer_started = 0;
+					/* Has the writer thread been started? */
+static cups_array_t	*writer_queue = NULL,
+					/* Files waiting to be moved or removed */
+			*writer_errors = NULL;
+					/* Error messages for the main thread */
+static cupsd_writer_t	*writer_current = NULL;
+					/* File being moved or removed */
+#endif /* HAVE_PTHREAD_H */
+
+
+/*
+ * Local functions...
+ */
+
+static int	finish_conf_file(const char *filename, int sync, char *message,
+		                 size_t messagesize);
+#ifdef HAVE_PTHREAD_H
+static int	is_queued(const char *filename);
+#endif /* HAVE_PTHREAD_H */
+#ifndef HAVE_REMOVEFILE
 static int	overwrite_data(int fd, const char *buffer, int bufsize,
 		               int filesize);
-#endif /* HAVE_REMOVEFILE */
+#endif /* !HAVE_REMOVEFILE */
+#ifdef HAVE_PTHREAD_H
+static void	queue_file(const char *filename, int remove);
+static int	start_writer(void);
+static void	*writer_thread(void *data);
+#endif /* HAVE_PTHREAD_H */
 
 
 /*
@@ -104,8 +176,7 @@ cupsdCloseCreatedConfFile(
     cups_file_t *fp,			/* I - File to close */
     const char  *filename)		/* I - Filename */
 {
-  char	newfile[1024],			/* filename.N */
-	oldfile[1024];			/* filename.O */
+  char	message[1024];			/* Error message */
 
 
  /*
@@ -116,19 +187,12 @@ cupsdCloseCreatedConfFile(
     return (-1);
 
  /*
-  * Then remove "filename.O", rename "filename" to "filename.O", and rename
-  * "filename.N" to "filename".
+  * Then move it into place...
   */
 
-  snprintf(newfile, sizeof(newfile), "%s.N", filename);
-  snprintf(oldfile, sizeof(oldfile), "%s.O", filename);
-
-  if ((cupsdRemoveFile(oldfile) && errno != ENOENT) ||
-      (rename(filename, oldfile) && errno != ENOENT) ||
-      rename(newfile, filename))
+  if (finish_conf_file(filename, 0, message, sizeof(message)))
   {
-    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to finalize \"%s\": %s",
-                    filename, strerror(errno));
+    cupsdLogMessage(CUPSD_LOG_ERROR, "%s", message);
     return (-1);
   }
 
@@ -174,6 +238,12 @@ cupsdCreateConfFile(
   char		newfile[1024];		/* filename.N */
 
 
+ /*
+  * Make sure the writer thread is not still using "filename.N"...
+  */
+
+  cupsdWaitConfFiles(filename);
+
   snprintf(newfile, sizeof(newfile), "%s.N", filename);
   if ((fp = cupsFileOpen(newfile, "w")) == NULL)
   {
@@ -209,6 +279,8 @@ cupsdOpenConfFile(const char *filename)	/* I - Filename */
   cups_file_t	*fp;			/* File pointer */
 
 
+  cupsdWaitConfFiles(filename);
+
   if ((fp = cupsFileOpen(filename, "r")) == NULL)
   {
     if (errno == ENOENT)
@@ -284,6 +356,82 @@ cupsdOpenPipe(int *fds)			/* O - Pipe file descriptors (2) */
 }
 
 
+/*
+ * 'cupsdQueueCreatedConfFile()' - Close a created configuration file and
+ *                                 queue it to be moved into place.
+ *
+ * The file is moved into place by a background thread.  Use
+ * cupsdWaitConfFiles() to wait for the move to complete.
+ */
+
+int					/* O - 0 on success, -1 on error */
+cupsdQueueCreatedConfFile(
+    cups_file_t *fp,			/* I - File to close */
+    const char  *filename)		/* I - Filename */
+{
+#ifdef HAVE_PTHREAD_H
+  char	message[1024];			/* Error message */
+
+
+ /*
+  * First close the file...
+  */
+
+  if (cupsFileClose(fp))
+    return (-1);
+
+ /*
+  * Then hand it to the writer thread, or move it into place now if the
+  * thread can't be started...
+  */
+
+  if (!start_writer())
+  {
+    if (finish_conf_file(filename, 0, message, sizeof(message)))
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "%s", message);
+      return (-1);
+    }
+
+    return (0);
+  }
+
+  queue_file(filename, 0);
+
+  return (0);
+
+#else
+  return (cupsdCloseCreatedConfFile(fp, filename));
+#endif /* HAVE_PTHREAD_H */
+}
+
+
+/*
+ * 'cupsdQueueRemoveFile()' - Queue a file to be removed after any pending
+ *                            moves.
+ *
+ * The file is removed by the writer thread once every configuration file
+ * queued before it has been moved into place.
+ */
+
+void
+cupsdQueueRemoveFile(const char *filename)
+					/* I - Filename */
+{
+#ifdef HAVE_PTHREAD_H
+  if (writer_started)
+  {
+    queue_file(filename, 1);
+    return;
+  }
+#endif /* HAVE_PTHREAD_H */
+
+  if (unlink(filename) && errno != ENOENT)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to remove \"%s\": %s", filename,
+                    strerror(errno));
+}
+
+
 /*
  * 'cupsdRemoveFile()' - Remove a file using the 7-pass US DoD method.
  */
@@ -398,6 +546,131 @@ cupsdRemoveFile(const char *filename)	/* I - File to remove */
 }
 
 
+/*
+ * 'cupsdWaitConfFiles()' - Wait for queued configuration files to be moved
+ *                          into place.
+ */
+
+void
+cupsdWaitConfFiles(const char *filename)/* I - Filename or NULL for all */
+{
+#ifdef HAVE_PTHREAD_H
+  char	*message;			/* Error message from writer thread */
+
+
+  if (!writer_started)
+    return;
+
+  pthread_mutex_lock(&writer_mutex);
+
+  if (filename)
+  {
+    while ((writer_current && !strcmp(writer_current->filename, filename)) ||
+           is_queued(filename))
+      pthread_cond_wait(&writer_cond, &writer_mutex);
+  }
+  else
+  {
+    while (writer_current || cupsArrayCount(writer_queue) > 0)
+      pthread_cond_wait(&writer_cond, &writer_mutex);
+  }
+
+ /*
+  * Log any errors reported by the writer thread...
+  */
+
+  while ((message = (char *)cupsArrayFirst(writer_errors)) != NULL)
+  {
+    cupsArrayRemove(writer_errors, message);
+    pthread_mutex_unlock(&writer_mutex);
+
+    cupsdLogMessage(CUPSD_LOG_ERROR, "%s", message);
+    free(message);
+
+    pthread_mutex_lock(&writer_mutex);
+  }
+
+  pthread_mutex_unlock(&writer_mutex);
+
+#else
+  (void)filename;
+#endif /* HAVE_PTHREAD_H */
+}
+
+
+/*
+ * 'finish_conf_file()' - Move a created configuration file into place.
+ *
+ * This function is called from the writer thread and must not log.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+finish_conf_file(
+    const char *filename,		/* I - Filename */
+    int        sync,			/* I - Sync the new file to disk first? */
+    char       *message,		/* O - Error message */
+    size_t     messagesize)		/* I - Size of error message buffer */
+{
+  int	fd;				/* New file descriptor */
+  char	newfile[1024],			/* filename.N */
+	oldfile[1024];			/* filename.O */
+
+
+  snprintf(newfile, sizeof(newfile), "%s.N", filename);
+  snprintf(oldfile, sizeof(oldfile), "%s.O", filename);
+
+ /*
+  * Make sure the new file is on disk before it replaces the old one...
+  */
+
+  if (sync && (fd = open(newfile, O_WRONLY)) >= 0)
+  {
+    fsync(fd);
+    close(fd);
+  }
+
+ /*
+  * Then remove "filename.O", rename "filename" to "filename.O", and rename
+  * "filename.N" to "filename".
+  */
+
+  if ((cupsdRemoveFile(oldfile) && errno != ENOENT) ||
+      (rename(filename, oldfile) && errno != ENOENT) ||
+      rename(newfile, filename))
+  {
+    snprintf(message, messagesize, "Unable to finalize \"%s\": %s",
+             filename, strerror(errno));
+    return (-1);
+  }
+
+  return (0);
+}
+
+
+#ifdef HAVE_PTHREAD_H
+/*
+ * 'is_queued()' - See if a configuration file is queued.
+ *
+ * The caller must hold the writer mutex.
+ */
+
+static int				/* O - 1 if queued, 0 otherwise */
+is_queued(const char *filename)		/* I - Filename */
+{
+  cupsd_writer_t	*queued;	/* Queued file */
+
+
+  for (queued = (cupsd_writer_t *)cupsArrayFirst(writer_queue);
+       queued;
+       queued = (cupsd_writer_t *)cupsArrayNext(writer_queue))
+    if (!strcmp(queued->filename, filename))
+      return (1);
+
+  return (0);
+}
+#endif /* HAVE_PTHREAD_H */
+
+
 #ifndef HAVE_REMOVEFILE
 /*
  * 'overwrite_data()' - Overwrite the data in a file.
@@ -445,6 +718,141 @@ overwrite_data(int        fd,		/* I - File descriptor */
 #endif /* HAVE_REMOVEFILE */
 
 
+#ifdef HAVE_PTHREAD_H
+/*
+ * 'queue_file()' - Add a file to the writer queue.
+ *
+ * A file that is already waiting for the same operation is not queued again.
+ */
+
+static void
+queue_file(const char *filename,	/* I - Filename */
+           int        remove)		/* I - Remove the file? */
+{
+  cupsd_writer_t	*queued;	/* Queued file */
+
+
+  pthread_mutex_lock(&writer_mutex);
+
+  for (queued = (cupsd_writer_t *)cupsArrayLast(writer_queue);
+       queued;
+       queued = (cupsd_writer_t *)cupsArrayPrev(writer_queue))
+    if (!strcmp(queued->filename, filename))
+      break;
+
+  if ((!queued || queued->remove != remove) &&
+      (queued = calloc(1, sizeof(cupsd_writer_t))) != NULL)
+  {
+    queued->remove = remove;
+    strlcpy(queued->filename, filename, sizeof(queued->filename));
+
+    cupsArrayAdd(writer_queue, queued);
+    pthread_cond_broadcast(&writer_cond);
+  }
+
+  pthread_mutex_unlock(&writer_mutex);
+}
+
+
+/*
+ * 'start_writer()' - Start the writer thread.
+ *
+ * The thread is started with all signals blocked so that they continue to be
+ * delivered to the main thread.
+ */
+
+static int				/* O - 1 if running, 0 otherwise */
+start_writer(void)
+{
+  pthread_t		thread;		/* Writer thread */
+  pthread_attr_t	attr;		/* Thread attributes */
+  sigset_t		newmask,	/* Signals to block */
+			oldmask;	/* Original signal mask */
+
+
+  if (writer_started)
+    return (1);
+
+  pthread_mutex_lock(&writer_mutex);
+
+  writer_queue  = cupsArrayNew(NULL, NULL);
+  writer_errors = cupsArrayNew(NULL, NULL);
+
+  sigfillset(&newmask);
+  pthread_sigmask(SIG_BLOCK, &newmask, &oldmask);
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  if (!pthread_create(&thread, &attr, writer_thread, NULL))
+    writer_started = 1;
+
+  pthread_attr_destroy(&attr);
+  pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+
+  pthread_mutex_unlock(&writer_mutex);
+
+  if (!writer_started)
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to start configuration file writer thread: %s",
+		    strerror(errno));
+
+  return (writer_started);
+}
+
+
+/*
+ * 'writer_thread()' - Move queued configuration files into place.
+ */
+
+static void *				/* O - Thread exit status (unused) */
+writer_thread(void *data)		/* I - Thread data (unused) */
+{
+  char	message[2048],			/* Error message with filename */
+	*copy;				/* Copy of error message */
+  int	status;				/* Status of move */
+
+
+  (void)data;
+
+  pthread_mutex_lock(&writer_mutex);
+
+  for (;;)
+  {
+    while ((writer_current =
+                (cupsd_writer_t *)cupsArrayFirst(writer_queue)) == NULL)
+      pthread_cond_wait(&writer_cond, &writer_mutex);
+
+    cupsArrayRemove(writer_queue, writer_current);
+
+    pthread_mutex_unlock(&writer_mutex);
+
+    if (!writer_current->remove)
+      status = finish_conf_file(writer_current->filename, 1, message,
+                                sizeof(message));
+    else if ((status = unlink(writer_current->filename)) != 0 &&
+             errno == ENOENT)
+      status = 0;
+    else if (status)
+      snprintf(message, sizeof(message), "Unable to remove \"%s\": %s",
+               writer_current->filename, strerror(errno));
+
+    pthread_mutex_lock(&writer_mutex);
+
+    if (status && (copy = strdup(message)) != NULL)
+      cupsArrayAdd(writer_errors, copy);
+
+    free(writer_current);
+    writer_current = NULL;
+
+    pthread_cond_broadcast(&writer_cond);
+  }
+
+  return (NULL);
+}
+#endif /* HAVE_PTHREAD_H */
+
+
 /*
  * End of "$Id: file.c 9766 2011-05-11 22:17:34Z mike $".
  */
@@ -17,9 +17,13 @@
  *
  * Contents:
  *
+ *   cupsdCheckNotifications()   - Finish Get-Notifications requests that are
+ *                                 waiting for events.
+ *   cupsdFlushAttrFilters()     - Free the compiled attribute filters.
  *   cupsdProcessIPPRequest()    - Process an incoming IPP request.
  *   cupsdTimeoutJob()           - Timeout a job waiting on job files.
  *   accept_jobs()               - Accept print jobs to a printer.
+ *   add_attr_filter()           - Add an attribute name to a compiled filter.
  *   add_class()                 - Add a class to the system.
  *   add_file()                  - Add a file to a job.
  *   add_job()                   - Add a job to a print queue.
@@ -52,6 +56,8 @@
  *   create_requested_array()    - Create an array for the requested-attributes.
  *   create_subscription()       - Create a notification subscription.
  *   delete_printer()            - Remove a printer or class from the system.
+ *   get_attr_filter()           - Get the compiled filter for the requested
+ *                                 and excluded attributes.
  *   get_default()               - Get the default destination.
  *   get_devices()               - Get the list of available devices on the
  *                                 local system.
@@ -68,6 +74,8 @@
  *   get_subscription_attrs()    - Get subscription attributes.
  *   get_subscriptions()         - Get subscriptions.
  *   get_username()              - Get the username associated with a request.
+ *   has_notifications()         - See if a Get-Notifications request has new
+ *                                 events.
  *   hold_job()                  - Hold a print job.
  *   hold_new_jobs()             - Hold pending/new jobs on a printer or class.
  *   move_job()                  - Move a job to a new destination.
@@ -84,6 +92,7 @@
  *   send_document()             - Send a file to a printer or class.
  *   send_http_error()           - Send a HTTP error back to the IPP client.
  *   send_ipp_status()           - Send a status back to the IPP client.
+ *   send_response()             - Send the IPP response back to the client.
  *   set_default()               - Set the default destination...
  *   set_job_attrs()             - Set job attributes.
  *   set_printer_attrs()         - Set printer attributes.
@@ -123,11 +132,43 @@ extern int mbr_check_membership_by_id(uuid_t user, gid_t group, int* ismember);
 #endif /* __APPLE__ */
 
 
+/*
+ * Local structures...
+ */
+
+#define CUPSD_AFILTER_MAX	4	/* Maximum number of cached filters */
+
+#define CUPSD_AFILTER_REQUESTED	1	/* Attribute was requested */
+#define CUPSD_AFILTER_EXCLUDED	2	/* Attribute is private */
+#define CUPSD_AFILTER_SKIP	4	/* Attribute is never copied */
+
+typedef struct cupsd_afilter_s		/**** Compiled attribute filter ****/
+{
+  cups_array_t	*ra,			/* Requested attributes */
+		*exclude;		/* Excluded attributes */
+  int		other,			/* Bits for all other names */
+		num_slots;		/* Number of slots (power of 2) */
+  char		**names;		/* String pool names */
+  unsigned char	*bits;			/* Bits for each name */
+} cupsd_afilter_t;
+
+
+/*
+ * Local globals...
+ */
+
+static int		num_afilters = 0;
+					/* Number of compiled filters */
+static cupsd_afilter_t	afilters[CUPSD_AFILTER_MAX];
+					/* Compiled filters */
+
+
 /*
  * Local functions...
  */
 
 static void	accept_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
+static int	add_attr_filter(cupsd_afilter_t *filter, const char *name);
 static void	add_class(cupsd_client_t *con, ipp_attribute_t *uri);
 static int	add_file(cupsd_client_t *con, cupsd_job_t *job,
 		         mime_type_t *filetype, int compression);
@@ -170,6 +211,8 @@ static void	create_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static cups_array_t *create_requested_array(ipp_t *request);
 static void	create_subscription(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	delete_printer(cupsd_client_t *con, ipp_attribute_t *uri);
+static cupsd_afilter_t *get_attr_filter(cups_array_t *ra,
+			                cups_array_t *exclude);
 static void	get_default(cupsd_client_t *con);
 static void	get_devices(cupsd_client_t *con);
 static void	get_document(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -184,6 +227,7 @@ static void	get_printer_supported(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	get_subscription_attrs(cupsd_client_t *con, int sub_id);
 static void	get_subscriptions(cupsd_client_t *con, ipp_attribute_t *uri);
 static const char *get_username(cupsd_client_t *con);
+static int	has_notifications(cupsd_client_t *con);
 static void	hold_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	hold_new_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	move_job(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -205,6 +249,7 @@ static void	send_http_error(cupsd_client_t *con, http_status_t status,
 static void	send_ipp_status(cupsd_client_t *con, ipp_status_t status,
 		                const char *message, ...)
 		__attribute__((__format__(__printf__, 3, 4)));
+static int	send_response(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	set_default(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	set_job_attrs(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	set_printer_attrs(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -223,6 +268,91 @@ static int	validate_user(cupsd_job_t *job, cupsd_client_t *con,
 		              int userlen);
 
 
+/*
+ * 'cupsdCheckNotifications()' - Finish Get-Notifications requests that are
+ *                               waiting for events.
+ */
+
+void
+cupsdCheckNotifications(void)
+{
+  cupsd_client_t	*con;		/* Current client */
+  time_t		curtime;	/* Current time */
+
+
+  NotifyWaitEvents = 0;
+
+  if (!NotifyWaitClients)
+    return;
+
+  curtime = time(NULL);
+
+  for (con = (cupsd_client_t *)cupsArrayFirst(NotifyWaitClients);
+       con;
+       con = (cupsd_client_t *)cupsArrayNext(NotifyWaitClients))
+  {
+    if (con->notify_wait > curtime && !has_notifications(con))
+      continue;
+
+    cupsArrayRemove(NotifyWaitClients, con);
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+                    "[Client %d] Finished waiting for events.", con->http.fd);
+
+   /*
+    * Build the response again with the current events and send it...
+    */
+
+    cupsdFlushPolicyCache();
+    get_notifications(con);
+
+    con->notify_wait   = 0;
+    con->http.activity = curtime;
+
+    if (!con->response)
+    {
+     /*
+      * send_http_error() already sent an HTTP error; close the connection
+      * unless it is ready for another request...
+      */
+
+      if (con->http.state != HTTP_WAITING || !con->http.keep_alive)
+        cupsdCloseClient(con);
+    }
+    else if (!send_response(con, ippFindAttribute(con->request, "printer-uri",
+                                                  IPP_TAG_URI)))
+      cupsdCloseClient(con);
+  }
+}
+
+
+/*
+ * 'cupsdFlushAttrFilters()' - Free the compiled attribute filters.
+ *
+ * Filters are looked up by the addresses of their requested and excluded
+ * attribute arrays, so they must be flushed whenever those arrays may have
+ * been freed: before each IPP request and when the policies are deleted.
+ */
+
+void
+cupsdFlushAttrFilters(void)
+{
+  int			i;		/* Looping var */
+  cupsd_afilter_t	*filter;	/* Current filter */
+
+
+  for (filter = afilters; num_afilters > 0; num_afilters --, filter ++)
+  {
+    for (i = 0; i < filter->num_slots; i ++)
+      if (filter->names[i])
+        _cupsStrFree(filter->names[i]);
+
+    free(filter->names);
+    free(filter->bits);
+  }
+}
+
+
 /*
  * 'cupsdProcessIPPRequest()' - Process an incoming IPP request.
  */
@@ -244,11 +374,19 @@ cupsdProcessIPPRequest(
                   "cupsdProcessIPPRequest(%p[%d]): operation_id = %04x",
                   con, con->http.fd, con->request->request.op.operation_id);
 
+ /*
+  * Policy decisions and attribute filters are only cached for a single
+  * request...
+  */
+
+  cupsdFlushPolicyCache();
+  cupsdFlushAttrFilters();
+
  /*
   * First build an empty response message for this request...
   */
 
-  con->response = ippNew();
+  con->response = ippNewWithArena();
 
   con->response->request.status.version[0] =
       con->request->request.op.version[0];
@@ -697,98 +835,22 @@ cupsdProcessIPPRequest(
     }
   }
 
-  if (con->response)
+  if (con->notify_wait)
   {
    /*
-    * Sending data from the scheduler...
+    * Get-Notifications is waiting for events; cupsdCheckNotifications()
+    * sends the response later...
     */
 
-    cupsdLogMessage(con->response->request.status.status_code
-                        >= IPP_BAD_REQUEST &&
-                    con->response->request.status.status_code
-		        != IPP_NOT_FOUND ? CUPSD_LOG_ERROR : CUPSD_LOG_DEBUG,
-                    "Returning IPP %s for %s (%s) from %s",
-	            ippErrorString(con->response->request.status.status_code),
-		    ippOpString(con->request->request.op.operation_id),
-		    uri ? uri->values[0].string.text : "no URI",
-		    con->http.hostname);
-
-    if (LogLevel == CUPSD_LOG_DEBUG2)
-      cupsdLogMessage(CUPSD_LOG_DEBUG2,
-		      "cupsdProcessIPPRequest: ippLength(response)=%ld",
-		      (long)ippLength(con->response));
-
-    if (cupsdSendHeader(con, HTTP_OK, "application/ipp", CUPSD_AUTH_NONE))
-    {
-#ifdef CUPSD_USE_CHUNKING
-     /*
-      * Because older versions of CUPS (1.1.17 and older) and some IPP
-      * clients do not implement chunking properly, we cannot use
-      * chunking by default.  This may become the default in future
-      * CUPS releases, or we might add a configuration directive for
-      * it.
-      */
-
-      if (con->http.version == HTTP_1_1)
-      {
-	if (httpPrintf(HTTP(con), "Transfer-Encoding: chunked\r\n\r\n") < 0)
-	  return (0);
-
-	if (cupsdFlushHeader(con) < 0)
-	  return (0);
-
-	con->http.data_encoding = HTTP_ENCODE_CHUNKED;
-      }
-      else
-#endif /* CUPSD_USE_CHUNKING */
-      {
-        size_t	length;			/* Length of response */
-
-
-	length = ippLength(con->response);
-
-	if (con->file >= 0 && !con->pipe_pid)
-	{
-	  struct stat	fileinfo;	/* File information */
-
-
-          if (!fstat(con->file, &fileinfo))
-	    length += fileinfo.st_size;
-	}
-
-	if (httpPrintf(HTTP(con), "Content-Length: " CUPS_LLFMT "\r\n\r\n",
-        	       CUPS_LLCAST length) < 0)
-	  return (0);
-
-	if (cupsdFlushHeader(con) < 0)
-	  return (0);
-
-	con->http.data_encoding  = HTTP_ENCODE_LENGTH;
-	con->http.data_remaining = length;
-
-	if (con->http.data_remaining <= INT_MAX)
-	  con->http._data_remaining = con->http.data_remaining;
-	else
-	  con->http._data_remaining = INT_MAX;
-      }
-
-      cupsdAddSelect(con->http.fd, (cupsd_selfunc_t)cupsdReadClient,
-                     (cupsd_selfunc_t)cupsdWriteClient, con);
-
-     /*
-      * Tell the caller the response header was sent successfully...
-      */
-
-      return (1);
-    }
-    else
-    {
-     /*
-      * Tell the caller the response header could not be sent...
-      */
+    return (1);
+  }
+  else if (con->response)
+  {
+   /*
+    * Sending data from the scheduler...
+    */
 
-      return (0);
-    }
+    return (send_response(con, uri));
   }
   else
   {
@@ -921,6 +983,40 @@ accept_jobs(cupsd_client_t  *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'add_attr_filter()' - Add an attribute name to a compiled filter.
+ */
+
+static int				/* O - Slot for name or -1 on error */
+add_attr_filter(cupsd_afilter_t *filter,/* I - Filter */
+                const char      *name)	/* I - Attribute name */
+{
+  char		*pooled;		/* String pool copy of name */
+  unsigned	mask,			/* Slot mask */
+		slot;			/* Current slot */
+
+
+  if ((pooled = _cupsStrAlloc(name)) == NULL)
+    return (-1);
+
+  mask = filter->num_slots - 1;
+  slot = ((unsigned)((unsigned long)pooled >> 3) * 2654435761U) & mask;
+
+  while (filter->names[slot] && filter->names[slot] != pooled)
+    slot = (slot + 1) & mask;
+
+  if (filter->names[slot])
+    _cupsStrFree(pooled);
+  else
+  {
+    filter->names[slot] = pooled;
+    filter->bits[slot]  = filter->other;
+  }
+
+  return ((int)slot);
+}
+
+
 /*
  * 'add_class()' - Add a class to the system.
  */
@@ -1551,9 +1647,25 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
   }
 
   job->dtype   = printer->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
-  job->attrs   = con->request;
   job->dirty   = 1;
-  con->request = ippNewRequest(job->attrs->request.op.operation_id);
+
+ /*
+  * Move the request attributes to the job; attributes in the request's arena
+  * move to the heap, and pointers to the old ones (like the printer URI) stay
+  * valid until the request is freed...
+  */
+
+  if ((job->attrs = _ippMoveAttributes(con->request)) == NULL)
+  {
+    send_ipp_status(con, IPP_INTERNAL_ERROR,
+                    _("Unable to add job for destination \"%s\"."),
+		    printer->name);
+    cupsdDeleteJob(job, CUPSD_JOB_PURGE);
+    return (NULL);
+  }
+
+  if (auth_info)
+    auth_info = ippFindAttribute(job->attrs, "auth-info", IPP_TAG_TEXT);
 
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 
@@ -1585,9 +1697,8 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
                  "job-originating-user-name", NULL, job->username);
   else
   {
-    attr->group_tag = IPP_TAG_JOB;
-    _cupsStrFree(attr->name);
-    attr->name = _cupsStrAlloc("job-originating-user-name");
+    ippSetGroupTag(job->attrs, &attr, IPP_TAG_JOB);
+    ippSetName(job->attrs, &attr, "job-originating-user-name");
   }
 
   if (con->username[0] || auth_info)
@@ -1949,8 +2060,7 @@ add_job_subscriptions(
     cupsd_job_t    *job)		/* I - Newly created job */
 {
   int			i;		/* Looping var */
-  ipp_attribute_t	*prev,		/* Previous attribute */
-			*next,		/* Next attribute */
+  ipp_attribute_t	*next,		/* Next attribute */
 			*attr;		/* Current attribute */
   cupsd_subscription_t	*sub;		/* Subscription object */
   const char		*recipient,	/* notify-recipient-uri */
@@ -2146,7 +2256,7 @@ add_job_subscriptions(
   * end of the request...
   */
 
-  for (attr = job->attrs->attrs, prev = NULL; attr; attr = next)
+  for (attr = job->attrs->attrs; attr; attr = next)
   {
     next = attr->next;
 
@@ -2157,19 +2267,9 @@ add_job_subscriptions(
       * Free and remove this attribute...
       */
 
-      ippDeleteAttribute(NULL, attr);
-
-      if (prev)
-        prev->next = next;
-      else
-        job->attrs->attrs = next;
+      ippDeleteAttribute(job->attrs, attr);
     }
-    else
-      prev = attr;
   }
-
-  job->attrs->last    = prev;
-  job->attrs->current = prev;
 }
 
 
@@ -2543,7 +2643,7 @@ add_printer(cupsd_client_t  *con,	/* I - Client connection */
         continue;
 
       printer->reasons[printer->num_reasons] =
-          _cupsStrRetain(attr->values[i].string.text);
+          _cupsStrAlloc(attr->values[i].string.text);
       printer->num_reasons ++;
 
       if (!strcmp(attr->values[i].string.text, "paused") &&
@@ -3978,6 +4078,10 @@ copy_attrs(ipp_t        *to,		/* I - Destination request */
 	   cups_array_t *exclude)	/* I - Attributes to exclude? */
 {
   ipp_attribute_t	*fromattr;	/* Source attribute */
+  cupsd_afilter_t	*filter;	/* Compiled attribute filter */
+  int			bits;		/* Filter bits for attribute */
+  unsigned		mask,		/* Slot mask */
+			slot;		/* Current slot */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
@@ -3987,6 +4091,8 @@ copy_attrs(ipp_t        *to,		/* I - Destination request */
   if (!to || !from)
     return;
 
+  filter = get_attr_filter(ra, exclude);
+
   for (fromattr = from->attrs; fromattr; fromattr = fromattr->next)
   {
    /*
@@ -3997,28 +4103,41 @@ copy_attrs(ipp_t        *to,		/* I - Destination request */
          fromattr->group_tag != IPP_TAG_ZERO) || !fromattr->name)
       continue;
 
-    if (!strcmp(fromattr->name, "job-printer-uri"))
-      continue;
-
-    if (exclude &&
-        (cupsArrayFind(exclude, fromattr->name) ||
-	 cupsArrayFind(exclude, "all")))
+    if (filter)
     {
      /*
-      * We need to exclude this attribute for security reasons; we require the
-      * job-id attribute regardless of the security settings for IPP
-      * conformance.
-      *
-      * The job-printer-uri attribute is handled by copy_job_attrs().
-      *
-      * Subscription attribute security is handled by copy_subscription_attrs().
+      * Attribute names come from the string pool, so look up the name's
+      * bits using its address...
       */
 
-      if (strcmp(fromattr->name, "job-id"))
-        continue;
+      mask = filter->num_slots - 1;
+      slot = ((unsigned)((unsigned long)fromattr->name >> 3) * 2654435761U) &
+             mask;
+
+      while (filter->names[slot] && filter->names[slot] != fromattr->name)
+        slot = (slot + 1) & mask;
+
+      bits = filter->names[slot] ? filter->bits[slot] : filter->other;
     }
+    else if (!strcmp(fromattr->name, "job-printer-uri"))
+      bits = CUPSD_AFILTER_SKIP;
+    else
+      bits = CUPSD_AFILTER_REQUESTED;
 
-    if (!ra || cupsArrayFind(ra, fromattr->name))
+   /*
+    * We need to exclude private attributes for security reasons; the
+    * job-id attribute is never excluded since it is required for IPP
+    * conformance.
+    *
+    * The job-printer-uri attribute is handled by copy_job_attrs().
+    *
+    * Subscription attribute security is handled by copy_subscription_attrs().
+    */
+
+    if (bits & (CUPSD_AFILTER_EXCLUDED | CUPSD_AFILTER_SKIP))
+      continue;
+
+    if (bits & CUPSD_AFILTER_REQUESTED)
     {
      /*
       * Don't send collection attributes by default to IPP/1.x clients
@@ -5156,6 +5275,12 @@ create_requested_array(ipp_t *request)	/* I - IPP request */
   char			*value;		/* Current value */
 
 
+ /*
+  * Any filters compiled for a previous request are now stale...
+  */
+
+  cupsdFlushAttrFilters();
+
  /*
   * Get the requested-attributes attribute, and return NULL if we don't
   * have one...
@@ -5847,6 +5972,8 @@ delete_printer(cupsd_client_t  *con,	/* I - Client connection */
   snprintf(filename, sizeof(filename), "%s/%s.data", CacheDir, printer->name);
   unlink(filename);
 
+  cupsdRemovePrinterState(printer);
+
  /*
   * Unregister color profiles...
   */
@@ -5882,6 +6009,126 @@ delete_printer(cupsd_client_t  *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'get_attr_filter()' - Get the compiled filter for the requested and
+ *                       excluded attributes.
+ *
+ * The filter maps each requested or excluded attribute name to a set of
+ * CUPSD_AFILTER_ bits so that copy_attrs() can filter each attribute with a
+ * single lookup.  Filters are cached until the next call to
+ * create_requested_array(), which is called by every operation that copies
+ * attributes, or cupsdFlushAttrFilters().
+ */
+
+static cupsd_afilter_t *		/* O - Filter or NULL for all */
+get_attr_filter(cups_array_t *ra,	/* I - Requested attributes */
+                cups_array_t *exclude)	/* I - Excluded attributes */
+{
+  int			i,		/* Looping var */
+			slot;		/* Slot for name */
+  cupsd_afilter_t	*filter;	/* Current filter */
+  char			*name;		/* Current name */
+
+
+ /*
+  * See if we need a filter at all...
+  */
+
+  if (!ra && !exclude)
+    return (NULL);
+
+ /*
+  * See if we already have a filter for these arrays...
+  */
+
+  for (i = num_afilters, filter = afilters; i > 0; i --, filter ++)
+    if (filter->ra == ra && filter->exclude == exclude)
+      return (filter);
+
+ /*
+  * No, compile a new one, replacing the last one if the cache is full...
+  */
+
+  if (num_afilters >= CUPSD_AFILTER_MAX)
+  {
+    filter = afilters + CUPSD_AFILTER_MAX - 1;
+
+    for (i = 0; i < filter->num_slots; i ++)
+      if (filter->names[i])
+        _cupsStrFree(filter->names[i]);
+
+    free(filter->names);
+    free(filter->bits);
+
+    num_afilters --;
+  }
+
+  filter = afilters + num_afilters;
+
+  memset(filter, 0, sizeof(cupsd_afilter_t));
+
+  filter->ra        = ra;
+  filter->exclude   = exclude;
+  filter->num_slots = 16;
+
+  while (filter->num_slots < 2 * (cupsArrayCount(ra) +
+                                  cupsArrayCount(exclude) + 2))
+    filter->num_slots *= 2;
+
+  filter->names = calloc(filter->num_slots, sizeof(char *));
+  filter->bits  = calloc(filter->num_slots, 1);
+
+  if (!filter->names || !filter->bits)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to allocate memory for attribute filter!");
+
+    free(filter->names);
+    free(filter->bits);
+
+    return (NULL);
+  }
+
+  num_afilters ++;
+
+ /*
+  * Names that aren't in either array are only copied when all attributes
+  * were requested and not excluded...
+  */
+
+  if (!ra)
+    filter->other = CUPSD_AFILTER_REQUESTED;
+
+  if (cupsArrayFind(exclude, "all"))
+    filter->other |= CUPSD_AFILTER_EXCLUDED;
+
+ /*
+  * Add the requested and excluded names, followed by the special-cased
+  * job-id and job-printer-uri attributes...
+  */
+
+  for (name = (char *)cupsArrayFirst(ra);
+       name;
+       name = (char *)cupsArrayNext(ra))
+    if ((slot = add_attr_filter(filter, name)) >= 0)
+      filter->bits[slot] |= CUPSD_AFILTER_REQUESTED;
+
+  for (name = (char *)cupsArrayFirst(exclude);
+       name;
+       name = (char *)cupsArrayNext(exclude))
+    if ((slot = add_attr_filter(filter, name)) >= 0)
+      filter->bits[slot] |= CUPSD_AFILTER_EXCLUDED;
+
+  if ((slot = add_attr_filter(filter, "job-id")) >= 0)
+    filter->bits[slot] &= ~CUPSD_AFILTER_EXCLUDED;
+
+  if ((slot = add_attr_filter(filter, "job-printer-uri")) >= 0)
+    filter->bits[slot] |= CUPSD_AFILTER_SKIP;
+
+  return (filter);
+}
+
+
 /*
  * 'get_default()' - Get the default destination.
  */
@@ -6650,7 +6897,8 @@ get_notifications(cupsd_client_t *con)	/* I - Client connection */
   http_status_t		status;		/* Policy status */
   cupsd_subscription_t	*sub;		/* Subscription */
   ipp_attribute_t	*ids,		/* notify-subscription-ids */
-			*sequences;	/* notify-sequence-numbers */
+			*sequences,	/* notify-sequence-numbers */
+			*wait;		/* notify-wait */
   int			min_seq;	/* Minimum sequence number */
   int			interval;	/* Poll interval */
 
@@ -6717,6 +6965,34 @@ get_notifications(cupsd_client_t *con)	/* I - Client connection */
       interval = 30;
   }
 
+ /*
+  * If the client wants to wait for events and there aren't any yet, keep
+  * the request on the connection until cupsdAddEvent() queues one or the
+  * poll interval expires.  Waits are limited to 30 seconds so that we
+  * answer before the usual 60 second client timeout...
+  */
+
+  if (interval > 0 && !con->notify_wait &&
+      (wait = ippFindAttribute(con->request, "notify-wait",
+                               IPP_TAG_BOOLEAN)) != NULL &&
+      wait->values[0].boolean && !has_notifications(con))
+  {
+    if (!NotifyWaitClients)
+      NotifyWaitClients = cupsArrayNew(NULL, NULL);
+
+    if (interval > 30)
+      interval = 30;
+
+    con->notify_wait = time(NULL) + interval;
+
+    cupsArrayAdd(NotifyWaitClients, con);
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+                    "[Client %d] Waiting up to %d seconds for events.",
+		    con->http.fd, interval);
+    return;
+  }
+
  /*
   * Tell the client to poll again in N seconds...
   */
@@ -6768,9 +7044,9 @@ get_notifications(cupsd_client_t *con)	/* I - Client connection */
     {
       ippAddSeparator(con->response);
 
-      copy_attrs(con->response,
-                 ((cupsd_event_t *)cupsArrayIndex(sub->events, j))->attrs, NULL,
-        	 IPP_TAG_EVENT_NOTIFICATION, 0, NULL);
+      cupsdCopyEvent(con->response, sub,
+                     (cupsd_event_t *)cupsArrayIndex(sub->events, j),
+		     sub->first_event_id + j);
     }
   }
 }
@@ -7596,6 +7872,49 @@ get_username(cupsd_client_t *con)	/* I - Connection */
 }
 
 
+/*
+ * 'has_notifications()' - See if a Get-Notifications request has new events.
+ */
+
+static int				/* O - 1 if events are available, 0 otherwise */
+has_notifications(cupsd_client_t *con)	/* I - Client connection */
+{
+  int			i;		/* Looping var */
+  cupsd_subscription_t	*sub;		/* Subscription */
+  ipp_attribute_t	*ids,		/* notify-subscription-ids */
+			*sequences;	/* notify-sequence-numbers */
+  int			min_seq;	/* Minimum sequence number */
+
+
+  if ((ids = ippFindAttribute(con->request, "notify-subscription-ids",
+                              IPP_TAG_INTEGER)) == NULL)
+    return (1);
+
+  sequences = ippFindAttribute(con->request, "notify-sequence-numbers",
+                               IPP_TAG_INTEGER);
+
+  for (i = 0; i < ids->num_values; i ++)
+  {
+   /*
+    * A subscription that went away also needs an answer...
+    */
+
+    if ((sub = cupsdFindSubscription(ids->values[i].integer)) == NULL)
+      return (1);
+
+    if (sequences && i < sequences->num_values)
+      min_seq = sequences->values[i].integer;
+    else
+      min_seq = 1;
+
+    if (min_seq < (sub->first_event_id + cupsArrayCount(sub->events)))
+      return (1);
+  }
+
+  return (0);
+}
+
+
 /*
  * 'hold_job()' - Hold a print job.
  */
@@ -8426,8 +8745,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
   cups_option_t		*options;	/* Options */
   ipp_t			*ticket;	/* New attributes */
   ipp_attribute_t	*attr,		/* Current attribute */
-			*attr2,		/* Job attribute */
-			*prev2;		/* Previous job attribute */
+			*attr2;		/* Job attribute */
 
 
  /*
@@ -8530,25 +8848,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (con->request->attrs == attr2)
-      {
-	con->request->attrs = attr2->next;
-	prev2               = NULL;
-      }
-      else
-      {
-	for (prev2 = con->request->attrs; prev2; prev2 = prev2->next)
-	  if (prev2->next == attr2)
-	  {
-	    prev2->next = attr2->next;
-	    break;
-	  }
-      }
-
-      if (con->request->last == attr2)
-        con->request->last = prev2;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(con->request, attr2);
     }
 
    /*
@@ -9809,6 +10109,137 @@ send_ipp_status(cupsd_client_t *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'send_response()' - Send the IPP response back to the client.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+send_response(cupsd_client_t  *con,	/* I - Client connection */
+              ipp_attribute_t *uri)	/* I - Printer or job URI */
+{
+  cupsdLogMessage(con->response->request.status.status_code
+		      >= IPP_BAD_REQUEST &&
+		  con->response->request.status.status_code
+		      != IPP_NOT_FOUND ? CUPSD_LOG_ERROR : CUPSD_LOG_DEBUG,
+		  "Returning IPP %s for %s (%s) from %s",
+		  ippErrorString(con->response->request.status.status_code),
+		  ippOpString(con->request->request.op.operation_id),
+		  uri ? uri->values[0].string.text : "no URI",
+		  con->http.hostname);
+
+  if (LogLevel == CUPSD_LOG_DEBUG2)
+    cupsdLogMessage(CUPSD_LOG_DEBUG2,
+		    "send_response: ippLength(response)=%ld",
+		    (long)ippLength(con->response));
+
+  if (cupsdSendHeader(con, HTTP_OK, "application/ipp", CUPSD_AUTH_NONE))
+  {
+#ifdef CUPSD_USE_CHUNKING
+   /*
+    * Because older versions of CUPS (1.1.17 and older) and some IPP
+    * clients do not implement chunking properly, we cannot use
+    * chunking by default.  This may become the default in future
+    * CUPS releases, or we might add a configuration directive for
+    * it.
+    */
+
+    if (con->http.version == HTTP_1_1)
+    {
+      if (httpPrintf(HTTP(con), "Transfer-Encoding: chunked\r\n\r\n") < 0)
+	return (0);
+
+      if (cupsdFlushHeader(con) < 0)
+	return (0);
+
+      con->http.data_encoding = HTTP_ENCODE_CHUNKED;
+    }
+    else
+#endif /* CUPSD_USE_CHUNKING */
+    {
+      size_t	length;			/* Length of response */
+      const char *coding;		/* Content coding to use */
+
+
+      length = ippLength(con->response);
+
+      if (con->file >= 0 && !con->pipe_pid)
+      {
+	struct stat	fileinfo;	/* File information */
+
+
+	if (!fstat(con->file, &fileinfo))
+	  length += fileinfo.st_size;
+      }
+
+      if (con->http.version == HTTP_1_1 && length >= CUPSD_COMPRESS_MIN &&
+	  (coding = httpGetContentEncoding(HTTP(con))) != NULL)
+      {
+       /*
+	* Compress large responses for clients that accept it; the
+	* compressed length isn't known up front, so use chunking...
+	*/
+
+	if (httpPrintf(HTTP(con), "Content-Encoding: %s\r\n"
+				  "Transfer-Encoding: chunked\r\n\r\n",
+		       coding) < 0)
+	  return (0);
+
+	if (cupsdFlushHeader(con) < 0)
+	  return (0);
+
+	con->http.data_encoding = HTTP_ENCODE_CHUNKED;
+
+	if (_httpSetContentCoding(HTTP(con), coding))
+	{
+	  cupsdLogMessage(CUPSD_LOG_ERROR,
+			  "[Client %d] Unable to start %s content coding.",
+			  con->http.fd, coding);
+	  return (0);
+	}
+
+	cupsdLogMessage(CUPSD_LOG_DEBUG2,
+			"[Client %d] Compressing response with %s.",
+			con->http.fd, coding);
+      }
+      else
+      {
+	if (httpPrintf(HTTP(con), "Content-Length: " CUPS_LLFMT "\r\n\r\n",
+		       CUPS_LLCAST length) < 0)
+	  return (0);
+
+	if (cupsdFlushHeader(con) < 0)
+	  return (0);
+
+	con->http.data_encoding  = HTTP_ENCODE_LENGTH;
+	con->http.data_remaining = length;
+
+	if (con->http.data_remaining <= INT_MAX)
+	  con->http._data_remaining = con->http.data_remaining;
+	else
+	  con->http._data_remaining = INT_MAX;
+      }
+    }
+
+    cupsdAddSelect(con->http.fd, (cupsd_selfunc_t)cupsdReadClient,
+		   (cupsd_selfunc_t)cupsdWriteClient, con);
+
+   /*
+    * Tell the caller the response header was sent successfully...
+    */
+
+    return (1);
+  }
+  else
+  {
+   /*
+    * Tell the caller the response header could not be sent...
+    */
+
+    return (0);
+  }
+}
+
+
 /*
  * 'set_default()' - Set the default destination...
  */
@@ -10156,15 +10587,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (job->attrs->prev)
-        job->attrs->prev->next = attr2->next;
-      else
-        job->attrs->attrs = attr2->next;
-
-      if (job->attrs->last == attr2)
-        job->attrs->last = job->attrs->prev;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(job->attrs, attr2);
 
      /*
       * Then copy the attribute...
@@ -10203,15 +10626,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       if ((attr2 = ippFindAttribute(job->attrs, attr->name,
                                     IPP_TAG_ZERO)) != NULL)
       {
-        if (job->attrs->prev)
-	  job->attrs->prev->next = attr2->next;
-	else
-	  job->attrs->attrs = attr2->next;
-
-        if (attr2 == job->attrs->last)
-	  job->attrs->last = job->attrs->prev;
-
-        ippDeleteAttribute(NULL, attr2);
+        ippDeleteAttribute(job->attrs, attr2);
 
         event |= CUPSD_EVENT_JOB_CONFIG_CHANGED;
       }
@@ -74,6 +74,7 @@
 
 #include "cupsd.h"
 #include <grp.h>
+#include <cups/array-private.h>
 #include <cups/backend.h>
 #include <cups/dir.h>
 #ifdef __APPLE__
@@ -1527,10 +1528,11 @@ cupsdLoadAllJobs(void)
   */
 
   if (!Jobs)
-    Jobs = cupsArrayNew(compare_jobs, NULL);
+    Jobs = _cupsArrayNewLarge(compare_jobs, NULL, NULL, 0, NULL, NULL);
 
   if (!ActiveJobs)
-    ActiveJobs = cupsArrayNew(compare_active_jobs, NULL);
+    ActiveJobs = _cupsArrayNewLarge(compare_active_jobs, NULL, NULL, 0, NULL,
+                                    NULL);
 
   if (!PrintingJobs)
     PrintingJobs = cupsArrayNew(compare_jobs, NULL);
@@ -2158,7 +2160,7 @@ cupsdSaveAllJobs(void)
     cupsFilePuts(fp, "</Job>\n");
   }
 
-  cupsdCloseCreatedConfFile(fp, filename);
+  cupsdQueueCreatedConfFile(fp, filename);
 }
 
 
@@ -4783,7 +4785,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
         cupsdSetPrinterAttr(job->printer, "marker-colors", (char *)attr);
 	job->printer->marker_time = time(NULL);
 	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+        cupsdMarkPrinterStateDirty(job->printer);
       }
 
       if ((attr = cupsGetOption("marker-levels", num_attrs, attrs)) != NULL)
@@ -4791,7 +4793,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
         cupsdSetPrinterAttr(job->printer, "marker-levels", (char *)attr);
 	job->printer->marker_time = time(NULL);
 	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+        cupsdMarkPrinterStateDirty(job->printer);
       }
 
       if ((attr = cupsGetOption("marker-low-levels", num_attrs, attrs)) != NULL)
@@ -4799,7 +4801,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
         cupsdSetPrinterAttr(job->printer, "marker-low-levels", (char *)attr);
 	job->printer->marker_time = time(NULL);
 	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+        cupsdMarkPrinterStateDirty(job->printer);
       }
 
       if ((attr = cupsGetOption("marker-high-levels", num_attrs, attrs)) != NULL)
@@ -4807,7 +4809,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
         cupsdSetPrinterAttr(job->printer, "marker-high-levels", (char *)attr);
 	job->printer->marker_time = time(NULL);
 	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+        cupsdMarkPrinterStateDirty(job->printer);
       }
 
       if ((attr = cupsGetOption("marker-message", num_attrs, attrs)) != NULL)
@@ -4815,7 +4817,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
         cupsdSetPrinterAttr(job->printer, "marker-message", (char *)attr);
 	job->printer->marker_time = time(NULL);
 	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+        cupsdMarkPrinterStateDirty(job->printer);
       }
 
       if ((attr = cupsGetOption("marker-names", num_attrs, attrs)) != NULL)
@@ -4823,7 +4825,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
         cupsdSetPrinterAttr(job->printer, "marker-names", (char *)attr);
 	job->printer->marker_time = time(NULL);
 	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+        cupsdMarkPrinterStateDirty(job->printer);
       }
 
       if ((attr = cupsGetOption("marker-types", num_attrs, attrs)) != NULL)
@@ -4831,7 +4833,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
         cupsdSetPrinterAttr(job->printer, "marker-types", (char *)attr);
 	job->printer->marker_time = time(NULL);
 	event |= CUPSD_EVENT_PRINTER_STATE;
-        cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+        cupsdMarkPrinterStateDirty(job->printer);
       }
 
       cupsFreeOptions(num_attrs, attrs);
@@ -793,6 +793,12 @@ main(int  argc,				/* I - Number of command-line args */
       }
     }
 
+   /*
+    * Send the events queued since the last pass to the notifiers...
+    */
+
+    cupsdFlushNotifications();
+
    /*
     * Check for available input or ready output.  If cupsdDoSelect()
     * returns 0 or -1, something bad happened and we should exit
@@ -889,9 +895,19 @@ main(int  argc,				/* I - Number of command-line args */
     * Write dirty config/state files...
     */
 
-    if (DirtyCleanTime && current_time >= DirtyCleanTime)
+    if ((DirtyCleanTime && current_time >= DirtyCleanTime) ||
+        (PrintcapTime && current_time >= PrintcapTime))
       cupsdCleanDirty();
 
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+   /*
+    * Send pending DNS-SD printer updates...
+    */
+
+    if (DNSSDUpdateTime && current_time >= DNSSDUpdateTime)
+      cupsdUpdateDNSSDPrinters();
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+
 #ifdef __APPLE__
    /*
     * If we are going to sleep and still have pending jobs, stop them after
@@ -908,10 +924,11 @@ main(int  argc,				/* I - Number of command-line args */
 
 #ifndef __APPLE__
    /*
-    * Update the network interfaces once a minute...
+    * Update the network interfaces once a minute, unless we are notified of
+    * changes...
     */
 
-    if ((current_time - netif_time) >= 60)
+    if (!NetIFMonitor && (current_time - netif_time) >= 60)
     {
       netif_time  = current_time;
       NetIFUpdate = 1;
@@ -953,9 +970,20 @@ main(int  argc,				/* I - Number of command-line args */
 
       cupsdUnloadCompletedJobs();
 
+      cupsdExpireGroupCache();
+
       expire_time = current_time;
     }
 
+   /*
+    * Finish Get-Notifications requests that have waited long enough...
+    */
+
+    if (cupsArrayCount(NotifyWaitClients) > 0)
+      cupsdCheckNotifications();
+    else
+      NotifyWaitEvents = 0;
+
 #ifndef HAVE_AUTHORIZATION_H
    /*
     * Update the root certificate once every 5 minutes if we have client
@@ -986,7 +1014,7 @@ main(int  argc,				/* I - Number of command-line args */
       * Process pending data in the input buffer...
       */
 
-      if (con->http.used)
+      if (con->http.used && !con->notify_wait)
       {
         cupsdReadClient(con);
 	continue;
@@ -997,7 +1025,8 @@ main(int  argc,				/* I - Number of command-line args */
       */
 
       activity = current_time - Timeout;
-      if (con->http.activity < activity && !con->pipe_pid)
+      if (con->http.activity < activity && !con->pipe_pid &&
+          !con->notify_wait)
       {
         cupsdLogMessage(CUPSD_LOG_DEBUG,
 	                "Closing client %d after %d seconds of inactivity...",
@@ -1033,7 +1062,9 @@ main(int  argc,				/* I - Number of command-line args */
     {
       size_t		string_count,	/* String count */
 			alloc_bytes,	/* Allocated string bytes */
-			total_bytes;	/* Total string bytes */
+			total_bytes,	/* Total string bytes */
+			string_hits,	/* String pool lookup hits */
+			string_misses;	/* String pool lookup misses */
 #ifdef HAVE_MALLINFO
       struct mallinfo	mem;		/* Malloc information */
 
@@ -1054,6 +1085,15 @@ main(int  argc,				/* I - Number of command-line args */
                       cupsArrayCount(ActiveJobs));
       cupsdLogMessage(CUPSD_LOG_DEBUG, "Report: printers=%d",
                       cupsArrayCount(Printers));
+      cupsdLogMessage(CUPSD_LOG_DEBUG, "Report: groupcache-hits=%d",
+                      GroupCacheHits);
+      cupsdLogMessage(CUPSD_LOG_DEBUG, "Report: groupcache-misses=%d",
+                      GroupCacheMisses);
+#ifdef HAVE_SSL
+      cupsdLogMessage(CUPSD_LOG_DEBUG, "Report: tls-handshakes=%d",
+                      TLSHandshakes);
+      cupsdLogMessage(CUPSD_LOG_DEBUG, "Report: tls-resumed=%d", TLSResumed);
+#endif /* HAVE_SSL */
 
       string_count = _cupsStrStatistics(&alloc_bytes, &total_bytes);
       cupsdLogMessage(CUPSD_LOG_DEBUG,
@@ -1066,6 +1106,17 @@ main(int  argc,				/* I - Number of command-line args */
                       "Report: stringpool-total-bytes=" CUPS_LLFMT,
 		      CUPS_LLCAST total_bytes);
 
+      string_count = _cupsStrPoolStatistics(&string_hits, &string_misses);
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Report: stringpool-unique-count=" CUPS_LLFMT,
+		      CUPS_LLCAST string_count);
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Report: stringpool-hits=" CUPS_LLFMT,
+		      CUPS_LLCAST string_hits);
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Report: stringpool-misses=" CUPS_LLFMT,
+		      CUPS_LLCAST string_misses);
+
       report_time = current_time;
     }
 
@@ -1153,6 +1204,12 @@ main(int  argc,				/* I - Number of command-line args */
 
   cupsdFreeAllJobs();
 
+ /*
+  * Wait for job.cache and any other saved files to be moved into place...
+  */
+
+  cupsdWaitConfFiles(NULL);
+
 #ifdef __APPLE__
  /*
   * Stop monitoring system event monitoring...
@@ -1832,9 +1889,16 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
   for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
        con;
        con = (cupsd_client_t *)cupsArrayNext(Clients))
-    if (con->http.used > 0)
+    if (con->http.used > 0 && !con->notify_wait)
       return (0);
 
+ /*
+  * Finish Get-Notifications requests for new events right away...
+  */
+
+  if (NotifyWaitEvents)
+    return (0);
+
  /*
   * If select has been active in the last second (fds > 0) or we have
   * many resources in use then don't bother trying to optimize the
@@ -1886,7 +1950,15 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
   for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
        con;
        con = (cupsd_client_t *)cupsArrayNext(Clients))
-    if ((con->http.activity + Timeout) < timeout)
+    if (con->notify_wait)
+    {
+      if (con->notify_wait < timeout)
+      {
+        timeout = con->notify_wait;
+	why     = "finish a Get-Notifications request";
+      }
+    }
+    else if ((con->http.activity + Timeout) < timeout)
     {
       timeout = con->http.activity + Timeout;
       why     = "timeout a client connection";
@@ -1902,6 +1974,24 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
     why     = "write dirty config/state files";
   }
 
+  if (PrintcapTime && timeout > PrintcapTime)
+  {
+    timeout = PrintcapTime;
+    why     = "write printcap file";
+  }
+
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+ /*
+  * Send pending DNS-SD printer updates...
+  */
+
+  if (DNSSDUpdateTime && timeout > DNSSDUpdateTime)
+  {
+    timeout = DNSSDUpdateTime;
+    why     = "update DNS-SD printer registrations";
+  }
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+
  /*
   * Check for any job activity...
   */
@@ -14,10 +14,24 @@
  *
  * Contents:
  *
- *   cupsdNetIFFind()   - Find a network interface.
- *   cupsdNetIFFree()   - Free the current network interface list.
- *   cupsdNetIFUpdate() - Update the network interface list as needed...
- *   compare_netif()    - Compare two network interfaces.
+ *   cupsdNetIFFind()         - Find a network interface.
+ *   cupsdNetIFFindAddress()  - Find a network interface by local address.
+ *   cupsdNetIFFindHostname() - Find a network interface by hostname.
+ *   cupsdNetIFFree()         - Free the current network interface list.
+ *   cupsdNetIFStartMonitor() - Start monitoring network interface changes.
+ *   cupsdNetIFStopMonitor()  - Stop monitoring network interface changes.
+ *   cupsdNetIFUpdate()       - Update the network interface list as needed...
+ *   compare_netif()          - Compare two network interfaces.
+ *   compare_netif_address()  - Compare the addresses of two network
+ *                              interfaces.
+ *   compare_netif_hostname() - Compare the hostnames of two network
+ *                              interfaces.
+ *   hash_netif_address()     - Generate a lookup hash for the address.
+ *   hash_netif_hostname()    - Generate a lookup hash for the hostname.
+ *   netif_add()              - Add a network interface address.
+ *   netif_delete()           - Delete a network interface address.
+ *   netif_netlink()          - Apply a netlink address change.
+ *   netif_read()             - Read network interface changes.
  */
 
 /*
@@ -26,6 +40,24 @@
 
 #include <cups/http-private.h>
 #include "cupsd.h"
+#ifdef __linux
+#  include <linux/netlink.h>
+#  include <linux/rtnetlink.h>
+#  include <sys/ioctl.h>
+#endif /* __linux */
+
+
+/*
+ * Local globals...
+ */
+
+static cups_array_t	*netif_addresses = NULL,
+					/* Interfaces by local address */
+			*netif_hostnames = NULL;
+					/* Interfaces by hostname */
+#ifdef __linux
+static int		netif_fd = -1;	/* rtnetlink socket */
+#endif /* __linux */
 
 
 /*
@@ -34,6 +66,18 @@
 
 static void	cupsdNetIFFree(void);
 static int	compare_netif(cupsd_netif_t *a, cupsd_netif_t *b);
+static int	compare_netif_address(cupsd_netif_t *a, cupsd_netif_t *b);
+static int	compare_netif_hostname(cupsd_netif_t *a, cupsd_netif_t *b);
+static int	hash_netif_address(cupsd_netif_t *netif);
+static int	hash_netif_hostname(cupsd_netif_t *netif);
+static cupsd_netif_t *netif_add(const char *name, struct sockaddr *address,
+		                struct sockaddr *netmask,
+				struct sockaddr *dstaddr, unsigned flags);
+static int	netif_delete(const char *name, struct sockaddr *address);
+#ifdef __linux
+static void	netif_netlink(struct nlmsghdr *nlh);
+static void	netif_read(void *data);
+#endif /* __linux */
 
 
 /*
@@ -63,6 +107,104 @@ cupsdNetIFFind(const char *name)	/* I - Name of interface */
 }
 
 
+/*
+ * 'cupsdNetIFFindAddress()' - Find a network interface by local address.
+ */
+
+cupsd_netif_t *				/* O - Network interface data */
+cupsdNetIFFindAddress(
+    http_addr_t *address)		/* I - Local address */
+{
+  cupsd_netif_t	key;			/* Search key */
+
+
+ /*
+  * Update the interface list as needed...
+  */
+
+  if (NetIFUpdate)
+    cupsdNetIFUpdate();
+
+ /*
+  * Search for the address...
+  */
+
+  memset(&key, 0, sizeof(key));
+
+#ifdef AF_INET6
+  if (address->addr.sa_family == AF_INET6 &&
+      IN6_IS_ADDR_V4MAPPED(&(address->ipv6.sin6_addr)))
+  {
+   /*
+    * Look up IPv4 clients of IPv6 listeners using the IPv4 address...
+    */
+
+    key.address.ipv4.sin_family = AF_INET;
+    memcpy(&(key.address.ipv4.sin_addr), address->ipv6.sin6_addr.s6_addr + 12,
+           sizeof(key.address.ipv4.sin_addr));
+  }
+  else
+#endif /* AF_INET6 */
+  memcpy(&(key.address), address, httpAddrLength(address));
+
+  return ((cupsd_netif_t *)cupsArrayFind(netif_addresses, &key));
+}
+
+
+/*
+ * 'cupsdNetIFFindHostname()' - Find a network interface by hostname.
+ *
+ * The hostname may be followed by a trailing "." and/or a ":port" suffix,
+ * as found in the HTTP Host: field.
+ */
+
+cupsd_netif_t *				/* O - Network interface data */
+cupsdNetIFFindHostname(
+    const char *hostname)		/* I - Hostname */
+{
+  struct
+  {
+    cupsd_netif_t	netif;		/* Search key */
+    char		buffer[256];	/* Space for hostname */
+  }		key;			/* Search key */
+  const char	*end;			/* End of hostname */
+  size_t	hostlen;		/* Length of hostname */
+
+
+ /*
+  * Update the interface list as needed...
+  */
+
+  if (NetIFUpdate)
+    cupsdNetIFUpdate();
+
+ /*
+  * Strip any ":port" or trailing "." from the hostname...
+  */
+
+  if (*hostname == '[' && (end = strchr(hostname, ']')) != NULL)
+    end ++;
+  else if ((end = strchr(hostname, ':')) == NULL)
+    end = hostname + strlen(hostname);
+
+  if (end > hostname && end[-1] == '.')
+    end --;
+
+  if ((hostlen = (size_t)(end - hostname)) > 255)
+    return (NULL);
+
+ /*
+  * Search for the hostname...
+  */
+
+  key.netif.hostlen = hostlen;
+  memcpy(key.netif.hostname, hostname, hostlen);
+  key.netif.hostname[hostlen] = '\0';
+
+  return ((cupsd_netif_t *)cupsArrayFind(netif_hostnames, &key));
+}
+
+
 /*
  * 'cupsdNetIFFree()' - Free the current network interface list.
  */
@@ -77,6 +219,9 @@ cupsdNetIFFree(void)
   * Loop through the interface list and free all the records...
   */
 
+  cupsArrayClear(netif_addresses);
+  cupsArrayClear(netif_hostnames);
+
   for (current = (cupsd_netif_t *)cupsArrayFirst(NetIFList);
        current;
        current = (cupsd_netif_t *)cupsArrayNext(NetIFList))
@@ -87,6 +232,82 @@ cupsdNetIFFree(void)
 }
 
 
+/*
+ * 'cupsdNetIFStartMonitor()' - Start monitoring network interface changes.
+ *
+ * On Linux the interface list is updated incrementally from rtnetlink
+ * address notifications.  Otherwise the main loop polls for changes.
+ */
+
+void
+cupsdNetIFStartMonitor(void)
+{
+#ifdef __linux
+  struct sockaddr_nl	nladdr;		/* Netlink address */
+
+
+  if (netif_fd >= 0)
+    return;
+
+  if ((netif_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC,
+                         NETLINK_ROUTE)) < 0)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+                    "Unable to create netlink socket - %s", strerror(errno));
+    return;
+  }
+
+  memset(&nladdr, 0, sizeof(nladdr));
+  nladdr.nl_family = AF_NETLINK;
+  nladdr.nl_groups = RTMGRP_IPV4_IFADDR
+#  ifdef AF_INET6
+		     | RTMGRP_IPV6_IFADDR
+#  endif /* AF_INET6 */
+		     ;
+
+  if (bind(netif_fd, (struct sockaddr *)&nladdr, sizeof(nladdr)))
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+                    "Unable to bind netlink socket - %s", strerror(errno));
+    close(netif_fd);
+    netif_fd = -1;
+    return;
+  }
+
+  fcntl(netif_fd, F_SETFL, fcntl(netif_fd, F_GETFL) | O_NONBLOCK);
+
+  cupsdAddSelect(netif_fd, (cupsd_selfunc_t)netif_read, NULL, NULL);
+
+ /*
+  * Changes may have been missed while we weren't listening...
+  */
+
+  NetIFMonitor = 1;
+  NetIFUpdate  = 1;
+#endif /* __linux */
+}
+
+
+/*
+ * 'cupsdNetIFStopMonitor()' - Stop monitoring network interface changes.
+ */
+
+void
+cupsdNetIFStopMonitor(void)
+{
+#ifdef __linux
+  if (netif_fd < 0)
+    return;
+
+  cupsdRemoveSelect(netif_fd);
+  close(netif_fd);
+
+  netif_fd     = -1;
+  NetIFMonitor = 0;
+#endif /* __linux */
+}
+
+
 /*
  * 'cupsdNetIFUpdate()' - Update the network interface list as needed...
  */
@@ -94,13 +315,8 @@ cupsdNetIFFree(void)
 void
 cupsdNetIFUpdate(void)
 {
-  int			match;		/* Matching address? */
-  cupsd_listener_t	*lis;		/* Listen address */
-  cupsd_netif_t		*temp;		/* New interface */
   struct ifaddrs	*addrs,		/* Interface address list */
 			*addr;		/* Current interface address */
-  char			hostname[1024];	/* Hostname for address */
-  size_t		hostlen;	/* Length of hostname */
 
 
  /*
@@ -111,6 +327,7 @@ cupsdNetIFUpdate(void)
     return;
 
   NetIFUpdate = 0;
+  NetIFGeneration ++;
 
  /*
   * Free the old interfaces...
@@ -119,13 +336,25 @@ cupsdNetIFUpdate(void)
   cupsdNetIFFree();
 
  /*
-  * Make sure we have an array...
+  * Make sure we have arrays...
   */
 
   if (!NetIFList)
     NetIFList = cupsArrayNew((cups_array_func_t)compare_netif, NULL);
 
-  if (!NetIFList)
+  if (!netif_addresses)
+    netif_addresses = cupsArrayNew2((cups_array_func_t)compare_netif_address,
+                                    NULL,
+				    (cups_ahash_func_t)hash_netif_address,
+				    256);
+
+  if (!netif_hostnames)
+    netif_hostnames = cupsArrayNew2((cups_array_func_t)compare_netif_hostname,
+                                    NULL,
+				    (cups_ahash_func_t)hash_netif_hostname,
+				    256);
+
+  if (!NetIFList || !netif_addresses || !netif_hostnames)
     return;
 
  /*
@@ -150,149 +379,586 @@ cupsdNetIFUpdate(void)
         addr->ifa_netmask == NULL || addr->ifa_name == NULL)
       continue;
 
+    if (!netif_add(addr->ifa_name, addr->ifa_addr, addr->ifa_netmask,
+                   addr->ifa_dstaddr, addr->ifa_flags))
+      break;
+  }
+
+  freeifaddrs(addrs);
+}
+
+
+/*
+ * 'compare_netif()' - Compare two network interfaces.
+ */
+
+static int				/* O - Result of comparison */
+compare_netif(cupsd_netif_t *a,		/* I - First network interface */
+              cupsd_netif_t *b)		/* I - Second network interface */
+{
+  return (strcmp(a->name, b->name));
+}
+
+
+/*
+ * 'compare_netif_address()' - Compare the addresses of two network
+ *                             interfaces.
+ */
+
+static int				/* O - Result of comparison */
+compare_netif_address(
+    cupsd_netif_t *a,			/* I - First network interface */
+    cupsd_netif_t *b)			/* I - Second network interface */
+{
+  int	result;				/* Result of comparison */
+
+
+  if (a->address.addr.sa_family != b->address.addr.sa_family)
+    return (a->address.addr.sa_family - b->address.addr.sa_family);
+
+#ifdef AF_INET6
+  if (a->address.addr.sa_family == AF_INET6)
+  {
+    if ((result = memcmp(&(a->address.ipv6.sin6_addr),
+                         &(b->address.ipv6.sin6_addr),
+			 sizeof(a->address.ipv6.sin6_addr))) != 0)
+      return (result);
+
+    return ((int)a->address.ipv6.sin6_scope_id -
+            (int)b->address.ipv6.sin6_scope_id);
+  }
+#endif /* AF_INET6 */
+
+  result = memcmp(&(a->address.ipv4.sin_addr), &(b->address.ipv4.sin_addr),
+                  sizeof(a->address.ipv4.sin_addr));
+
+  return (result);
+}
+
+
+/*
+ * 'compare_netif_hostname()' - Compare the hostnames of two network
+ *                              interfaces.
+ */
+
+static int				/* O - Result of comparison */
+compare_netif_hostname(
+    cupsd_netif_t *a,			/* I - First network interface */
+    cupsd_netif_t *b)			/* I - Second network interface */
+{
+  return (_cups_strcasecmp(a->hostname, b->hostname));
+}
+
+
+/*
+ * 'hash_netif_address()' - Generate a lookup hash for the address.
+ */
+
+static int				/* O - Hash value */
+hash_netif_address(
+    cupsd_netif_t *netif)		/* I - Network interface */
+{
+#ifdef AF_INET6
+  if (netif->address.addr.sa_family == AF_INET6)
+    return (netif->address.ipv6.sin6_addr.s6_addr[15]);
+#endif /* AF_INET6 */
+
+  return (((unsigned char *)&(netif->address.ipv4.sin_addr))[3]);
+}
+
+
+/*
+ * 'hash_netif_hostname()' - Generate a lookup hash for the hostname.
+ */
+
+static int				/* O - Hash value */
+hash_netif_hostname(
+    cupsd_netif_t *netif)		/* I - Network interface */
+{
+  int		hash;			/* Hash value */
+  const char	*ptr;			/* Pointer into hostname */
+
+
+  for (hash = 0, ptr = netif->hostname; *ptr; ptr ++)
+    hash += _cups_tolower(*ptr);
+
+  return (hash & 255);
+}
+
+
+/*
+ * 'netif_add()' - Add a network interface address.
+ */
+
+static cupsd_netif_t *			/* O - New network interface or NULL */
+netif_add(const char      *name,	/* I - Interface name */
+          struct sockaddr *address,	/* I - Interface address */
+	  struct sockaddr *netmask,	/* I - Network mask */
+	  struct sockaddr *dstaddr,	/* I - Broadcast/destination address */
+	  unsigned        flags)	/* I - Interface flags */
+{
+  int			match;		/* Matching address? */
+  cupsd_listener_t	*lis;		/* Listen address */
+  cupsd_netif_t		*temp;		/* New interface */
+  char			hostname[1024];	/* Hostname for address */
+  size_t		hostlen;	/* Length of hostname */
+
+
+ /*
+  * Try looking up the hostname for the address as needed...
+  */
+
+  if (HostNameLookups)
+    httpAddrLookup((http_addr_t *)address, hostname, sizeof(hostname));
+  else
+  {
    /*
-    * Try looking up the hostname for the address as needed...
+    * Map the default server address and localhost to the server name
+    * and localhost, respectively; for all other addresses, use the
+    * numeric address...
     */
 
-    if (HostNameLookups)
-      httpAddrLookup((http_addr_t *)(addr->ifa_addr), hostname,
-                     sizeof(hostname));
+    if (httpAddrLocalhost((http_addr_t *)address))
+      strlcpy(hostname, "localhost", sizeof(hostname));
     else
-    {
-     /*
-      * Map the default server address and localhost to the server name
-      * and localhost, respectively; for all other addresses, use the
-      * numeric address...
-      */
+      httpAddrString((http_addr_t *)address, hostname, sizeof(hostname));
+  }
 
-      if (httpAddrLocalhost((http_addr_t *)(addr->ifa_addr)))
-        strlcpy(hostname, "localhost", sizeof(hostname));
-      else
-	httpAddrString((http_addr_t *)(addr->ifa_addr), hostname,
-		       sizeof(hostname));
-    }
+ /*
+  * Create a new address element...
+  */
+
+  hostlen = strlen(hostname);
+  if ((temp = calloc(1, sizeof(cupsd_netif_t) + hostlen)) == NULL)
+    return (NULL);
 
+ /*
+  * Copy all of the information...
+  */
+
+  strlcpy(temp->name, name, sizeof(temp->name));
+  temp->hostlen = hostlen;
+  memcpy(temp->hostname, hostname, hostlen + 1);
+
+  if (address->sa_family == AF_INET)
+  {
    /*
-    * Create a new address element...
+    * Copy IPv4 addresses...
     */
 
-    hostlen = strlen(hostname);
-    if ((temp = calloc(1, sizeof(cupsd_netif_t) + hostlen)) == NULL)
-      break;
+    memcpy(&(temp->address), address, sizeof(struct sockaddr_in));
+    memcpy(&(temp->mask), netmask, sizeof(struct sockaddr_in));
 
+    if (dstaddr)
+      memcpy(&(temp->broadcast), dstaddr, sizeof(struct sockaddr_in));
+  }
+#ifdef AF_INET6
+  else
+  {
    /*
-    * Copy all of the information...
+    * Copy IPv6 addresses...
     */
 
-    strlcpy(temp->name, addr->ifa_name, sizeof(temp->name));
-    temp->hostlen = hostlen;
-    memcpy(temp->hostname, hostname, hostlen + 1);
+    memcpy(&(temp->address), address, sizeof(struct sockaddr_in6));
+    memcpy(&(temp->mask), netmask, sizeof(struct sockaddr_in6));
 
-    if (addr->ifa_addr->sa_family == AF_INET)
-    {
-     /*
-      * Copy IPv4 addresses...
-      */
+    if (dstaddr)
+      memcpy(&(temp->broadcast), dstaddr, sizeof(struct sockaddr_in6));
+  }
+#endif /* AF_INET6 */
 
-      memcpy(&(temp->address), addr->ifa_addr, sizeof(struct sockaddr_in));
-      memcpy(&(temp->mask), addr->ifa_netmask, sizeof(struct sockaddr_in));
+  if (!(flags & IFF_POINTOPOINT) && !httpAddrLocalhost(&(temp->address)))
+    temp->is_local = 1;
 
-      if (addr->ifa_dstaddr)
-	memcpy(&(temp->broadcast), addr->ifa_dstaddr,
-	       sizeof(struct sockaddr_in));
-    }
+ /*
+  * Determine which port to use when advertising printers...
+  */
+
+  for (lis = (cupsd_listener_t *)cupsArrayFirst(Listeners);
+       lis;
+       lis = (cupsd_listener_t *)cupsArrayNext(Listeners))
+  {
+    match = 0;
+
+    if (httpAddrAny(&(lis->address)))
+      match = 1;
+    else if (address->sa_family == AF_INET &&
+             lis->address.addr.sa_family == AF_INET &&
+             (lis->address.ipv4.sin_addr.s_addr &
+	      temp->mask.ipv4.sin_addr.s_addr) ==
+	         (temp->address.ipv4.sin_addr.s_addr &
+		  temp->mask.ipv4.sin_addr.s_addr))
+      match = 1;
 #ifdef AF_INET6
-    else
+    else if (address->sa_family == AF_INET6 &&
+             lis->address.addr.sa_family == AF_INET6 &&
+             (lis->address.ipv6.sin6_addr.s6_addr[0] &
+	      temp->mask.ipv6.sin6_addr.s6_addr[0]) ==
+		 (temp->address.ipv6.sin6_addr.s6_addr[0] &
+		  temp->mask.ipv6.sin6_addr.s6_addr[0]) &&
+             (lis->address.ipv6.sin6_addr.s6_addr[1] &
+	      temp->mask.ipv6.sin6_addr.s6_addr[1]) ==
+		 (temp->address.ipv6.sin6_addr.s6_addr[1] &
+		  temp->mask.ipv6.sin6_addr.s6_addr[1]) &&
+             (lis->address.ipv6.sin6_addr.s6_addr[2] &
+	      temp->mask.ipv6.sin6_addr.s6_addr[2]) ==
+		 (temp->address.ipv6.sin6_addr.s6_addr[2] &
+		  temp->mask.ipv6.sin6_addr.s6_addr[2]) &&
+             (lis->address.ipv6.sin6_addr.s6_addr[3] &
+	      temp->mask.ipv6.sin6_addr.s6_addr[3]) ==
+		 (temp->address.ipv6.sin6_addr.s6_addr[3] &
+		  temp->mask.ipv6.sin6_addr.s6_addr[3]))
+      match = 1;
+#endif /* AF_INET6 */
+
+    if (match)
     {
-     /*
-      * Copy IPv6 addresses...
-      */
+      temp->port = _httpAddrPort(&(lis->address));
+      break;
+    }
+  }
 
-      memcpy(&(temp->address), addr->ifa_addr, sizeof(struct sockaddr_in6));
-      memcpy(&(temp->mask), addr->ifa_netmask, sizeof(struct sockaddr_in6));
+ /*
+  * Add it to the arrays...
+  */
 
-      if (addr->ifa_dstaddr)
-	memcpy(&(temp->broadcast), addr->ifa_dstaddr,
-	       sizeof(struct sockaddr_in6));
-    }
+  cupsArrayAdd(NetIFList, temp);
+  cupsArrayAdd(netif_addresses, temp);
+  cupsArrayAdd(netif_hostnames, temp);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdNetIFUpdate: \"%s\" = %s:%d",
+                  temp->name, temp->hostname, temp->port);
+
+  return (temp);
+}
+
+
+/*
+ * 'netif_delete()' - Delete a network interface address.
+ */
+
+static int				/* O - 1 if deleted, 0 if not found */
+netif_delete(const char      *name,	/* I - Interface name */
+             struct sockaddr *address)	/* I - Interface address */
+{
+  cupsd_netif_t	key,			/* Search key */
+		*netif,			/* Matching interface */
+		*current;		/* Current interface */
+
+
+  memset(&key, 0, sizeof(key));
+  memcpy(&(key.address), address, httpAddrLength((http_addr_t *)address));
+
+  for (netif = (cupsd_netif_t *)cupsArrayFind(netif_addresses, &key);
+       netif && !compare_netif_address(netif, &key);
+       netif = (cupsd_netif_t *)cupsArrayNext(netif_addresses))
+    if (!strcmp(netif->name, name))
+      break;
+
+  if (!netif || compare_netif_address(netif, &key))
+    return (0);
+
+ /*
+  * Remove the exact element from each array; the arrays may contain other
+  * elements that compare the same...
+  */
+
+  cupsArrayRemove(netif_addresses, netif);
+
+  for (current = (cupsd_netif_t *)cupsArrayFind(NetIFList, netif);
+       current && current != netif;
+       current = (cupsd_netif_t *)cupsArrayNext(NetIFList));
+
+  if (current)
+    cupsArrayRemove(NetIFList, current);
+
+  for (current = (cupsd_netif_t *)cupsArrayFind(netif_hostnames, netif);
+       current && current != netif;
+       current = (cupsd_netif_t *)cupsArrayNext(netif_hostnames));
+
+  if (current)
+    cupsArrayRemove(netif_hostnames, current);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdNetIFUpdate: \"%s\" = %s removed",
+                  netif->name, netif->hostname);
+
+  free(netif);
+
+  return (1);
+}
+
+
+#ifdef __linux
+/*
+ * 'netif_netlink()' - Apply a netlink address change.
+ */
+
+static void
+netif_netlink(struct nlmsghdr *nlh)	/* I - Netlink message */
+{
+  struct ifaddrmsg	*ifa;		/* Address message */
+  struct rtattr		*rta;		/* Current attribute */
+  int			rtalen;		/* Length of attributes */
+  void			*address = NULL,/* IFA_ADDRESS attribute */
+			*local = NULL,	/* IFA_LOCAL attribute */
+			*broadcast = NULL;
+					/* IFA_BROADCAST attribute */
+  const char		*label = NULL;	/* IFA_LABEL attribute */
+  char			name[IF_NAMESIZE],
+					/* Interface name */
+			ifname[IFNAMSIZ];
+					/* Interface or label name */
+  struct ifreq		ifr;		/* Interface flags request */
+  cupsd_netif_t		key,		/* Search key */
+			*netif;		/* Existing interface */
+  http_addr_t		ifmask,		/* Network mask */
+			ifdstaddr;	/* Broadcast/destination address */
+  size_t		addrlen;	/* Length of address */
+  unsigned char		*maskptr;	/* Pointer into network mask */
+  int			bits;		/* Remaining prefix bits */
+
+
+  ifa = (struct ifaddrmsg *)NLMSG_DATA(nlh);
+
+  if (ifa->ifa_family == AF_INET)
+    addrlen = 4;
+#ifdef AF_INET6
+  else if (ifa->ifa_family == AF_INET6)
+    addrlen = 16;
 #endif /* AF_INET6 */
+  else
+    return;
+
+  for (rta = IFA_RTA(ifa), rtalen = IFA_PAYLOAD(nlh);
+       RTA_OK(rta, rtalen);
+       rta = RTA_NEXT(rta, rtalen))
+  {
+    switch (rta->rta_type)
+    {
+      case IFA_ADDRESS :
+          address = RTA_DATA(rta);
+	  break;
+      case IFA_LOCAL :
+          local = RTA_DATA(rta);
+	  break;
+      case IFA_BROADCAST :
+          broadcast = RTA_DATA(rta);
+	  break;
+      case IFA_LABEL :
+          label = (const char *)RTA_DATA(rta);
+	  break;
+    }
+  }
+
+ /*
+  * For point-to-point links IFA_LOCAL is the local address and IFA_ADDRESS
+  * is the peer address, just like getifaddrs() reports them...
+  */
 
-    if (!(addr->ifa_flags & IFF_POINTOPOINT) &&
-        !httpAddrLocalhost(&(temp->address)))
-      temp->is_local = 1;
+  if (!local)
+    local = address;
+  else if (address && memcmp(local, address, addrlen))
+    broadcast = address;
 
+  if (!local)
+    return;
+
+  if (!if_indextoname(ifa->ifa_index, name))
+  {
    /*
-    * Determine which port to use when advertising printers...
+    * The interface is already gone; we'll get the address deletions
+    * separately, but make sure nothing is missed...
     */
 
-    for (lis = (cupsd_listener_t *)cupsArrayFirst(Listeners);
-         lis;
-	 lis = (cupsd_listener_t *)cupsArrayNext(Listeners))
+    NetIFUpdate = 1;
+    return;
+  }
+
+ /*
+  * Build the addresses...
+  */
+
+  memset(&key, 0, sizeof(key));
+  memset(&ifmask, 0, sizeof(ifmask));
+  memset(&ifdstaddr, 0, sizeof(ifdstaddr));
+
+  if (ifa->ifa_family == AF_INET)
+  {
+    key.address.ipv4.sin_family = AF_INET;
+    memcpy(&(key.address.ipv4.sin_addr), local, addrlen);
+
+    ifmask.ipv4.sin_family = AF_INET;
+    maskptr                = (unsigned char *)&(ifmask.ipv4.sin_addr);
+
+    if (broadcast)
     {
-      match = 0;
-
-      if (httpAddrAny(&(lis->address)))
-        match = 1;
-      else if (addr->ifa_addr->sa_family == AF_INET &&
-               lis->address.addr.sa_family == AF_INET &&
-               (lis->address.ipv4.sin_addr.s_addr &
-	        temp->mask.ipv4.sin_addr.s_addr) ==
-	           (temp->address.ipv4.sin_addr.s_addr &
-		    temp->mask.ipv4.sin_addr.s_addr))
-        match = 1;
+      ifdstaddr.ipv4.sin_family = AF_INET;
+      memcpy(&(ifdstaddr.ipv4.sin_addr), broadcast, addrlen);
+    }
+  }
 #ifdef AF_INET6
-      else if (addr->ifa_addr->sa_family == AF_INET6 &&
-               lis->address.addr.sa_family == AF_INET6 &&
-               (lis->address.ipv6.sin6_addr.s6_addr[0] &
-	        temp->mask.ipv6.sin6_addr.s6_addr[0]) ==
-		   (temp->address.ipv6.sin6_addr.s6_addr[0] &
-		    temp->mask.ipv6.sin6_addr.s6_addr[0]) &&
-               (lis->address.ipv6.sin6_addr.s6_addr[1] &
-	        temp->mask.ipv6.sin6_addr.s6_addr[1]) ==
-		   (temp->address.ipv6.sin6_addr.s6_addr[1] &
-		    temp->mask.ipv6.sin6_addr.s6_addr[1]) &&
-               (lis->address.ipv6.sin6_addr.s6_addr[2] &
-	        temp->mask.ipv6.sin6_addr.s6_addr[2]) ==
-		   (temp->address.ipv6.sin6_addr.s6_addr[2] &
-		    temp->mask.ipv6.sin6_addr.s6_addr[2]) &&
-               (lis->address.ipv6.sin6_addr.s6_addr[3] &
-	        temp->mask.ipv6.sin6_addr.s6_addr[3]) ==
-		   (temp->address.ipv6.sin6_addr.s6_addr[3] &
-		    temp->mask.ipv6.sin6_addr.s6_addr[3]))
-        match = 1;
-#endif /* AF_INET6 */
+  else
+  {
+    key.address.ipv6.sin6_family = AF_INET6;
+    memcpy(&(key.address.ipv6.sin6_addr), local, addrlen);
 
-      if (match)
-      {
-        temp->port = _httpAddrPort(&(lis->address));
-	break;
-      }
+    if (IN6_IS_ADDR_LINKLOCAL(&(key.address.ipv6.sin6_addr)) ||
+        IN6_IS_ADDR_MC_LINKLOCAL(&(key.address.ipv6.sin6_addr)))
+      key.address.ipv6.sin6_scope_id = ifa->ifa_index;
+
+    ifmask.ipv6.sin6_family = AF_INET6;
+    maskptr                 = ifmask.ipv6.sin6_addr.s6_addr;
+
+    if (broadcast)
+    {
+      ifdstaddr.ipv6.sin6_family = AF_INET6;
+      memcpy(&(ifdstaddr.ipv6.sin6_addr), broadcast, addrlen);
     }
+  }
+#endif /* AF_INET6 */
 
-   /*
-    * Add it to the array...
-    */
+  for (bits = ifa->ifa_prefixlen; bits >= 8; bits -= 8)
+    *maskptr++ = 0xff;
 
-    cupsArrayAdd(NetIFList, temp);
+  if (bits > 0)
+    *maskptr = (unsigned char)(0xff << (8 - bits));
+
+ /*
+  * IPv4 addresses are named using their label, like getifaddrs() does...
+  */
 
-    cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdNetIFUpdate: \"%s\" = %s:%d",
-                    temp->name, temp->hostname, temp->port);
+  if (label && ifa->ifa_family == AF_INET)
+    strlcpy(ifname, label, sizeof(ifname));
+  else
+    strlcpy(ifname, name, sizeof(ifname));
+
+  if (nlh->nlmsg_type == RTM_DELADDR)
+  {
+    if (netif_delete(ifname, &(key.address.addr)))
+      NetIFGeneration ++;
+
+    return;
   }
 
-  freeifaddrs(addrs);
+ /*
+  * The kernel also sends RTM_NEWADDR when the address flags or lifetimes
+  * change; only replace the interface when something we track changed...
+  */
+
+  for (netif = (cupsd_netif_t *)cupsArrayFind(netif_addresses, &key);
+       netif && !compare_netif_address(netif, &key);
+       netif = (cupsd_netif_t *)cupsArrayNext(netif_addresses))
+    if (!strcmp(netif->name, ifname))
+    {
+      if (!memcmp(&(netif->mask), &ifmask, sizeof(ifmask)) &&
+          !memcmp(&(netif->broadcast), &ifdstaddr, sizeof(ifdstaddr)))
+        return;
+
+      break;
+    }
+
+  netif_delete(ifname, &(key.address.addr));
+
+ /*
+  * Get the interface flags; if we can't, treat the interface as
+  * point-to-point so that it doesn't match @LOCAL...
+  */
+
+  strlcpy(ifr.ifr_name, name, sizeof(ifr.ifr_name));
+
+  if (ioctl(netif_fd, SIOCGIFFLAGS, &ifr))
+    ifr.ifr_flags = IFF_POINTOPOINT;
+
+  netif_add(ifname, &(key.address.addr), &(ifmask.addr),
+            broadcast ? &(ifdstaddr.addr) : NULL, (unsigned)ifr.ifr_flags);
+
+  NetIFGeneration ++;
 }
 
 
 /*
- * 'compare_netif()' - Compare two network interfaces.
+ * 'netif_read()' - Read network interface changes.
  */
 
-static int				/* O - Result of comparison */
-compare_netif(cupsd_netif_t *a,		/* I - First network interface */
-              cupsd_netif_t *b)		/* I - Second network interface */
+static void
+netif_read(void *data)			/* I - Callback data (unused) */
 {
-  return (strcmp(a->name, b->name));
+  char			buffer[8192];	/* Netlink messages */
+  ssize_t		bytes;		/* Bytes read */
+  int			len;		/* Remaining bytes */
+  struct nlmsghdr	*nlh;		/* Current message */
+  struct sockaddr_nl	addr;		/* Sender address */
+  struct iovec		iov;		/* Message buffer */
+  struct msghdr		msg;		/* Message header */
+
+
+  (void)data;
+
+  for (;;)
+  {
+    memset(&msg, 0, sizeof(msg));
+
+    iov.iov_base    = buffer;
+    iov.iov_len     = sizeof(buffer);
+    msg.msg_name    = &addr;
+    msg.msg_namelen = sizeof(addr);
+    msg.msg_iov     = &iov;
+    msg.msg_iovlen  = 1;
+
+    if ((bytes = recvmsg(netif_fd, &msg, 0)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      if (errno == ENOBUFS)
+      {
+       /*
+        * The kernel dropped some notifications, so rebuild the list...
+	*/
+
+        NetIFUpdate = 1;
+	continue;
+      }
+
+      break;
+    }
+
+    if (bytes == 0)
+      break;
+
+   /*
+    * Only trust messages from the kernel...
+    */
+
+    if (msg.msg_namelen != sizeof(addr) || addr.nl_pid != 0)
+      continue;
+
+    if (msg.msg_flags & MSG_TRUNC)
+    {
+     /*
+      * Part of the message was lost, so rebuild the list...
+      */
+
+      NetIFUpdate = 1;
+      continue;
+    }
+
+   /*
+    * Changes are applied to the current list unless it needs to be rebuilt
+    * anyways...
+    */
+
+    if (NetIFUpdate || !NetIFList)
+      continue;
+
+    for (nlh = (struct nlmsghdr *)buffer, len = (int)bytes;
+         NLMSG_OK(nlh, len);
+	 nlh = NLMSG_NEXT(nlh, len))
+      if (nlh->nlmsg_type == RTM_NEWADDR || nlh->nlmsg_type == RTM_DELADDR)
+        netif_netlink(nlh);
+  }
 }
+#endif /* __linux */
 
 
 /*
@@ -34,8 +34,12 @@ typedef struct cupsd_netif_s		/**** Network interface data ****/
  * Globals...
  */
 
-VAR int			NetIFUpdate	VALUE(1);
+VAR int			NetIFUpdate	VALUE(1),
 					/* Network interface list needs updating */
+			NetIFMonitor	VALUE(0);
+					/* Monitoring network interface changes? */
+VAR int			NetIFGeneration	VALUE(0);
+					/* Network interface list generation */
 VAR cups_array_t	*NetIFList	VALUE(NULL);
 					/* Array of network interfaces */
 
@@ -44,6 +48,10 @@ VAR cups_array_t	*NetIFList	VALUE(NULL);
  */
 
 extern cupsd_netif_t	*cupsdNetIFFind(const char *name);
+extern cupsd_netif_t	*cupsdNetIFFindAddress(http_addr_t *address);
+extern cupsd_netif_t	*cupsdNetIFFindHostname(const char *hostname);
+extern void		cupsdNetIFStartMonitor(void);
+extern void		cupsdNetIFStopMonitor(void);
 extern void		cupsdNetIFUpdate(void);
 
 
@@ -21,10 +21,13 @@
  *   cupsdDeleteAllPolicies() - Delete all policies in memory.
  *   cupsdFindPolicy()        - Find a named policy.
  *   cupsdFindPolicyOp()      - Find a policy operation.
+ *   cupsdFlushPolicyCache()  - Flush the cached policy decisions.
  *   cupsdGetPrivateAttrs()   - Get the private attributes for the current
  *                              request.
+ *   check_private_access()   - Check a user against a private access list.
  *   compare_ops()            - Compare two operations.
  *   compare_policies()       - Compare two policies.
+ *   find_cache()             - Find a cached policy decision.
  *   free_policy()            - Free the memory used by a policy.
  *   hash_op()                - Generate a lookup hash for the operation.
  */
@@ -37,12 +40,47 @@
 #include <pwd.h>
 
 
+/*
+ * Local structures...
+ */
+
+#define CUPSD_PCACHE_MAX	32	/* Maximum number of cached decisions */
+
+#define CUPSD_PCACHE_ACCESS	1	/* User is in the access list */
+#define CUPSD_PCACHE_OWNER	2	/* Access list contains @OWNER */
+#define CUPSD_PCACHE_CHECKED	4	/* Access list was checked */
+
+typedef struct cupsd_pcache_s		/**** Cached policy decision ****/
+{
+  void		*key;			/* Policy operation or access list */
+  cupsd_printer_t *printer;		/* Printer, if any */
+  char		*owner;			/* Owner of object, if any */
+  int		result;			/* HTTP status or access bits */
+} cupsd_pcache_t;
+
+
+/*
+ * Local globals...
+ */
+
+static cupsd_client_t	*pcache_con = NULL;
+					/* Connection for cached decisions */
+static int		num_pcache = 0;	/* Number of cached decisions */
+static cupsd_pcache_t	pcache[CUPSD_PCACHE_MAX];
+					/* Cached decisions */
+
+
 /*
  * Local functions...
  */
 
+static int	check_private_access(cups_array_t *access_ptr,
+		                     cupsd_printer_t *printer,
+				     const char *username);
 static int	compare_ops(cupsd_location_t *a, cupsd_location_t *b);
 static int	compare_policies(cupsd_policy_t *a, cupsd_policy_t *b);
+static cupsd_pcache_t *find_cache(cupsd_client_t *con, void *key,
+		                  cupsd_printer_t *printer, const char *owner);
 static void	free_policy(cupsd_policy_t *p);
 static int	hash_op(cupsd_location_t *op);
 
@@ -128,6 +166,7 @@ cupsdCheckPolicy(cupsd_policy_t *p,	/* I - Policy */
 	         const char     *owner)	/* I - Owner of object */
 {
   cupsd_location_t	*po;		/* Current policy operation */
+  cupsd_pcache_t	*pc;		/* Cached decision */
 
 
  /*
@@ -154,10 +193,17 @@ cupsdCheckPolicy(cupsd_policy_t *p,	/* I - Policy */
   con->best = po;
 
  /*
-  * Return the status of the check...
+  * Return the status of the check, reusing the result for other objects with
+  * the same owner in the current request...
   */
 
-  return (cupsdIsAuthorized(con, owner));
+  if ((pc = find_cache(con, po, NULL, owner)) == NULL)
+    return (cupsdIsAuthorized(con, owner));
+
+  if (!pc->result)
+    pc->result = cupsdIsAuthorized(con, owner);
+
+  return ((http_status_t)pc->result);
 }
 
 
@@ -174,6 +220,9 @@ cupsdDeleteAllPolicies(void)
   if (!Policies)
     return;
 
+  cupsdFlushPolicyCache();
+  cupsdFlushAttrFilters();
+
  /*
   * First clear the policy pointers for all printers...
   */
@@ -269,6 +318,23 @@ cupsdFindPolicyOp(cupsd_policy_t *p,	/* I - Policy */
 }
 
 
+/*
+ * 'cupsdFlushPolicyCache()' - Flush the cached policy decisions.
+ *
+ * Decisions are cached for the current request only, so this is called before
+ * processing each IPP request and whenever the policies change.
+ */
+
+void
+cupsdFlushPolicyCache(void)
+{
+  for (; num_pcache > 0; num_pcache --)
+    _cupsStrFree(pcache[num_pcache - 1].owner);
+
+  pcache_con = NULL;
+}
+
+
 /*
  * 'cupsdGetPrivateAttrs()' - Get the private attributes for the current
  *                            request.
@@ -286,7 +352,8 @@ cupsdGetPrivateAttrs(
 		*attrs_ptr;		/* Attributes array */
   const char	*username;		/* Username associated with request */
   ipp_attribute_t *attr;		/* Attribute from request */
-  struct passwd	*pw;			/* User info */
+  cupsd_pcache_t *pc;			/* Cached decision */
+  int		access;			/* Access bits */
 
 
 #ifdef DEBUG
@@ -346,6 +413,58 @@ cupsdGetPrivateAttrs(
   else
     username = "anonymous";
 
+ /*
+  * The user and group checks don't depend on the owner, so use the result
+  * from a previous object in this request if we have one...
+  */
+
+  if ((pc = find_cache(con, access_ptr, printer, NULL)) != NULL &&
+      pc->result)
+    access = pc->result;
+  else
+    access = check_private_access(access_ptr, printer, username);
+
+  if (pc)
+    pc->result = access;
+
+  if ((access & CUPSD_PCACHE_ACCESS) ||
+      ((access & CUPSD_PCACHE_OWNER) && owner &&
+       !_cups_strcasecmp(username, owner)))
+  {
+#ifdef DEBUG
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdGetPrivateAttrs: Returning NULL.");
+#endif /* DEBUG */
+
+    return (NULL);
+  }
+
+ /*
+  * No direct access, so return private attributes list...
+  */
+
+#ifdef DEBUG
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdGetPrivateAttrs: Returning list.");
+#endif /* DEBUG */
+
+  return (attrs_ptr);
+}
+
+
+/*
+ * 'check_private_access()' - Check a user against a private access list.
+ */
+
+static int				/* O - Access bits */
+check_private_access(
+    cups_array_t    *access_ptr,	/* I - Access array */
+    cupsd_printer_t *printer,		/* I - Printer, if any */
+    const char      *username)		/* I - Username */
+{
+  char		*name;			/* Current name in access list */
+  struct passwd	*pw;			/* User info */
+  int		access;			/* Access bits */
+
+
   if (username[0])
   {
     pw = getpwnam(username);
@@ -355,20 +474,18 @@ cupsdGetPrivateAttrs(
     pw = NULL;
 
 #ifdef DEBUG
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdGetPrivateAttrs: username=\"%s\"",
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "check_private_access: username=\"%s\"",
                   username);
 #endif /* DEBUG */
 
- /*
-  * Otherwise check the user against the access list...
-  */
+  access = CUPSD_PCACHE_CHECKED;
 
   for (name = (char *)cupsArrayFirst(access_ptr);
        name;
        name = (char *)cupsArrayNext(access_ptr))
   {
 #ifdef DEBUG
-    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdGetPrivateAttrs: name=%s", name);
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "check_private_access: name=%s", name);
 #endif /* DEBUG */
 
     if (printer && !_cups_strcasecmp(name, "@ACL"))
@@ -401,15 +518,13 @@ cupsdGetPrivateAttrs(
 	  break;
       }
     }
-    else if (owner && !_cups_strcasecmp(name, "@OWNER") &&
-             !_cups_strcasecmp(username, owner))
+    else if (!_cups_strcasecmp(name, "@OWNER"))
     {
-#ifdef DEBUG
-      cupsdLogMessage(CUPSD_LOG_DEBUG2,
-		      "cupsdGetPrivateAttrs: Returning NULL.");
-#endif /* DEBUG */
+     /*
+      * The owner is checked by the caller for each object...
+      */
 
-      return (NULL);
+      access |= CUPSD_PCACHE_OWNER;
     }
     else if (!_cups_strcasecmp(name, "@SYSTEM"))
     {
@@ -417,46 +532,18 @@ cupsdGetPrivateAttrs(
 
       for (i = 0; i < NumSystemGroups; i ++)
 	if (cupsdCheckGroup(username, pw, SystemGroups[i]))
-	{
-#ifdef DEBUG
-	  cupsdLogMessage(CUPSD_LOG_DEBUG2,
-	                  "cupsdGetPrivateAttrs: Returning NULL.");
-#endif /* DEBUG */
-
-	  return (NULL);
-	}
+	  return (access | CUPSD_PCACHE_ACCESS);
     }
     else if (name[0] == '@')
     {
       if (cupsdCheckGroup(username, pw, name + 1))
-      {
-#ifdef DEBUG
-        cupsdLogMessage(CUPSD_LOG_DEBUG2,
-	                "cupsdGetPrivateAttrs: Returning NULL.");
-#endif /* DEBUG */
-
-	return (NULL);
-      }
+	return (access | CUPSD_PCACHE_ACCESS);
     }
     else if (!_cups_strcasecmp(username, name))
-    {
-#ifdef DEBUG
-      cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdGetPrivateAttrs: Returning NULL.");
-#endif /* DEBUG */
-
-      return (NULL);
-    }
+      return (access | CUPSD_PCACHE_ACCESS);
   }
 
- /*
-  * No direct access, so return private attributes list...
-  */
-
-#ifdef DEBUG
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdGetPrivateAttrs: Returning list.");
-#endif /* DEBUG */
-
-  return (attrs_ptr);
+  return (access);
 }
 
 
@@ -484,6 +571,59 @@ compare_policies(cupsd_policy_t *a,	/* I - First policy */
 }
 
 
+/*
+ * 'find_cache()' - Find a cached policy decision.
+ *
+ * Returns a new entry with a zero result if the decision has not been cached
+ * yet, or NULL if the cache is full.
+ */
+
+static cupsd_pcache_t *			/* O - Cached decision or NULL */
+find_cache(cupsd_client_t  *con,	/* I - Client connection */
+           void            *key,	/* I - Policy operation or access list */
+	   cupsd_printer_t *printer,	/* I - Printer, if any */
+	   const char      *owner)	/* I - Owner of object, if any */
+{
+  int			i;		/* Looping var */
+  cupsd_pcache_t	*pc;		/* Current decision */
+
+
+ /*
+  * Decisions depend on the client's username, address, and authentication,
+  * so only use them for the same connection...
+  */
+
+  if (con != pcache_con)
+  {
+    cupsdFlushPolicyCache();
+
+    pcache_con = con;
+  }
+
+  for (i = num_pcache, pc = pcache; i > 0; i --, pc ++)
+    if (pc->key == key && pc->printer == printer &&
+        (pc->owner ? owner && !strcmp(pc->owner, owner) : !owner))
+      return (pc);
+
+  if (num_pcache >= CUPSD_PCACHE_MAX)
+    return (NULL);
+
+  pc = pcache + num_pcache;
+
+  pc->key     = key;
+  pc->printer = printer;
+  pc->owner   = owner ? _cupsStrAlloc(owner) : NULL;
+  pc->result  = 0;
+
+  if (owner && !pc->owner)
+    return (NULL);
+
+  num_pcache ++;
+
+  return (pc);
+}
+
+
 /*
  * 'free_policy()' - Free the memory used by a policy.
  */
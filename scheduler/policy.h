@@ -52,6 +52,7 @@ extern http_status_t	cupsdCheckPolicy(cupsd_policy_t *p, cupsd_client_t *con,
 extern void		cupsdDeleteAllPolicies(void);
 extern cupsd_policy_t	*cupsdFindPolicy(const char *policy);
 extern cupsd_location_t	*cupsdFindPolicyOp(cupsd_policy_t *p, ipp_op_t op);
+extern void		cupsdFlushPolicyCache(void);
 extern cups_array_t	*cupsdGetPrivateAttrs(cupsd_policy_t *p,
 			                      cupsd_client_t *con,
 					      cupsd_printer_t *printer,
@@ -21,9 +21,15 @@
  *   cupsdFindDest()            - Find a destination in the list.
  *   cupsdFindPrinter()         - Find a printer in the list.
  *   cupsdLoadAllPrinters()     - Load printers from the printers.conf file.
+ *   cupsdLoadPrinterState()    - Load the saved state of a printer or class.
+ *   cupsdMarkPrinterStateDirty() - Mark the state of a printer or class as
+ *                                needing a write.
+ *   cupsdRemovePrinterState()  - Remove the state file for a printer or
+ *                                class.
  *   cupsdRenamePrinter()       - Rename a printer.
  *   cupsdSaveAllPrinters()     - Save all printer definitions to the
  *                                printers.conf file.
+ *   cupsdSavePrinterState()    - Save the state of a printer or class.
  *   cupsdSetAuthInfoRequired() - Set the required authentication info.
  *   cupsdSetDeviceURI()        - Set the device URI for a printer.
  *   cupsdSetPrinterAttr()      - Set a printer attribute.
@@ -44,8 +50,8 @@
  *                                printer.
  *   compare_printers()         - Compare two printers.
  *   delete_printer_filters()   - Delete all MIME filters for a printer.
- *   dirty_printer()            - Mark config and state files dirty for the
- *                                specified printer.
+ *   dirty_printer()            - Mark state files dirty for the specified
+ *                                printer.
  *   load_ppd()                 - Load a cached PPD file, updating the cache as
  *                                needed.
  *   new_media_col()            - Create a media-col collection value.
@@ -53,6 +59,9 @@
  *                                desktop tools.
  *   write_irix_state()         - Update the status files used by IRIX printing
  *                                desktop tools.
+ *   write_markers()            - Write the marker attributes for a printer.
+ *   write_state()              - Write the state, state message, state time,
+ *                                and reasons for a printer or class.
  *   write_xml_string()         - Write a string with XML escaping.
  */
 
@@ -100,6 +109,8 @@ static ipp_t	*new_media_col(_pwg_size_t *size, const char *source,
 static void	write_irix_config(cupsd_printer_t *p);
 static void	write_irix_state(cupsd_printer_t *p);
 #endif /* __sgi */
+static void	write_markers(cups_file_t *fp, cupsd_printer_t *p);
+static void	write_state(cups_file_t *fp, cupsd_printer_t *p);
 static void	write_xml_string(cups_file_t *fp, const char *s);
 
 
@@ -904,6 +915,8 @@ cupsdLoadAllPrinters(void)
 			*value,		/* Pointer to value */
 			*valueptr;	/* Pointer into value */
   cupsd_printer_t	*p;		/* Current printer */
+  struct stat		fileinfo;	/* printers.conf file information */
+  time_t		conftime;	/* printers.conf modification time */
 
 
  /*
@@ -914,6 +927,11 @@ cupsdLoadAllPrinters(void)
   if ((fp = cupsdOpenConfFile(line)) == NULL)
     return;
 
+  if (stat(line, &fileinfo))
+    conftime = 0;
+  else
+    conftime = fileinfo.st_mtime;
+
  /*
   * Read printer configurations until we hit EOF...
   */
@@ -965,6 +983,7 @@ cupsdLoadAllPrinters(void)
         * Close out the current printer...
 	*/
 
+        cupsdLoadPrinterState(p, conftime);
         cupsdSetPrinterAttrs(p);
 
         if (strncmp(p->device_uri, "file:", 5) &&
@@ -1331,6 +1350,176 @@ cupsdLoadAllPrinters(void)
 }
 
 
+/*
+ * 'cupsdLoadPrinterState()' - Load the saved state of a printer or class.
+ *
+ * The state file is only used when it is newer than the printers.conf or
+ * classes.conf file the printer or class was loaded from.
+ */
+
+void
+cupsdLoadPrinterState(
+    cupsd_printer_t *p,			/* I - Printer or class */
+    time_t          conftime)		/* I - Time configuration file was saved */
+{
+  int		i;			/* Looping var */
+  cups_file_t	*fp;			/* State file */
+  int		linenum;		/* Current line number */
+  char		filename[1024],		/* State filename */
+		line[4096],		/* Line from file */
+		*value,			/* Pointer to value */
+		*valueptr;		/* Pointer into value */
+  struct stat	fileinfo;		/* State file information */
+
+
+  snprintf(filename, sizeof(filename), "%s/%s.state", CacheDir, p->name);
+
+  if (stat(filename, &fileinfo))
+    return;
+
+ /*
+  * Remember the file so that it gets removed by the next full save...
+  */
+
+  p->state_saved = 1;
+
+  if (fileinfo.st_mtime < conftime)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Ignoring old state file \"%s\".",
+                    filename);
+    return;
+  }
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to open \"%s\": %s", filename,
+                    strerror(errno));
+    return;
+  }
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Loading state file \"%s\"...", filename);
+
+ /*
+  * The state file replaces the state and reasons from the configuration
+  * file...
+  */
+
+  for (i = 0; i < p->num_reasons; i ++)
+    _cupsStrFree(p->reasons[i]);
+
+  p->num_reasons      = 0;
+  p->state_message[0] = '\0';
+
+  linenum = 0;
+
+  while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
+  {
+    if (!value)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Syntax error on line %d of %s.",
+                      linenum, filename);
+    }
+    else if (!_cups_strcasecmp(line, "State"))
+    {
+      if (!_cups_strcasecmp(value, "stopped"))
+        p->state = IPP_PRINTER_STOPPED;
+      else
+        p->state = IPP_PRINTER_IDLE;
+    }
+    else if (!_cups_strcasecmp(line, "StateMessage"))
+      strlcpy(p->state_message, value, sizeof(p->state_message));
+    else if (!_cups_strcasecmp(line, "StateTime"))
+      p->state_time = atoi(value);
+    else if (!_cups_strcasecmp(line, "Reason"))
+    {
+      if (p->num_reasons < (int)(sizeof(p->reasons) / sizeof(p->reasons[0])))
+        p->reasons[p->num_reasons ++] = _cupsStrAlloc(value);
+    }
+    else if (!_cups_strcasecmp(line, "Attribute"))
+    {
+      for (valueptr = value; *valueptr && !isspace(*valueptr & 255); valueptr ++);
+
+      for (; *valueptr && isspace(*valueptr & 255); *valueptr++ = '\0');
+
+      if (!*valueptr)
+        cupsdLogMessage(CUPSD_LOG_ERROR, "Syntax error on line %d of %s.",
+	                linenum, filename);
+      else
+      {
+        if (!p->attrs)
+	  cupsdSetPrinterAttrs(p);
+
+        if (!strcmp(value, "marker-change-time"))
+	  p->marker_time = atoi(valueptr);
+	else
+          cupsdSetPrinterAttr(p, value, valueptr);
+      }
+    }
+    else
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Unknown directive %s on line %d of %s.", line, linenum,
+		      filename);
+  }
+
+  cupsFileClose(fp);
+
+ /*
+  * Stopped queues always have the "paused" reason...
+  */
+
+  if (p->state == IPP_PRINTER_STOPPED)
+  {
+    for (i = 0; i < p->num_reasons; i ++)
+      if (!strcmp(p->reasons[i], "paused"))
+        break;
+
+    if (i >= p->num_reasons &&
+        p->num_reasons < (int)(sizeof(p->reasons) / sizeof(p->reasons[0])))
+      p->reasons[p->num_reasons ++] = _cupsStrAlloc("paused");
+  }
+}
+
+
+/*
+ * 'cupsdMarkPrinterStateDirty()' - Mark the state of a printer or class as
+ *                                  needing a write.
+ */
+
+void
+cupsdMarkPrinterStateDirty(
+    cupsd_printer_t *p)			/* I - Printer or class */
+{
+  p->state_dirty = 1;
+
+  cupsdMarkDirty(CUPSD_DIRTY_STATE);
+}
+
+
+/*
+ * 'cupsdRemovePrinterState()' - Remove the state file for a printer or class.
+ *
+ * The files are removed by the writer thread after any configuration files
+ * that are already queued, so the state is not lost before printers.conf or
+ * classes.conf is in place.
+ */
+
+void
+cupsdRemovePrinterState(
+    cupsd_printer_t *p)			/* I - Printer or class */
+{
+  char	filename[1024];			/* State filename */
+
+
+  snprintf(filename, sizeof(filename), "%s/%s.state", CacheDir, p->name);
+  cupsdQueueRemoveFile(filename);
+
+  snprintf(filename, sizeof(filename), "%s/%s.state.O", CacheDir, p->name);
+  cupsdQueueRemoveFile(filename);
+
+  p->state_saved = 0;
+}
+
+
 /*
  * 'cupsdRenamePrinter()' - Rename a printer.
  */
@@ -1348,6 +1537,16 @@ cupsdRenamePrinter(
                   "cupsdRenamePrinter: Removing %s from Printers", p->name);
   cupsArrayRemove(Printers, p);
 
+ /*
+  * Remove the state file for the old name; the state is saved again under
+  * the new name...
+  */
+
+  if (p->state_saved)
+    cupsdRemovePrinterState(p);
+
+  cupsdMarkPrinterStateDirty(p);
+
  /*
   * Rename the printer type...
   */
@@ -1396,13 +1595,11 @@ cupsdSaveAllPrinters(void)
   char			filename[1024],	/* printers.conf filename */
 			temp[1024],	/* Temporary string */
 			value[2048],	/* Value string */
-			*ptr,		/* Pointer into value */
 			*name;		/* Current user/group name */
   cupsd_printer_t	*printer;	/* Current printer class */
   time_t		curtime;	/* Current time */
   struct tm		*curdate;	/* Current date */
   cups_option_t		*option;	/* Current option */
-  ipp_attribute_t	*marker;	/* Current marker attribute */
 
 
  /*
@@ -1494,23 +1691,7 @@ cupsdSaveAllPrinters(void)
     if (printer->port_monitor)
       cupsFilePutConf(fp, "PortMonitor", printer->port_monitor);
 
-    if (printer->state == IPP_PRINTER_STOPPED)
-    {
-      cupsFilePuts(fp, "State Stopped\n");
-
-      if (printer->state_message)
-        cupsFilePutConf(fp, "StateMessage", printer->state_message);
-    }
-    else
-      cupsFilePuts(fp, "State Idle\n");
-
-    cupsFilePrintf(fp, "StateTime %d\n", (int)printer->state_time);
-
-    for (i = 0; i < printer->num_reasons; i ++)
-      if (strcmp(printer->reasons[i], "connecting-to-device") &&
-          strcmp(printer->reasons[i], "cups-insecure-filter-warning") &&
-          strcmp(printer->reasons[i], "cups-missing-filter-warning"))
-        cupsFilePutConf(fp, "Reason", printer->reasons[i]);
+    write_state(fp, printer);
 
     cupsFilePrintf(fp, "Type %d\n", printer->type);
 
@@ -1550,124 +1731,80 @@ cupsdSaveAllPrinters(void)
       cupsFilePutConf(fp, "Option", value);
     }
 
-    if ((marker = ippFindAttribute(printer->attrs, "marker-colors",
-                                   IPP_TAG_NAME)) != NULL)
-    {
-      snprintf(value, sizeof(value), "%s ", marker->name);
-
-      for (i = 0, ptr = value + strlen(value);
-           i < marker->num_values && ptr < (value + sizeof(value) - 1);
-	   i ++)
-      {
-        if (i)
-	  *ptr++ = ',';
+    write_markers(fp, printer);
 
-        strlcpy(ptr, marker->values[i].string.text,
-	        value + sizeof(value) - ptr);
-        ptr += strlen(ptr);
-      }
+    cupsFilePuts(fp, "</Printer>\n");
 
-      *ptr = '\0';
-      cupsFilePutConf(fp, "Attribute", value);
-    }
+#ifdef __sgi
+    /*
+     * Make IRIX desktop & printer status happy
+     */
 
-    if ((marker = ippFindAttribute(printer->attrs, "marker-levels",
-                                   IPP_TAG_INTEGER)) != NULL)
-    {
-      cupsFilePrintf(fp, "Attribute %s %d", marker->name,
-                     marker->values[0].integer);
-      for (i = 1; i < marker->num_values; i ++)
-        cupsFilePrintf(fp, ",%d", marker->values[i].integer);
-      cupsFilePuts(fp, "\n");
-    }
+    write_irix_state(printer);
+#endif /* __sgi */
+  }
 
-    if ((marker = ippFindAttribute(printer->attrs, "marker-low-levels",
-                                   IPP_TAG_INTEGER)) != NULL)
-    {
-      cupsFilePrintf(fp, "Attribute %s %d", marker->name,
-                     marker->values[0].integer);
-      for (i = 1; i < marker->num_values; i ++)
-        cupsFilePrintf(fp, ",%d", marker->values[i].integer);
-      cupsFilePuts(fp, "\n");
-    }
+  if (cupsdQueueCreatedConfFile(fp, filename))
+    return;
 
-    if ((marker = ippFindAttribute(printer->attrs, "marker-high-levels",
-                                   IPP_TAG_INTEGER)) != NULL)
-    {
-      cupsFilePrintf(fp, "Attribute %s %d", marker->name,
-                     marker->values[0].integer);
-      for (i = 1; i < marker->num_values; i ++)
-        cupsFilePrintf(fp, ",%d", marker->values[i].integer);
-      cupsFilePuts(fp, "\n");
-    }
+ /*
+  * printers.conf now has the current state of every printer, so remove any
+  * state files that have been written since the last save once it is in
+  * place...
+  */
 
-    if ((marker = ippFindAttribute(printer->attrs, "marker-message",
-                                   IPP_TAG_TEXT)) != NULL)
-    {
-      snprintf(value, sizeof(value), "%s %s", marker->name,
-               marker->values[0].string.text);
+  for (printer = (cupsd_printer_t *)cupsArrayFirst(Printers);
+       printer;
+       printer = (cupsd_printer_t *)cupsArrayNext(Printers))
+  {
+    if (printer->type & CUPS_PRINTER_CLASS)
+      continue;
 
-      cupsFilePutConf(fp, "Attribute", value);
-    }
+    printer->state_dirty = 0;
 
-    if ((marker = ippFindAttribute(printer->attrs, "marker-names",
-                                   IPP_TAG_NAME)) != NULL)
-    {
-      snprintf(value, sizeof(value), "%s ", marker->name);
+    if (printer->state_saved)
+      cupsdRemovePrinterState(printer);
+  }
+}
 
-      for (i = 0, ptr = value + strlen(value);
-           i < marker->num_values && ptr < (value + sizeof(value) - 1);
-	   i ++)
-      {
-        if (i)
-	  *ptr++ = ',';
 
-        strlcpy(ptr, marker->values[i].string.text,
-	        value + sizeof(value) - ptr);
-        ptr += strlen(ptr);
-      }
+/*
+ * 'cupsdSavePrinterState()' - Save the state of a printer or class.
+ *
+ * State changes are written to a small per-queue file in CacheDir so that
+ * printers.conf and classes.conf only need to be rewritten when the
+ * configuration changes.
+ */
 
-      *ptr = '\0';
-      cupsFilePutConf(fp, "Attribute", value);
-    }
+void
+cupsdSavePrinterState(
+    cupsd_printer_t *p)			/* I - Printer or class */
+{
+  cups_file_t	*fp;			/* State file */
+  char		filename[1024];		/* State filename */
 
-    if ((marker = ippFindAttribute(printer->attrs, "marker-types",
-                                   IPP_TAG_KEYWORD)) != NULL)
-    {
-      snprintf(value, sizeof(value), "%s ", marker->name);
 
-      for (i = 0, ptr = value + strlen(value);
-           i < marker->num_values && ptr < (value + sizeof(value) - 1);
-	   i ++)
-      {
-        if (i)
-	  *ptr++ = ',';
+  snprintf(filename, sizeof(filename), "%s/%s.state", CacheDir, p->name);
 
-        strlcpy(ptr, marker->values[i].string.text,
-	        value + sizeof(value) - ptr);
-        ptr += strlen(ptr);
-      }
+  if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm & 0600)) == NULL)
+    return;
 
-      *ptr = '\0';
-      cupsFilePutConf(fp, "Attribute", value);
-    }
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Saving %s.state...", p->name);
 
-    if (printer->marker_time)
-      cupsFilePrintf(fp, "Attribute marker-change-time %ld\n",
-                     (long)printer->marker_time);
+  cupsFilePrintf(fp, "# %s state file for " CUPS_SVERSION "\n",
+                 (p->type & CUPS_PRINTER_CLASS) ? "Class" : "Printer");
+  cupsFilePuts(fp, "# DO NOT EDIT THIS FILE WHEN CUPSD IS RUNNING\n");
 
-    cupsFilePuts(fp, "</Printer>\n");
+  write_state(fp, p);
 
-#ifdef __sgi
-    /*
-     * Make IRIX desktop & printer status happy
-     */
+  if (!(p->type & CUPS_PRINTER_CLASS))
+    write_markers(fp, p);
 
-    write_irix_state(printer);
-#endif /* __sgi */
+  if (!cupsdQueueCreatedConfFile(fp, filename))
+  {
+    p->state_dirty = 0;
+    p->state_saved = 1;
   }
-
-  cupsdCloseCreatedConfFile(fp, filename);
 }
 
 
@@ -3699,17 +3836,13 @@ delete_printer_filters(
 
 
 /*
- * 'dirty_printer()' - Mark config and state files dirty for the specified
- *                     printer.
+ * 'dirty_printer()' - Mark state files dirty for the specified printer.
  */
 
 static void
 dirty_printer(cupsd_printer_t *p)	/* I - Printer */
 {
-  if (p->type & CUPS_PRINTER_CLASS)
-    cupsdMarkDirty(CUPSD_DIRTY_CLASSES);
-  else
-    cupsdMarkDirty(CUPSD_DIRTY_PRINTERS);
+  cupsdMarkPrinterStateDirty(p);
 
   if (PrintcapFormat == PRINTCAP_PLIST)
     cupsdMarkDirty(CUPSD_DIRTY_PRINTCAP);
@@ -5299,6 +5432,162 @@ write_irix_state(cupsd_printer_t *p)	/* I - Printer to update */
 }
 #endif /* __sgi */
 
+/*
+ * 'write_markers()' - Write the marker attributes for a printer.
+ */
+
+static void
+write_markers(cups_file_t     *fp,	/* I - File to write to */
+              cupsd_printer_t *p)	/* I - Printer */
+{
+  int			i;		/* Looping var */
+  char			value[2048],	/* Value string */
+			*ptr;		/* Pointer into value */
+  ipp_attribute_t	*marker;	/* Current marker attribute */
+
+
+  if ((marker = ippFindAttribute(p->attrs, "marker-colors",
+                                 IPP_TAG_NAME)) != NULL)
+  {
+    snprintf(value, sizeof(value), "%s ", marker->name);
+
+    for (i = 0, ptr = value + strlen(value);
+         i < marker->num_values && ptr < (value + sizeof(value) - 1);
+	   i ++)
+    {
+      if (i)
+	  *ptr++ = ',';
+
+      strlcpy(ptr, marker->values[i].string.text,
+	        value + sizeof(value) - ptr);
+      ptr += strlen(ptr);
+    }
+
+    *ptr = '\0';
+    cupsFilePutConf(fp, "Attribute", value);
+  }
+
+  if ((marker = ippFindAttribute(p->attrs, "marker-levels",
+                                 IPP_TAG_INTEGER)) != NULL)
+  {
+    cupsFilePrintf(fp, "Attribute %s %d", marker->name,
+                   marker->values[0].integer);
+    for (i = 1; i < marker->num_values; i ++)
+      cupsFilePrintf(fp, ",%d", marker->values[i].integer);
+    cupsFilePuts(fp, "\n");
+  }
+
+  if ((marker = ippFindAttribute(p->attrs, "marker-low-levels",
+                                 IPP_TAG_INTEGER)) != NULL)
+  {
+    cupsFilePrintf(fp, "Attribute %s %d", marker->name,
+                   marker->values[0].integer);
+    for (i = 1; i < marker->num_values; i ++)
+      cupsFilePrintf(fp, ",%d", marker->values[i].integer);
+    cupsFilePuts(fp, "\n");
+  }
+
+  if ((marker = ippFindAttribute(p->attrs, "marker-high-levels",
+                                 IPP_TAG_INTEGER)) != NULL)
+  {
+    cupsFilePrintf(fp, "Attribute %s %d", marker->name,
+                   marker->values[0].integer);
+    for (i = 1; i < marker->num_values; i ++)
+      cupsFilePrintf(fp, ",%d", marker->values[i].integer);
+    cupsFilePuts(fp, "\n");
+  }
+
+  if ((marker = ippFindAttribute(p->attrs, "marker-message",
+                                 IPP_TAG_TEXT)) != NULL)
+  {
+    snprintf(value, sizeof(value), "%s %s", marker->name,
+             marker->values[0].string.text);
+
+    cupsFilePutConf(fp, "Attribute", value);
+  }
+
+  if ((marker = ippFindAttribute(p->attrs, "marker-names",
+                                 IPP_TAG_NAME)) != NULL)
+  {
+    snprintf(value, sizeof(value), "%s ", marker->name);
+
+    for (i = 0, ptr = value + strlen(value);
+         i < marker->num_values && ptr < (value + sizeof(value) - 1);
+	   i ++)
+    {
+      if (i)
+	  *ptr++ = ',';
+
+      strlcpy(ptr, marker->values[i].string.text,
+	        value + sizeof(value) - ptr);
+      ptr += strlen(ptr);
+    }
+
+    *ptr = '\0';
+    cupsFilePutConf(fp, "Attribute", value);
+  }
+
+  if ((marker = ippFindAttribute(p->attrs, "marker-types",
+                                 IPP_TAG_KEYWORD)) != NULL)
+  {
+    snprintf(value, sizeof(value), "%s ", marker->name);
+
+    for (i = 0, ptr = value + strlen(value);
+         i < marker->num_values && ptr < (value + sizeof(value) - 1);
+	   i ++)
+    {
+      if (i)
+	  *ptr++ = ',';
+
+      strlcpy(ptr, marker->values[i].string.text,
+	        value + sizeof(value) - ptr);
+      ptr += strlen(ptr);
+    }
+
+    *ptr = '\0';
+    cupsFilePutConf(fp, "Attribute", value);
+  }
+
+  if (p->marker_time)
+    cupsFilePrintf(fp, "Attribute marker-change-time %ld\n",
+                   (long)p->marker_time);
+}
+
+
+/*
+ * 'write_state()' - Write the state, state message, state time, and reasons
+ *                   for a printer or class.
+ */
+
+static void
+write_state(cups_file_t     *fp,	/* I - File to write to */
+            cupsd_printer_t *p)		/* I - Printer or class */
+{
+  int	i;				/* Looping var */
+
+
+  if (p->state == IPP_PRINTER_STOPPED)
+  {
+    cupsFilePuts(fp, "State Stopped\n");
+
+    if (p->state_message[0])
+      cupsFilePutConf(fp, "StateMessage", p->state_message);
+  }
+  else
+    cupsFilePuts(fp, "State Idle\n");
+
+  cupsFilePrintf(fp, "StateTime %d\n", (int)p->state_time);
+
+  if (p->type & CUPS_PRINTER_CLASS)
+    return;
+
+  for (i = 0; i < p->num_reasons; i ++)
+    if (strcmp(p->reasons[i], "connecting-to-device") &&
+        strcmp(p->reasons[i], "cups-insecure-filter-warning") &&
+        strcmp(p->reasons[i], "cups-missing-filter-warning"))
+      cupsFilePutConf(fp, "Reason", p->reasons[i]);
+}
+
 
 /*
  * 'write_xml_string()' - Write a string with XML escaping.
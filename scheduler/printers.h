@@ -78,6 +78,8 @@ struct cupsd_printer_s
   int		num_reasons;		/* Number of printer-state-reasons */
   char		*reasons[64];		/* printer-state-reasons strings */
   time_t	state_time;		/* Time at this state */
+  int		state_dirty,		/* Does the state file need a write? */
+		state_saved;		/* Is there a state file? */
   char		*job_sheets[2];		/* Banners/job sheets */
   cups_ptype_t	type;			/* Printer type (color, small, etc.) */
   char		*device_uri;		/* Device URI */
@@ -110,6 +112,9 @@ struct cupsd_printer_s
 		*alert_description;	/* PSX printer-alert-description value */
   time_t	marker_time;		/* Last time marker attributes were updated */
   _ppd_cache_t	*pc;			/* PPD cache and mapping data */
+  time_t	reg_time,		/* Time of last registration */
+		reg_update;		/* Time of pending registration update */
+  unsigned char	reg_digest[16];		/* Digest of registered services */
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
   char		*reg_name,		/* Name used for service registration */
@@ -158,9 +163,14 @@ extern cupsd_quota_t	*cupsdFindQuota(cupsd_printer_t *p,
 			                const char *username);
 extern void		cupsdFreeQuotas(cupsd_printer_t *p);
 extern void		cupsdLoadAllPrinters(void);
+extern void		cupsdLoadPrinterState(cupsd_printer_t *p,
+			                      time_t conftime);
+extern void		cupsdMarkPrinterStateDirty(cupsd_printer_t *p);
+extern void		cupsdRemovePrinterState(cupsd_printer_t *p);
 extern void		cupsdRenamePrinter(cupsd_printer_t *p,
 			                   const char *name);
 extern void		cupsdSaveAllPrinters(void);
+extern void		cupsdSavePrinterState(cupsd_printer_t *p);
 extern int		cupsdSetAuthInfoRequired(cupsd_printer_t *p,
 			                         const char *values,
 						 ipp_attribute_t *attr);
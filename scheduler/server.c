@@ -62,6 +62,7 @@ cupsdStartServer(void)
 
   cupsdStartListening();
   cupsdStartBrowsing();
+  cupsdNetIFStartMonitor();
 
  /*
   * Create a pipe for CGI processes...
@@ -112,6 +113,7 @@ cupsdStopServer(void)
   cupsdCloseAllClients();
   cupsdStopListening();
   cupsdStopBrowsing();
+  cupsdNetIFStopMonitor();
   cupsdStopAllNotifiers();
   cupsdDeleteAllCerts();
 
@@ -175,6 +177,8 @@ cupsdStopServer(void)
   if (DirtyFiles)
     cupsdCleanDirty();
 
+  cupsdWaitConfFiles(NULL);
+
   started = 0;
 }
 
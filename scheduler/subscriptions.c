@@ -16,22 +16,32 @@
  *
  *   cupsdAddEvent()               - Add an event to the global event cache.
  *   cupsdAddSubscription()        - Add a new subscription object.
+ *   cupsdCopyEvent()              - Copy an event notification for a
+ *                                   subscription.
  *   cupsdDeleteAllSubscriptions() - Delete all subscriptions.
  *   cupsdDeleteSubscription()     - Delete a subscription object.
  *   cupsdEventName()              - Return a single event name.
  *   cupsdEventValue()             - Return the event mask value for a name.
  *   cupsdExpireSubscriptions()    - Expire old subscription objects.
  *   cupsdFindSubscription()       - Find a subscription by ID.
+ *   cupsdFlushNotifications()     - Send queued events to the notifiers.
  *   cupsdLoadAllSubscriptions()   - Load all subscriptions from the .conf file.
  *   cupsdSaveAllSubscriptions()   - Save all subscriptions to the .conf file.
  *   cupsdStopAllNotifiers()       - Stop all notifier processes.
+ *   cupsd_append_notifier()       - Append IPP data to the notifier buffer.
+ *   cupsd_compare_subindex()      - Compare two subscription index buckets.
  *   cupsd_compare_subscriptions() - Compare two subscriptions.
- *   cupsd_delete_event()          - Delete a single event...
+ *   cupsd_delete_event()          - Release a single event...
+ *   cupsd_delete_pending()        - Free the events queued for a notifier.
+ *   cupsd_find_subindex()         - Find a subscription index bucket.
+ *   cupsd_index_subscription()    - Add a subscription to the indices.
  *   cupsd_send_dbus()             - Send a DBUS notification...
  *   cupsd_send_notification()     - Send a notification for the specified
  *                                   event.
  *   cupsd_start_notifier()        - Start a notifier subprocess...
+ *   cupsd_unindex_subscription()  - Remove a subscription from the indices.
  *   cupsd_update_notifier()       - Read messages from notifiers.
+ *   cupsd_write_notifier()        - Write queued events to a notifier.
  */
 
 /*
@@ -49,14 +59,47 @@
 #endif /* HAVE_DBUS */
 
 
+/*
+ * Local constants...
+ */
+
+#define CUPSD_EVENT_BITS	21	/* Number of bits in CUPSD_EVENT_ALL */
+
+
+/*
+ * Local structures...
+ */
+
+typedef struct cupsd_subindex_s		/**** Subscription index bucket ****/
+{
+  void		*key;			/* Printer or job */
+  cups_array_t	*subs;			/* Subscriptions, sorted by ID */
+} cupsd_subindex_t;
+
+typedef struct cupsd_pending_s		/**** Event queued for a notifier ****/
+{
+  cupsd_event_t	*event;			/* Event */
+  int		seq;			/* notify-sequence-number */
+} cupsd_pending_t;
+
+
 /*
  * Local functions...
  */
 
+static ssize_t	cupsd_append_notifier(cupsd_subscription_t *sub,
+		                      ipp_uchar_t *buffer, size_t bytes);
+static int	cupsd_compare_subindex(cupsd_subindex_t *first,
+		                       cupsd_subindex_t *second,
+				       void *unused);
 static int	cupsd_compare_subscriptions(cupsd_subscription_t *first,
 		                            cupsd_subscription_t *second,
 		                            void *unused);
 static void	cupsd_delete_event(cupsd_event_t *event);
+static void	cupsd_delete_pending(cupsd_subscription_t *sub);
+static cupsd_subindex_t *cupsd_find_subindex(cups_array_t **index, void *key,
+		                             int create);
+static void	cupsd_index_subscription(cupsd_subscription_t *sub);
 #ifdef HAVE_DBUS
 static void	cupsd_send_dbus(cupsd_eventmask_t event, cupsd_printer_t *dest,
 		                cupsd_job_t *job);
@@ -64,7 +107,27 @@ static void	cupsd_send_dbus(cupsd_eventmask_t event, cupsd_printer_t *dest,
 static void	cupsd_send_notification(cupsd_subscription_t *sub,
 		                        cupsd_event_t *event);
 static void	cupsd_start_notifier(cupsd_subscription_t *sub);
+static void	cupsd_unindex_subscription(cupsd_subscription_t *sub);
 static void	cupsd_update_notifier(void);
+static void	cupsd_write_notifier(cupsd_subscription_t *sub);
+
+
+/*
+ * Local globals...
+ *
+ * Each subscription is indexed by its job, by its printer if it has no job,
+ * or by each bit of its event mask otherwise, so that events only need to
+ * look at the subscriptions that can possibly match...
+ */
+
+static cups_array_t	*job_subscriptions = NULL,
+					/* Job subscriptions */
+			*dest_subscriptions = NULL,
+					/* Printer subscriptions */
+			*event_subscriptions[CUPSD_EVENT_BITS] = { NULL };
+					/* Other subscriptions by event */
+static cups_array_t	*notifier_subscriptions = NULL;
+					/* Subscriptions with queued events */
 
 
 /*
@@ -84,6 +147,10 @@ cupsdAddEvent(
   ipp_attribute_t	*attr;		/* Printer/job attribute */
   cupsd_event_t		*temp;		/* New event pointer */
   cupsd_subscription_t	*sub;		/* Current subscription */
+  cups_array_t		*subs;		/* Subscriptions for this event */
+  cupsd_subindex_t	*bucket;	/* Index bucket */
+  cupsd_printer_t	*jobdest;	/* Printer for job */
+  int			i;		/* Looping var */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
@@ -113,14 +180,58 @@ cupsdAddEvent(
     return;
   }
 
+ /*
+  * Collect the subscriptions that can match this event from the indices,
+  * sorted by ID.  Job events without a printer are also checked against the
+  * job's printer, since that is used once the first notification is made...
+  */
+
+  if ((subs = cupsArrayNew((cups_array_func_t)cupsd_compare_subscriptions,
+                           NULL)) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_CRIT, "Unable to allocate memory for event - %s",
+                    strerror(errno));
+    return;
+  }
+
+  if (job && (bucket = cupsd_find_subindex(&job_subscriptions, job,
+                                           0)) != NULL)
+    for (sub = (cupsd_subscription_t *)cupsArrayFirst(bucket->subs);
+	 sub;
+	 sub = (cupsd_subscription_t *)cupsArrayNext(bucket->subs))
+      cupsArrayAdd(subs, sub);
+
+  if (dest)
+    jobdest = dest;
+  else if (job)
+    jobdest = cupsdFindPrinter(job->dest);
+  else
+    jobdest = NULL;
+
+  if (jobdest && (bucket = cupsd_find_subindex(&dest_subscriptions, jobdest,
+                                               0)) != NULL)
+    for (sub = (cupsd_subscription_t *)cupsArrayFirst(bucket->subs);
+	 sub;
+	 sub = (cupsd_subscription_t *)cupsArrayNext(bucket->subs))
+      cupsArrayAdd(subs, sub);
+
+  for (i = 0; i < CUPSD_EVENT_BITS; i ++)
+    if (event & (1 << i))
+      for (sub = (cupsd_subscription_t *)cupsArrayFirst(event_subscriptions[i]);
+	   sub;
+	   sub = (cupsd_subscription_t *)cupsArrayNext(event_subscriptions[i]))
+	if (!cupsArrayFind(subs, sub))
+	  cupsArrayAdd(subs, sub);
+
  /*
   * Then loop through the subscriptions and add the event to the corresponding
-  * caches...
+  * caches.  A single event record is shared by all of the subscriptions, with
+  * the subscription attributes added by cupsdCopyEvent()...
   */
 
-  for (temp = NULL, sub = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions);
+  for (temp = NULL, sub = (cupsd_subscription_t *)cupsArrayFirst(subs);
        sub;
-       sub = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
+       sub = (cupsd_subscription_t *)cupsArrayNext(subs))
   {
    /*
     * Check if this subscription requires this event...
@@ -130,6 +241,16 @@ cupsdAddEvent(
         (sub->dest == dest || !sub->dest) &&
 	(sub->job == job || !sub->job))
     {
+      if (temp)
+      {
+       /*
+        * Already have the event record, just send it...
+	*/
+
+        cupsd_send_notification(sub, temp);
+	continue;
+      }
+
      /*
       * Need this event, so create a new event record...
       */
@@ -139,6 +260,7 @@ cupsdAddEvent(
 	cupsdLogMessage(CUPSD_LOG_CRIT,
 	                "Unable to allocate memory for event - %s",
         	        strerror(errno));
+	cupsArrayDelete(subs);
 	return;
       }
 
@@ -153,29 +275,13 @@ cupsdAddEvent(
         temp->dest = dest = cupsdFindPrinter(job->dest);
 
      /*
-      * Add common event notification attributes...
+      * Add common event notification attributes.  The notify-subscribed-event
+      * attribute must be first, see cupsdCopyEvent()...
       */
 
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_CHARSET,
-                   "notify-charset", NULL, "utf-8");
-
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_LANGUAGE,
-                   "notify-natural-language", NULL, "en-US");
-
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-	            "notify-subscription-id", sub->id);
-
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-	            "notify-sequence-number", sub->next_event_id);
-
       ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD,
 	           "notify-subscribed-event", NULL, cupsdEventName(event));
 
-      if (sub->user_data_len > 0)
-        ippAddOctetString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-	                  "notify-user-data", sub->user_data,
-			  sub->user_data_len);
-
       ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
 	            "printer-up-time", time(NULL));
 
@@ -300,8 +406,26 @@ cupsdAddEvent(
     }
   }
 
+  cupsArrayDelete(subs);
+
   if (temp)
+  {
+    if (temp->refs <= 0)
+    {
+      temp->refs = 1;
+      cupsd_delete_event(temp);
+    }
+
     cupsdMarkDirty(CUPSD_DIRTY_SUBSCRIPTIONS);
+
+   /*
+    * Wake up any Get-Notifications requests waiting for this event; the
+    * main loop sends the responses since we can be called from anywhere...
+    */
+
+    if (cupsArrayCount(NotifyWaitClients) > 0)
+      NotifyWaitEvents = 1;
+  }
   else
     cupsdLogMessage(CUPSD_LOG_DEBUG, "Discarding unused %s event...",
                     cupsdEventName(event));
@@ -440,6 +564,7 @@ cupsdAddSubscription(
   */
 
   cupsArrayAdd(Subscriptions, temp);
+  cupsd_index_subscription(temp);
 
  /*
   * For RSS subscriptions, run the notifier immediately...
@@ -452,6 +577,43 @@ cupsdAddSubscription(
 }
 
 
+/*
+ * 'cupsdCopyEvent()' - Copy an event notification for a subscription.
+ */
+
+void
+cupsdCopyEvent(
+    ipp_t                *ipp,		/* I - Destination message */
+    cupsd_subscription_t *sub,		/* I - Subscription object */
+    cupsd_event_t        *event,	/* I - Event */
+    int                  seq)		/* I - notify-sequence-number */
+{
+  ipp_attribute_t	*attr;		/* Current event attribute */
+
+
+  ippAddString(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_CHARSET,
+	       "notify-charset", NULL, "utf-8");
+
+  ippAddString(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_LANGUAGE,
+	       "notify-natural-language", NULL, "en-US");
+
+  ippAddInteger(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		"notify-subscription-id", sub->id);
+
+  ippAddInteger(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		"notify-sequence-number", seq);
+
+  for (attr = event->attrs->attrs; attr; attr = attr->next)
+  {
+    ippCopyAttribute(ipp, attr, 0);
+
+    if (attr == event->attrs->attrs && sub->user_data_len > 0)
+      ippAddOctetString(ipp, IPP_TAG_EVENT_NOTIFICATION, "notify-user-data",
+			sub->user_data, sub->user_data_len);
+  }
+}
+
+
 /*
  * 'cupsdDeleteAllSubscriptions()' - Delete all subscriptions.
  */
@@ -460,6 +622,7 @@ void
 cupsdDeleteAllSubscriptions(void)
 {
   cupsd_subscription_t	*sub;		/* Subscription */
+  int			i;		/* Looping var */
 
 
   if (!Subscriptions)
@@ -472,6 +635,21 @@ cupsdDeleteAllSubscriptions(void)
 
   cupsArrayDelete(Subscriptions);
   Subscriptions = NULL;
+
+  cupsArrayDelete(job_subscriptions);
+  job_subscriptions = NULL;
+
+  cupsArrayDelete(dest_subscriptions);
+  dest_subscriptions = NULL;
+
+  for (i = 0; i < CUPSD_EVENT_BITS; i ++)
+  {
+    cupsArrayDelete(event_subscriptions[i]);
+    event_subscriptions[i] = NULL;
+  }
+
+  cupsArrayDelete(notifier_subscriptions);
+  notifier_subscriptions = NULL;
 }
 
 
@@ -489,13 +667,18 @@ cupsdDeleteSubscription(
   */
 
   if (sub->pipe >= 0)
+  {
+    cupsdRemoveSelect(sub->pipe);
     close(sub->pipe);
+  }
 
  /*
   * Remove subscription from array...
   */
 
   cupsArrayRemove(Subscriptions, sub);
+  cupsArrayRemove(notifier_subscriptions, sub);
+  cupsd_unindex_subscription(sub);
 
  /*
   * Free memory...
@@ -506,6 +689,12 @@ cupsdDeleteSubscription(
 
   cupsArrayDelete(sub->events);
 
+  cupsd_delete_pending(sub);
+  cupsArrayDelete(sub->pending);
+
+  if (sub->buffer)
+    free(sub->buffer);
+
   free(sub);
 
  /*
@@ -716,6 +905,72 @@ cupsdFindSubscription(int id)		/* I - Subscription ID */
 }
 
 
+/*
+ * 'cupsdFlushNotifications()' - Send queued events to the notifiers.
+ */
+
+void
+cupsdFlushNotifications(void)
+{
+  cupsd_subscription_t	*sub;		/* Current subscription */
+  cupsd_pending_t	*pending;	/* Current queued event */
+  ipp_t			*message;	/* Notification message */
+  int			count;		/* Number of events */
+
+
+  for (sub = (cupsd_subscription_t *)cupsArrayFirst(notifier_subscriptions);
+       sub;
+       sub = (cupsd_subscription_t *)cupsArrayNext(notifier_subscriptions))
+  {
+   /*
+    * Wait for the previous batch to be written before starting another...
+    */
+
+    if (sub->bufpos < sub->bufused)
+      continue;
+
+    cupsArrayRemove(notifier_subscriptions, sub);
+
+   /*
+    * Encode all of the queued events into the buffer...
+    */
+
+    sub->bufused = sub->bufpos = 0;
+    count        = cupsArrayCount(sub->pending);
+
+    for (pending = (cupsd_pending_t *)cupsArrayFirst(sub->pending);
+         pending;
+	 pending = (cupsd_pending_t *)cupsArrayNext(sub->pending))
+    {
+      if ((message = ippNew()) != NULL)
+      {
+	cupsdCopyEvent(message, sub, pending->event, pending->seq);
+
+	if (ippWriteIO(sub, (ipp_iocb_t)cupsd_append_notifier, 1, NULL,
+	               message) != IPP_DATA)
+	  cupsdLogMessage(CUPSD_LOG_ERROR,
+	                  "Unable to send event %d for subscription %d (%s)!",
+			  pending->seq, sub->id, sub->recipient);
+
+	ippDelete(message);
+      }
+    }
+
+    cupsd_delete_pending(sub);
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                    "cupsdFlushNotifications: Sending %d events (%d bytes) "
+		    "for subscription %d.", count, (int)sub->bufused, sub->id);
+
+   /*
+    * Then write as much as the notifier will take right now...
+    */
+
+    cupsd_write_notifier(sub);
+  }
+}
+
+
 /*
  * 'cupsdLoadAllSubscriptions()' - Load all subscriptions from the .conf file.
  */
@@ -793,6 +1048,8 @@ cupsdLoadAllSubscriptions(void)
 
       if (delete_sub)
         cupsdDeleteSubscription(sub, 0);
+      else
+        cupsd_index_subscription(sub);
 
       sub        = NULL;
       delete_sub = 0;
@@ -1065,6 +1322,9 @@ cupsdLoadAllSubscriptions(void)
     }
   }
 
+  if (sub)
+    cupsd_index_subscription(sub);
+
   cupsFileClose(fp);
 }
 
@@ -1198,7 +1458,7 @@ cupsdSaveAllSubscriptions(void)
     cupsFilePuts(fp, "</Subscription>\n");
   }
 
-  cupsdCloseCreatedConfFile(fp, filename);
+  cupsdQueueCreatedConfFile(fp, filename);
 }
 
 
@@ -1220,7 +1480,13 @@ cupsdStopAllNotifiers(void)
     return;
 
  /*
-  * Yes, kill any processes that are left...
+  * Send any events that are still queued...
+  */
+
+  cupsdFlushNotifications();
+
+ /*
+  * Then kill any processes that are left...
   */
 
   for (sub = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions);
@@ -1230,8 +1496,11 @@ cupsdStopAllNotifiers(void)
     {
       cupsdEndProcess(sub->pid, 0);
 
+      cupsdRemoveSelect(sub->pipe);
       close(sub->pipe);
       sub->pipe = -1;
+
+      sub->bufused = sub->bufpos = 0;
     }
 
  /*
@@ -1254,6 +1523,61 @@ cupsdStopAllNotifiers(void)
 }
 
 
+/*
+ * 'cupsd_append_notifier()' - Append IPP data to the notifier buffer.
+ */
+
+static ssize_t				/* O - Number of bytes or -1 on error */
+cupsd_append_notifier(
+    cupsd_subscription_t *sub,		/* I - Subscription object */
+    ipp_uchar_t          *buffer,	/* I - Data to append */
+    size_t               bytes)		/* I - Number of bytes */
+{
+  if (sub->bufused + bytes > sub->bufsize)
+  {
+    char	*temp;			/* New buffer */
+    size_t	tempsize;		/* New size */
+
+
+    for (tempsize = sub->bufsize ? sub->bufsize : 4096;
+         tempsize < (sub->bufused + bytes);
+	 tempsize *= 2);
+
+    if ((temp = realloc(sub->buffer, tempsize)) == NULL)
+      return (-1);
+
+    sub->buffer  = temp;
+    sub->bufsize = tempsize;
+  }
+
+  memcpy(sub->buffer + sub->bufused, buffer, bytes);
+  sub->bufused += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+/*
+ * 'cupsd_compare_subindex()' - Compare two subscription index buckets.
+ */
+
+static int				/* O - Result of comparison */
+cupsd_compare_subindex(
+    cupsd_subindex_t *first,		/* I - First bucket */
+    cupsd_subindex_t *second,		/* I - Second bucket */
+    void             *unused)		/* I - Unused user data pointer */
+{
+  (void)unused;
+
+  if (first->key < second->key)
+    return (-1);
+  else if (first->key > second->key)
+    return (1);
+  else
+    return (0);
+}
+
+
 /*
  * 'cupsd_compare_subscriptions()' - Compare two subscriptions.
  */
@@ -1271,15 +1595,19 @@ cupsd_compare_subscriptions(
 
 
 /*
- * 'cupsd_delete_event()' - Delete a single event...
+ * 'cupsd_delete_event()' - Release a single event...
  *
  * Oldest events must be deleted first, otherwise the subscription cache
- * flushing code will not work properly.
+ * flushing code will not work properly.  The event is freed once the last
+ * subscription using it lets it go.
  */
 
 static void
 cupsd_delete_event(cupsd_event_t *event)/* I - Event to delete */
 {
+  if (-- event->refs > 0)
+    return;
+
  /*
   * Free memory...
   */
@@ -1289,6 +1617,125 @@ cupsd_delete_event(cupsd_event_t *event)/* I - Event to delete */
 }
 
 
+/*
+ * 'cupsd_delete_pending()' - Free the events queued for a notifier.
+ */
+
+static void
+cupsd_delete_pending(
+    cupsd_subscription_t *sub)		/* I - Subscription object */
+{
+  cupsd_pending_t	*pending;	/* Current queued event */
+
+
+  for (pending = (cupsd_pending_t *)cupsArrayFirst(sub->pending);
+       pending;
+       pending = (cupsd_pending_t *)cupsArrayNext(sub->pending))
+  {
+    cupsd_delete_event(pending->event);
+    free(pending);
+  }
+
+  cupsArrayClear(sub->pending);
+}
+
+
+/*
+ * 'cupsd_find_subindex()' - Find a subscription index bucket.
+ */
+
+static cupsd_subindex_t *		/* O - Bucket or NULL */
+cupsd_find_subindex(
+    cups_array_t **index,		/* IO - Index array */
+    void         *key,			/* I  - Printer or job */
+    int          create)		/* I  - Create bucket as needed? */
+{
+  cupsd_subindex_t	bkey,		/* Search key */
+			*bucket;	/* Matching bucket */
+
+
+  bkey.key = key;
+
+  if ((bucket = (cupsd_subindex_t *)cupsArrayFind(*index, &bkey)) != NULL ||
+      !create)
+    return (bucket);
+
+  if (!*index &&
+      (*index = cupsArrayNew((cups_array_func_t)cupsd_compare_subindex,
+                             NULL)) == NULL)
+    return (NULL);
+
+  if ((bucket = calloc(1, sizeof(cupsd_subindex_t))) == NULL)
+    return (NULL);
+
+  if ((bucket->subs = cupsArrayNew((cups_array_func_t)cupsd_compare_subscriptions,
+                                   NULL)) == NULL)
+  {
+    free(bucket);
+    return (NULL);
+  }
+
+  bucket->key = key;
+
+  cupsArrayAdd(*index, bucket);
+
+  return (bucket);
+}
+
+
+/*
+ * 'cupsd_index_subscription()' - Add a subscription to the indices.
+ */
+
+static void
+cupsd_index_subscription(
+    cupsd_subscription_t *sub)		/* I - Subscription object */
+{
+  int			i;		/* Looping var */
+  cupsd_subindex_t	*bucket;	/* Index bucket */
+
+
+  if (sub->job || sub->dest)
+  {
+    if (sub->job)
+      bucket = cupsd_find_subindex(&job_subscriptions, sub->job, 1);
+    else
+      bucket = cupsd_find_subindex(&dest_subscriptions, sub->dest, 1);
+
+    if (!bucket)
+    {
+      cupsdLogMessage(CUPSD_LOG_CRIT,
+		      "Unable to allocate memory for subscription #%d!",
+		      sub->id);
+      return;
+    }
+
+    if (!cupsArrayFind(bucket->subs, sub))
+      cupsArrayAdd(bucket->subs, sub);
+  }
+  else
+  {
+    for (i = 0; i < CUPSD_EVENT_BITS; i ++)
+      if (sub->mask & (1 << i))
+      {
+        if (!event_subscriptions[i] &&
+	    (event_subscriptions[i] =
+	         cupsArrayNew((cups_array_func_t)cupsd_compare_subscriptions,
+		              NULL)) == NULL)
+	{
+	  cupsdLogMessage(CUPSD_LOG_CRIT,
+			  "Unable to allocate memory for subscription #%d!",
+			  sub->id);
+	  return;
+	}
+
+        if (!cupsArrayFind(event_subscriptions[i], sub))
+	  cupsArrayAdd(event_subscriptions[i], sub);
+      }
+  }
+}
+
+
 #ifdef HAVE_DBUS
 /*
  * 'cupsd_send_dbus()' - Send a DBUS notification...
@@ -1378,7 +1825,7 @@ cupsd_send_notification(
     cupsd_subscription_t *sub,		/* I - Subscription object */
     cupsd_event_t        *event)	/* I - Event to send */
 {
-  ipp_state_t	state;			/* IPP event state */
+  cupsd_pending_t	*pending;	/* Queued event */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
@@ -1428,6 +1875,7 @@ cupsd_send_notification(
   */
 
   cupsArrayAdd(sub->events, event);
+  event->refs ++;
 
  /*
   * Deliver the event...
@@ -1435,51 +1883,81 @@ cupsd_send_notification(
 
   if (sub->recipient)
   {
-    for (;;)
-    {
-      if (sub->pipe < 0)
-	cupsd_start_notifier(sub);
+   /*
+    * Queue the event for the notifier; cupsdFlushNotifications() sends
+    * everything that was queued in one write once per pass through the
+    * main loop...
+    */
 
-      cupsdLogMessage(CUPSD_LOG_DEBUG2, "sub->pipe=%d", sub->pipe);
+    if (!sub->pending && (sub->pending = cupsArrayNew(NULL, NULL)) == NULL)
+    {
+      cupsdLogMessage(CUPSD_LOG_CRIT,
+                      "Unable to allocate memory for subscription #%d!",
+                      sub->id);
+      return;
+    }
 
-      if (sub->pipe < 0)
-	break;
+    if (!cupsArrayCount(sub->pending))
+    {
+      if (!notifier_subscriptions)
+        notifier_subscriptions = cupsArrayNew(NULL, NULL);
 
-      event->attrs->state = IPP_IDLE;
+      cupsArrayAdd(notifier_subscriptions, sub);
+    }
 
-      while ((state = ippWriteFile(sub->pipe, event->attrs)) != IPP_DATA)
-        if (state == IPP_ERROR)
-	  break;
+    if (event->event & CoalesceEvents)
+    {
+     /*
+      * Only send the latest event of this kind for the job or printer...
+      */
 
-      if (state == IPP_ERROR)
-      {
-        if (errno == EPIPE)
+      for (pending = (cupsd_pending_t *)cupsArrayLast(sub->pending);
+           pending;
+	   pending = (cupsd_pending_t *)cupsArrayPrev(sub->pending))
+        if (pending->event->event == event->event &&
+	    pending->event->job == event->job &&
+	    pending->event->dest == event->dest)
 	{
-	 /*
-	  * Notifier died, try restarting it...
-	  */
-
-          cupsdLogMessage(CUPSD_LOG_WARN,
-	                  "Notifier for subscription %d (%s) went away, "
-			  "retrying!",
-			  sub->id, sub->recipient);
-	  cupsdEndProcess(sub->pid, 0);
-
-	  close(sub->pipe);
-	  sub->pipe = -1;
-          continue;
+	  cupsArrayRemove(sub->pending, pending);
+	  cupsd_delete_event(pending->event);
+	  free(pending);
+	  break;
 	}
+    }
 
-        cupsdLogMessage(CUPSD_LOG_ERROR,
-	                "Unable to send event for subscription %d (%s)!",
-			sub->id, sub->recipient);
-      }
-
+    if (sub->bufpos < sub->bufused &&
+        cupsArrayCount(sub->pending) >= MaxEvents)
+    {
      /*
-      * If we get this far, break out of the loop...
+      * Drop the oldest event if the notifier can't keep up...
       */
 
-      break;
+      pending = (cupsd_pending_t *)cupsArrayFirst(sub->pending);
+
+      cupsdLogMessage(CUPSD_LOG_WARN,
+                      "Notifier for subscription %d (%s) is not keeping up, "
+		      "dropping event %d!", sub->id, sub->recipient,
+		      pending->seq);
+
+      cupsArrayRemove(sub->pending, pending);
+      cupsd_delete_event(pending->event);
+      free(pending);
+    }
+
+    if ((pending = calloc(1, sizeof(cupsd_pending_t))) == NULL)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Unable to queue event for subscription %d (%s)!",
+		      sub->id, sub->recipient);
+    }
+    else
+    {
+      pending->event = event;
+      pending->seq   = sub->next_event_id;
+
+      event->refs ++;
+
+      cupsArrayAdd(sub->pending, pending);
     }
   }
 
@@ -1614,6 +2092,46 @@ cupsd_start_notifier(
 }
 
 
+/*
+ * 'cupsd_unindex_subscription()' - Remove a subscription from the indices.
+ */
+
+static void
+cupsd_unindex_subscription(
+    cupsd_subscription_t *sub)		/* I - Subscription object */
+{
+  int			i;		/* Looping var */
+  cups_array_t		**index;	/* Index array */
+  cupsd_subindex_t	*bucket;	/* Index bucket */
+
+
+  if (sub->job || sub->dest)
+  {
+    index = sub->job ? &job_subscriptions : &dest_subscriptions;
+
+    if ((bucket = cupsd_find_subindex(index, sub->job ? (void *)sub->job :
+                                                        (void *)sub->dest,
+				      0)) != NULL)
+    {
+      cupsArrayRemove(bucket->subs, sub);
+
+      if (cupsArrayCount(bucket->subs) == 0)
+      {
+        cupsArrayRemove(*index, bucket);
+	cupsArrayDelete(bucket->subs);
+	free(bucket);
+      }
+    }
+  }
+  else
+  {
+    for (i = 0; i < CUPSD_EVENT_BITS; i ++)
+      if (sub->mask & (1 << i))
+        cupsArrayRemove(event_subscriptions[i], sub);
+  }
+}
+
+
 /*
  * 'cupsd_update_notifier()' - Read messages from notifiers.
  */
@@ -1637,6 +2155,89 @@ cupsd_update_notifier(void)
 }
 
 
+/*
+ * 'cupsd_write_notifier()' - Write queued events to a notifier.
+ */
+
+static void
+cupsd_write_notifier(
+    cupsd_subscription_t *sub)		/* I - Subscription object */
+{
+  ssize_t	bytes;			/* Bytes written */
+  int		retried = 0;		/* Restarted the notifier? */
+
+
+  while (sub->bufpos < sub->bufused)
+  {
+    if (sub->pipe < 0)
+      cupsd_start_notifier(sub);
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "sub->pipe=%d", sub->pipe);
+
+    if (sub->pipe < 0)
+      break;
+
+    if ((bytes = write(sub->pipe, sub->buffer + sub->bufpos,
+                       sub->bufused - sub->bufpos)) > 0)
+    {
+      sub->bufpos += (size_t)bytes;
+      continue;
+    }
+
+    if (bytes < 0 && errno == EINTR)
+      continue;
+
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+     /*
+      * Pipe is full, finish writing when the notifier catches up...
+      */
+
+      cupsdAddSelect(sub->pipe, NULL, (cupsd_selfunc_t)cupsd_write_notifier,
+                     sub);
+      return;
+    }
+
+    if (bytes < 0 && errno == EPIPE)
+    {
+     /*
+      * Notifier died, try restarting it if it didn't get any of this
+      * batch...
+      */
+
+      cupsdRemoveSelect(sub->pipe);
+      cupsdEndProcess(sub->pid, 0);
+
+      close(sub->pipe);
+      sub->pipe = -1;
+
+      if (!sub->bufpos && !retried)
+      {
+	cupsdLogMessage(CUPSD_LOG_WARN,
+			"Notifier for subscription %d (%s) went away, "
+			"retrying!", sub->id, sub->recipient);
+        retried = 1;
+	continue;
+      }
+    }
+
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+		    "Unable to send event for subscription %d (%s)!",
+		    sub->id, sub->recipient);
+    break;
+  }
+
+ /*
+  * The whole batch has been written or dropped...
+  */
+
+  if (sub->pipe >= 0)
+    cupsdRemoveSelect(sub->pipe);
+
+  sub->bufused = sub->bufpos = 0;
+}
+
+
 /*
  * End of "$Id: subscriptions.c 10253 2012-02-11 22:10:54Z mike $".
  */
@@ -77,9 +77,11 @@ typedef struct cupsd_event_s		/**** Event structure ****/
 {
   cupsd_eventmask_t	event;		/* Event */
   time_t		time;		/* Time of event */
-  ipp_t			*attrs;		/* Notification message */
+  ipp_t			*attrs;		/* Notification message, without the
+					 * subscription attributes */
   cupsd_printer_t	*dest;		/* Associated printer, if any */
   cupsd_job_t		*job;		/* Associated job, if any */
+  int			refs;		/* Number of subscriptions using event */
 } cupsd_event_t; 
 
 typedef struct cupsd_subscription_s	/**** Subscription structure ****/
@@ -102,6 +104,11 @@ typedef struct cupsd_subscription_s	/**** Subscription structure ****/
   int			first_event_id,	/* First event-id in cache */
 			next_event_id;	/* Next event-id to use */
   cups_array_t		*events;	/* Cached events */
+  cups_array_t		*pending;	/* Events waiting for the notifier */
+  char			*buffer;	/* Events being written to notifier */
+  size_t		bufsize,	/* Size of buffer */
+			bufused,	/* Bytes used in buffer */
+			bufpos;		/* Bytes written from buffer */
 } cupsd_subscription_t;
 
 
@@ -127,6 +134,8 @@ VAR cups_array_t *Subscriptions VALUE(NULL);
 					/* Active subscriptions */
 
 VAR int		MaxEvents VALUE(100);	/* Maximum number of events */
+VAR unsigned	CoalesceEvents VALUE(CUPSD_EVENT_NONE);
+					/* Events to coalesce for notifiers */
 
 VAR unsigned	LastEvent VALUE(0);	/* Last event(s) processed */
 VAR int		NotifierPipes[2] VALUE2(-1, -1);
@@ -145,6 +154,8 @@ extern cupsd_subscription_t *
 		cupsdAddSubscription(unsigned mask, cupsd_printer_t *dest,
 		                     cupsd_job_t *job, const char *uri,
 				     int sub_id);
+extern void	cupsdCopyEvent(ipp_t *ipp, cupsd_subscription_t *sub,
+		               cupsd_event_t *event, int seq);
 extern void	cupsdDeleteAllSubscriptions(void);
 extern void	cupsdDeleteSubscription(cupsd_subscription_t *sub, int update);
 extern const char *
@@ -156,6 +167,7 @@ extern cupsd_subscription_t *
 		cupsdFindSubscription(int id);
 extern void	cupsdExpireSubscriptions(cupsd_printer_t *dest,
 		                         cupsd_job_t *job);
+extern void	cupsdFlushNotifications(void);
 extern void	cupsdLoadAllSubscriptions(void);
 extern void	cupsdSaveAllSubscriptions(void);
 extern void	cupsdStopAllNotifiers(void);
@@ -48,6 +48,13 @@
 #endif /* __APPLE__ */
 
 
+/*
+ * Local constants...
+ */
+
+#define PRINTCAP_DEADLINE 300		/* Maximum delay for printcap writes */
+
+
 /*
  * The system management functions cover disk and power management which
  * are primarily used on portable computers.
@@ -72,6 +79,8 @@
 #ifdef kIOPMAssertionTypeDenySystemSleep
 static IOPMAssertionID	dark_wake = 0;	/* "Dark wake" assertion for sharing */
 #endif /* kIOPMAssertionTypeDenySystemSleep */
+static time_t		printcap_deadline = 0;
+					/* Latest time to write printcap */
 
 
 /*
@@ -87,9 +96,26 @@ cupsdCleanDirty(void)
   if (DirtyFiles & CUPSD_DIRTY_CLASSES)
     cupsdSaveAllClasses();
 
-  if (DirtyFiles & CUPSD_DIRTY_PRINTCAP)
+  if (DirtyFiles & CUPSD_DIRTY_STATE)
+  {
+    cupsd_printer_t	*p;		/* Current printer */
+
+    for (p = (cupsd_printer_t *)cupsArrayFirst(Printers);
+         p;
+	 p = (cupsd_printer_t *)cupsArrayNext(Printers))
+      if (p->state_dirty)
+        cupsdSavePrinterState(p);
+  }
+
+  if ((DirtyFiles & CUPSD_DIRTY_PRINTCAP) &&
+      (DoingShutdown || time(NULL) >= PrintcapTime))
+  {
     cupsdWritePrintcap();
 
+    DirtyFiles   &= ~CUPSD_DIRTY_PRINTCAP;
+    PrintcapTime = 0;
+  }
+
   if (DirtyFiles & CUPSD_DIRTY_JOBS)
   {
     cupsd_job_t	*job;			/* Current job */
@@ -106,7 +132,7 @@ cupsdCleanDirty(void)
   if (DirtyFiles & CUPSD_DIRTY_SUBSCRIPTIONS)
     cupsdSaveAllSubscriptions();
 
-  DirtyFiles     = CUPSD_DIRTY_NONE;
+  DirtyFiles     &= CUPSD_DIRTY_PRINTCAP;
   DirtyCleanTime = 0;
 
   cupsdSetBusyState();
@@ -120,20 +146,46 @@ cupsdCleanDirty(void)
 void
 cupsdMarkDirty(int what)		/* I - What file(s) are dirty? */
 {
-  cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdMarkDirty(%c%c%c%c%c)",
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdMarkDirty(%c%c%c%c%c%c)",
 		  (what & CUPSD_DIRTY_PRINTERS) ? 'P' : '-',
 		  (what & CUPSD_DIRTY_CLASSES) ? 'C' : '-',
 		  (what & CUPSD_DIRTY_PRINTCAP) ? 'p' : '-',
 		  (what & CUPSD_DIRTY_JOBS) ? 'J' : '-',
-		  (what & CUPSD_DIRTY_SUBSCRIPTIONS) ? 'S' : '-');
+		  (what & CUPSD_DIRTY_SUBSCRIPTIONS) ? 'S' : '-',
+		  (what & CUPSD_DIRTY_STATE) ? 's' : '-');
 
   if (what == CUPSD_DIRTY_PRINTCAP && !Printcap)
     return;
 
-  DirtyFiles |= what;
+  if (what & CUPSD_DIRTY_PRINTCAP)
+  {
+   /*
+    * The printcap file is regenerated from scratch, so wait until printers
+    * stop being added, deleted, or renamed before writing it, up to a
+    * deadline...
+    */
+
+    time_t	curtime = time(NULL);	/* Current time */
+
+    if (!(DirtyFiles & CUPSD_DIRTY_PRINTCAP))
+      printcap_deadline = curtime + PRINTCAP_DEADLINE;
+
+    DirtyFiles   |= CUPSD_DIRTY_PRINTCAP;
+    PrintcapTime = curtime + DirtyCleanInterval;
 
-  if (!DirtyCleanTime)
-    DirtyCleanTime = time(NULL) + DirtyCleanInterval;
+    if (PrintcapTime > printcap_deadline)
+      PrintcapTime = printcap_deadline;
+
+    what &= ~CUPSD_DIRTY_PRINTCAP;
+  }
+
+  if (what)
+  {
+    DirtyFiles |= what;
+
+    if (!DirtyCleanTime)
+      DirtyCleanTime = time(NULL) + DirtyCleanInterval;
+  }
 
   cupsdSetBusyState();
 }
@@ -171,7 +223,7 @@ cupsdSetBusyState(void)
   * Figure out how busy we are...
   */
 
-  newbusy = (DirtyCleanTime ? 1 : 0) |
+  newbusy = ((DirtyCleanTime || PrintcapTime) ? 1 : 0) |
 	    (cupsArrayCount(ActiveClients) ? 4 : 0);
 
   for (job = (cupsd_job_t *)cupsArrayFirst(PrintingJobs);
@@ -23,6 +23,7 @@
 #define CUPSD_DIRTY_PRINTCAP	4	/* printcap is dirty */
 #define CUPSD_DIRTY_JOBS	8	/* jobs.cache or "c" file(s) are dirty */
 #define CUPSD_DIRTY_SUBSCRIPTIONS 16	/* subscriptions.conf is dirty */
+#define CUPSD_DIRTY_STATE	32	/* Printer/class state file(s) are dirty */
 
 
 /*
@@ -33,8 +34,10 @@ VAR int			DirtyFiles	VALUE(CUPSD_DIRTY_NONE),
 					/* What files are dirty? */
 			DirtyCleanInterval VALUE(DEFAULT_KEEPALIVE);
 					/* How often do we write dirty files? */
-VAR time_t		DirtyCleanTime	VALUE(0);
+VAR time_t		DirtyCleanTime	VALUE(0),
 					/* When to clean dirty files next */
+			PrintcapTime	VALUE(0);
+					/* When to write printcap next */
 VAR int			Sleeping	VALUE(0);
 					/* Non-zero if machine is entering or *
 					 * in a sleep state...                */
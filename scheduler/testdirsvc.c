@@ -0,0 +1,326 @@
+/*
+ * "$Id$"
+ *
+ *   DNS-SD registration unit test for the CUPS scheduler.
+ *
+ *   Copyright 2012 by Apple Inc.
+ *
+ *   These coded instructions, statements, and computer programs are the
+ *   property of Apple Inc. and are protected by Federal copyright
+ *   law.  Distribution and use rights are outlined in the file "LICENSE.txt"
+ *   which should have been included with this file.  If this file is
+ *   file is missing or damaged, see the license at "http://www.cups.org/".
+ *
+ * Contents:
+ *
+ *   main()              - Test DNS-SD printer registration.
+ *   cupsdLogMessage()   - Log a message (stub).
+ *   test_deregister()   - Deregister a printer (fake).
+ *   test_digest()       - Compute a printer digest (fake).
+ *   test_register()     - Register a printer (fake).
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#define _MAIN_C_
+#include "cupsd.h"
+
+
+/*
+ * Local functions...
+ */
+
+static void	test_deregister(cupsd_printer_t *p, int clear_name);
+static void	test_digest(cupsd_printer_t *p, unsigned char digest[16]);
+static int	test_register(cupsd_printer_t *p);
+
+
+/*
+ * Local globals...
+ */
+
+static const cupsd_dnssd_ops_t test_ops =
+{					/* Fake DNS-SD registration functions */
+  test_digest,
+  test_register,
+  test_deregister
+};
+static int	num_deregisters = 0,	/* Number of deregistrations */
+		num_digests = 0,	/* Number of digests computed */
+		num_registers = 0;	/* Number of registrations */
+static unsigned char test_value = 0;	/* Value for digest */
+
+
+/*
+ * 'main()' - Test DNS-SD printer registration.
+ */
+
+int					/* O - Exit status */
+main(void)
+{
+  int			i;		/* Looping var */
+  int			status = 0;	/* Exit status */
+  cupsd_printer_t	*p;		/* Test printer */
+
+
+ /*
+  * Setup a single shared local printer with the fake registration
+  * functions...
+  */
+
+  Browsing             = 1;
+  BrowseLocalProtocols = BROWSE_DNSSD;
+  DNSSDOps             = &test_ops;
+  Printers             = cupsArrayNew(NULL, NULL);
+
+  p         = calloc(1, sizeof(cupsd_printer_t));
+  p->name   = "Test";
+  p->shared = 1;
+
+  cupsArrayAdd(Printers, p);
+
+ /*
+  * The first registration happens right away...
+  */
+
+  fputs("cupsdRegisterPrinter (new): ", stdout);
+
+  cupsdRegisterPrinter(p);
+
+  if (num_registers == 1 && p->reg_time && !p->reg_update)
+    puts("PASS");
+  else
+  {
+    printf("FAIL (%d registrations)\n", num_registers);
+    status = 1;
+  }
+
+ /*
+  * A burst of changes gets deferred to a single pending update...
+  */
+
+  fputs("cupsdRegisterPrinter (burst): ", stdout);
+
+  for (i = 0; i < 10; i ++)
+    cupsdRegisterPrinter(p);
+
+  if (num_registers == 1 && num_digests == 1 && p->reg_update &&
+      DNSSDUpdateTime == p->reg_update)
+    puts("PASS");
+  else
+  {
+    printf("FAIL (%d registrations, %d digests)\n", num_registers,
+           num_digests);
+    status = 1;
+  }
+
+ /*
+  * The pending update is skipped when nothing we advertise has changed...
+  */
+
+  fputs("cupsdUpdateDNSSDPrinters (unchanged): ", stdout);
+
+  p->reg_update = DNSSDUpdateTime = time(NULL) - 1;
+
+  cupsdUpdateDNSSDPrinters();
+
+  if (num_registers == 1 && num_digests == 2 && !p->reg_update &&
+      !DNSSDUpdateTime)
+    puts("PASS");
+  else
+  {
+    printf("FAIL (%d registrations, %d digests)\n", num_registers,
+           num_digests);
+    status = 1;
+  }
+
+ /*
+  * Another burst with an actual change coalesces into one registration...
+  */
+
+  fputs("cupsdUpdateDNSSDPrinters (changed): ", stdout);
+
+  p->reg_time = time(NULL);
+
+  for (i = 0; i < 10; i ++)
+  {
+    test_value ++;
+    cupsdRegisterPrinter(p);
+  }
+
+  p->reg_update = DNSSDUpdateTime = time(NULL) - 1;
+
+  cupsdUpdateDNSSDPrinters();
+  cupsdUpdateDNSSDPrinters();
+
+  if (num_registers == 2 && num_digests == 3 && num_deregisters == 2 &&
+      !p->reg_update)
+    puts("PASS");
+  else
+  {
+    printf("FAIL (%d registrations, %d digests, %d deregistrations)\n",
+           num_registers, num_digests, num_deregisters);
+    status = 1;
+  }
+
+ /*
+  * Disabling sharing removes the registration right away...
+  */
+
+  fputs("cupsdRegisterPrinter (not shared): ", stdout);
+
+  p->shared = 0;
+
+  cupsdRegisterPrinter(p);
+
+  if (num_registers == 2 && num_deregisters == 3 && !p->reg_time)
+    puts("PASS");
+  else
+  {
+    printf("FAIL (%d registrations, %d deregistrations)\n", num_registers,
+           num_deregisters);
+    status = 1;
+  }
+
+  cupsArrayDelete(Printers);
+  free(p);
+
+  return (status);
+}
+
+
+/*
+ * 'cupsdLogMessage()' - Log a message (stub).
+ */
+
+int					/* O - 1 on success, 0 on error */
+cupsdLogMessage(int        level,	/* I - Log level */
+                const char *message,	/* I - printf-style message string */
+	        ...)			/* I - Additional args as needed */
+{
+  (void)level;
+  (void)message;
+
+  return (1);
+}
+
+
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+/*
+ * Stubs for the scheduler functions the DNS-SD code uses; they are never
+ * called since the fake registration functions replace the real ones...
+ */
+
+int
+cupsdAddSelect(int             fd,
+               cupsd_selfunc_t read_cb,
+               cupsd_selfunc_t write_cb,
+	       void            *data)
+{
+  (void)fd; (void)read_cb; (void)write_cb; (void)data;
+  return (0);
+}
+
+void
+cupsdClearString(char **s)
+{
+  (void)s;
+}
+
+int
+cupsdDefaultAuthType(void)
+{
+  return (CUPSD_AUTH_BASIC);
+}
+
+int
+cupsdEndProcess(int pid,
+                int force)
+{
+  (void)pid; (void)force;
+  return (0);
+}
+
+cupsd_location_t *
+cupsdFindBest(const char   *path,
+              http_state_t state)
+{
+  (void)path; (void)state;
+  return (NULL);
+}
+
+cupsd_location_t *
+cupsdFindPolicyOp(cupsd_policy_t *p,
+                  ipp_op_t       op)
+{
+  (void)p; (void)op;
+  return (NULL);
+}
+
+void
+cupsdRemoveSelect(int fd)
+{
+  (void)fd;
+}
+
+void
+cupsdSetString(char       **s,
+               const char *v)
+{
+  (void)s; (void)v;
+}
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+
+
+/*
+ * 'test_deregister()' - Deregister a printer (fake).
+ */
+
+static void
+test_deregister(cupsd_printer_t *p,	/* I - Printer */
+                int             clear_name)
+					/* I - Clear the name? */
+{
+  (void)p;
+  (void)clear_name;
+
+  num_deregisters ++;
+}
+
+
+/*
+ * 'test_digest()' - Compute a printer digest (fake).
+ */
+
+static void
+test_digest(cupsd_printer_t *p,		/* I - Printer */
+            unsigned char   digest[16])	/* O - Digest */
+{
+  (void)p;
+
+  memset(digest, test_value, 16);
+
+  num_digests ++;
+}
+
+
+/*
+ * 'test_register()' - Register a printer (fake).
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+test_register(cupsd_printer_t *p)	/* I - Printer */
+{
+  (void)p;
+
+  num_registers ++;
+
+  return (1);
+}
+
+
+/*
+ * End of "$Id$".
+ */
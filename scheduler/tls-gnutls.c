@@ -14,17 +14,76 @@
  *
  * Contents:
  *
- *   cupsdEndTLS()	- Shutdown a secure session with the client.
- *   cupsdStartTLS()	- Start a secure session with the client.
- *   make_certificate() - Make a self-signed SSL/TLS certificate.
+ *   cupsdEndTLS()	   - Shutdown a secure session with the client.
+ *   cupsdStartTLS()	   - Start a secure session with the client.
+ *   get_credentials()     - Get the server credentials, loading them as
+ *                           needed.
+ *   make_certificate()    - Make a self-signed SSL/TLS certificate.
+ *   release_credentials() - Release a reference to server credentials.
+ *   session_remove()      - Remove a session from the session cache.
+ *   session_retrieve()    - Get a session from the session cache.
+ *   session_store()       - Add a session to the session cache.
+ *   update_ticket_key()   - Create or rotate the session ticket key.
  */
 
 
+/*
+ * Local constants...
+ */
+
+#define CUPSD_TLS_SESSIONS	256	/* Number of cached sessions */
+#define CUPSD_TLS_SESSION_LIFE	3600	/* Lifetime of cached sessions */
+#define CUPSD_TLS_TICKET_LIFE	3600	/* Lifetime of session ticket keys */
+
+
+/*
+ * Local structures...
+ */
+
+typedef struct cupsd_tls_creds_s	/**** Server credentials ****/
+{
+  gnutls_certificate_credentials_t creds;
+					/* Certificate and key */
+  int			refs;		/* Number of connections using them */
+  time_t		cert_mtime,	/* Modification time of certificate */
+			key_mtime;	/* Modification time of key */
+} cupsd_tls_creds_t;
+
+typedef struct cupsd_tls_session_s	/**** Cached session ****/
+{
+  unsigned char		id[64];		/* Session ID */
+  unsigned		idlen;		/* Length of session ID */
+  gnutls_datum_t	data;		/* Session data */
+  time_t		expires;	/* Expiration time */
+} cupsd_tls_session_t;
+
+
 /*
  * Local functions...
  */
 
+static cupsd_tls_creds_t *get_credentials(void);
 static int		make_certificate(cupsd_client_t *con);
+static void		release_credentials(cupsd_tls_creds_t *creds);
+static int		session_remove(void *ptr, gnutls_datum_t key);
+static gnutls_datum_t	session_retrieve(void *ptr, gnutls_datum_t key);
+static int		session_store(void *ptr, gnutls_datum_t key,
+			              gnutls_datum_t data);
+static void		update_ticket_key(void);
+
+
+/*
+ * Local globals...
+ */
+
+static cupsd_tls_creds_t *tls_creds = NULL;
+					/* Current server credentials */
+static cupsd_tls_session_t tls_sessions[CUPSD_TLS_SESSIONS];
+					/* Session cache */
+static gnutls_datum_t	tls_ticket_key = { NULL, 0 };
+					/* Session ticket key */
+static time_t		tls_ticket_time = 0;
+					/* Time ticket key was created */
 
 
 /*
@@ -35,12 +94,7 @@ int					/* O - 1 on success, 0 on error */
 cupsdEndTLS(cupsd_client_t *con)	/* I - Client connection */
 {
   int		error;			/* Error code */
-  gnutls_certificate_server_credentials *credentials;
-					/* TLS credentials */
-
 
-  credentials = (gnutls_certificate_server_credentials *)
-                    (con->http.tls_credentials);
 
   error = gnutls_bye(con->http.tls, GNUTLS_SHUT_WR);
   switch (error)
@@ -58,8 +112,8 @@ cupsdEndTLS(cupsd_client_t *con)	/* I - Client connection */
   gnutls_deinit(con->http.tls);
   con->http.tls = NULL;
 
-  gnutls_certificate_free_credentials(*credentials);
-  free(credentials);
+  release_credentials((cupsd_tls_creds_t *)con->http.tls_credentials);
+  con->http.tls_credentials = NULL;
 
   return (1);
 }
@@ -72,9 +126,8 @@ cupsdEndTLS(cupsd_client_t *con)	/* I - Client connection */
 int					/* O - 1 on success, 0 on error */
 cupsdStartTLS(cupsd_client_t *con)	/* I - Client connection */
 {
-  int		status;			/* Error code */
-  gnutls_certificate_server_credentials *credentials;
-					/* TLS credentials */
+  int			status;		/* Error code */
+  cupsd_tls_creds_t	*creds;		/* Server credentials */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG, "[Client %d] Encrypting connection.",
@@ -95,28 +148,29 @@ cupsdStartTLS(cupsd_client_t *con)	/* I - Client connection */
   }
 
  /*
-  * Create the SSL object and perform the SSL handshake...
+  * Create the SSL object and perform the SSL handshake.  The credentials are
+  * shared by all connections, and sessions can be resumed using the session
+  * cache or session tickets...
   */
 
-  credentials = (gnutls_certificate_server_credentials *)
-                    malloc(sizeof(gnutls_certificate_server_credentials));
-  if (credentials == NULL)
-  {
-    cupsdLogMessage(CUPSD_LOG_ERROR,
-                    "Unable to encrypt connection from %s - %s",
-                    con->http.hostname, strerror(errno));
-
+  if ((creds = get_credentials()) == NULL)
     return (0);
-  }
 
-  gnutls_certificate_allocate_credentials(credentials);
-  gnutls_certificate_set_x509_key_file(*credentials, ServerCertificate,
-				       ServerKey, GNUTLS_X509_FMT_PEM);
+  creds->refs ++;
+
+  update_ticket_key();
 
   gnutls_init(&con->http.tls, GNUTLS_SERVER);
   gnutls_set_default_priority(con->http.tls);
 
-  gnutls_credentials_set(con->http.tls, GNUTLS_CRD_CERTIFICATE, *credentials);
+  gnutls_credentials_set(con->http.tls, GNUTLS_CRD_CERTIFICATE, creds->creds);
+  gnutls_db_set_cache_expiration(con->http.tls, CUPSD_TLS_SESSION_LIFE);
+  gnutls_db_set_retrieve_function(con->http.tls, session_retrieve);
+  gnutls_db_set_remove_function(con->http.tls, session_remove);
+  gnutls_db_set_store_function(con->http.tls, session_store);
+  gnutls_db_set_ptr(con->http.tls, NULL);
+  if (tls_ticket_key.data)
+    gnutls_session_ticket_enable_server(con->http.tls, &tls_ticket_key);
   gnutls_transport_set_ptr(con->http.tls, (gnutls_transport_ptr)HTTP(con));
   gnutls_transport_set_pull_function(con->http.tls, _httpReadGNUTLS);
   gnutls_transport_set_push_function(con->http.tls, _httpWriteGNUTLS);
@@ -130,21 +184,95 @@ cupsdStartTLS(cupsd_client_t *con)	/* I - Client connection */
                       con->http.hostname, gnutls_strerror(status));
 
       gnutls_deinit(con->http.tls);
-      gnutls_certificate_free_credentials(*credentials);
       con->http.tls = NULL;
-      free(credentials);
+      release_credentials(creds);
       return (0);
     }
   }
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG, "Connection from %s now encrypted.",
-                  con->http.hostname);
+  TLSHandshakes ++;
+
+  if (gnutls_session_is_resumed(con->http.tls))
+  {
+    TLSResumed ++;
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+                    "Connection from %s now encrypted (resumed session).",
+		    con->http.hostname);
+  }
+  else
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Connection from %s now encrypted.",
+		    con->http.hostname);
 
-  con->http.tls_credentials = credentials;
+  con->http.tls_credentials = creds;
   return (1);
 }
 
 
+/*
+ * 'get_credentials()' - Get the server credentials, loading them as needed.
+ *
+ * The certificate and key are loaded again when either file changes.  Old
+ * credentials are kept until the last connection using them is closed.
+ */
+
+static cupsd_tls_creds_t *		/* O - Server credentials or NULL */
+get_credentials(void)
+{
+  cupsd_tls_creds_t	*creds;		/* New credentials */
+  struct stat		certinfo,	/* Certificate file information */
+			keyinfo;	/* Key file information */
+  int			status;		/* Status of GNU TLS calls */
+
+
+  if (stat(ServerCertificate, &certinfo) || stat(ServerKey, &keyinfo))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to access SSL server certificate or key - %s",
+		    strerror(errno));
+    return (NULL);
+  }
+
+  if (tls_creds && tls_creds->cert_mtime == certinfo.st_mtime &&
+      tls_creds->key_mtime == keyinfo.st_mtime)
+    return (tls_creds);
+
+  if ((creds = calloc(1, sizeof(cupsd_tls_creds_t))) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to allocate memory for SSL credentials - %s",
+		    strerror(errno));
+    return (NULL);
+  }
+
+  gnutls_certificate_allocate_credentials(&(creds->creds));
+
+  if ((status = gnutls_certificate_set_x509_key_file(creds->creds,
+                                                     ServerCertificate,
+						     ServerKey,
+						     GNUTLS_X509_FMT_PEM)) < 0)
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to load SSL server certificate \"%s\" - %s",
+		    ServerCertificate, gnutls_strerror(status));
+
+  creds->cert_mtime = certinfo.st_mtime;
+  creds->key_mtime  = keyinfo.st_mtime;
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Loaded SSL server certificate \"%s\".",
+                  ServerCertificate);
+
+  if (tls_creds && !tls_creds->refs)
+  {
+    gnutls_certificate_free_credentials(tls_creds->creds);
+    free(tls_creds);
+  }
+
+  tls_creds = creds;
+
+  return (creds);
+}
+
+
 /*
  * 'make_certificate()' - Make a self-signed SSL/TLS certificate.
  */
@@ -287,6 +415,184 @@ make_certificate(cupsd_client_t *con)	/* I - Client connection */
 }
 
 
+/*
+ * 'release_credentials()' - Release a reference to server credentials.
+ */
+
+static void
+release_credentials(
+    cupsd_tls_creds_t *creds)		/* I - Server credentials */
+{
+  if (!creds)
+    return;
+
+  creds->refs --;
+
+  if (creds != tls_creds && creds->refs <= 0)
+  {
+    gnutls_certificate_free_credentials(creds->creds);
+    free(creds);
+  }
+}
+
+
+/*
+ * 'session_remove()' - Remove a session from the session cache.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+session_remove(void           *ptr,	/* I - Callback data (unused) */
+               gnutls_datum_t key)	/* I - Session ID */
+{
+  int			i;		/* Looping var */
+  cupsd_tls_session_t	*session;	/* Current session */
+
+
+  (void)ptr;
+
+  for (i = CUPSD_TLS_SESSIONS, session = tls_sessions; i > 0; i --, session ++)
+    if (session->data.data && session->idlen == key.size &&
+        !memcmp(session->id, key.data, key.size))
+    {
+      gnutls_free(session->data.data);
+      memset(session, 0, sizeof(cupsd_tls_session_t));
+      return (0);
+    }
+
+  return (-1);
+}
+
+
+/*
+ * 'session_retrieve()' - Get a session from the session cache.
+ */
+
+static gnutls_datum_t			/* O - Copy of session data */
+session_retrieve(void           *ptr,	/* I - Callback data (unused) */
+                 gnutls_datum_t key)	/* I - Session ID */
+{
+  int			i;		/* Looping var */
+  cupsd_tls_session_t	*session;	/* Current session */
+  gnutls_datum_t	data = { NULL, 0 };
+					/* Session data */
+  time_t		curtime;	/* Current time */
+
+
+  (void)ptr;
+
+  curtime = time(NULL);
+
+  for (i = CUPSD_TLS_SESSIONS, session = tls_sessions; i > 0; i --, session ++)
+    if (session->data.data && session->expires > curtime &&
+        session->idlen == key.size && !memcmp(session->id, key.data, key.size))
+    {
+      if ((data.data = gnutls_malloc(session->data.size)) != NULL)
+      {
+        memcpy(data.data, session->data.data, session->data.size);
+	data.size = session->data.size;
+      }
+      break;
+    }
+
+  return (data);
+}
+
+
+/*
+ * 'session_store()' - Add a session to the session cache.
+ *
+ * When the cache is full the session that expires first is replaced.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+session_store(void           *ptr,	/* I - Callback data (unused) */
+              gnutls_datum_t key,	/* I - Session ID */
+	      gnutls_datum_t data)	/* I - Session data */
+{
+  int			i;		/* Looping var */
+  cupsd_tls_session_t	*session,	/* Current session */
+			*oldest;	/* Session to replace */
+
+
+  (void)ptr;
+
+  if (key.size > sizeof(session->id))
+    return (-1);
+
+  for (i = CUPSD_TLS_SESSIONS, session = tls_sessions, oldest = tls_sessions;
+       i > 0;
+       i --, session ++)
+  {
+    if (session->data.data && session->idlen == key.size &&
+        !memcmp(session->id, key.data, key.size))
+    {
+      oldest = session;
+      break;
+    }
+
+    if (session->expires < oldest->expires)
+      oldest = session;
+  }
+
+  if (oldest->data.data)
+    gnutls_free(oldest->data.data);
+
+  if ((oldest->data.data = gnutls_malloc(data.size)) == NULL)
+  {
+    memset(oldest, 0, sizeof(cupsd_tls_session_t));
+    return (-1);
+  }
+
+  memcpy(oldest->data.data, data.data, data.size);
+  memcpy(oldest->id, key.data, key.size);
+
+  oldest->data.size = data.size;
+  oldest->idlen     = key.size;
+  oldest->expires   = time(NULL) + CUPSD_TLS_SESSION_LIFE;
+
+  return (0);
+}
+
+
+/*
+ * 'update_ticket_key()' - Create or rotate the session ticket key.
+ */
+
+static void
+update_ticket_key(void)
+{
+  time_t	curtime;		/* Current time */
+
+
+  curtime = time(NULL);
+
+  if (tls_ticket_key.data &&
+      (curtime - tls_ticket_time) < CUPSD_TLS_TICKET_LIFE)
+    return;
+
+  if (tls_ticket_key.data)
+  {
+    memset(tls_ticket_key.data, 0, tls_ticket_key.size);
+    gnutls_free(tls_ticket_key.data);
+
+    tls_ticket_key.data = NULL;
+    tls_ticket_key.size = 0;
+  }
+
+  if (gnutls_session_ticket_key_generate(&tls_ticket_key))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create session ticket key.");
+
+    tls_ticket_key.data = NULL;
+    tls_ticket_key.size = 0;
+  }
+  else
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Created new session ticket key.");
+
+  tls_ticket_time = curtime;
+}
+
+
 /*
  * End of "$Id: tls-gnutls.c 10374 2012-03-22 20:30:20Z mike $".
  */
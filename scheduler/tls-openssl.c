@@ -14,17 +14,45 @@
  *
  * Contents:
  *
- *   cupsdEndTLS()	- Shutdown a secure session with the client.
- *   cupsdStartTLS()	- Start a secure session with the client.
- *   make_certificate() - Make a self-signed SSL/TLS certificate.
+ *   cupsdEndTLS()	   - Shutdown a secure session with the client.
+ *   cupsdStartTLS()	   - Start a secure session with the client.
+ *   get_context()	   - Get the shared server context, creating it as
+ *                           needed.
+ *   make_certificate()    - Make a self-signed SSL/TLS certificate.
+ *   update_ticket_key()   - Create or rotate the session ticket keys.
  */
 
 
+/*
+ * Local constants...
+ */
+
+#define CUPSD_TLS_SESSIONS	256	/* Number of cached sessions */
+#define CUPSD_TLS_SESSION_LIFE	3600	/* Lifetime of cached sessions */
+#define CUPSD_TLS_TICKET_LIFE	3600	/* Lifetime of session ticket keys */
+
+
 /*
  * Local functions...
  */
 
+static SSL_CTX		*get_context(void);
 static int		make_certificate(cupsd_client_t *con);
+static void		update_ticket_key(void);
+
+
+/*
+ * Local globals...
+ */
+
+static SSL_CTX		*tls_context = NULL;
+					/* Shared server context */
+static time_t		tls_cert_mtime = 0,
+					/* Modification time of certificate */
+			tls_key_mtime = 0,
+					/* Modification time of key */
+			tls_ticket_time = 0;
+					/* Time ticket keys were created */
 
 
 /*
@@ -34,13 +62,10 @@ static int		make_certificate(cupsd_client_t *con);
 int					/* O - 1 on success, 0 on error */
 cupsdEndTLS(cupsd_client_t *con)	/* I - Client connection */
 {
-  SSL_CTX	*context;		/* Context for encryption */
   unsigned long	error;			/* Error code */
   int		status;			/* Return status */
 
 
-  context = SSL_get_SSL_CTX(con->http.tls);
-
   switch (SSL_shutdown(con->http.tls))
   {
     case 1 :
@@ -61,7 +86,6 @@ cupsdEndTLS(cupsd_client_t *con)	/* I - Client connection */
 	break;
   }
 
-  SSL_CTX_free(context);
   SSL_free(con->http.tls);
   con->http.tls = NULL;
 
@@ -99,16 +123,14 @@ cupsdStartTLS(cupsd_client_t *con)	/* I - Client connection */
   }
 
  /*
-  * Create the SSL context and accept the connection...
+  * Get the shared SSL context and accept the connection.  Sessions can be
+  * resumed using the context's session cache or session tickets...
   */
 
-  context = SSL_CTX_new(SSLv23_server_method());
+  if ((context = get_context()) == NULL)
+    return (0);
 
-  SSL_CTX_set_options(context, SSL_OP_NO_SSLv2); /* Only use SSLv3 or TLS */
-  if (SSLOptions & CUPSD_SSL_NOEMPTY)
-    SSL_CTX_set_options(context, SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS);
-  SSL_CTX_use_PrivateKey_file(context, ServerKey, SSL_FILETYPE_PEM);
-  SSL_CTX_use_certificate_chain_file(context, ServerCertificate);
+  update_ticket_key();
 
   bio = BIO_new(_httpBIOMethods());
   BIO_ctrl(bio, BIO_C_SET_FILE_PTR, 0, (char *)HTTP(con));
@@ -124,19 +146,91 @@ cupsdStartTLS(cupsd_client_t *con)	/* I - Client connection */
     while ((error = ERR_get_error()) != 0)
       cupsdLogMessage(CUPSD_LOG_ERROR, "%s", ERR_error_string(error, NULL));
 
-    SSL_CTX_free(context);
     SSL_free(con->http.tls);
     con->http.tls = NULL;
     return (0);
   }
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG, "Connection from %s now encrypted.",
-                  con->http.hostname);
+  TLSHandshakes ++;
+
+  if (SSL_session_reused(con->http.tls))
+  {
+    TLSResumed ++;
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG,
+                    "Connection from %s now encrypted (resumed session).",
+		    con->http.hostname);
+  }
+  else
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Connection from %s now encrypted.",
+		    con->http.hostname);
 
   return (1);
 }
 
 
+/*
+ * 'get_context()' - Get the shared server context, creating it as needed.
+ *
+ * A new context is created when the certificate or key changes.  Each SSL
+ * object holds a reference to its context, so existing connections keep
+ * using the old one until they are closed.
+ */
+
+static SSL_CTX *			/* O - Server context or NULL */
+get_context(void)
+{
+  SSL_CTX	*context;		/* New context */
+  struct stat	certinfo,		/* Certificate file information */
+		keyinfo;		/* Key file information */
+  static const unsigned char sid_ctx[] = "cupsd";
+					/* Session ID context */
+
+
+  if (stat(ServerCertificate, &certinfo) || stat(ServerKey, &keyinfo))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to access SSL server certificate or key - %s",
+		    strerror(errno));
+    return (NULL);
+  }
+
+  if (tls_context && tls_cert_mtime == certinfo.st_mtime &&
+      tls_key_mtime == keyinfo.st_mtime)
+    return (tls_context);
+
+  if ((context = SSL_CTX_new(SSLv23_server_method())) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create SSL context.");
+    return (NULL);
+  }
+
+  SSL_CTX_set_options(context, SSL_OP_NO_SSLv2); /* Only use SSLv3 or TLS */
+  if (SSLOptions & CUPSD_SSL_NOEMPTY)
+    SSL_CTX_set_options(context, SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS);
+  SSL_CTX_use_PrivateKey_file(context, ServerKey, SSL_FILETYPE_PEM);
+  SSL_CTX_use_certificate_chain_file(context, ServerCertificate);
+
+  SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER);
+  SSL_CTX_set_session_id_context(context, sid_ctx, sizeof(sid_ctx) - 1);
+  SSL_CTX_sess_set_cache_size(context, CUPSD_TLS_SESSIONS);
+  SSL_CTX_set_timeout(context, CUPSD_TLS_SESSION_LIFE);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Loaded SSL server certificate \"%s\".",
+                  ServerCertificate);
+
+  if (tls_context)
+    SSL_CTX_free(tls_context);
+
+  tls_context     = context;
+  tls_cert_mtime  = certinfo.st_mtime;
+  tls_key_mtime   = keyinfo.st_mtime;
+  tls_ticket_time = 0;
+
+  return (context);
+}
+
+
 /*
  * 'make_certificate()' - Make a self-signed SSL/TLS certificate.
  */
@@ -348,6 +442,36 @@ make_certificate(cupsd_client_t *con)	/* I - Client connection */
 }
 
 
+/*
+ * 'update_ticket_key()' - Create or rotate the session ticket keys.
+ */
+
+static void
+update_ticket_key(void)
+{
+#ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEYS
+  time_t	curtime;		/* Current time */
+  unsigned char	keys[48];		/* Key name, HMAC and AES keys */
+
+
+  curtime = time(NULL);
+
+  if (tls_ticket_time && (curtime - tls_ticket_time) < CUPSD_TLS_TICKET_LIFE)
+    return;
+
+  if (RAND_bytes(keys, sizeof(keys)) != 1 ||
+      SSL_CTX_set_tlsext_ticket_keys(tls_context, keys, sizeof(keys)) != 1)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create session ticket keys.");
+  else
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Created new session ticket keys.");
+
+  memset(keys, 0, sizeof(keys));
+
+  tls_ticket_time = curtime;
+#endif /* SSL_CTRL_SET_TLSEXT_TICKET_KEYS */
+}
+
+
 /*
  * End of "$Id: tls-openssl.c 10374 2012-03-22 20:30:20Z mike $".
  */
@@ -818,10 +818,7 @@ create_job(_ipp_client_t *client)	/* I - Client */
 
   if ((attr = ippFindAttribute(job->attrs, "requesting-user-name",
                                IPP_TAG_NAME)) != NULL)
-  {
-    _cupsStrFree(attr->name);
-    attr->name = _cupsStrAlloc("job-originating-user-name");
-  }
+    ippSetName(job->attrs, &attr, "job-originating-user-name");
   else
     attr = ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_NAME | IPP_TAG_COPY,
                         "job-originating-user-name", NULL, "anonymous");
@@ -1932,6 +1929,7 @@ delete_client(_ipp_client_t *client)	/* I - Client */
 
   httpClearCookie(&(client->http));
   httpClearFields(&(client->http));
+  _httpFreeBuffers(&(client->http));
 
   ippDelete(client->request);
 
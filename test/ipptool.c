@@ -1146,7 +1146,7 @@ do_tests(_cups_vars_t *vars,		/* I - Variables */
     strlcpy(resource, vars->resource, sizeof(resource));
 
     request_id ++;
-    request       = ippNew();
+    request       = ippNewWithArena();
     op            = (ipp_op_t)0;
     group         = IPP_TAG_ZERO;
     ignore_errors = IgnoreErrors;
@@ -1204,38 +1204,19 @@ do_tests(_cups_vars_t *vars,		/* I - Variables */
 
 	if (col)
 	{
-	  ipp_attribute_t *tempcol;	/* Pointer to new buffer */
-
-
 	 /*
-	  * Reallocate memory...
+	  * Append the value; ippSetCollection() takes its own reference...
 	  */
 
-	  if ((tempcol = realloc(lastcol, sizeof(ipp_attribute_t) +
-				          (lastcol->num_values + 1) *
-				          sizeof(_ipp_value_t))) == NULL)
+	  if (!ippSetCollection(request, &lastcol, ippGetCount(lastcol), col))
 	  {
+	    ippDelete(col);
 	    print_fatal_error("Unable to allocate memory on line %d.", linenum);
 	    pass = 0;
 	    goto test_exit;
 	  }
 
-	  if (tempcol != lastcol)
-	  {
-	   /*
-	    * Reset pointers in the list...
-	    */
-
-	    if (request->prev)
-	      request->prev->next = tempcol;
-	    else
-	      request->attrs = tempcol;
-
-	    lastcol = request->current = request->last = tempcol;
-	  }
-
-	  lastcol->values[lastcol->num_values].collection = col;
-	  lastcol->num_values ++;
+	  ippDelete(col);
 	}
 	else
 	{
@@ -3271,37 +3252,18 @@ get_collection(_cups_vars_t *vars,	/* I  - Variables */
 
       if (subcol)
       {
-	ipp_attribute_t	*tempcol;	/* Pointer to new buffer */
-
-
        /*
-	* Reallocate memory...
+	* Append the value; ippSetCollection() takes its own reference...
 	*/
 
-	if ((tempcol = realloc(lastcol, sizeof(ipp_attribute_t) +
-				        (lastcol->num_values + 1) *
-					sizeof(_ipp_value_t))) == NULL)
+	if (!ippSetCollection(col, &lastcol, ippGetCount(lastcol), subcol))
 	{
+	  ippDelete(subcol);
 	  print_fatal_error("Unable to allocate memory on line %d.", *linenum);
 	  goto col_error;
 	}
 
-	if (tempcol != lastcol)
-	{
-	 /*
-	  * Reset pointers in the list...
-	  */
-
-	  if (col->prev)
-	    col->prev->next = tempcol;
-	  else
-	    col->attrs = tempcol;
-
-	  lastcol = col->current = col->last = tempcol;
-	}
-
-	lastcol->values[lastcol->num_values].collection = subcol;
-	lastcol->num_values ++;
+	ippDelete(subcol);
       }
       else
 	goto col_error;